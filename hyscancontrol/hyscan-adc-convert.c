@@ -0,0 +1,486 @@
+/*
+ * \file hyscan-adc-convert.c
+ *
+ * \brief Исходный файл функций преобразования отсчётов АЦП
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-adc-convert.h"
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+#define HYSCAN_ADC_CONVERT_X86
+#endif
+
+#ifdef HYSCAN_ADC_CONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/* Наборы инструкций для отдельных функций. Компилятор MSVC допускает
+ * использование любых инструкций без дополнительных атрибутов. */
+#if defined (__GNUC__) || defined (__clang__)
+#define HYSCAN_ADC_CONVERT_SSE2                __attribute__ ((target ("sse2")))
+#define HYSCAN_ADC_CONVERT_AVX2                __attribute__ ((target ("avx2")))
+#else
+#define HYSCAN_ADC_CONVERT_SSE2
+#define HYSCAN_ADC_CONVERT_AVX2
+#endif
+
+/* Функция преобразования отсчётов. Отсчёты считываются по маске из 16 или
+ * 32 битных слов в формате little endian. */
+typedef void (*HyScanAdcConvertFunc)                           (const guint8          *src,
+                                                                gfloat                *dst,
+                                                                guint32                n_values,
+                                                                guint32                mask,
+                                                                gint32                 offset,
+                                                                gfloat                 scale);
+
+/* Функция поэлементного умножения значений на коэффициенты. */
+typedef void (*HyScanAdcMultiplyFunc)                          (gfloat                *values,
+                                                                const gfloat          *factors,
+                                                                guint32                n_values);
+
+/* Набор функций преобразования. */
+typedef struct
+{
+  const gchar                 *name;                           /* Название набора инструкций. */
+  HyScanAdcConvertFunc         convert16;                      /* Преобразование 16 битных отсчётов. */
+  HyScanAdcConvertFunc         convert32;                      /* Преобразование 32 битных отсчётов. */
+  HyScanAdcMultiplyFunc        multiply;                       /* Умножение на коэффициенты. */
+} HyScanAdcConvertKernels;
+
+/* Функция преобразования 16 битных отсчётов без векторных инструкций. */
+static void
+hyscan_adc_convert16_generic (const guint8 *src,
+                              gfloat       *dst,
+                              guint32       n_values,
+                              guint32       mask,
+                              gint32        offset,
+                              gfloat        scale)
+{
+  guint32 i;
+
+  for (i = 0; i < n_values; i++)
+    {
+      guint32 code = src[2 * i] | ((guint32)src[2 * i + 1] << 8);
+
+      dst[i] = (gfloat)((gint32)(code & mask) - offset) * scale;
+    }
+}
+
+/* Функция преобразования 32 битных отсчётов без векторных инструкций. */
+static void
+hyscan_adc_convert32_generic (const guint8 *src,
+                              gfloat       *dst,
+                              guint32       n_values,
+                              guint32       mask,
+                              gint32        offset,
+                              gfloat        scale)
+{
+  guint32 i;
+
+  for (i = 0; i < n_values; i++)
+    {
+      guint32 code = src[4 * i] |
+                     ((guint32)src[4 * i + 1] << 8) |
+                     ((guint32)src[4 * i + 2] << 16) |
+                     ((guint32)src[4 * i + 3] << 24);
+
+      dst[i] = (gfloat)((gint32)(code & mask) - offset) * scale;
+    }
+}
+
+/* Функция умножения на коэффициенты без векторных инструкций. */
+static void
+hyscan_adc_multiply_generic (gfloat       *values,
+                             const gfloat *factors,
+                             guint32       n_values)
+{
+  guint32 i;
+
+  for (i = 0; i < n_values; i++)
+    values[i] *= factors[i];
+}
+
+static const HyScanAdcConvertKernels hyscan_adc_convert_generic =
+{
+  "generic",
+  hyscan_adc_convert16_generic,
+  hyscan_adc_convert32_generic,
+  hyscan_adc_multiply_generic
+};
+
+#ifdef HYSCAN_ADC_CONVERT_X86
+
+/* Функция преобразования 16 битных отсчётов с использованием инструкций SSE2. */
+HYSCAN_ADC_CONVERT_SSE2 static void
+hyscan_adc_convert16_sse2 (const guint8 *src,
+                           gfloat       *dst,
+                           guint32       n_values,
+                           guint32       mask,
+                           gint32        offset,
+                           gfloat        scale)
+{
+  const __m128i vmask = _mm_set1_epi16 ((gint16)mask);
+  const __m128i voffset = _mm_set1_epi32 (offset);
+  const __m128 vscale = _mm_set1_ps (scale);
+  const __m128i zero = _mm_setzero_si128 ();
+  guint32 i;
+
+  for (i = 0; i + 8 <= n_values; i += 8)
+    {
+      __m128i codes = _mm_and_si128 (_mm_loadu_si128 ((const __m128i *)(src + 2 * i)), vmask);
+      __m128i low = _mm_sub_epi32 (_mm_unpacklo_epi16 (codes, zero), voffset);
+      __m128i high = _mm_sub_epi32 (_mm_unpackhi_epi16 (codes, zero), voffset);
+
+      _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (low), vscale));
+      _mm_storeu_ps (dst + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (high), vscale));
+    }
+
+  hyscan_adc_convert16_generic (src + 2 * i, dst + i, n_values - i, mask, offset, scale);
+}
+
+/* Функция преобразования 32 битных отсчётов с использованием инструкций SSE2. */
+HYSCAN_ADC_CONVERT_SSE2 static void
+hyscan_adc_convert32_sse2 (const guint8 *src,
+                           gfloat       *dst,
+                           guint32       n_values,
+                           guint32       mask,
+                           gint32        offset,
+                           gfloat        scale)
+{
+  const __m128i vmask = _mm_set1_epi32 ((gint32)mask);
+  const __m128i voffset = _mm_set1_epi32 (offset);
+  const __m128 vscale = _mm_set1_ps (scale);
+  guint32 i;
+
+  for (i = 0; i + 4 <= n_values; i += 4)
+    {
+      __m128i codes = _mm_and_si128 (_mm_loadu_si128 ((const __m128i *)(src + 4 * i)), vmask);
+
+      _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (_mm_sub_epi32 (codes, voffset)), vscale));
+    }
+
+  hyscan_adc_convert32_generic (src + 4 * i, dst + i, n_values - i, mask, offset, scale);
+}
+
+/* Функция преобразования 16 битных отсчётов с использованием инструкций AVX2. */
+HYSCAN_ADC_CONVERT_AVX2 static void
+hyscan_adc_convert16_avx2 (const guint8 *src,
+                           gfloat       *dst,
+                           guint32       n_values,
+                           guint32       mask,
+                           gint32        offset,
+                           gfloat        scale)
+{
+  const __m256i vmask = _mm256_set1_epi32 ((gint32)mask);
+  const __m256i voffset = _mm256_set1_epi32 (offset);
+  const __m256 vscale = _mm256_set1_ps (scale);
+  guint32 i;
+
+  for (i = 0; i + 16 <= n_values; i += 16)
+    {
+      __m256i low = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *)(src + 2 * i)));
+      __m256i high = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i *)(src + 2 * i + 16)));
+
+      low = _mm256_sub_epi32 (_mm256_and_si256 (low, vmask), voffset);
+      high = _mm256_sub_epi32 (_mm256_and_si256 (high, vmask), voffset);
+
+      _mm256_storeu_ps (dst + i, _mm256_mul_ps (_mm256_cvtepi32_ps (low), vscale));
+      _mm256_storeu_ps (dst + i + 8, _mm256_mul_ps (_mm256_cvtepi32_ps (high), vscale));
+    }
+
+  hyscan_adc_convert16_generic (src + 2 * i, dst + i, n_values - i, mask, offset, scale);
+}
+
+/* Функция преобразования 32 битных отсчётов с использованием инструкций AVX2. */
+HYSCAN_ADC_CONVERT_AVX2 static void
+hyscan_adc_convert32_avx2 (const guint8 *src,
+                           gfloat       *dst,
+                           guint32       n_values,
+                           guint32       mask,
+                           gint32        offset,
+                           gfloat        scale)
+{
+  const __m256i vmask = _mm256_set1_epi32 ((gint32)mask);
+  const __m256i voffset = _mm256_set1_epi32 (offset);
+  const __m256 vscale = _mm256_set1_ps (scale);
+  guint32 i;
+
+  for (i = 0; i + 8 <= n_values; i += 8)
+    {
+      __m256i codes = _mm256_and_si256 (_mm256_loadu_si256 ((const __m256i *)(src + 4 * i)), vmask);
+
+      _mm256_storeu_ps (dst + i, _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_sub_epi32 (codes, voffset)), vscale));
+    }
+
+  hyscan_adc_convert32_generic (src + 4 * i, dst + i, n_values - i, mask, offset, scale);
+}
+
+/* Функция умножения на коэффициенты с использованием инструкций SSE2. */
+HYSCAN_ADC_CONVERT_SSE2 static void
+hyscan_adc_multiply_sse2 (gfloat       *values,
+                          const gfloat *factors,
+                          guint32       n_values)
+{
+  guint32 i;
+
+  for (i = 0; i + 4 <= n_values; i += 4)
+    _mm_storeu_ps (values + i, _mm_mul_ps (_mm_loadu_ps (values + i), _mm_loadu_ps (factors + i)));
+
+  hyscan_adc_multiply_generic (values + i, factors + i, n_values - i);
+}
+
+/* Функция умножения на коэффициенты с использованием инструкций AVX2. */
+HYSCAN_ADC_CONVERT_AVX2 static void
+hyscan_adc_multiply_avx2 (gfloat       *values,
+                          const gfloat *factors,
+                          guint32       n_values)
+{
+  guint32 i;
+
+  for (i = 0; i + 8 <= n_values; i += 8)
+    _mm256_storeu_ps (values + i, _mm256_mul_ps (_mm256_loadu_ps (values + i), _mm256_loadu_ps (factors + i)));
+
+  hyscan_adc_multiply_generic (values + i, factors + i, n_values - i);
+}
+
+static const HyScanAdcConvertKernels hyscan_adc_convert_sse2 =
+{
+  "sse2",
+  hyscan_adc_convert16_sse2,
+  hyscan_adc_convert32_sse2,
+  hyscan_adc_multiply_sse2
+};
+
+static const HyScanAdcConvertKernels hyscan_adc_convert_avx2 =
+{
+  "avx2",
+  hyscan_adc_convert16_avx2,
+  hyscan_adc_convert32_avx2,
+  hyscan_adc_multiply_avx2
+};
+
+/* Функция определяет наличие инструкций SSE2 и AVX2. */
+static void
+hyscan_adc_convert_check_cpu (gboolean *sse2,
+                              gboolean *avx2)
+{
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuid (info, 0);
+  if (info[0] < 7)
+    {
+      __cpuid (info, 1);
+      *sse2 = (info[3] & (1 << 26)) != 0;
+      *avx2 = FALSE;
+      return;
+    }
+
+  __cpuid (info, 1);
+  *sse2 = (info[3] & (1 << 26)) != 0;
+  *avx2 = ((info[2] & (1 << 27)) != 0) &&                  /* OSXSAVE. */
+          ((info[2] & (1 << 28)) != 0) &&                  /* AVX. */
+          ((_xgetbv (0) & 0x6) == 0x6);                    /* Сохранение регистров YMM. */
+
+  __cpuidex (info, 7, 0);
+  *avx2 = *avx2 && ((info[1] & (1 << 5)) != 0);
+#else
+  __builtin_cpu_init ();
+  *sse2 = __builtin_cpu_supports ("sse2");
+  *avx2 = __builtin_cpu_supports ("avx2");
+#endif
+}
+
+#endif /* HYSCAN_ADC_CONVERT_X86 */
+
+/* Функция выбирает набор функций преобразования при первом вызове. */
+static const HyScanAdcConvertKernels *
+hyscan_adc_convert_get_kernels (void)
+{
+  static gsize kernels = 0;
+
+  if (g_once_init_enter (&kernels))
+    {
+      const HyScanAdcConvertKernels *selected = &hyscan_adc_convert_generic;
+
+#ifdef HYSCAN_ADC_CONVERT_X86
+      gboolean sse2;
+      gboolean avx2;
+
+      hyscan_adc_convert_check_cpu (&sse2, &avx2);
+      if (avx2)
+        selected = &hyscan_adc_convert_avx2;
+      else if (sse2)
+        selected = &hyscan_adc_convert_sse2;
+#endif
+
+      g_once_init_leave (&kernels, (gsize)selected);
+    }
+
+  return (const HyScanAdcConvertKernels *)kernels;
+}
+
+/* Функция возвращает тип данных после преобразования. */
+HyScanDataType
+hyscan_adc_convert_get_type (HyScanDataType type)
+{
+  switch (type)
+    {
+    case HYSCAN_DATA_ADC_14LE:
+    case HYSCAN_DATA_ADC_16LE:
+    case HYSCAN_DATA_ADC_24LE:
+    case HYSCAN_DATA_FLOAT:
+      return HYSCAN_DATA_FLOAT;
+
+    case HYSCAN_DATA_COMPLEX_ADC_14LE:
+    case HYSCAN_DATA_COMPLEX_ADC_16LE:
+    case HYSCAN_DATA_COMPLEX_ADC_24LE:
+    case HYSCAN_DATA_COMPLEX_FLOAT:
+      return HYSCAN_DATA_COMPLEX_FLOAT;
+
+    default:
+      break;
+    }
+
+  return HYSCAN_DATA_INVALID;
+}
+
+/* Функция возвращает число значений после преобразования. */
+guint32
+hyscan_adc_convert_get_n_values (HyScanDataType type,
+                                 guint32        size)
+{
+  switch (type)
+    {
+    case HYSCAN_DATA_ADC_14LE:
+    case HYSCAN_DATA_ADC_16LE:
+      return size / sizeof (guint16);
+
+    case HYSCAN_DATA_COMPLEX_ADC_14LE:
+    case HYSCAN_DATA_COMPLEX_ADC_16LE:
+      return 2 * (size / (2 * sizeof (guint16)));
+
+    case HYSCAN_DATA_ADC_24LE:
+      return size / sizeof (guint32);
+
+    case HYSCAN_DATA_COMPLEX_ADC_24LE:
+      return 2 * (size / (2 * sizeof (guint32)));
+
+    default:
+      break;
+    }
+
+  return 0;
+}
+
+/* Функция преобразовывает данные. */
+guint32
+hyscan_adc_convert (HyScanDataType  type,
+                    gint            offset,
+                    gdouble         vref,
+                    gconstpointer   data,
+                    guint32         size,
+                    gfloat         *values)
+{
+  const HyScanAdcConvertKernels *kernels = hyscan_adc_convert_get_kernels ();
+  guint32 n_values = hyscan_adc_convert_get_n_values (type, size);
+  guint32 mask;
+
+  switch (type)
+    {
+    case HYSCAN_DATA_ADC_14LE:
+    case HYSCAN_DATA_COMPLEX_ADC_14LE:
+      mask = 0x3FFF;
+      kernels->convert16 (data, values, n_values, mask, offset, vref / mask);
+      break;
+
+    case HYSCAN_DATA_ADC_16LE:
+    case HYSCAN_DATA_COMPLEX_ADC_16LE:
+      mask = 0xFFFF;
+      kernels->convert16 (data, values, n_values, mask, offset, vref / mask);
+      break;
+
+    case HYSCAN_DATA_ADC_24LE:
+    case HYSCAN_DATA_COMPLEX_ADC_24LE:
+      mask = 0xFFFFFF;
+      kernels->convert32 (data, values, n_values, mask, offset, vref / mask);
+      break;
+
+    default:
+      return 0;
+    }
+
+  return n_values;
+}
+
+/* Функция возвращает число отсчётов АЦП, достигших границ шкалы. */
+guint32
+hyscan_adc_convert_count_saturated (HyScanDataType type,
+                                    gconstpointer  data,
+                                    guint32        size)
+{
+  const guint8 *src = data;
+  guint32 n_saturated = 0;
+  guint32 n_values;
+  guint32 mask;
+  guint32 i;
+
+  n_values = hyscan_adc_convert_get_n_values (type, size);
+
+  switch (type)
+    {
+    case HYSCAN_DATA_ADC_14LE:
+    case HYSCAN_DATA_COMPLEX_ADC_14LE:
+    case HYSCAN_DATA_ADC_16LE:
+    case HYSCAN_DATA_COMPLEX_ADC_16LE:
+      mask = ((type == HYSCAN_DATA_ADC_14LE) || (type == HYSCAN_DATA_COMPLEX_ADC_14LE)) ? 0x3FFF : 0xFFFF;
+      for (i = 0; i < n_values; i++)
+        {
+          guint32 code = (src[2 * i] | ((guint32)src[2 * i + 1] << 8)) & mask;
+
+          if ((code == 0) || (code == mask))
+            n_saturated += 1;
+        }
+      break;
+
+    case HYSCAN_DATA_ADC_24LE:
+    case HYSCAN_DATA_COMPLEX_ADC_24LE:
+      mask = 0xFFFFFF;
+      for (i = 0; i < n_values; i++)
+        {
+          guint32 code = (src[4 * i] | ((guint32)src[4 * i + 1] << 8) | ((guint32)src[4 * i + 2] << 16)) & mask;
+
+          if ((code == 0) || (code == mask))
+            n_saturated += 1;
+        }
+      break;
+
+    default:
+      break;
+    }
+
+  return n_saturated;
+}
+
+/* Функция умножает значения на коэффициенты. */
+void
+hyscan_adc_convert_multiply (gfloat       *values,
+                             const gfloat *factors,
+                             guint32       n_values)
+{
+  hyscan_adc_convert_get_kernels ()->multiply (values, factors, n_values);
+}
+
+/* Функция возвращает название используемого набора инструкций. */
+const gchar *
+hyscan_adc_convert_get_kernel (void)
+{
+  return hyscan_adc_convert_get_kernels ()->name;
+}
@@ -0,0 +1,68 @@
+/*
+ * \file hyscan-adc-convert.h
+ *
+ * \brief Заголовочный файл функций преобразования отсчётов АЦП
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * Функции преобразуют "сырые" данные в форматах HYSCAN_DATA_ADC_* и HYSCAN_DATA_COMPLEX_ADC_*
+ * в действительные (HYSCAN_DATA_FLOAT) или комплексные (HYSCAN_DATA_COMPLEX_FLOAT) числа.
+ *
+ * Отсчёт АЦП переводится в напряжение по формуле:
+ *
+ * value = (code - offset) * vref / max_code,
+ *
+ * где code - код отсчёта, offset - смещение нуля АЦП, vref - опорное напряжение АЦП,
+ * max_code - максимальный код АЦП (2^14 - 1, 2^16 - 1 или 2^24 - 1). Отсчёты форматов
+ * ADC_14LE и ADC_16LE занимают 16 бит, отсчёты формата ADC_24LE - 32 бита. Комплексные
+ * отсчёты состоят из пары значений: действительной и мнимой частей.
+ *
+ * Также реализовано поэлементное умножение значений на коэффициенты, используемое
+ * для коррекции данных.
+ *
+ * На процессорах x86 преобразование выполняется с использованием инструкций SSE2 или AVX2.
+ * Доступные инструкции определяются при первом вызове.
+ *
+ */
+
+#ifndef __HYSCAN_ADC_CONVERT_H__
+#define __HYSCAN_ADC_CONVERT_H__
+
+#include <hyscan-core-types.h>
+
+/* Функция возвращает тип данных после преобразования или HYSCAN_DATA_INVALID,
+ * если данные не могут быть преобразованы. Для данных HYSCAN_DATA_FLOAT и
+ * HYSCAN_DATA_COMPLEX_FLOAT возвращается исходный тип. */
+HyScanDataType         hyscan_adc_convert_get_type             (HyScanDataType         type);
+
+/* Функция возвращает число значений типа gfloat после преобразования данных
+ * размером size байт. */
+guint32                hyscan_adc_convert_get_n_values         (HyScanDataType         type,
+                                                                guint32                size);
+
+/* Функция преобразовывает данные размером size байт. Буфер values должен
+ * вмещать hyscan_adc_convert_get_n_values значений. Функция возвращает число
+ * записанных значений. */
+guint32                hyscan_adc_convert                      (HyScanDataType         type,
+                                                                gint                   offset,
+                                                                gdouble                vref,
+                                                                gconstpointer          data,
+                                                                guint32                size,
+                                                                gfloat                *values);
+
+/* Функция возвращает число отсчётов АЦП, достигших границ шкалы. Для данных
+ * в формате с плавающей точкой функция возвращает 0. */
+guint32                hyscan_adc_convert_count_saturated      (HyScanDataType         type,
+                                                                gconstpointer          data,
+                                                                guint32                size);
+
+/* Функция поэлементно умножает n_values значений на коэффициенты. */
+void                   hyscan_adc_convert_multiply             (gfloat                *values,
+                                                                const gfloat          *factors,
+                                                                guint32                n_values);
+
+/* Функция возвращает название используемого набора инструкций. */
+const gchar           *hyscan_adc_convert_get_kernel           (void);
+
+#endif /* __HYSCAN_ADC_CONVERT_H__ */
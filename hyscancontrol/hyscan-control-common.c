@@ -10,6 +10,9 @@
 
 #include "hyscan-control-common.h"
 
+/* Максимальное число параметров, считываемых одним запросом. */
+#define HYSCAN_CONTROL_MAX_PARAMS              256
+
 /* Функция возвращает название борта гидролокатора по его идентификатору. */
 const gchar *
 hyscan_control_get_source_name (HyScanSourceType source)
@@ -167,3 +170,116 @@ hyscan_control_find_string_param (const gchar         *name,
 
   return NULL;
 }
+
+/* Функция проверяет наличие параметра prefix/key в схеме. */
+gboolean
+hyscan_control_has_param (HyScanDataSchema *schema,
+                          const gchar      *prefix,
+                          const gchar      *key)
+{
+  gchar *name = g_strconcat (prefix, key, NULL);
+  gboolean has_key;
+
+  has_key = hyscan_data_schema_has_key (schema, name);
+  g_free (name);
+
+  return has_key;
+}
+
+/* Функция добавляет в список название параметра prefix/key, если он есть в схеме.
+ * Проверка выполняется по схеме и не требует обращения к гидролокатору. */
+void
+hyscan_control_add_param (GPtrArray        *names,
+                          HyScanDataSchema *schema,
+                          const gchar      *prefix,
+                          const gchar      *key)
+{
+  gchar *name = g_strconcat (prefix, key, NULL);
+
+  if (hyscan_data_schema_has_key (schema, name))
+    g_ptr_array_add (names, name);
+  else
+    g_free (name);
+}
+
+/* Функция считывает значения параметров из списка. Параметры считываются одним
+ * запросом или, для длинных списков, запросами по HYSCAN_CONTROL_MAX_PARAMS
+ * параметров. */
+GHashTable *
+hyscan_control_get_params (HyScanParam *param,
+                           GPtrArray   *names)
+{
+  const gchar *chunk_names[HYSCAN_CONTROL_MAX_PARAMS + 1];
+  GVariant *chunk_values[HYSCAN_CONTROL_MAX_PARAMS + 1];
+  GHashTable *params;
+  guint i, j;
+
+  params = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+
+  for (i = 0; i < names->len; i += HYSCAN_CONTROL_MAX_PARAMS)
+    {
+      guint n_names = MIN (names->len - i, HYSCAN_CONTROL_MAX_PARAMS);
+
+      for (j = 0; j < n_names; j++)
+        chunk_names[j] = g_ptr_array_index (names, i + j);
+      chunk_names[n_names] = NULL;
+
+      if (!hyscan_param_get (param, chunk_names, chunk_values))
+        {
+          g_hash_table_unref (params);
+          return NULL;
+        }
+
+      for (j = 0; j < n_names; j++)
+        {
+          if (chunk_values[j] != NULL)
+            g_hash_table_insert (params, g_strdup (chunk_names[j]), chunk_values[j]);
+        }
+    }
+
+  return params;
+}
+
+/* Функция ищет integer параметр prefix/key в таблице и считывает его значение. */
+gboolean
+hyscan_control_lookup_integer_param (GHashTable  *params,
+                                     const gchar *prefix,
+                                     const gchar *key,
+                                     gint64      *value)
+{
+  GVariant *variant;
+  gchar *name;
+
+  name = g_strconcat (prefix, key, NULL);
+  variant = g_hash_table_lookup (params, name);
+  g_free (name);
+
+  if ((variant == NULL) || (g_variant_classify (variant) != G_VARIANT_CLASS_INT64))
+    return FALSE;
+
+  *value = g_variant_get_int64 (variant);
+
+  return TRUE;
+}
+
+/* Функция ищет double параметр prefix/key в таблице и считывает его значение. */
+gboolean
+hyscan_control_lookup_double_param (GHashTable  *params,
+                                    const gchar *prefix,
+                                    const gchar *key,
+                                    gdouble     *value)
+{
+  GVariant *variant;
+  gchar *name;
+
+  name = g_strconcat (prefix, key, NULL);
+  variant = g_hash_table_lookup (params, name);
+  g_free (name);
+
+  if ((variant == NULL) || (g_variant_classify (variant) != G_VARIANT_CLASS_DOUBLE))
+    return FALSE;
+
+  *value = g_variant_get_double (variant);
+
+  return TRUE;
+}
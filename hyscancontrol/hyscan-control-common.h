@@ -12,6 +12,8 @@
 #define __HYSCAN_CONTROL_COMMON_H__
 
 #include <hyscan-sonar-schema.h>
+#include <hyscan-sensor-control.h>
+#include <hyscan-sonar-messages.h>
 #include <hyscan-core-types.h>
 
 #define HYSCAN_SONAR_SCHEMA_ID                 0x4D45484353524E53
@@ -19,6 +21,33 @@
 
 #define HYSCAN_SENSOR_CONTROL_MAX_CHANNELS     5
 
+/* Функция обработки сообщений источника данных гидролокатора. Функции передаётся
+ * описание источника данных, указанное при добавлении маршрута. */
+typedef void (*HyScanSensorControlDataFunc)                    (HyScanSensorControl           *control,
+                                                                gpointer                       channel,
+                                                                HyScanSonarMessage            *message);
+
+/* Функция добавляет маршрут сообщений источника данных id. Маршруты вступают
+ * в силу после вызова функции hyscan_sensor_control_apply_routes. */
+void                   hyscan_sensor_control_add_route         (HyScanSensorControl           *control,
+                                                                guint32                        id,
+                                                                HyScanSensorControlDataFunc    func,
+                                                                gpointer                       channel);
+
+/* Функция строит таблицу маршрутов сообщений из добавленных маршрутов. */
+void                   hyscan_sensor_control_apply_routes      (HyScanSensorControl           *control);
+
+/* Функция помещает копию сообщения в очередь записи. Сообщение будет передано
+ * функции func в потоке записи данных. Если очередь отключена, функция func
+ * вызывается сразу. */
+void                   hyscan_sensor_control_write             (HyScanSensorControl           *control,
+                                                                HyScanSensorControlDataFunc    func,
+                                                                gpointer                       channel,
+                                                                HyScanSonarMessage            *message);
+
+/* Функция ожидает завершения записи всех сообщений из очереди. */
+void                   hyscan_sensor_control_write_flush       (HyScanSensorControl           *control);
+
 /* Функция возвращает название источника данных по его идентификатору. */
 const gchar           *hyscan_control_get_source_name          (HyScanSourceType               source);
 
@@ -54,4 +83,32 @@ const gchar           *hyscan_control_find_string_param        (const gchar
                                                                 const gchar *const            *names,
                                                                 GVariant                     **values);
 
+/* Функция проверяет наличие параметра prefix/key в схеме. */
+gboolean               hyscan_control_has_param                (HyScanDataSchema              *schema,
+                                                                const gchar                   *prefix,
+                                                                const gchar                   *key);
+
+/* Функция добавляет в список название параметра prefix/key, если он есть в схеме. */
+void                   hyscan_control_add_param                (GPtrArray                     *names,
+                                                                HyScanDataSchema              *schema,
+                                                                const gchar                   *prefix,
+                                                                const gchar                   *key);
+
+/* Функция считывает значения параметров из списка и возвращает таблицу значений
+ * по названиям параметров или NULL в случае ошибки. */
+GHashTable            *hyscan_control_get_params               (HyScanParam                   *param,
+                                                                GPtrArray                     *names);
+
+/* Функция ищет integer параметр prefix/key в таблице и считывает его значение. */
+gboolean               hyscan_control_lookup_integer_param     (GHashTable                    *params,
+                                                                const gchar                   *prefix,
+                                                                const gchar                   *key,
+                                                                gint64                        *value);
+
+/* Функция ищет double параметр prefix/key в таблице и считывает его значение. */
+gboolean               hyscan_control_lookup_double_param      (GHashTable                    *params,
+                                                                const gchar                   *prefix,
+                                                                const gchar                   *key,
+                                                                gdouble                       *value);
+
 #endif /* __HYSCAN_CONTROL_COMMON_H__ */
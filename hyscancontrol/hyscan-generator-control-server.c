@@ -664,6 +664,7 @@ hyscan_generator_control_server_send_signal (HyScanGeneratorControlServer  *serv
   message.rate = signal->rate;
   message.size = signal->n_points * hyscan_data_get_point_size (HYSCAN_DATA_COMPLEX_FLOAT);
   message.data = signal->points;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
@@ -12,6 +12,7 @@
 #include "hyscan-sonar-messages.h"
 #include "hyscan-control-common.h"
 #include "hyscan-control-marshallers.h"
+#include "hyscan-sonar-model.h"
 
 enum
 {
@@ -25,21 +26,11 @@ enum
   PROP_SONAR
 };
 
-typedef struct
-{
-  HyScanSourceType             source;                         /* Тип источника данных. */
-  gchar                       *path;                           /* Путь к описанию генератора в схеме. */
-  HyScanGeneratorModeType      capabilities;                   /* Режимы работы. */
-  HyScanGeneratorSignalType    signals;                        /* Возможные сигналы. */
-} HyScanGeneratorControlGen;
-
 struct _HyScanGeneratorControlPrivate
 {
   HyScanParam                 *sonar;                          /* Интерфейс управления гидролокатором. */
+  HyScanSonarModel            *model;                          /* Описание гидролокатора. */
   HyScanDataSchema            *schema;                         /* Схема параметров гидролокатора. */
-
-  GHashTable                  *gens_by_id;                     /* Список генераторов гидролокатора. */
-  GHashTable                  *gens_by_source;                 /* Список генераторов гидролокатора. */
 };
 
 static void    hyscan_generator_control_set_property           (GObject                   *object,
@@ -49,10 +40,12 @@ static void    hyscan_generator_control_set_property           (GObject
 static void    hyscan_generator_control_object_constructed     (GObject                   *object);
 static void    hyscan_generator_control_object_finalize        (GObject                   *object);
 
-static void    hyscan_generator_control_signal_receiver        (HyScanGeneratorControl    *control,
+static void    hyscan_generator_control_signal_receiver        (HyScanSensorControl       *control,
+                                                                gpointer                   channel,
+                                                                HyScanSonarMessage        *message);
+static void    hyscan_generator_control_signal_writer          (HyScanSensorControl       *control,
+                                                                gpointer                   channel,
                                                                 HyScanSonarMessage        *message);
-
-static void    hyscan_generator_control_free_gen               (gpointer                   data);
 
 static guint   hyscan_generator_control_signals[SIGNAL_LAST] = { 0 };
 
@@ -113,120 +106,32 @@ hyscan_generator_control_object_constructed (GObject *object)
   HyScanGeneratorControl *control = HYSCAN_GENERATOR_CONTROL (object);
   HyScanGeneratorControlPrivate *priv = control->priv;
 
-  HyScanDataSchemaNode *params;
-  HyScanDataSchemaNode *sources;
-
-  gint64 version;
-  gint64 id;
+  HyScanSonarModel *model;
   guint i;
 
   G_OBJECT_CLASS (hyscan_generator_control_parent_class)->constructed (object);
 
-  /* Список генераторов. */
-  priv->gens_by_id = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                            NULL, hyscan_generator_control_free_gen);
-  priv->gens_by_source = g_hash_table_new (g_direct_hash, g_direct_equal);
-
-  /* Обязательно должен быть передан указатель на интерфейс управления локатором. */
-  if (priv->sonar == NULL)
-    return;
-
-  /* Проверяем идентификатор и версию схемы гидролокатора. */
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/id", &id))
-    return;
-  if (id != HYSCAN_SONAR_SCHEMA_ID)
-    return;
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/version", &version))
-    return;
-  if ((version / 100) != (HYSCAN_SONAR_SCHEMA_VERSION / 100))
+  /* Описание гидролокатора. */
+  model = hyscan_sensor_control_get_model (HYSCAN_SENSOR_CONTROL (control));
+  if (model == NULL)
     return;
 
-  /* Параметры гидролокатора. */
-  priv->schema = hyscan_param_schema (priv->sonar);
-  params = hyscan_data_schema_list_nodes (priv->schema);
+  priv->model = hyscan_sonar_model_ref (model);
+  priv->schema = g_object_ref (model->schema);
 
-  /* Ветка схемы с описанием источников данных - "/sources". */
-  for (i = 0, sources = NULL; i < params->n_nodes; i++)
+  /* Обработчики образов сигналов от гидролокатора. */
+  for (i = 0; i < model->n_sources; i++)
     {
-      if (g_strcmp0 (params->nodes[i]->path, "/sources") == 0)
-        {
-          sources = params->nodes[i];
-          break;
-        }
-    }
-
-  if (sources != NULL)
-    {
-      /* Считываем описания генераторов. */
-      for (i = 0; i < sources->n_nodes; i++)
-        {
-          HyScanGeneratorControlGen *generator;
-
-          gchar *param_names[4];
-          GVariant *param_values[4];
-
-          gchar **pathv;
-          HyScanSourceType source;
-
-          gint64 id;
-          gint64 capabilities;
-          gint64 signals;
-
-          gboolean status;
-
-          /* Тип источника данных гидролокатора. */
-          pathv = g_strsplit (sources->nodes[i]->path, "/", -1);
-          source = hyscan_control_get_source_type (pathv[2]);
-          g_strfreev (pathv);
-
-          if (source == HYSCAN_SOURCE_INVALID)
-            continue;
-
-          param_names[0] = g_strdup_printf ("%s/generator/id", sources->nodes[i]->path);
-          param_names[1] = g_strdup_printf ("%s/generator/capabilities", sources->nodes[i]->path);
-          param_names[2] = g_strdup_printf ("%s/generator/signals", sources->nodes[i]->path);
-          param_names[3] = NULL;
-
-          status = hyscan_param_get (priv->sonar, (const gchar **)param_names, param_values);
+      HyScanSonarModelGenerator *generator = &model->sources[i].generator;
 
-          if (status)
-            {
-              id = g_variant_get_int64 (param_values[0]);
-              capabilities = g_variant_get_int64 (param_values[1]);
-              signals = g_variant_get_int64 (param_values[2]);
+      if (generator->id == 0)
+        continue;
 
-              g_variant_unref (param_values[0]);
-              g_variant_unref (param_values[1]);
-              g_variant_unref (param_values[2]);
-            }
-
-          g_free (param_names[0]);
-          g_free (param_names[1]);
-          g_free (param_names[2]);
-
-          if (!status)
-            continue;
-
-          if (id <= 0 || id > G_MAXINT32)
-            continue;
-
-          /* Описание генератора. */
-          generator = g_new0 (HyScanGeneratorControlGen, 1);
-          generator->source = source;
-          generator->path = g_strdup_printf ("%s/generator", sources->nodes[i]->path);
-          generator->capabilities = capabilities;
-          generator->signals = signals;
-
-          g_hash_table_insert (priv->gens_by_id, GINT_TO_POINTER (id), generator);
-          g_hash_table_insert (priv->gens_by_source, GINT_TO_POINTER (source), generator);
-        }
-
-      /* Обработчик образов сигналов от гидролокатора. */
-      g_signal_connect_swapped (priv->sonar, "data",
-                                G_CALLBACK (hyscan_generator_control_signal_receiver), control);
+      hyscan_sensor_control_add_route (HYSCAN_SENSOR_CONTROL (control), generator->id,
+                                       hyscan_generator_control_signal_receiver, generator);
     }
 
-  hyscan_data_schema_free_nodes (params);
+  hyscan_sensor_control_apply_routes (HYSCAN_SENSOR_CONTROL (control));
 }
 
 static void
@@ -236,22 +141,22 @@ hyscan_generator_control_object_finalize (GObject *object)
   HyScanGeneratorControlPrivate *priv = control->priv;
 
   g_signal_handlers_disconnect_by_data (priv->sonar, control);
+  hyscan_sensor_control_write_flush (HYSCAN_SENSOR_CONTROL (control));
 
   g_clear_object (&priv->schema);
+  g_clear_pointer (&priv->model, hyscan_sonar_model_unref);
   g_clear_object (&priv->sonar);
 
-  g_hash_table_unref (priv->gens_by_source);
-  g_hash_table_unref (priv->gens_by_id);
-
   G_OBJECT_CLASS (hyscan_generator_control_parent_class)->finalize (object);
 }
 
 /* Функция обрабатывает сообщения с образцами сигналов от гидролокатора. */
 static void
-hyscan_generator_control_signal_receiver (HyScanGeneratorControl *control,
-                                          HyScanSonarMessage     *message)
+hyscan_generator_control_signal_receiver (HyScanSensorControl *control,
+                                          gpointer             channel,
+                                          HyScanSonarMessage  *message)
 {
-  HyScanGeneratorControlGen *generator;
+  HyScanSonarModelGenerator *generator = channel;
 
   HyScanDataWriterSignal signal;
 
@@ -259,30 +164,33 @@ hyscan_generator_control_signal_receiver (HyScanGeneratorControl *control,
   if (message->type != HYSCAN_DATA_COMPLEX_FLOAT)
     return;
 
-  /* Ищем генератор. */
-  generator = g_hash_table_lookup (control->priv->gens_by_id, GINT_TO_POINTER (message->id));
-  if (generator == NULL)
-    return;
-
   /* Образец сигнала. */
   signal.time = message->time;
   signal.rate = message->rate;
   signal.n_points = message->size / sizeof (HyScanComplexFloat);
   signal.points = message->data;
 
-  hyscan_data_writer_raw_add_signal (HYSCAN_DATA_WRITER (control), generator->source, &signal);
+  hyscan_sensor_control_write (control, hyscan_generator_control_signal_writer, generator, message);
 
   g_signal_emit (control, hyscan_generator_control_signals[SIGNAL_SIGNAL_IMAGE], 0, generator->source, &signal);
 }
 
-/* Функция освобождает память, занятую структурой HyScanGeneratorControlGen. */
+/* Функция записывает образец сигнала. Вызывается из потока записи данных. */
 static void
-hyscan_generator_control_free_gen (gpointer data)
+hyscan_generator_control_signal_writer (HyScanSensorControl *control,
+                                        gpointer             channel,
+                                        HyScanSonarMessage  *message)
 {
-  HyScanGeneratorControlGen *generator = data;
+  HyScanSonarModelGenerator *generator = channel;
 
-  g_free (generator->path);
-  g_free (generator);
+  HyScanDataWriterSignal signal;
+
+  signal.time = message->time;
+  signal.rate = message->rate;
+  signal.n_points = message->size / sizeof (HyScanComplexFloat);
+  signal.points = message->data;
+
+  hyscan_data_writer_raw_add_signal (HYSCAN_DATA_WRITER (control), generator->source, &signal);
 }
 
 /* Функция возвращает флаги допустимых режимов работы генератора. */
@@ -290,11 +198,11 @@ HyScanGeneratorModeType
 hyscan_generator_control_get_capabilities (HyScanGeneratorControl *control,
                                            HyScanSourceType        source)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), HYSCAN_GENERATOR_MODE_INVALID);
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return HYSCAN_GENERATOR_MODE_INVALID;
 
@@ -306,11 +214,11 @@ HyScanGeneratorSignalType
 hyscan_generator_control_get_signals (HyScanGeneratorControl *control,
                                       HyScanSourceType        source)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), HYSCAN_GENERATOR_SIGNAL_INVALID);
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return HYSCAN_GENERATOR_SIGNAL_INVALID;
 
@@ -325,9 +233,9 @@ hyscan_generator_control_get_duration_range (HyScanGeneratorControl    *control,
                                              gdouble                   *min_duration,
                                              gdouble                   *max_duration)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_name;
+  const gchar *param_name;
   GVariant *min_duration_value;
   GVariant *max_duration_value;
   gboolean status = FALSE;
@@ -337,14 +245,14 @@ hyscan_generator_control_get_duration_range (HyScanGeneratorControl    *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
   if (signal == HYSCAN_GENERATOR_SIGNAL_TONE)
-    param_name = g_strdup_printf ("%s/tone/duration", generator->path);
+    param_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_TONE_DURATION];
   else if (signal != HYSCAN_GENERATOR_SIGNAL_LFM || signal != HYSCAN_GENERATOR_SIGNAL_LFMD)
-    param_name = g_strdup_printf ("%s/lfm/duration", generator->path);
+    param_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_LFM_DURATION];
   else
     return FALSE;
 
@@ -362,8 +270,6 @@ hyscan_generator_control_get_duration_range (HyScanGeneratorControl    *control,
   g_clear_pointer (&min_duration_value, g_variant_unref);
   g_clear_pointer (&max_duration_value, g_variant_unref);
 
-  g_free (param_name);
-
   return status;
 }
 
@@ -372,26 +278,25 @@ HyScanDataSchemaEnumValue **
 hyscan_generator_control_list_presets (HyScanGeneratorControl *control,
                                        HyScanSourceType        source)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
   const gchar *param_values_id;
   HyScanDataSchemaEnumValue **param_values = NULL;
-  gchar *params_name;
+  const gchar *params_name;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), NULL);
 
   if (control->priv->sonar == NULL)
     return NULL;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return NULL;
 
-  params_name = g_strdup_printf ("%s/preset/id", generator->path);
+  params_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_PRESET_ID];
   param_values_id = hyscan_data_schema_key_get_enum_id (control->priv->schema, params_name);
   if (param_values_id != NULL)
     param_values = hyscan_data_schema_key_get_enum_values (control->priv->schema, param_values_id);
-  g_free (params_name);
 
   return param_values;
 }
@@ -402,9 +307,9 @@ hyscan_generator_control_set_preset (HyScanGeneratorControl *control,
                                      HyScanSourceType        source,
                                      guint                   preset)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), FALSE);
@@ -412,13 +317,12 @@ hyscan_generator_control_set_preset (HyScanGeneratorControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/preset/id", generator->path);
+  param_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_PRESET_ID];
   status = hyscan_param_set_enum (control->priv->sonar, param_name, preset);
-  g_free (param_name);
 
   return status;
 }
@@ -429,9 +333,9 @@ hyscan_generator_control_set_auto (HyScanGeneratorControl    *control,
                                    HyScanSourceType           source,
                                    HyScanGeneratorSignalType  signal)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), FALSE);
@@ -439,13 +343,12 @@ hyscan_generator_control_set_auto (HyScanGeneratorControl    *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/auto/signal", generator->path);
+  param_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_AUTO_SIGNAL];
   status = hyscan_param_set_enum (control->priv->sonar, param_name, signal);
-  g_free (param_name);
 
   return status;
 }
@@ -457,9 +360,9 @@ hyscan_generator_control_set_simple (HyScanGeneratorControl    *control,
                                      HyScanGeneratorSignalType  signal,
                                      gdouble                    power)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_names[3];
+  const gchar *param_names[3];
   GVariant *param_values[3];
   gboolean status;
 
@@ -468,19 +371,19 @@ hyscan_generator_control_set_simple (HyScanGeneratorControl    *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
-  param_names[0] = g_strdup_printf ("%s/simple/signal", generator->path);
-  param_names[1] = g_strdup_printf ("%s/simple/power", generator->path);
+  param_names[0] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_SIMPLE_SIGNAL];
+  param_names[1] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_SIMPLE_POWER];
   param_names[2] = NULL;
 
   param_values[0] = g_variant_new_int64 (signal);
   param_values[1] = g_variant_new_double (power);
   param_values[2] = NULL;
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -488,9 +391,6 @@ hyscan_generator_control_set_simple (HyScanGeneratorControl    *control,
       g_variant_unref (param_values[1]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-
   return status;
 }
 
@@ -502,9 +402,9 @@ hyscan_generator_control_set_extended (HyScanGeneratorControl    *control,
                                        gdouble                    duration,
                                        gdouble                    power)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_names[4];
+  const gchar *param_names[4];
   GVariant *param_values[4];
   gboolean status;
 
@@ -513,14 +413,14 @@ hyscan_generator_control_set_extended (HyScanGeneratorControl    *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
   if (signal == HYSCAN_GENERATOR_SIGNAL_TONE)
     {
-      param_names[0] = g_strdup_printf ("%s/tone/duration", generator->path);
-      param_names[1] = g_strdup_printf ("%s/tone/power", generator->path);
+      param_names[0] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_TONE_DURATION];
+      param_names[1] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_TONE_POWER];
       param_names[2] = NULL;
       param_names[3] = NULL;
 
@@ -535,9 +435,9 @@ hyscan_generator_control_set_extended (HyScanGeneratorControl    *control,
 
       decreasing = (signal == HYSCAN_GENERATOR_SIGNAL_LFMD) ? TRUE : FALSE;
 
-      param_names[0] = g_strdup_printf ("%s/lfm/decreasing", generator->path);
-      param_names[1] = g_strdup_printf ("%s/lfm/duration", generator->path);
-      param_names[2] = g_strdup_printf ("%s/lfm/power", generator->path);
+      param_names[0] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_LFM_DECREASING];
+      param_names[1] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_LFM_DURATION];
+      param_names[2] = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_LFM_POWER];
       param_names[3] = NULL;
 
       param_values[0] = g_variant_new_boolean (decreasing);
@@ -550,7 +450,7 @@ hyscan_generator_control_set_extended (HyScanGeneratorControl    *control,
       return FALSE;
     }
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -559,10 +459,6 @@ hyscan_generator_control_set_extended (HyScanGeneratorControl    *control,
       g_clear_pointer (&param_values[2], g_variant_unref);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-
   return status;
 }
 
@@ -572,9 +468,9 @@ hyscan_generator_control_set_enable (HyScanGeneratorControl *control,
                                      HyScanSourceType        source,
                                      gboolean                enable)
 {
-  HyScanGeneratorControlGen *generator;
+  const HyScanSonarModelGenerator *generator;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_GENERATOR_CONTROL (control), FALSE);
@@ -582,13 +478,12 @@ hyscan_generator_control_set_enable (HyScanGeneratorControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  generator = g_hash_table_lookup (control->priv->gens_by_source, GINT_TO_POINTER (source));
+  generator = hyscan_sonar_model_get_generator (control->priv->model, source);
   if (generator == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/enable", generator->path);
+  param_name = generator->keys[HYSCAN_SONAR_MODEL_GENERATOR_ENABLE];
   status = hyscan_param_set_boolean (control->priv->sonar, param_name, enable);
-  g_free (param_name);
 
   return status;
 }
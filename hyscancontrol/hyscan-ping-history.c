@@ -0,0 +1,257 @@
+/*
+ * \file hyscan-ping-history.c
+ *
+ * \brief Исходный файл кольцевой истории строк гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-ping-history.h"
+
+typedef struct _HyScanPingHistoryEntry HyScanPingHistoryEntry;
+
+/* Строка данных. */
+struct _HyScanPingHistoryEntry
+{
+  gsize                        index;                          /* Номер строки. */
+  gint64                       time;                           /* Время приёма строки. */
+  HyScanRawDataInfo            info;                           /* Параметры данных. */
+  GBytes                      *data;                           /* Данные строки. */
+  HyScanPingHistoryEntry      *next;                           /* Следующая замещённая строка ячейки. */
+};
+
+/* Ячейка истории. */
+typedef struct
+{
+  HyScanPingHistoryEntry      *entry;                          /* Строка данных. */
+  gint                         readers;                        /* Число читателей ячейки. */
+  HyScanPingHistoryEntry      *retired;                        /* Замещённые строки, которые могли читаться. */
+} HyScanPingHistorySlot;
+
+struct _HyScanPingHistory
+{
+  guint                        n_slots;                        /* Число ячеек истории. */
+  HyScanPingHistorySlot       *slots;                          /* Ячейки истории. */
+  gsize                        n_pushed;                       /* Число добавленных строк. */
+};
+
+/* Функция удаляет строку данных. */
+static void
+hyscan_ping_history_entry_free (HyScanPingHistoryEntry *entry)
+{
+  g_bytes_unref (entry->data);
+  g_slice_free (HyScanPingHistoryEntry, entry);
+}
+
+/* Функция удаляет список замещённых строк. */
+static void
+hyscan_ping_history_retired_free (HyScanPingHistoryEntry *entry)
+{
+  while (entry != NULL)
+    {
+      HyScanPingHistoryEntry *next = entry->next;
+
+      hyscan_ping_history_entry_free (entry);
+      entry = next;
+    }
+}
+
+/* Функция считывает параметры строки с указанным номером. Если data не равен NULL,
+ * возвращается ссылка на данные строки. */
+static gboolean
+hyscan_ping_history_read (HyScanPingHistory  *history,
+                          guint64             index,
+                          gint64             *time,
+                          HyScanRawDataInfo  *info,
+                          GBytes            **data)
+{
+  HyScanPingHistorySlot *slot;
+  HyScanPingHistoryEntry *entry;
+  gsize n_pushed;
+  gboolean status = FALSE;
+
+  n_pushed = (gsize)g_atomic_pointer_get (&history->n_pushed);
+  if ((index >= n_pushed) || (n_pushed - index > history->n_slots))
+    return FALSE;
+
+  /* Пока счётчик читателей не равен нулю, поток записи не освобождает строку ячейки. */
+  slot = &history->slots[index % history->n_slots];
+  g_atomic_int_inc (&slot->readers);
+
+  entry = g_atomic_pointer_get (&slot->entry);
+  if ((entry != NULL) && (entry->index == index))
+    {
+      if (time != NULL)
+        *time = entry->time;
+      if (info != NULL)
+        *info = entry->info;
+      if (data != NULL)
+        *data = g_bytes_ref (entry->data);
+
+      status = TRUE;
+    }
+
+  g_atomic_int_add (&slot->readers, -1);
+
+  return status;
+}
+
+/* Функция создаёт историю. */
+HyScanPingHistory *
+hyscan_ping_history_new (guint n_pings)
+{
+  HyScanPingHistory *history;
+
+  history = g_slice_new0 (HyScanPingHistory);
+  history->n_slots = MAX (n_pings, 1);
+  history->slots = g_new0 (HyScanPingHistorySlot, history->n_slots);
+
+  return history;
+}
+
+/* Функция удаляет историю. */
+void
+hyscan_ping_history_free (HyScanPingHistory *history)
+{
+  guint i;
+
+  if (history == NULL)
+    return;
+
+  for (i = 0; i < history->n_slots; i++)
+    {
+      if (history->slots[i].entry != NULL)
+        hyscan_ping_history_entry_free (history->slots[i].entry);
+
+      hyscan_ping_history_retired_free (history->slots[i].retired);
+    }
+
+  g_free (history->slots);
+  g_slice_free (HyScanPingHistory, history);
+}
+
+/* Функция добавляет строку в историю. */
+void
+hyscan_ping_history_push (HyScanPingHistory *history,
+                          HyScanRawDataInfo *info,
+                          gint64             time,
+                          GBytes            *data)
+{
+  HyScanPingHistorySlot *slot;
+  HyScanPingHistoryEntry *entry;
+  HyScanPingHistoryEntry *old_entry;
+  gsize index;
+
+  index = (gsize)g_atomic_pointer_get (&history->n_pushed);
+
+  entry = g_slice_new (HyScanPingHistoryEntry);
+  entry->index = index;
+  entry->time = time;
+  entry->info = *info;
+  entry->data = g_bytes_ref (data);
+  entry->next = NULL;
+
+  /* Замещаем строку. Замещённая строка может читаться, поэтому она переносится
+   * в список замещённых строк ячейки. */
+  slot = &history->slots[index % history->n_slots];
+  old_entry = g_atomic_pointer_get (&slot->entry);
+  g_atomic_pointer_set (&slot->entry, entry);
+
+  if (old_entry != NULL)
+    {
+      old_entry->next = slot->retired;
+      slot->retired = old_entry;
+    }
+
+  /* Если ячейку никто не читает, новые читатели получат только новую строку и
+   * замещённые строки можно освободить. Иначе они освобождаются при
+   * одном из следующих замещений строки этой ячейки: поток записи не ожидает читателей. */
+  if (g_atomic_int_get (&slot->readers) == 0)
+    {
+      hyscan_ping_history_retired_free (slot->retired);
+      slot->retired = NULL;
+    }
+
+  g_atomic_pointer_add (&history->n_pushed, 1);
+}
+
+/* Функция возвращает номера самой старой и самой новой строки в истории. */
+gboolean
+hyscan_ping_history_get_range (HyScanPingHistory *history,
+                               guint64           *first,
+                               guint64           *last)
+{
+  gsize n_pushed;
+
+  n_pushed = (gsize)g_atomic_pointer_get (&history->n_pushed);
+  if (n_pushed == 0)
+    return FALSE;
+
+  /* Самая старая ячейка может замещаться в данный момент, поэтому она не учитывается. */
+  if (first != NULL)
+    *first = (n_pushed >= history->n_slots) ? n_pushed - history->n_slots + 1 : 0;
+  if (last != NULL)
+    *last = n_pushed - 1;
+
+  return TRUE;
+}
+
+/* Функция ищет самую новую строку, принятую не позднее указанного времени. */
+gboolean
+hyscan_ping_history_find (HyScanPingHistory *history,
+                          gint64             time,
+                          guint64           *index)
+{
+  guint64 first, last;
+  gint64 ping_time;
+  gboolean found = FALSE;
+
+  if (!hyscan_ping_history_get_range (history, &first, &last))
+    return FALSE;
+
+  /* Двоичный поиск по времени приёма. Строки, замещённые во время поиска,
+   * считаются принятыми раньше искомого времени. */
+  while (first <= last)
+    {
+      guint64 middle = first + (last - first) / 2;
+      gboolean valid;
+
+      valid = hyscan_ping_history_read (history, middle, &ping_time, NULL, NULL);
+      if (valid && (ping_time > time))
+        {
+          if (middle == 0)
+            break;
+
+          last = middle - 1;
+        }
+      else
+        {
+          if (valid)
+            {
+              *index = middle;
+              found = TRUE;
+            }
+
+          first = middle + 1;
+        }
+    }
+
+  return found;
+}
+
+/* Функция возвращает данные строки с указанным номером. */
+GBytes *
+hyscan_ping_history_get (HyScanPingHistory *history,
+                         guint64            index,
+                         gint64            *time,
+                         HyScanRawDataInfo *info)
+{
+  GBytes *data;
+
+  if (!hyscan_ping_history_read (history, index, time, info, &data))
+    return NULL;
+
+  return data;
+}
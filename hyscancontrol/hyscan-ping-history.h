@@ -0,0 +1,59 @@
+/*
+ * \file hyscan-ping-history.h
+ *
+ * \brief Заголовочный файл кольцевой истории строк гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * История хранит заданное число последних строк одного канала данных. Каждой строке
+ * присваивается порядковый номер, номера строк возрастают на единицу. Новая строка
+ * замещает самую старую.
+ *
+ * Строки добавляются одним потоком функцией #hyscan_ping_history_push. Чтение
+ * выполняется из любых потоков без блокировок: читатель отмечает ячейку истории
+ * счётчиком и берёт ссылку на данные строки. Поток записи не ожидает читателей:
+ * замещённая строка освобождается сразу, если ячейку никто не читает, иначе - при
+ * одном из следующих замещений строки этой ячейки. Данные строки не копируются при чтении
+ * и передаются читателю в виде GBytes.
+ *
+ */
+
+#ifndef __HYSCAN_PING_HISTORY_H__
+#define __HYSCAN_PING_HISTORY_H__
+
+#include "hyscan-sonar-model.h"
+
+typedef struct _HyScanPingHistory HyScanPingHistory;
+
+/* Функция создаёт историю на n_pings строк. */
+HyScanPingHistory     *hyscan_ping_history_new                 (guint                    n_pings);
+
+/* Функция удаляет историю. */
+void                   hyscan_ping_history_free                (HyScanPingHistory       *history);
+
+/* Функция добавляет строку в историю. История получает ссылку на данные строки,
+ * данные не копируются. */
+void                   hyscan_ping_history_push                (HyScanPingHistory       *history,
+                                                                HyScanRawDataInfo       *info,
+                                                                gint64                   time,
+                                                                GBytes                  *data);
+
+/* Функция возвращает номера самой старой и самой новой строки в истории. */
+gboolean               hyscan_ping_history_get_range           (HyScanPingHistory       *history,
+                                                                guint64                 *first,
+                                                                guint64                 *last);
+
+/* Функция ищет самую новую строку, принятую не позднее указанного времени. */
+gboolean               hyscan_ping_history_find                (HyScanPingHistory       *history,
+                                                                gint64                   time,
+                                                                guint64                 *index);
+
+/* Функция возвращает данные строки с указанным номером или NULL, если строка
+ * отсутствует в истории. */
+GBytes                *hyscan_ping_history_get                 (HyScanPingHistory       *history,
+                                                                guint64                  index,
+                                                                gint64                  *time,
+                                                                HyScanRawDataInfo       *info);
+
+#endif /* __HYSCAN_PING_HISTORY_H__ */
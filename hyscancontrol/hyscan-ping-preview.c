@@ -0,0 +1,308 @@
+/*
+ * \file hyscan-ping-preview.c
+ *
+ * \brief Исходный файл предварительного просмотра строк гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-ping-preview.h"
+#include "hyscan-adc-convert.h"
+
+#include <string.h>
+#include <math.h>
+
+typedef struct _HyScanPingPreviewJob HyScanPingPreviewJob;
+
+/* Состояние обработки канала данных. */
+typedef struct
+{
+  gint64                       time;                           /* Время приёма последней обработанной строки. */
+  gboolean                     busy;                           /* Признак обработки строки в пуле потоков. */
+  HyScanPingPreviewJob        *job;                            /* Строка, ожидающая обработки. */
+} HyScanPingPreviewChannel;
+
+/* Строка данных для обработки. */
+struct _HyScanPingPreviewJob
+{
+  HyScanPingPreviewChannel    *state;                          /* Состояние обработки канала. */
+  gpointer                     channel;                        /* Канал данных. */
+  guint32                      width;                          /* Ширина огибающей. */
+
+  HyScanDataType               type;                           /* Тип данных. */
+  gdouble                      rate;                           /* Частота дискретизации данных. */
+  gint                         offset;                         /* Смещение нуля АЦП. */
+  gdouble                      vref;                           /* Опорное напряжение АЦП. */
+
+  gint64                       time;                           /* Время приёма данных. */
+  guint32                      size;                           /* Размер данных. */
+  gpointer                     data;                           /* Данные. */
+};
+
+struct _HyScanPingPreview
+{
+  HyScanPingPreviewFunc        func;                           /* Функция обратного вызова. */
+  gpointer                     user_data;                      /* Пользовательские данные для функции. */
+
+  GThreadPool                 *pool;                           /* Пул потоков обработки. */
+  GHashTable                  *channels;                       /* Состояния каналов данных. */
+
+  guint32                      width;                          /* Ширина огибающей. */
+  gint64                       period;                         /* Минимальный интервал между строками, мкс. */
+
+  GMutex                       lock;                           /* Блокировка. */
+};
+
+static void            hyscan_ping_preview_worker              (gpointer                   data,
+                                                                gpointer                   user_data);
+
+/* Функция удаляет строку данных. */
+static void
+hyscan_ping_preview_job_free (HyScanPingPreviewJob *job)
+{
+  g_free (job->data);
+  g_slice_free (HyScanPingPreviewJob, job);
+}
+
+/* Функция удаляет состояние канала данных и строку, не переданную в обработку. */
+static void
+hyscan_ping_preview_channel_free (HyScanPingPreviewChannel *channel)
+{
+  if (channel->job != NULL)
+    hyscan_ping_preview_job_free (channel->job);
+
+  g_slice_free (HyScanPingPreviewChannel, channel);
+}
+
+/* Функция формирует огибающую и статистику строки данных. */
+static void
+hyscan_ping_preview_process (HyScanPingPreview    *preview,
+                             HyScanPingPreviewJob *job)
+{
+  HyScanSonarControlPreview result;
+  HyScanDataType type;
+  gfloat *values;
+  gfloat *envelope;
+  guint32 n_values;
+  guint32 n_points;
+  gdouble sum;
+  guint32 i, j;
+
+  type = hyscan_adc_convert_get_type (job->type);
+  if (type == HYSCAN_DATA_INVALID)
+    return;
+
+  if (type == job->type)
+    n_values = job->size / sizeof (gfloat);
+  else
+    n_values = hyscan_adc_convert_get_n_values (job->type, job->size);
+
+  n_points = (type == HYSCAN_DATA_COMPLEX_FLOAT) ? n_values / 2 : n_values;
+  if (n_points == 0)
+    return;
+
+  values = g_new (gfloat, n_values);
+  if (type == job->type)
+    memcpy (values, job->data, n_values * sizeof (gfloat));
+  else
+    hyscan_adc_convert (job->type, job->offset, job->vref, job->data, job->size, values);
+
+  /* Амплитуда комплексных данных. */
+  if (type == HYSCAN_DATA_COMPLEX_FLOAT)
+    {
+      for (i = 0; i < n_points; i++)
+        {
+          gfloat re = values[2 * i];
+          gfloat im = values[2 * i + 1];
+
+          values[i] = sqrtf (re * re + im * im);
+        }
+    }
+
+  /* Статистика строки. */
+  result.peak = 0.0;
+  sum = 0.0;
+  for (i = 0; i < n_points; i++)
+    {
+      gfloat amplitude = fabsf (values[i]);
+
+      if (amplitude > result.peak)
+        result.peak = amplitude;
+
+      sum += (gdouble)values[i] * values[i];
+    }
+
+  result.time = job->time;
+  result.rate = job->rate;
+  result.n_points = n_points;
+  result.rms = sqrt (sum / n_points);
+  result.n_saturated = hyscan_adc_convert_count_saturated (job->type, job->data, job->size);
+
+  /* Огибающая. */
+  result.width = MIN (job->width, n_points);
+  envelope = g_new (gfloat, 3 * result.width);
+
+  for (i = 0; i < result.width; i++)
+    {
+      guint32 start = (guint64)i * n_points / result.width;
+      guint32 end = (guint64)(i + 1) * n_points / result.width;
+      gfloat min = values[start];
+      gfloat max = values[start];
+
+      sum = 0.0;
+      for (j = start; j < end; j++)
+        {
+          if (values[j] < min)
+            min = values[j];
+          if (values[j] > max)
+            max = values[j];
+
+          sum += values[j];
+        }
+
+      envelope[i] = min;
+      envelope[result.width + i] = max;
+      envelope[2 * result.width + i] = sum / (end - start);
+    }
+
+  result.min = envelope;
+  result.max = envelope + result.width;
+  result.mean = envelope + 2 * result.width;
+
+  preview->func (job->channel, &result, preview->user_data);
+
+  g_free (envelope);
+  g_free (values);
+}
+
+/* Функция обрабатывает строку данных. Вызывается из пула потоков. */
+static void
+hyscan_ping_preview_worker (gpointer data,
+                            gpointer user_data)
+{
+  HyScanPingPreviewJob *job = data;
+  HyScanPingPreview *preview = user_data;
+
+  g_mutex_lock (&preview->lock);
+  job->state->job = NULL;
+  g_mutex_unlock (&preview->lock);
+
+  hyscan_ping_preview_process (preview, job);
+
+  g_mutex_lock (&preview->lock);
+  job->state->busy = FALSE;
+  g_mutex_unlock (&preview->lock);
+
+  hyscan_ping_preview_job_free (job);
+}
+
+/* Функция создаёт объект предварительного просмотра. */
+HyScanPingPreview *
+hyscan_ping_preview_new (HyScanPingPreviewFunc func,
+                         gpointer              user_data)
+{
+  HyScanPingPreview *preview;
+
+  preview = g_slice_new0 (HyScanPingPreview);
+  preview->func = func;
+  preview->user_data = user_data;
+
+  preview->pool = g_thread_pool_new (hyscan_ping_preview_worker, preview,
+                                     g_get_num_processors (), FALSE, NULL);
+  preview->channels = g_hash_table_new_full (NULL, NULL, NULL,
+                                             (GDestroyNotify)hyscan_ping_preview_channel_free);
+
+  g_mutex_init (&preview->lock);
+
+  return preview;
+}
+
+/* Функция удаляет объект предварительного просмотра. */
+void
+hyscan_ping_preview_free (HyScanPingPreview *preview)
+{
+  if (preview == NULL)
+    return;
+
+  /* Строки, ожидающие обработки, не обрабатываются и удаляются вместе с состояниями
+   * каналов. Дожидаемся завершения обработки текущих строк. */
+  g_thread_pool_free (preview->pool, TRUE, TRUE);
+
+  g_hash_table_unref (preview->channels);
+  g_mutex_clear (&preview->lock);
+
+  g_slice_free (HyScanPingPreview, preview);
+}
+
+/* Функция задаёт параметры обработки. */
+void
+hyscan_ping_preview_set_params (HyScanPingPreview *preview,
+                                guint32            width,
+                                gdouble            period)
+{
+  g_mutex_lock (&preview->lock);
+  preview->width = width;
+  preview->period = (period > 0.0) ? (gint64)(period * G_TIME_SPAN_SECOND) : 0;
+  g_mutex_unlock (&preview->lock);
+}
+
+/* Функция добавляет строку данных канала в очередь обработки. */
+void
+hyscan_ping_preview_add (HyScanPingPreview    *preview,
+                         gpointer              channel,
+                         HyScanDataType        type,
+                         gdouble               rate,
+                         gint                  offset,
+                         gdouble               vref,
+                         HyScanDataWriterData *data)
+{
+  HyScanPingPreviewChannel *state;
+  HyScanPingPreviewJob *job;
+  guint32 width;
+
+  g_mutex_lock (&preview->lock);
+
+  width = preview->width;
+
+  state = g_hash_table_lookup (preview->channels, channel);
+  if (state == NULL)
+    {
+      state = g_slice_new0 (HyScanPingPreviewChannel);
+      state->time = G_MININT64;
+      g_hash_table_insert (preview->channels, channel, state);
+    }
+
+  /* Пропускаем строки во время обработки и чаще заданного интервала. */
+  if ((width == 0) || state->busy ||
+      ((state->time != G_MININT64) && (data->time >= state->time) &&
+       (data->time - state->time < preview->period)))
+    {
+      g_mutex_unlock (&preview->lock);
+      return;
+    }
+
+  state->busy = TRUE;
+  state->time = data->time;
+
+  g_mutex_unlock (&preview->lock);
+
+  job = g_slice_new (HyScanPingPreviewJob);
+  job->state = state;
+  job->channel = channel;
+  job->width = width;
+  job->type = type;
+  job->rate = rate;
+  job->offset = offset;
+  job->vref = vref;
+  job->time = data->time;
+  job->size = data->size;
+  job->data = g_memdup (data->data, data->size);
+
+  g_mutex_lock (&preview->lock);
+  state->job = job;
+  g_mutex_unlock (&preview->lock);
+
+  g_thread_pool_push (preview->pool, job, NULL);
+}
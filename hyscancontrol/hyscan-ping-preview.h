@@ -0,0 +1,57 @@
+/*
+ * \file hyscan-ping-preview.h
+ *
+ * \brief Заголовочный файл предварительного просмотра строк гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * Функции формируют для строки данных огибающую заданной ширины (минимальные,
+ * максимальные и средние значения на равных участках строки) и статистику строки:
+ * максимальную и среднеквадратичную амплитуду и число отсчётов АЦП на границах шкалы.
+ * Для комплексных данных огибающая строится по амплитуде.
+ *
+ * Обработка выполняется в пуле потоков. Для каждого канала данных в обработке
+ * находится не более одной строки, строки, поступившие во время обработки или
+ * раньше заданного интервала после предыдущей строки, пропускаются.
+ *
+ * Результат передаётся функции обратного вызова из потока обработки.
+ *
+ */
+
+#ifndef __HYSCAN_PING_PREVIEW_H__
+#define __HYSCAN_PING_PREVIEW_H__
+
+#include "hyscan-sonar-model.h"
+
+typedef struct _HyScanPingPreview HyScanPingPreview;
+
+/* Функция обратного вызова для результатов обработки. */
+typedef void (*HyScanPingPreviewFunc)                          (gpointer                   channel,
+                                                                HyScanSonarControlPreview *preview,
+                                                                gpointer                   user_data);
+
+/* Функция создаёт объект предварительного просмотра. */
+HyScanPingPreview     *hyscan_ping_preview_new                 (HyScanPingPreviewFunc      func,
+                                                                gpointer                   user_data);
+
+/* Функция удаляет объект предварительного просмотра. Функция дожидается
+ * завершения обработки текущих строк, строки, ожидающие обработки, отбрасываются. */
+void                   hyscan_ping_preview_free                (HyScanPingPreview         *preview);
+
+/* Функция задаёт ширину огибающей и минимальный интервал между строками канала
+ * в секундах. Нулевая ширина отключает обработку. */
+void                   hyscan_ping_preview_set_params          (HyScanPingPreview         *preview,
+                                                                guint32                    width,
+                                                                gdouble                    period);
+
+/* Функция добавляет строку данных канала в очередь обработки. */
+void                   hyscan_ping_preview_add                 (HyScanPingPreview         *preview,
+                                                                gpointer                   channel,
+                                                                HyScanDataType             type,
+                                                                gdouble                    rate,
+                                                                gint                       offset,
+                                                                gdouble                    vref,
+                                                                HyScanDataWriterData      *data);
+
+#endif /* __HYSCAN_PING_PREVIEW_H__ */
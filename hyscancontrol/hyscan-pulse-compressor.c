@@ -0,0 +1,343 @@
+/*
+ * \file hyscan-pulse-compressor.c
+ *
+ * \brief Исходный файл сжатия импульсов в "сырых" гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-pulse-compressor.h"
+#include "hyscan-adc-convert.h"
+
+#include <hyscan-convolution.h>
+#include <string.h>
+
+/* Максимальное число строк в очереди канала. */
+#define HYSCAN_PULSE_COMPRESSOR_MAX_JOBS       4
+
+/* Образ сигнала. */
+typedef struct
+{
+  volatile gint                ref_count;                      /* Число ссылок на объект. */
+  guint32                      n_points;                       /* Число точек образа. */
+  HyScanComplexFloat          *points;                         /* Образ сигнала. */
+} HyScanPulseCompressorImage;
+
+/* Строка данных для обработки. */
+typedef struct
+{
+  HyScanPulseCompressorImage  *image;                          /* Образ сигнала для свёртки. */
+  HyScanRawDataInfo            info;                           /* Параметры данных. */
+  gint64                       time;                           /* Время приёма данных. */
+  guint32                      n_points;                       /* Число точек данных. */
+  HyScanComplexFloat          *points;                         /* Данные. */
+} HyScanPulseCompressorJob;
+
+/* Состояние обработки приёмного канала. */
+typedef struct
+{
+  HyScanSonarModelChannel     *channel;                        /* Описание приёмного канала. */
+
+  HyScanConvolution           *convolution;                    /* Объект свёртки. */
+  HyScanPulseCompressorImage  *image;                          /* Текущий образ сигнала в объекте свёртки. */
+
+  GQueue                       jobs;                           /* Очередь строк для обработки. */
+  gboolean                     busy;                           /* Признак обработки канала в пуле потоков. */
+} HyScanPulseCompressorChannel;
+
+struct _HyScanPulseCompressor
+{
+  HyScanPulseCompressorFunc    func;                           /* Функция обратного вызова. */
+  gpointer                     user_data;                      /* Пользовательские данные для функции. */
+
+  GThreadPool                 *pool;                           /* Пул потоков обработки. */
+
+  GHashTable                  *images;                         /* Образы сигналов источников данных. */
+  GHashTable                  *channels;                       /* Состояния приёмных каналов. */
+
+  GMutex                       lock;                           /* Блокировка. */
+};
+
+static void            hyscan_pulse_compressor_worker          (gpointer                 data,
+                                                                gpointer                 user_data);
+
+/* Функция освобождает ссылку на образ сигнала. */
+static void
+hyscan_pulse_compressor_image_unref (HyScanPulseCompressorImage *image)
+{
+  if (!g_atomic_int_dec_and_test (&image->ref_count))
+    return;
+
+  g_free (image->points);
+  g_slice_free (HyScanPulseCompressorImage, image);
+}
+
+/* Функция удаляет строку данных. */
+static void
+hyscan_pulse_compressor_job_free (HyScanPulseCompressorJob *job)
+{
+  hyscan_pulse_compressor_image_unref (job->image);
+  g_free (job->points);
+  g_slice_free (HyScanPulseCompressorJob, job);
+}
+
+/* Функция удаляет состояние приёмного канала. */
+static void
+hyscan_pulse_compressor_channel_free (HyScanPulseCompressorChannel *channel)
+{
+  HyScanPulseCompressorJob *job;
+
+  while ((job = g_queue_pop_head (&channel->jobs)) != NULL)
+    hyscan_pulse_compressor_job_free (job);
+
+  if (channel->image != NULL)
+    hyscan_pulse_compressor_image_unref (channel->image);
+
+  g_object_unref (channel->convolution);
+  g_slice_free (HyScanPulseCompressorChannel, channel);
+}
+
+/* Функция преобразовывает данные в комплексные числа. */
+static HyScanComplexFloat *
+hyscan_pulse_compressor_convert (HyScanRawDataInfo    *info,
+                                 HyScanDataWriterData *data,
+                                 guint32              *n_points)
+{
+  HyScanDataType type = hyscan_adc_convert_get_type (info->data.type);
+  HyScanComplexFloat *points;
+  gfloat *values;
+  guint32 n_values;
+  guint32 i;
+
+  if (type == HYSCAN_DATA_COMPLEX_FLOAT)
+    {
+      if (info->data.type == HYSCAN_DATA_COMPLEX_FLOAT)
+        *n_points = data->size / sizeof (HyScanComplexFloat);
+      else
+        *n_points = hyscan_adc_convert_get_n_values (info->data.type, data->size) / 2;
+
+      if (*n_points == 0)
+        return NULL;
+
+      points = g_new (HyScanComplexFloat, *n_points);
+      if (info->data.type == HYSCAN_DATA_COMPLEX_FLOAT)
+        memcpy (points, data->data, *n_points * sizeof (HyScanComplexFloat));
+      else
+        hyscan_adc_convert (info->data.type, info->adc.offset, info->adc.vref,
+                            data->data, data->size, (gfloat*)points);
+
+      return points;
+    }
+
+  if (type != HYSCAN_DATA_FLOAT)
+    return NULL;
+
+  /* Действительные данные размещаются в начале буфера и
+   * расширяются до комплексных с конца буфера. */
+  if (info->data.type == HYSCAN_DATA_FLOAT)
+    n_values = data->size / sizeof (gfloat);
+  else
+    n_values = hyscan_adc_convert_get_n_values (info->data.type, data->size);
+
+  *n_points = n_values;
+  if (n_values == 0)
+    return NULL;
+
+  points = g_new (HyScanComplexFloat, n_values);
+  values = (gfloat*)points;
+
+  if (info->data.type == HYSCAN_DATA_FLOAT)
+    memcpy (values, data->data, n_values * sizeof (gfloat));
+  else
+    hyscan_adc_convert (info->data.type, info->adc.offset, info->adc.vref,
+                        data->data, data->size, values);
+
+  for (i = n_values; i > 0; i--)
+    {
+      points[i - 1].im = 0.0;
+      points[i - 1].re = values[i - 1];
+    }
+
+  return points;
+}
+
+/* Функция обрабатывает строки приёмного канала. Вызывается из пула потоков. */
+static void
+hyscan_pulse_compressor_worker (gpointer data,
+                                gpointer user_data)
+{
+  HyScanPulseCompressorChannel *channel = data;
+  HyScanPulseCompressor *compressor = user_data;
+  HyScanPulseCompressorJob *job;
+
+  while (TRUE)
+    {
+      HyScanDataWriterData compressed;
+
+      g_mutex_lock (&compressor->lock);
+      job = g_queue_pop_head (&channel->jobs);
+      if (job == NULL)
+        channel->busy = FALSE;
+      g_mutex_unlock (&compressor->lock);
+
+      if (job == NULL)
+        break;
+
+      /* Образ сигнала изменился. */
+      if (channel->image != job->image)
+        {
+          hyscan_convolution_set_image (channel->convolution, job->image->points, job->image->n_points);
+
+          if (channel->image != NULL)
+            hyscan_pulse_compressor_image_unref (channel->image);
+          channel->image = job->image;
+          g_atomic_int_inc (&channel->image->ref_count);
+        }
+
+      if (hyscan_convolution_convolve (channel->convolution, job->points, job->n_points, 1.0))
+        {
+          job->info.data.type = HYSCAN_DATA_COMPLEX_FLOAT;
+          compressed.time = job->time;
+          compressed.size = job->n_points * sizeof (HyScanComplexFloat);
+          compressed.data = job->points;
+
+          compressor->func (channel->channel, &job->info, &compressed, compressor->user_data);
+        }
+
+      hyscan_pulse_compressor_job_free (job);
+    }
+}
+
+/* Функция создаёт объект сжатия импульсов. */
+HyScanPulseCompressor *
+hyscan_pulse_compressor_new (HyScanPulseCompressorFunc func,
+                             gpointer                  user_data)
+{
+  HyScanPulseCompressor *compressor;
+
+  compressor = g_slice_new0 (HyScanPulseCompressor);
+  compressor->func = func;
+  compressor->user_data = user_data;
+
+  compressor->pool = g_thread_pool_new (hyscan_pulse_compressor_worker, compressor,
+                                        g_get_num_processors (), FALSE, NULL);
+
+  compressor->images = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify)hyscan_pulse_compressor_image_unref);
+  compressor->channels = g_hash_table_new_full (NULL, NULL, NULL,
+                                                (GDestroyNotify)hyscan_pulse_compressor_channel_free);
+
+  g_mutex_init (&compressor->lock);
+
+  return compressor;
+}
+
+/* Функция удаляет объект сжатия импульсов. */
+void
+hyscan_pulse_compressor_free (HyScanPulseCompressor *compressor)
+{
+  if (compressor == NULL)
+    return;
+
+  g_thread_pool_free (compressor->pool, TRUE, TRUE);
+
+  g_hash_table_unref (compressor->channels);
+  g_hash_table_unref (compressor->images);
+
+  g_mutex_clear (&compressor->lock);
+
+  g_slice_free (HyScanPulseCompressor, compressor);
+}
+
+/* Функция устанавливает образ сигнала для источника данных. */
+void
+hyscan_pulse_compressor_set_image (HyScanPulseCompressor  *compressor,
+                                   HyScanSourceType        source,
+                                   HyScanDataWriterSignal *signal)
+{
+  HyScanPulseCompressorImage *image = NULL;
+
+  if (signal->n_points > 0)
+    {
+      image = g_slice_new (HyScanPulseCompressorImage);
+      image->ref_count = 1;
+      image->n_points = signal->n_points;
+      image->points = g_memdup (signal->points, signal->n_points * sizeof (HyScanComplexFloat));
+    }
+
+  g_mutex_lock (&compressor->lock);
+
+  if (image != NULL)
+    g_hash_table_insert (compressor->images, GINT_TO_POINTER (source), image);
+  else
+    g_hash_table_remove (compressor->images, GINT_TO_POINTER (source));
+
+  g_mutex_unlock (&compressor->lock);
+}
+
+/* Функция добавляет строку "сырых" данных приёмного канала в очередь обработки. */
+void
+hyscan_pulse_compressor_add (HyScanPulseCompressor   *compressor,
+                             HyScanSonarModelChannel *channel,
+                             HyScanRawDataInfo       *info,
+                             HyScanDataWriterData    *data)
+{
+  HyScanPulseCompressorChannel *compressor_channel;
+  HyScanPulseCompressorImage *image;
+  HyScanPulseCompressorJob *job;
+  HyScanComplexFloat *points;
+  guint32 n_points;
+
+  /* Без образа сигнала свёртка не выполняется. */
+  g_mutex_lock (&compressor->lock);
+  image = g_hash_table_lookup (compressor->images, GINT_TO_POINTER (channel->source));
+  if (image != NULL)
+    g_atomic_int_inc (&image->ref_count);
+  g_mutex_unlock (&compressor->lock);
+
+  if (image == NULL)
+    return;
+
+  points = hyscan_pulse_compressor_convert (info, data, &n_points);
+  if (points == NULL)
+    {
+      hyscan_pulse_compressor_image_unref (image);
+      return;
+    }
+
+  job = g_slice_new (HyScanPulseCompressorJob);
+  job->image = image;
+  job->info = *info;
+  job->time = data->time;
+  job->n_points = n_points;
+  job->points = points;
+
+  g_mutex_lock (&compressor->lock);
+
+  compressor_channel = g_hash_table_lookup (compressor->channels, channel);
+  if (compressor_channel == NULL)
+    {
+      compressor_channel = g_slice_new0 (HyScanPulseCompressorChannel);
+      compressor_channel->channel = channel;
+      compressor_channel->convolution = hyscan_convolution_new ();
+      g_queue_init (&compressor_channel->jobs);
+
+      g_hash_table_insert (compressor->channels, channel, compressor_channel);
+    }
+
+  /* Если обработка не успевает, отбрасываем самые старые строки. */
+  if (g_queue_get_length (&compressor_channel->jobs) >= HYSCAN_PULSE_COMPRESSOR_MAX_JOBS)
+    hyscan_pulse_compressor_job_free (g_queue_pop_head (&compressor_channel->jobs));
+
+  g_queue_push_tail (&compressor_channel->jobs, job);
+
+  if (!compressor_channel->busy)
+    {
+      compressor_channel->busy = TRUE;
+      g_thread_pool_push (compressor->pool, compressor_channel, NULL);
+    }
+
+  g_mutex_unlock (&compressor->lock);
+}
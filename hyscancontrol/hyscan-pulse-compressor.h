@@ -0,0 +1,58 @@
+/*
+ * \file hyscan-pulse-compressor.h
+ *
+ * \brief Заголовочный файл сжатия импульсов в "сырых" гидролокационных данных
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * Сжатие импульсов выполняется свёрткой "сырых" данных приёмного канала с образом излучаемого
+ * сигнала (согласованная фильтрация). Свёртка выполняется в частотной области с помощью
+ * класса HyScanConvolution.
+ *
+ * Образы сигналов для источников данных задаются функцией #hyscan_pulse_compressor_set_image.
+ * Каждая строка данных, добавленная функцией #hyscan_pulse_compressor_add, сворачивается с
+ * образом, действовавшим на момент её добавления. Строки без образа сигнала не обрабатываются.
+ *
+ * Обработка выполняется в пуле потоков: приёмные каналы обрабатываются параллельно, строки
+ * одного канала обрабатываются последовательно в порядке добавления. Если обработка не
+ * успевает за приёмом, в очереди канала сохраняются только последние строки.
+ *
+ * Результат передаётся функции обратного вызова из потока обработки в формате
+ * HYSCAN_DATA_COMPLEX_FLOAT.
+ *
+ */
+
+#ifndef __HYSCAN_PULSE_COMPRESSOR_H__
+#define __HYSCAN_PULSE_COMPRESSOR_H__
+
+#include "hyscan-sonar-model.h"
+
+typedef struct _HyScanPulseCompressor HyScanPulseCompressor;
+
+/* Функция обратного вызова для обработанных данных. */
+typedef void (*HyScanPulseCompressorFunc)                      (HyScanSonarModelChannel *channel,
+                                                                HyScanRawDataInfo       *info,
+                                                                HyScanDataWriterData    *data,
+                                                                gpointer                 user_data);
+
+/* Функция создаёт объект сжатия импульсов. */
+HyScanPulseCompressor *hyscan_pulse_compressor_new             (HyScanPulseCompressorFunc func,
+                                                                gpointer                 user_data);
+
+/* Функция удаляет объект сжатия импульсов. Функция дожидается завершения
+ * обработки текущих строк, необработанные строки отбрасываются. */
+void                   hyscan_pulse_compressor_free            (HyScanPulseCompressor   *compressor);
+
+/* Функция устанавливает образ сигнала для источника данных. */
+void                   hyscan_pulse_compressor_set_image       (HyScanPulseCompressor   *compressor,
+                                                                HyScanSourceType         source,
+                                                                HyScanDataWriterSignal  *signal);
+
+/* Функция добавляет строку "сырых" данных приёмного канала в очередь обработки. */
+void                   hyscan_pulse_compressor_add             (HyScanPulseCompressor   *compressor,
+                                                                HyScanSonarModelChannel *channel,
+                                                                HyScanRawDataInfo       *info,
+                                                                HyScanDataWriterData    *data);
+
+#endif /* __HYSCAN_PULSE_COMPRESSOR_H__ */
@@ -750,6 +750,7 @@ hyscan_sensor_control_server_send_data (HyScanSensorControlServer   *server,
   message.rate = 1.0;
   message.size = data->size;
   message.data = data->data;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
@@ -17,8 +17,12 @@
 #include "hyscan-sonar-messages.h"
 #include "hyscan-control-common.h"
 #include "hyscan-control-marshallers.h"
+#include "hyscan-sonar-model.h"
 #include <string.h>
 
+#define HYSCAN_SENSOR_CONTROL_MAX_DENSE_ID     4096
+#define HYSCAN_SENSOR_CONTROL_WRITE_QUEUE_SIZE (64 * 1024 * 1024)
+
 enum
 {
   PROP_O,
@@ -58,20 +62,50 @@ typedef struct
   GObject                     *receiver;                       /* Приёмник NMEA данных. */
 } HyScanSensorControlLocalPort;
 
-/* Описание порта гидролокатора. */
+/* Параметры порта гидролокатора. Название, тип порта и названия его
+ * параметров берутся из описания гидролокатора. */
 typedef struct
 {
-  gchar                       *name;                           /* Название порта. */
-  gchar                       *path;                           /* Путь к описанию порта в схеме. */
+  const gchar                 *name;                           /* Название порта. */
+  const gchar *const          *keys;                           /* Названия параметров порта. */
   HyScanSensorPortType         type;                           /* Тип порта. */
   HyScanSensorProtocolType     protocol;                       /* Протокол передачи данных. */
   gint64                       time_offset;                    /* Коррекция времени. */
   guint                        channel;                        /* Номер канала данных. */
 } HyScanSensorControlPort;
 
+/* Маршрут сообщений источника данных. */
+typedef struct
+{
+  guint32                      id;                             /* Идентификатор источника данных. */
+  HyScanSensorControlDataFunc  func;                           /* Функция обработки сообщений. */
+  gpointer                     channel;                        /* Описание источника данных. */
+} HyScanSensorControlRoute;
+
+/* Таблица маршрутов сообщений. Маршруты источников с идентификаторами меньше
+ * HYSCAN_SENSOR_CONTROL_MAX_DENSE_ID размещаются в массиве по идентификатору,
+ * остальные - в хэш таблице. */
+typedef struct
+{
+  guint32                      n_routes;                       /* Размер массива маршрутов. */
+  HyScanSensorControlRoute    *routes;                         /* Массив маршрутов по идентификаторам. */
+  GHashTable                  *sparse;                         /* Маршруты с большими идентификаторами. */
+} HyScanSensorControlRouter;
+
+/* Сообщение в очереди записи. Данные сообщения размещаются сразу за структурой. */
+typedef struct
+{
+  HyScanSensorControlDataFunc  func;                           /* Функция записи сообщения. */
+  gpointer                     channel;                        /* Описание источника данных. */
+  gint64                       queue_time;                     /* Время помещения в очередь. */
+  gsize                        size;                           /* Размер сообщения в очереди. */
+  HyScanSonarMessage           message;                        /* Сообщение. */
+} HyScanSensorControlWriteJob;
+
 struct _HyScanSensorControlPrivate
 {
   HyScanParam                 *sonar;                          /* Интерфейс управления гидролокатором. */
+  HyScanSonarModel            *model;                          /* Описание гидролокатора. */
   HyScanDataSchema            *schema;                         /* Схема параметров гидролокатора. */
 
   guint                        n_uart_ports;                   /* Число локальных UART портов. */
@@ -83,9 +117,23 @@ struct _HyScanSensorControlPrivate
   GHashTable                  *ip_addresses;                   /* IP адреса доступные системе. */
   GHashTable                  *local_ports;                    /* Список локальных портов. */
 
-  GHashTable                  *ports_by_id;                    /* Список портов для подключения датчиков. */
   GHashTable                  *ports_by_name;                  /* Список портов для подключения датчиков. */
 
+  GArray                      *routes;                         /* Добавленные маршруты сообщений. */
+  HyScanSensorControlRouter   *router;                         /* Текущая таблица маршрутов сообщений. */
+  GSList                      *old_routers;                    /* Заменённые таблицы маршрутов сообщений. */
+
+  GThread                     *writer;                         /* Поток записи данных. */
+  GMutex                       write_lock;                     /* Блокировка очереди записи. */
+  GCond                        write_cond;                     /* Сигнализатор новых сообщений в очереди. */
+  GCond                        flush_cond;                     /* Сигнализатор завершения записи очереди. */
+  GQueue                       write_queue;                    /* Очередь записи. */
+  gboolean                     writing;                        /* Признак записи сообщения. */
+  gboolean                     write_shutdown;                 /* Признак завершения потока записи. */
+  gboolean                     write_overflow;                 /* Признак переполнения очереди. */
+  gsize                        write_limit;                    /* Максимальный объём данных в очереди. */
+  HyScanSensorControlWriteStats write_stats;                   /* Статистика очереди записи. */
+
   GMutex                       lock;                           /* Блокировка. */
 };
 
@@ -106,7 +154,6 @@ static void          hyscan_sensor_control_add_ip_addresses    (HyScanDataSchema
                                                                 GHashTable                   *addresses);
 
 static void          hyscan_sensor_control_free_local_port     (gpointer                      data);
-static void          hyscan_sensor_control_free_port           (gpointer                      data);
 
 static gboolean      hyscan_sensor_control_setup_uart_port     (HyScanSensorControl          *control,
                                                                 const gchar                  *name,
@@ -128,7 +175,12 @@ static void          hyscan_sensor_control_local_receiver      (HyScanSensorCont
                                                                 guint                         size,
                                                                 const gchar                  *nmea);
 static void          hyscan_sensor_control_data_receiver       (HyScanSensorControl          *control,
+                                                                gpointer                      channel,
                                                                 HyScanSonarMessage           *message);
+static void          hyscan_sensor_control_data_router         (HyScanSensorControl          *control,
+                                                                HyScanSonarMessage           *message);
+static void          hyscan_sensor_control_free_router         (gpointer                      data);
+static gpointer      hyscan_sensor_control_writer              (gpointer                      data);
 
 static gboolean      hyscan_sensor_control_check_nmea_crc      (const gchar                  *nmea_str);
 
@@ -206,11 +258,6 @@ hyscan_sensor_control_object_constructed (GObject *object)
   HyScanSensorControl *control = HYSCAN_SENSOR_CONTROL (object);
   HyScanSensorControlPrivate *priv = control->priv;
 
-  HyScanDataSchemaNode *params;
-  HyScanDataSchemaNode *sensors;
-
-  gint64 version;
-  gint64 id;
   guint i, j;
 
   G_OBJECT_CLASS (hyscan_sensor_control_parent_class)->constructed (object);
@@ -220,9 +267,17 @@ hyscan_sensor_control_object_constructed (GObject *object)
   /* Список доступных портов. */
   priv->local_ports = g_hash_table_new_full (g_str_hash, g_str_equal,
                                              g_free, hyscan_sensor_control_free_local_port);
-  priv->ports_by_id = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                       NULL, hyscan_sensor_control_free_port);
-  priv->ports_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  priv->ports_by_name = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+  /* Маршруты сообщений от гидролокатора. */
+  priv->routes = g_array_new (FALSE, FALSE, sizeof (HyScanSensorControlRoute));
+
+  /* Очередь записи данных. */
+  g_mutex_init (&priv->write_lock);
+  g_cond_init (&priv->write_cond);
+  g_cond_init (&priv->flush_cond);
+  g_queue_init (&priv->write_queue);
+  priv->write_limit = HYSCAN_SENSOR_CONTROL_WRITE_QUEUE_SIZE;
 
   /* Параметры локальных портов. */
   priv->uart_devices = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
@@ -236,122 +291,40 @@ hyscan_sensor_control_object_constructed (GObject *object)
       return;
     }
 
-  /* Проверяем идентификатор и версию схемы гидролокатора. */
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/id", &id))
-    {
-      g_warning ("HyScanControl: unknown sonar schema id");
-      return;
-    }
-  if (id != HYSCAN_SONAR_SCHEMA_ID)
-    {
-      g_warning ("HyScanControl: sonar schema id mismatch");
-      return;
-    }
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/version", &version))
-    {
-      g_warning ("HyScanControl: unknown sonar schema version");
-      return;
-    }
-  if ((version / 100) != (HYSCAN_SONAR_SCHEMA_VERSION / 100))
-    {
-      g_warning ("HyScanControl: sonar schema version mismatch");
-      return;
-    }
-
-  /* Параметры гидролокатора. */
-  priv->schema = hyscan_param_schema (priv->sonar);
-  params = hyscan_data_schema_list_nodes (priv->schema);
+  /* Описание гидролокатора. */
+  priv->model = hyscan_sonar_model_new (priv->sonar);
+  if (priv->model == NULL)
+    return;
 
-  /* Ветка схемы с описанием портов - "/sensors". */
-  for (i = 0, sensors = NULL; i < params->n_nodes; i++)
-    {
-      if (g_strcmp0 (params->nodes[i]->path, "/sensors") == 0)
-        {
-          sensors = params->nodes[i];
-          break;
-        }
-    }
+  priv->schema = g_object_ref (priv->model->schema);
 
-  if (sensors != NULL)
+  /* Порты для подключения датчиков. */
+  for (i = 0; i < priv->model->n_ports; i++)
     {
-      /* Считываем описания портов. */
-      for (i = 0; i < sensors->n_nodes; i++)
-        {
-          HyScanSensorControlPort *port;
-
-          gchar *param_names[4];
-          GVariant *param_values[4];
-
-          gint64 id;
-          gint64 type;
-          gint64 protocol;
-
-          gchar **pathv;
-          gchar *name;
-
-          gboolean status;
-
-          param_names[0] = g_strdup_printf ("%s/id", sensors->nodes[i]->path);
-          param_names[1] = g_strdup_printf ("%s/type", sensors->nodes[i]->path);
-          param_names[2] = g_strdup_printf ("%s/protocol", sensors->nodes[i]->path);
-          param_names[3] = NULL;
-
-          status = hyscan_param_get (priv->sonar, (const gchar **)param_names, param_values);
+      const HyScanSonarModelPort *info = &priv->model->ports[i];
+      HyScanSensorControlPort *port;
 
-          if (status)
-            {
-              id = g_variant_get_int64 (param_values[0]);
-              type = g_variant_get_int64 (param_values[1]);
-              protocol = g_variant_get_int64 (param_values[2]);
-
-              g_variant_unref (param_values[0]);
-              g_variant_unref (param_values[1]);
-              g_variant_unref (param_values[2]);
-            }
-
-          g_free (param_names[0]);
-          g_free (param_names[1]);
-          g_free (param_names[2]);
+      port = g_new0 (HyScanSensorControlPort, 1);
+      port->name = info->name;
+      port->keys = info->keys;
+      port->type = info->type;
+      port->channel = 1;
+      port->protocol = info->protocol;
 
-          if (!status)
-            continue;
+      g_hash_table_insert (priv->ports_by_name, (gpointer)info->name, port);
 
-          if (id <= 0 || id > G_MAXINT32)
-            continue;
-
-          if (type != HYSCAN_SENSOR_PORT_VIRTUAL &&
-              type != HYSCAN_SENSOR_PORT_UART &&
-              type != HYSCAN_SENSOR_PORT_UDP_IP)
-            {
-              continue;
-            }
-
-          if (protocol != HYSCAN_SENSOR_PROTOCOL_SAS &&
-              protocol != HYSCAN_SENSOR_PROTOCOL_NMEA_0183)
-            {
-              continue;
-            }
-
-          pathv = g_strsplit (sensors->nodes[i]->path, "/", -1);
-          name = g_strdup (pathv[2]);
-          g_strfreev (pathv);
+      hyscan_sensor_control_add_route (control, info->id, hyscan_sensor_control_data_receiver, port);
+    }
 
-          /* Описание порта. */
-          port = g_new0 (HyScanSensorControlPort, 1);
-          port->name = name;
-          port->path = g_strdup (sensors->nodes[i]->path);
-          port->type = type;
-          port->channel = 1;
-          port->protocol = protocol;
+  /* Единый обработчик данных от гидролокатора. Сообщения направляются обработчикам
+   * этого класса и классов наследников по таблице маршрутов. Наследники добавляют
+   * свои маршруты при создании объекта. */
+  hyscan_sensor_control_apply_routes (control);
+  g_signal_connect_swapped (priv->sonar, "data",
+                            G_CALLBACK (hyscan_sensor_control_data_router), control);
 
-          g_hash_table_insert (priv->ports_by_id, GINT_TO_POINTER (id), port);
-          g_hash_table_insert (priv->ports_by_name, name, port);
-        }
-
-      /* Обработчик данных от гидролокатора. */
-      g_signal_connect_swapped (priv->sonar, "data",
-                                G_CALLBACK (hyscan_sensor_control_data_receiver), control);
-    }
+  /* Поток записи данных. */
+  priv->writer = g_thread_new ("sensor-control-writer", hyscan_sensor_control_writer, control);
 
   /* Локальные порты. */
   if ((priv->n_uart_ports > 0) || (priv->n_udp_ports > 0))
@@ -412,8 +385,6 @@ hyscan_sensor_control_object_constructed (GObject *object)
           g_free (name);
         }
     }
-
-  hyscan_data_schema_free_nodes (params);
 }
 
 static void
@@ -424,11 +395,22 @@ hyscan_sensor_control_object_finalize (GObject *object)
 
   g_signal_handlers_disconnect_by_data (priv->sonar, control);
 
+  /* Завершаем поток записи после записи всех сообщений из очереди. */
+  if (priv->writer != NULL)
+    {
+      g_mutex_lock (&priv->write_lock);
+      priv->write_shutdown = TRUE;
+      g_cond_signal (&priv->write_cond);
+      g_mutex_unlock (&priv->write_lock);
+
+      g_thread_join (priv->writer);
+    }
+
   g_clear_object (&priv->local_schema);
   g_clear_object (&priv->schema);
+  g_clear_pointer (&priv->model, hyscan_sonar_model_unref);
   g_clear_object (&priv->sonar);
 
-  g_hash_table_unref (priv->ports_by_id);
   g_hash_table_unref (priv->ports_by_name);
   g_hash_table_unref (priv->local_ports);
 
@@ -436,6 +418,14 @@ hyscan_sensor_control_object_finalize (GObject *object)
   g_hash_table_unref (priv->uart_modes);
   g_hash_table_unref (priv->ip_addresses);
 
+  g_array_unref (priv->routes);
+  g_clear_pointer (&priv->router, hyscan_sensor_control_free_router);
+  g_slist_free_full (priv->old_routers, hyscan_sensor_control_free_router);
+
+  g_mutex_clear (&priv->write_lock);
+  g_cond_clear (&priv->write_cond);
+  g_cond_clear (&priv->flush_cond);
+
   g_mutex_clear (&priv->lock);
 
   G_OBJECT_CLASS (hyscan_sensor_control_parent_class)->finalize (object);
@@ -561,17 +551,6 @@ hyscan_sensor_control_free_local_port (gpointer data)
   g_free (port);
 }
 
-/* Функция освобождает память, занятую структурой HyScanSensorControlPort. */
-static void
-hyscan_sensor_control_free_port (gpointer data)
-{
-  HyScanSensorControlPort *port = data;
-
-  g_free (port->path);
-  g_free (port->name);
-  g_free (port);
-}
-
 /* Функция устанавливает параметры работы локального UART порта. */
 static gboolean
 hyscan_sensor_control_setup_uart_port (HyScanSensorControl *control,
@@ -712,16 +691,13 @@ hyscan_sensor_control_local_receiver (HyScanSensorControl *control,
   g_mutex_unlock (&control->priv->lock);
 }
 
-/* Функция обрабатывает сообщения с данными от гидролокатора. */
+/* Функция обрабатывает сообщения с данными от датчиков гидролокатора. */
 static void
 hyscan_sensor_control_data_receiver (HyScanSensorControl *control,
+                                     gpointer             channel,
                                      HyScanSonarMessage  *message)
 {
-  HyScanSensorControlPort *port;
-
-  port = g_hash_table_lookup (control->priv->ports_by_id, GINT_TO_POINTER (message->id));
-  if (port == NULL)
-    return;
+  HyScanSensorControlPort *port = channel;
 
   g_mutex_lock (&control->priv->lock);
 
@@ -738,6 +714,289 @@ hyscan_sensor_control_data_receiver (HyScanSensorControl *control,
 
 }
 
+/* Функция направляет сообщение от гидролокатора обработчику его источника данных. */
+static void
+hyscan_sensor_control_data_router (HyScanSensorControl *control,
+                                   HyScanSonarMessage  *message)
+{
+  HyScanSensorControlRouter *router;
+  HyScanSensorControlRoute *route;
+
+  router = g_atomic_pointer_get (&control->priv->router);
+
+  if (message->id < router->n_routes)
+    route = &router->routes[message->id];
+  else if (router->sparse != NULL)
+    route = g_hash_table_lookup (router->sparse, GUINT_TO_POINTER (message->id));
+  else
+    return;
+
+  if ((route == NULL) || (route->func == NULL))
+    return;
+
+  route->func (control, route->channel, message);
+}
+
+/* Функция освобождает память, занятую таблицей маршрутов. */
+static void
+hyscan_sensor_control_free_router (gpointer data)
+{
+  HyScanSensorControlRouter *router = data;
+
+  if (router->sparse != NULL)
+    g_hash_table_unref (router->sparse);
+
+  g_free (router->routes);
+  g_free (router);
+}
+
+/* Функция возвращает описание гидролокатора. Наследники используют это описание
+ * вместо повторного разбора схемы гидролокатора. */
+HyScanSonarModel *
+hyscan_sensor_control_get_model (HyScanSensorControl *control)
+{
+  return control->priv->model;
+}
+
+/* Функция добавляет маршрут сообщений источника данных. */
+void
+hyscan_sensor_control_add_route (HyScanSensorControl         *control,
+                                 guint32                      id,
+                                 HyScanSensorControlDataFunc  func,
+                                 gpointer                     channel)
+{
+  HyScanSensorControlRoute route;
+
+  route.id = id;
+  route.func = func;
+  route.channel = channel;
+
+  g_array_append_val (control->priv->routes, route);
+}
+
+/* Функция строит таблицу маршрутов сообщений. Таблица заменяется целиком, так как
+ * может одновременно использоваться потоком приёма данных. Заменённые таблицы
+ * освобождаются при удалении объекта. Маршруты добавляются только при создании
+ * объекта, поэтому таких таблиц не больше числа классов в иерархии. */
+void
+hyscan_sensor_control_apply_routes (HyScanSensorControl *control)
+{
+  HyScanSensorControlPrivate *priv = control->priv;
+  HyScanSensorControlRouter *router;
+  guint32 n_routes = 0;
+  guint i;
+
+  for (i = 0; i < priv->routes->len; i++)
+    {
+      HyScanSensorControlRoute *route = &g_array_index (priv->routes, HyScanSensorControlRoute, i);
+
+      if (route->id < HYSCAN_SENSOR_CONTROL_MAX_DENSE_ID)
+        n_routes = MAX (n_routes, route->id + 1);
+    }
+
+  router = g_new0 (HyScanSensorControlRouter, 1);
+  router->n_routes = n_routes;
+  router->routes = g_new0 (HyScanSensorControlRoute, n_routes);
+
+  for (i = 0; i < priv->routes->len; i++)
+    {
+      HyScanSensorControlRoute *route = &g_array_index (priv->routes, HyScanSensorControlRoute, i);
+      HyScanSensorControlRoute *dst;
+
+      if (route->id < n_routes)
+        {
+          dst = &router->routes[route->id];
+        }
+      else
+        {
+          if (router->sparse == NULL)
+            router->sparse = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+          dst = g_hash_table_lookup (router->sparse, GUINT_TO_POINTER (route->id));
+          if (dst == NULL)
+            {
+              dst = g_new0 (HyScanSensorControlRoute, 1);
+              g_hash_table_insert (router->sparse, GUINT_TO_POINTER (route->id), dst);
+            }
+        }
+
+      if (dst->func != NULL)
+        g_warning ("HyScanControl: duplicate data source id %u", route->id);
+
+      *dst = *route;
+    }
+
+  if (priv->router != NULL)
+    priv->old_routers = g_slist_prepend (priv->old_routers, priv->router);
+
+  g_atomic_pointer_set (&priv->router, router);
+}
+
+/* Поток записи данных. Сообщения записываются в порядке помещения в очередь. */
+static gpointer
+hyscan_sensor_control_writer (gpointer data)
+{
+  HyScanSensorControl *control = data;
+  HyScanSensorControlPrivate *priv = control->priv;
+  HyScanSensorControlWriteStats *stats = &priv->write_stats;
+
+  g_mutex_lock (&priv->write_lock);
+
+  while (TRUE)
+    {
+      HyScanSensorControlWriteJob *job;
+      gint64 start_time;
+      gint64 write_time;
+
+      /* Сообщение записывается напрямую, минуя очередь. */
+      if (priv->writing)
+        {
+          g_cond_wait (&priv->write_cond, &priv->write_lock);
+          continue;
+        }
+
+      job = g_queue_pop_head (&priv->write_queue);
+      if (job == NULL)
+        {
+          g_cond_broadcast (&priv->flush_cond);
+
+          if (priv->write_shutdown)
+            break;
+
+          g_cond_wait (&priv->write_cond, &priv->write_lock);
+          continue;
+        }
+
+      priv->writing = TRUE;
+      stats->n_queued -= 1;
+      stats->queue_size -= job->size;
+
+      g_mutex_unlock (&priv->write_lock);
+
+      start_time = g_get_monotonic_time ();
+      job->func (control, job->channel, &job->message);
+      write_time = g_get_monotonic_time () - start_time;
+
+      g_mutex_lock (&priv->write_lock);
+
+      priv->writing = FALSE;
+      stats->n_written += 1;
+      stats->write_time += write_time;
+      stats->max_write_time = MAX (stats->max_write_time, write_time);
+      stats->max_delay = MAX (stats->max_delay, start_time - job->queue_time);
+
+      /* Очередь освободилась наполовину - сообщаем о следующем переполнении. */
+      if (stats->queue_size < priv->write_limit / 2)
+        priv->write_overflow = FALSE;
+
+      g_free (job);
+    }
+
+  g_mutex_unlock (&priv->write_lock);
+
+  return NULL;
+}
+
+/* Функция помещает копию сообщения в очередь записи. */
+void
+hyscan_sensor_control_write (HyScanSensorControl         *control,
+                             HyScanSensorControlDataFunc  func,
+                             gpointer                     channel,
+                             HyScanSonarMessage          *message)
+{
+  HyScanSensorControlPrivate *priv = control->priv;
+  HyScanSensorControlWriteStats *stats = &priv->write_stats;
+  HyScanSensorControlWriteJob *job;
+  gsize size;
+
+  if (priv->writer == NULL)
+    {
+      func (control, channel, message);
+      return;
+    }
+
+  size = sizeof (HyScanSensorControlWriteJob) + message->size;
+
+  g_mutex_lock (&priv->write_lock);
+
+  /* Очередь отключена - данные записываются сразу, после записи всех ранее помещённых
+   * в очередь сообщений. Блокировка очереди удерживается только на время ожидания,
+   * сама запись выполняется без неё. Признак writing не позволяет другим потокам
+   * начать запись до её завершения, что сохраняет порядок записи сообщений. */
+  if (priv->write_limit == 0)
+    {
+      while ((stats->n_queued > 0) || priv->writing)
+        g_cond_wait (&priv->flush_cond, &priv->write_lock);
+
+      priv->writing = TRUE;
+      g_mutex_unlock (&priv->write_lock);
+
+      func (control, channel, message);
+
+      g_mutex_lock (&priv->write_lock);
+      priv->writing = FALSE;
+      g_cond_broadcast (&priv->flush_cond);
+      g_cond_signal (&priv->write_cond);
+      g_mutex_unlock (&priv->write_lock);
+
+      return;
+    }
+
+  /* Очередь переполнена - данные не записываются. */
+  if (stats->queue_size + size > priv->write_limit)
+    {
+      if (!priv->write_overflow)
+        g_warning ("HyScanSensorControl: write queue overflow, data will be lost");
+
+      priv->write_overflow = TRUE;
+      stats->n_dropped += 1;
+
+      g_mutex_unlock (&priv->write_lock);
+
+      return;
+    }
+
+  stats->n_queued += 1;
+  stats->queue_size += size;
+  stats->max_queue_size = MAX (stats->max_queue_size, stats->queue_size);
+
+  g_mutex_unlock (&priv->write_lock);
+
+  /* Копия сообщения. */
+  job = g_malloc (size);
+  job->func = func;
+  job->channel = channel;
+  job->queue_time = g_get_monotonic_time ();
+  job->size = size;
+  job->message = *message;
+  job->message.data = job + 1;
+  job->message.n_parts = 0;
+  job->message.parts = NULL;
+  memcpy (job + 1, message->data, message->size);
+
+  g_mutex_lock (&priv->write_lock);
+  g_queue_push_tail (&priv->write_queue, job);
+  g_cond_signal (&priv->write_cond);
+  g_mutex_unlock (&priv->write_lock);
+}
+
+/* Функция ожидает завершения записи всех сообщений из очереди. */
+void
+hyscan_sensor_control_write_flush (HyScanSensorControl *control)
+{
+  HyScanSensorControlPrivate *priv = control->priv;
+
+  if (priv->writer == NULL)
+    return;
+
+  /* Счётчик n_queued учитывает и сообщения, место для которых в очереди уже занято,
+   * но которые ещё не помещены в очередь. */
+  g_mutex_lock (&priv->write_lock);
+  while ((priv->write_stats.n_queued > 0) || priv->writing)
+    g_cond_wait (&priv->flush_cond, &priv->write_lock);
+  g_mutex_unlock (&priv->write_lock);
+}
+
 /* Функция проверяет контрольную сумму NMEA сообщения. */
 static gboolean
 hyscan_sensor_control_check_nmea_crc (const gchar *nmea_str)
@@ -761,6 +1020,48 @@ hyscan_sensor_control_check_nmea_crc (const gchar *nmea_str)
   return TRUE;
 }
 
+/* Функция устанавливает максимальный объём данных в очереди записи. */
+void
+hyscan_sensor_control_set_write_queue_size (HyScanSensorControl *control,
+                                            gsize                max_size)
+{
+  g_return_if_fail (HYSCAN_IS_SENSOR_CONTROL (control));
+
+  g_mutex_lock (&control->priv->write_lock);
+  control->priv->write_limit = max_size;
+  g_mutex_unlock (&control->priv->write_lock);
+
+  /* При отключении очереди новые сообщения записываются только после записи
+   * накопленных данных. Дожидаемся записи накопленных данных. */
+  if (max_size == 0)
+    hyscan_sensor_control_write_flush (control);
+}
+
+/* Функция возвращает статистику очереди записи данных. */
+gboolean
+hyscan_sensor_control_get_write_stats (HyScanSensorControl           *control,
+                                       HyScanSensorControlWriteStats *stats)
+{
+  HyScanSensorControlPrivate *priv;
+
+  g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  priv = control->priv;
+
+  g_mutex_lock (&priv->write_lock);
+
+  *stats = priv->write_stats;
+
+  priv->write_stats.max_queue_size = priv->write_stats.queue_size;
+  priv->write_stats.max_delay = 0;
+  priv->write_stats.max_write_time = 0;
+
+  g_mutex_unlock (&priv->write_lock);
+
+  return TRUE;
+}
+
 /* Функция возвращает список портов, к которым могут быть подключены датчики. */
 gchar **
 hyscan_sensor_control_list_ports (HyScanSensorControl *control)
@@ -782,7 +1083,7 @@ hyscan_sensor_control_list_ports (HyScanSensorControl *control)
     return NULL;
 
   n_local_ports = g_hash_table_size (priv->local_ports);
-  n_ports = g_hash_table_size (priv->ports_by_id);
+  n_ports = g_hash_table_size (priv->ports_by_name);
   if ((n_local_ports == 0) && (n_ports == 0))
     return NULL;
 
@@ -809,7 +1110,7 @@ hyscan_sensor_control_list_uart_devices (HyScanSensorControl *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
   const gchar *values_id;
-  gchar *param_name;
+  const gchar *param_name;
 
   g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), NULL);
 
@@ -826,11 +1127,10 @@ hyscan_sensor_control_list_uart_devices (HyScanSensorControl *control,
   if ((port == NULL) || (port->type != HYSCAN_SENSOR_PORT_UART))
     return NULL;
 
-  param_name = g_strdup_printf ("%s/uart-device", port->path);
+  param_name = port->keys[HYSCAN_SONAR_MODEL_PORT_UART_DEVICE];
   values_id = hyscan_data_schema_key_get_enum_id (priv->schema, param_name);
   if (values_id != NULL)
     param_values = hyscan_data_schema_key_get_enum_values (priv->schema, values_id);
-  g_free (param_name);
 
   return param_values;
 }
@@ -845,7 +1145,7 @@ hyscan_sensor_control_list_uart_modes (HyScanSensorControl *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
   const gchar *values_id;
-  gchar *param_name;
+  const gchar *param_name;
 
   g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), NULL);
 
@@ -862,11 +1162,10 @@ hyscan_sensor_control_list_uart_modes (HyScanSensorControl *control,
   if ((port == NULL) || (port->type != HYSCAN_SENSOR_PORT_UART))
     return NULL;
 
-  param_name = g_strdup_printf ("%s/uart-mode", port->path);
+  param_name = port->keys[HYSCAN_SONAR_MODEL_PORT_UART_MODE];
   values_id = hyscan_data_schema_key_get_enum_id (priv->schema, param_name);
   if (values_id != NULL)
     param_values = hyscan_data_schema_key_get_enum_values (priv->schema, values_id);
-  g_free (param_name);
 
   return param_values;
 }
@@ -881,7 +1180,7 @@ hyscan_sensor_control_list_ip_addresses (HyScanSensorControl *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
   const gchar *values_id;
-  gchar *param_name;
+  const gchar *param_name;
 
   g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), NULL);
 
@@ -898,11 +1197,10 @@ hyscan_sensor_control_list_ip_addresses (HyScanSensorControl *control,
   if ((port == NULL) || (port->type != HYSCAN_SENSOR_PORT_UDP_IP))
     return NULL;
 
-  param_name = g_strdup_printf ("%s/ip-address", port->path);
+  param_name = port->keys[HYSCAN_SONAR_MODEL_PORT_IP_ADDRESS];
   values_id = hyscan_data_schema_key_get_enum_id (priv->schema, param_name);
   if (values_id != NULL)
     param_values = hyscan_data_schema_key_get_enum_values (priv->schema, values_id);
-  g_free (param_name);
 
   return param_values;
 }
@@ -966,7 +1264,7 @@ hyscan_sensor_control_get_port_status (HyScanSensorControl *control,
   HyScanSensorControlPort *port;
 
   gint64 port_status;
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), HYSCAN_SENSOR_PORT_STATUS_INVALID);
@@ -1008,9 +1306,8 @@ hyscan_sensor_control_get_port_status (HyScanSensorControl *control,
   if (port == NULL)
     return HYSCAN_SENSOR_PORT_STATUS_INVALID;
 
-  param_name = g_strdup_printf ("%s/status", port->path);
+  param_name = port->keys[HYSCAN_SONAR_MODEL_PORT_STATUS];
   status = hyscan_param_get_enum (priv->sonar, param_name, &port_status);
-  g_free (param_name);
 
   if (!status)
     port_status = HYSCAN_SENSOR_PORT_STATUS_INVALID;
@@ -1028,7 +1325,7 @@ hyscan_sensor_control_set_virtual_port_param (HyScanSensorControl     *control,
   HyScanSensorControlPrivate *priv;
   HyScanSensorControlPort *port;
 
-  gchar *param_names[3];
+  const gchar *param_names[3];
   GVariant *param_values[3];
   gboolean status;
 
@@ -1054,15 +1351,15 @@ hyscan_sensor_control_set_virtual_port_param (HyScanSensorControl     *control,
 
   g_mutex_lock (&priv->lock);
 
-  param_names[0] = g_strdup_printf ("%s/channel", port->path);
-  param_names[1] = g_strdup_printf ("%s/time-offset", port->path);
+  param_names[0] = port->keys[HYSCAN_SONAR_MODEL_PORT_CHANNEL];
+  param_names[1] = port->keys[HYSCAN_SONAR_MODEL_PORT_TIME_OFFSET];
   param_names[2] = NULL;
 
   param_values[0] = g_variant_new_int64 (channel);
   param_values[1] = g_variant_new_int64 (time_offset);
   param_values[2] = NULL;
 
-  status = hyscan_param_set (priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -1070,9 +1367,6 @@ hyscan_sensor_control_set_virtual_port_param (HyScanSensorControl     *control,
       g_variant_unref (param_values[1]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-
   if (status)
     {
       port->channel = channel;
@@ -1098,7 +1392,7 @@ hyscan_sensor_control_set_uart_port_param (HyScanSensorControl      *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
 
-  gchar *param_names[6];
+  const gchar *param_names[6];
   GVariant *param_values[6];
   gboolean status;
 
@@ -1146,11 +1440,11 @@ hyscan_sensor_control_set_uart_port_param (HyScanSensorControl      *control,
 
   g_mutex_lock (&priv->lock);
 
-  param_names[0] = g_strdup_printf ("%s/protocol", port->path);
-  param_names[1] = g_strdup_printf ("%s/uart-device", port->path);
-  param_names[2] = g_strdup_printf ("%s/uart-mode", port->path);
-  param_names[3] = g_strdup_printf ("%s/channel", port->path);
-  param_names[4] = g_strdup_printf ("%s/time-offset", port->path);
+  param_names[0] = port->keys[HYSCAN_SONAR_MODEL_PORT_PROTOCOL];
+  param_names[1] = port->keys[HYSCAN_SONAR_MODEL_PORT_UART_DEVICE];
+  param_names[2] = port->keys[HYSCAN_SONAR_MODEL_PORT_UART_MODE];
+  param_names[3] = port->keys[HYSCAN_SONAR_MODEL_PORT_CHANNEL];
+  param_names[4] = port->keys[HYSCAN_SONAR_MODEL_PORT_TIME_OFFSET];
   param_names[5] = NULL;
 
   param_values[0] = g_variant_new_int64 (protocol);
@@ -1160,7 +1454,7 @@ hyscan_sensor_control_set_uart_port_param (HyScanSensorControl      *control,
   param_values[4] = g_variant_new_int64 (time_offset);
   param_values[5] = NULL;
 
-  status = hyscan_param_set (priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -1171,12 +1465,6 @@ hyscan_sensor_control_set_uart_port_param (HyScanSensorControl      *control,
       g_variant_unref (param_values[4]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-  g_free (param_names[3]);
-  g_free (param_names[4]);
-
   if (status)
     {
       port->channel = channel;
@@ -1203,7 +1491,7 @@ hyscan_sensor_control_set_udp_ip_port_param (HyScanSensorControl      *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
 
-  gchar *param_names[6];
+  const gchar *param_names[6];
   GVariant *param_values[6];
   gboolean status;
 
@@ -1251,11 +1539,11 @@ hyscan_sensor_control_set_udp_ip_port_param (HyScanSensorControl      *control,
 
   g_mutex_lock (&priv->lock);
 
-  param_names[0] = g_strdup_printf ("%s/protocol", port->path);
-  param_names[1] = g_strdup_printf ("%s/ip-address", port->path);
-  param_names[2] = g_strdup_printf ("%s/udp-port", port->path);
-  param_names[3] = g_strdup_printf ("%s/channel", port->path);
-  param_names[4] = g_strdup_printf ("%s/time-offset", port->path);
+  param_names[0] = port->keys[HYSCAN_SONAR_MODEL_PORT_PROTOCOL];
+  param_names[1] = port->keys[HYSCAN_SONAR_MODEL_PORT_IP_ADDRESS];
+  param_names[2] = port->keys[HYSCAN_SONAR_MODEL_PORT_UDP_PORT];
+  param_names[3] = port->keys[HYSCAN_SONAR_MODEL_PORT_CHANNEL];
+  param_names[4] = port->keys[HYSCAN_SONAR_MODEL_PORT_TIME_OFFSET];
   param_names[5] = NULL;
 
   param_values[0] = g_variant_new_int64 (protocol);
@@ -1265,7 +1553,7 @@ hyscan_sensor_control_set_udp_ip_port_param (HyScanSensorControl      *control,
   param_values[4] = g_variant_new_int64 (time_offset);
   param_values[5] = NULL;
 
-  status = hyscan_param_set (priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -1276,12 +1564,6 @@ hyscan_sensor_control_set_udp_ip_port_param (HyScanSensorControl      *control,
       g_variant_unref (param_values[4]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-  g_free (param_names[3]);
-  g_free (param_names[4]);
-
   if (status)
     {
       port->channel = channel;
@@ -1304,7 +1586,7 @@ hyscan_sensor_control_set_position (HyScanSensorControl   *control,
   HyScanSensorControlLocalPort *local_port;
   HyScanSensorControlPort *port;
 
-  gchar *param_names[7];
+  const gchar *param_names[7];
   GVariant *param_values[7];
   gboolean status = FALSE;
 
@@ -1328,12 +1610,12 @@ hyscan_sensor_control_set_position (HyScanSensorControl   *control,
 
   g_mutex_lock (&priv->lock);
 
-  param_names[0] = g_strdup_printf ("%s/position/x", port->path);
-  param_names[1] = g_strdup_printf ("%s/position/y", port->path);
-  param_names[2] = g_strdup_printf ("%s/position/z", port->path);
-  param_names[3] = g_strdup_printf ("%s/position/psi", port->path);
-  param_names[4] = g_strdup_printf ("%s/position/gamma", port->path);
-  param_names[5] = g_strdup_printf ("%s/position/theta", port->path);
+  param_names[0] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_X];
+  param_names[1] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_Y];
+  param_names[2] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_Z];
+  param_names[3] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_PSI];
+  param_names[4] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_GAMMA];
+  param_names[5] = port->keys[HYSCAN_SONAR_MODEL_PORT_POSITION_THETA];
   param_names[6] = NULL;
 
   param_values[0] = g_variant_new_double (position->x);
@@ -1344,7 +1626,7 @@ hyscan_sensor_control_set_position (HyScanSensorControl   *control,
   param_values[5] = g_variant_new_double (position->theta);
   param_values[6] = NULL;
 
-  status = hyscan_param_set (priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -1356,13 +1638,6 @@ hyscan_sensor_control_set_position (HyScanSensorControl   *control,
       g_variant_unref (param_values[5]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-  g_free (param_names[3]);
-  g_free (param_names[4]);
-  g_free (param_names[5]);
-
   g_mutex_unlock (&priv->lock);
 
 exit:
@@ -1381,7 +1656,7 @@ hyscan_sensor_control_set_enable (HyScanSensorControl *control,
   HyScanSensorControlPrivate *priv;
   HyScanSensorControlPort *port;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status = FALSE;
 
   g_return_val_if_fail (HYSCAN_IS_SENSOR_CONTROL (control), FALSE);
@@ -1405,9 +1680,8 @@ hyscan_sensor_control_set_enable (HyScanSensorControl *control,
   if (port == NULL)
     goto exit;
 
-  param_name = g_strdup_printf ("%s/enable", port->path);
+  param_name = port->keys[HYSCAN_SONAR_MODEL_PORT_ENABLE];
   status = hyscan_param_set_boolean (priv->sonar, param_name, enable);
-  g_free (param_name);
 
 exit:
   g_mutex_unlock (&priv->lock);
@@ -84,6 +84,14 @@
  * - type - тип данных;
  * - data - данные.
  *
+ * Данные от гидролокатора записываются отдельным потоком через очередь записи. Это
+ * позволяет не задерживать приём данных и отправку сигналов с ними, если запись в базу
+ * данных временно замедлилась. Объём данных в очереди ограничивается функцией
+ * #hyscan_sensor_control_set_write_queue_size. При переполнении очереди новые данные
+ * не записываются, но сигналы с ними отправляются. Состояние очереди можно узнать
+ * функцией #hyscan_sensor_control_get_write_stats. Данные от датчиков записываются
+ * без очереди.
+ *
  * Класс HyScanSensorControl поддерживает работу в многопоточном режиме.
  *
  */
@@ -127,6 +135,19 @@ typedef enum
   HYSCAN_SENSOR_PORT_STATUS_ERROR                      = 104   /**< Нет данных. */
 } HyScanSensorPortStatus;
 
+/** \brief Статистика очереди записи данных. */
+typedef struct
+{
+  guint                        n_queued;                       /**< Число сообщений в очереди. */
+  gsize                        queue_size;                     /**< Объём данных в очереди, байт. */
+  gsize                        max_queue_size;                 /**< Максимальный объём данных в очереди, байт. */
+  guint64                      n_written;                      /**< Число записанных сообщений. */
+  guint64                      n_dropped;                      /**< Число сообщений, отброшенных при переполнении очереди. */
+  gint64                       max_delay;                      /**< Максимальное время ожидания сообщения в очереди, мкс. */
+  gint64                       max_write_time;                 /**< Максимальное время записи одного сообщения, мкс. */
+  gint64                       write_time;                     /**< Суммарное время записи сообщений, мкс. */
+} HyScanSensorControlWriteStats;
+
 #define HYSCAN_TYPE_SENSOR_CONTROL             (hyscan_sensor_control_get_type ())
 #define HYSCAN_SENSOR_CONTROL(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), HYSCAN_TYPE_SENSOR_CONTROL, HyScanSensorControl))
 #define HYSCAN_IS_SENSOR_CONTROL(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), HYSCAN_TYPE_SENSOR_CONTROL))
@@ -362,6 +383,38 @@ gboolean                       hyscan_sensor_control_set_enable                (
                                                                                 const gchar               *name,
                                                                                 gboolean                   enable);
 
+/**
+ *
+ * Функция устанавливает максимальный объём данных в очереди записи. По умолчанию
+ * используется очередь объёмом 64 Мб. Если max_size равен нулю, данные записываются
+ * сразу при приёме, в потоке доставки данных от гидролокатора. При отключении очереди
+ * новые данные записываются только после записи данных, накопленных в очереди.
+ *
+ * \param control указатель на класс \link HyScanSensorControl \endlink;
+ * \param max_size максимальный объём данных в очереди, байт.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                           hyscan_sensor_control_set_write_queue_size      (HyScanSensorControl       *control,
+                                                                                gsize                      max_size);
+
+/**
+ *
+ * Функция возвращает статистику очереди записи данных. Максимальные значения
+ * сбрасываются при каждом вызове функции.
+ *
+ * \param control указатель на класс \link HyScanSensorControl \endlink;
+ * \param stats указатель на структуру \link HyScanSensorControlWriteStats \endlink.
+ *
+ * \return TRUE - если статистика считана, FALSE - в случае ошибки.
+ *
+ */
+HYSCAN_API
+gboolean                       hyscan_sensor_control_get_write_stats           (HyScanSensorControl       *control,
+                                                                                HyScanSensorControlWriteStats *stats);
+
 G_END_DECLS
 
 #endif /* __HYSCAN_SENSOR_CONTROL_H__ */
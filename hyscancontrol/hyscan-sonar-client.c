@@ -11,6 +11,7 @@
 #include "hyscan-sonar-messages.h"
 #include "hyscan-sonar-client.h"
 #include "hyscan-sonar-rpc.h"
+#include "hyscan-sonar-receiver.h"
 
 #include <hyscan-slice-pool.h>
 #include <urpc-client.h>
@@ -19,6 +20,52 @@
 #include <string.h>
 #include <zlib.h>
 
+#ifdef G_OS_UNIX
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <errno.h>
+#endif
+
+/* Метки времени приёма датаграмм ядром: с наносекундным разрешением, если
+ * поддерживается, иначе с микросекундным. */
+#if defined (G_OS_UNIX) && defined (SO_TIMESTAMPNS)
+#define HYSCAN_SONAR_CLIENT_SO_TIMESTAMP       SO_TIMESTAMPNS
+#define HYSCAN_SONAR_CLIENT_SCM_TIMESTAMP      SCM_TIMESTAMPNS
+#define HYSCAN_SONAR_CLIENT_TIMESTAMP_USEC(t)  ((gint64)(t).tv_sec * G_USEC_PER_SEC + (t).tv_nsec / 1000)
+typedef struct timespec HyScanSonarClientTimestamp;
+#elif defined (G_OS_UNIX) && defined (SO_TIMESTAMP)
+#define HYSCAN_SONAR_CLIENT_SO_TIMESTAMP       SO_TIMESTAMP
+#define HYSCAN_SONAR_CLIENT_SCM_TIMESTAMP      SCM_TIMESTAMP
+#define HYSCAN_SONAR_CLIENT_TIMESTAMP_USEC(t)  ((gint64)(t).tv_sec * G_USEC_PER_SEC + (t).tv_usec)
+typedef struct timeval HyScanSonarClientTimestamp;
+#endif
+
+#define HYSCAN_SONAR_CLIENT_HEADER_SIZE        offsetof (HyScanSonarRpcPacket, data)
+#define HYSCAN_SONAR_CLIENT_MIN_RTO            0.01
+#define HYSCAN_SONAR_CLIENT_RTO_GRANULARITY    0.001
+#define HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE     128
+#define HYSCAN_SONAR_CLIENT_WHEEL_SLOTS        256
+#define HYSCAN_SONAR_CLIENT_WHEEL_TICK         (10 * G_TIME_SPAN_MILLISECOND)
+#define HYSCAN_SONAR_CLIENT_REPORT_INTERVAL    (10 * G_TIME_SPAN_SECOND)
+#define HYSCAN_SONAR_CLIENT_STATS_PREFIX       "/stats/"
+#define HYSCAN_SONAR_CLIENT_MAX_VECTORS        3
+#define HYSCAN_SONAR_CLIENT_RECEIVE_BATCH      64
+#define HYSCAN_SONAR_CLIENT_DELIVER_BATCH      32
+#define HYSCAN_SONAR_CLIENT_SEQ_WINDOW         1024
+#define HYSCAN_SONAR_CLIENT_SEQ_RESET          65536
+
+#define HYSCAN_SONAR_CLIENT_SLOT_SIZE          ((sizeof (HyScanSonarRpcPacket) + 63) & ~(gsize)63)
+#define HYSCAN_SONAR_CLIENT_SLAB_ALIGN         65536
+#define HYSCAN_SONAR_CLIENT_HUGE_PAGE_SIZE     (2 * 1024 * 1024)
+
+/* Файл записи принятых пакетов начинается с заголовка из идентификатора формата и
+ * его версии. Далее следуют записи пакетов: время приёма (gint64, микросекунды UTC),
+ * размер пакета (guint32) и сам пакет. Все числа записываются в формате little endian. */
+#define HYSCAN_SONAR_CLIENT_CAPTURE_MAGIC      0x50414353
+#define HYSCAN_SONAR_CLIENT_CAPTURE_VERSION    1
+#define HYSCAN_SONAR_CLIENT_CAPTURE_RECORD_SIZE (sizeof (gint64) + sizeof (guint32))
+
 #define hyscan_sonar_client_lock_error()       do { \
                                                  g_warning ("HyScanSonarClient: can't lock '%s'", \
                                                             __FUNCTION__); \
@@ -54,7 +101,10 @@ enum
   PROP_TIMEOUT,
   PROP_N_EXEC,
   PROP_MASTER,
-  PROP_N_BUFFERS
+  PROP_N_BUFFERS,
+  PROP_N_WORKERS,
+  PROP_N_SESSIONS,
+  PROP_RECEIVER
 };
 
 enum
@@ -63,27 +113,219 @@ enum
   SIGNAL_LAST
 };
 
+typedef struct _HyScanSonarClientSource HyScanSonarClientSource;
+
+/* Статистика приёма данных источника. Счётчики приёма изменяются только потоком
+ * приёма, гистограмма задержки - только потоком доставки сообщений источника.
+ * Структуры объединены в список, новые источники добавляются в его начало атомарно,
+ * поэтому чтение статистики выполняется без блокировок. Каждая группа счётчиков
+ * изменяется между двумя атомарными увеличениями своего номера изменения, другие
+ * потоки повторяют чтение, пока номер нечётный или изменился за время чтения. */
+struct _HyScanSonarClientSource
+{
+  HyScanSonarClientSource *next;               /* Следующий источник данных. */
+  guint32              id;                     /* Идентификатор источника данных. */
+  gint                 rx_seq;                 /* Номер изменения счётчиков приёма. */
+  gint                 latency_seq;            /* Номер изменения гистограммы задержки. */
+  guint32              last_index;             /* Номер последнего принятого пакета. */
+
+  guint64              n_packets;              /* Число принятых пакетов. */
+  guint64              n_bytes;                /* Объём принятых данных. */
+  guint64              n_lost;                 /* Число потерянных фрагментов. */
+  guint64              n_crc_errors;           /* Число пакетов с ошибкой контрольной суммы. */
+  guint64              n_malformed;            /* Число пакетов с ошибкой формата. */
+  guint64              n_duplicates;           /* Число повторно принятых фрагментов. */
+  guint64              n_overruns;             /* Число пакетов, отброшенных из-за нехватки буферов. */
+  guint64              n_incomplete;           /* Число доставленных неполных сообщений. */
+  guint32              max_reorder;            /* Максимальная глубина переупорядочивания пакетов. */
+
+  guint64              n_latency;              /* Число измерений задержки доставки. */
+  guint64              latency[HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE];
+                                               /* Гистограмма задержки доставки. */
+
+  guint64              reported[6];            /* Значения счётчиков ошибок в последней сводке. */
+};
+
+typedef struct _HyScanSonarClientPool HyScanSonarClientPool;
+
+/* Буфер сборки сообщения. Доставленное сообщение размещается в самом буфере,
+ * буфер возвращается в кучу после освобождения последней ссылки на сообщение. */
 typedef struct
 {
+  HyScanSonarMessage   message;                /* Доставляемое сообщение. */
+  HyScanSonarClientPool *pool;                 /* Куча, которой принадлежит буфер. */
+  gint                 ref_count;              /* Число ссылок на доставленное сообщение. */
+
   guint32              id;                     /* Идентификатор источника данных. */
+  HyScanSonarClientSource *source;             /* Статистика источника данных. */
   gint64               time;                   /* Метка времени данных. */
   guint32              type;                   /* Тип данных. */
   gfloat               rate;                   /* Частота дискретизации данных, Гц. */
   guint32              size;                   /* Целевой размер. */
-  guint32              cur_size;               /* Текущий размер данных. */
   gchar               *buffer;                 /* Буфер для данных. */
   guint32              buffer_size;            /* Размер буфера для данных. */
-  GTimer              *timer;                  /* Таймер. */
+  gboolean             in_arena;               /* Признак размещения буфера данных в общей области памяти. */
+  guint32             *parts;                  /* Битовая маска принятых фрагментов. */
+  guint32              parts_size;             /* Размер битовой маски, в словах. */
+  guint32              n_parts;                /* Число фрагментов в сообщении. */
+  guint32              n_received;             /* Число принятых фрагментов. */
+  HyScanSonarRpcPacket *packet;                /* Пакет с данными сообщения из одного фрагмента. */
+  gint64               update_time;            /* Время приёма последнего фрагмента. */
+  gint64               arrival_time;           /* Время приёма последнего фрагмента ядром, UTC. */
+  gint64               flush_timeout;          /* Время ожидания недостающих фрагментов. */
+  gboolean             deliver;                /* Признак доставки неполного сообщения. */
+  GList                wheel_link;             /* Элемент списка ячейки таймера. */
+  guint                wheel_slot;             /* Номер ячейки таймера. */
 } HyScanSonarClientBuffer;
 
+typedef struct
+{
+  GQueue               slots[HYSCAN_SONAR_CLIENT_WHEEL_SLOTS];
+                                               /* Ячейки таймера. */
+  gint64               tick;                   /* Номер последнего обработанного интервала. */
+  guint                n_entries;              /* Число сообщений в таймере. */
+} HyScanSonarClientWheel;
+
+typedef struct
+{
+  guint8              *data;                   /* Область памяти. */
+  gsize                size;                   /* Размер области памяти. */
+  gboolean             mapped;                 /* Признак отображённой области памяти. */
+} HyScanSonarClientArena;
+
+/* Куча буферов клиента. Ссылки на кучу удерживают клиент и все ссылки на
+ * доставленные сообщения, полученные функцией hyscan_sonar_client_message_ref,
+ * поэтому куча освобождается после освобождения последней из них. */
+struct _HyScanSonarClientPool
+{
+  gint                 ref_count;              /* Счётчик ссылок. */
+  HyScanSlicePool     *buffers;                /* Буферы данных. */
+  HyScanSlicePool     *messages;               /* Буферы сборки сообщений. */
+  HyScanSonarClientArena packet_arena;         /* Область памяти буферов данных. */
+  HyScanSonarClientArena message_arena;        /* Область памяти буферов сборки сообщений. */
+  GRWLock              lock;                   /* Блокировка доступа к куче буферов. */
+};
+
+typedef struct
+{
+  GSocket             *socket;                 /* Сокет приёма пакетов. */
+  GInputStream        *replay;                 /* Файл записанных пакетов. */
+  gdouble              speed;                  /* Скорость воспроизведения. */
+  gint64               start_time;             /* Время начала воспроизведения. */
+  gint64               first_time;             /* Время приёма первого записанного пакета. */
+  gint64               time;                   /* Время приёма текущего пакета. */
+  guint8              *datagram;               /* Текущий воспроизводимый пакет. */
+  gsize                size;                   /* Размер текущего пакета. */
+  gboolean             pending;                /* Признак наличия непрочитанного пакета. */
+} HyScanSonarClientInput;
+
+/* Окно номеров принятых пакетов. Номера пакетов сквозные для всех источников,
+ * поэтому пропуск номера означает потерю пакета, даже если по самому пакету
+ * нельзя определить его источник или сообщение. */
+typedef struct
+{
+  gboolean             started;                /* Признак приёма первого пакета. */
+  guint32              next;                   /* Номер, следующий за наибольшим принятым. */
+  guint32              received[HYSCAN_SONAR_CLIENT_SEQ_WINDOW / 32];
+                                               /* Битовая маска принятых номеров окна. */
+} HyScanSonarClientSequence;
+
+/* Состояние приёма сообщений. */
+typedef struct
+{
+  HyScanSonarClientInput input;                /* Источник пакетов. */
+  HyScanSonarClientSequence sequence;          /* Окно номеров принятых пакетов. */
+  HyScanSonarClientWheel wheel;                /* Таймер ожидания фрагментов сообщений. */
+  GHashTable          *buffers;                /* Буферы сборки сообщений по источникам данных. */
+  GHashTable          *sources;                /* Статистика приёма по источникам данных. */
+  gint64               report_time;            /* Время последней сводки ошибок приёма. */
+} HyScanSonarClientReception;
+
+typedef struct
+{
+  gint64               timeout;                /* Время ожидания недостающих фрагментов. */
+  gboolean             deliver;                /* Признак доставки неполного сообщения. */
+} HyScanSonarClientFlushPolicy;
+
+typedef struct
+{
+  gchar              **names;                  /* Названия параметров. */
+  GVariant           **values;                 /* Значения параметров. */
+  gint64               deadline;               /* Время завершения запроса. */
+} HyScanSonarClientRequest;
+
+typedef struct
+{
+  HyScanSonarClientProgressFunc func;          /* Функция уведомления о ходе подключения. */
+  gpointer             data;                   /* Пользовательские данные. */
+  HyScanSonarClientStage stage;                /* Выполненный этап подключения. */
+} HyScanSonarClientProgress;
+
+typedef struct
+{
+  gboolean             set;                    /* Признак запроса установки значений. */
+  uRpcClient          *rpc;                    /* RPC сессия. */
+  gchar              **names;                  /* Названия параметров. */
+  GVariant           **values;                 /* Значения параметров. */
+  GAsyncQueue         *results;                /* Очередь результатов попыток запроса. */
+  gint64               start;                  /* Время начала попытки. */
+  gint64               rtt;                    /* Время выполнения попытки. */
+  guint32              status;                 /* Результат выполнения попытки. */
+} HyScanSonarClientAttempt;
+
+/* Функция приёма данных. Список функций заменяется целиком при добавлении
+ * или удалении функции, поэтому функция может выполняться после удаления
+ * из списка, пока не завершится доставка текущих сообщений. */
+typedef struct
+{
+  gint                 ref_count;              /* Счётчик ссылок. */
+  guint                id;                     /* Идентификатор функции. */
+  guint32              source;                 /* Идентификатор источника данных. */
+  guint32              type;                   /* Тип данных. */
+  HyScanSonarClientSinkFunc func;              /* Функция приёма данных. */
+  gpointer             user_data;              /* Пользовательские данные. */
+  GDestroyNotify       destroy;                /* Функция освобождения пользовательских данных. */
+} HyScanSonarClientSink;
+
+typedef struct
+{
+  HyScanSonarClient   *client;                 /* Указатель на объект клиента. */
+  GThread             *emitter;                /* Поток доставки сообщений гидролокатора. */
+
+  GMutex               queue_lock;             /* Блокировка очереди собранных сообщений. */
+  GCond                queue_cond;             /* Семафор очереди собранных сообщений. */
+  GQueue              *queue;                  /* Очередь собранных сообщений. */
+} HyScanSonarClientWorker;
+
 struct _HyScanSonarClientPrivate
 {
+  HyScanSonarClient   *client;                 /* Указатель на объект клиента. */
   gchar               *host;                   /* Адрес гидролокатора. */
   gdouble              timeout;                /* Таймаут RPC соединения. */
   guint                n_exec;                 /* Число попыток выполнения RPC запроса. */
   gboolean             master;                 /* Признак "главного" подключения. */
 
   uRpcClient          *rpc;                    /* RPC клиент. */
+  guint                n_sessions;             /* Число RPC сессий. */
+  GAsyncQueue         *sessions;               /* Свободные RPC сессии. */
+  GThreadPool         *attempts;               /* Пул потоков выполнения попыток запросов. */
+
+  GMutex               rtt_lock;               /* Блокировка доступа к статистике RPC. */
+  gdouble              srtt;                   /* Сглаженное время обращения к серверу, с. */
+  gdouble              rttvar;                 /* Отклонение времени обращения к серверу, с. */
+  gdouble              rto;                    /* Таймаут повтора запроса, с. */
+  gint64               loss_time;              /* Время обнаружения потерь пакетов. */
+  guint64              rtt_samples;            /* Число измерений времени обращения. */
+  guint64              rtt_histogram[HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE];
+                                               /* Гистограмма времени обращения. */
+  guint64              n_requests;             /* Число запросов. */
+  guint64              n_retransmits;          /* Число повторов запросов. */
+  guint64              n_timeouts;             /* Число попыток без ответа. */
+
+  HyScanSonarClientProgressFunc progress_func; /* Функция уведомления о ходе подключения. */
+  gpointer             progress_data;          /* Пользовательские данные для функции уведомления. */
+  GMainContext        *progress_context;       /* Контекст вызова функции уведомления. */
+
   HyScanDataSchema    *schema;                 /* Схема данных гидролокатора. */
   const gchar         *self_address;           /* Локальный адрес RPC клиента. */
 
@@ -91,20 +333,52 @@ struct _HyScanSonarClientPrivate
   guint16              receiver_port;          /* Номер UDP порта на котором запущен приёмник сообщений от гидролокатора. */
 
   GThread             *receiver;               /* Поток приёма сообщений по UDP. */
-  GThread             *emitter;                /* Поток доставки сообщений гидролокатора. */
-  gint                 started;                /* Признак запуска потоков. */
+  HyScanSonarReceiver *shared;                 /* Общий приёмник данных. */
+  guint                shared_id;              /* Идентификатор подключения в общем приёмнике. */
+  HyScanSonarClientReception *reception;       /* Состояние приёма при использовании общего приёмника. */
+  gboolean             initialized;            /* Признак выполненной инициализации. */
+  GMutex               started_lock;           /* Блокировка счётчика запущенных потоков. */
+  GCond                started_cond;           /* Сигнализатор запуска потоков. */
+  guint                n_threads;              /* Число запускаемых потоков. */
+  guint                started;                /* Число запущенных потоков. */
   gint                 shutdown;               /* Признак необходимости завершения работы. */
 
   guint                n_buffers;              /* Число буферов данных. */
-  HyScanSlicePool     *buffers;                /* Буферы данных. */
-  GRWLock              b_lock;                 /* Блокировка доступа к куче буферов. */
+  HyScanSonarClientPool *pool;                 /* Куча буферов. */
 
-  GMutex               queue_lock;             /* Блокировка очереди принятых пакетов. */
-  GCond                queue_cond;             /* Семафор очереди принятых пакетов. */
-  GQueue              *queue;                  /* Очередь принятых пакетов данных. */
+  guint                n_workers;              /* Число потоков доставки сообщений. */
+  HyScanSonarClientWorker *workers;            /* Потоки доставки сообщений. */
+
+  GMutex               sinks_lock;             /* Блокировка замены списка функций приёма данных. */
+  GPtrArray           *sinks;                  /* Функции приёма данных. */
+  guint                sink_id;                /* Идентификатор последней функции приёма данных. */
+
+  HyScanSonarClientSource *sources;            /* Статистика приёма данных по источникам. */
+  gint                 missing_seq;            /* Номер изменения числа пропущенных пакетов. */
+  guint64              n_missing;              /* Число пакетов, пропущенных в последовательности номеров. */
+  guint64              n_format_errors;        /* Число пакетов неизвестного формата. */
+  guint64              reported_format_errors; /* Число пакетов неизвестного формата в последней сводке. */
+
+  GMutex               capture_lock;           /* Блокировка записи принятых пакетов. */
+  GOutputStream       *capture;                /* Файл записи принятых пакетов. */
+  guint8              *capture_buffer;         /* Буфер записываемого пакета. */
+
+  GInputStream        *replay;                 /* Файл воспроизводимых пакетов. */
+  gdouble              replay_speed;           /* Скорость воспроизведения. */
+  gint                 replay_done;            /* Признак завершения воспроизведения. */
+
+  GMutex               policy_lock;            /* Блокировка доступа к правилам сборки сообщений. */
+  GHashTable          *policies;               /* Правила сборки сообщений по источникам данных. */
+
+  GMutex               cache_lock;             /* Блокировка доступа к кэшу параметров. */
+  GHashTable          *cache;                  /* Кэш значений параметров только для чтения. */
+  guint64              cache_hits;             /* Число значений, считанных из кэша. */
+  guint64              cache_misses;           /* Число значений, считанных с сервера. */
 };
 
 static void    hyscan_sonar_client_interface_init              (HyScanParamInterface          *iface);
+static void    hyscan_sonar_client_initable_iface_init         (GInitableIface                *iface);
+static void    hyscan_sonar_client_async_initable_iface_init   (GAsyncInitableIface           *iface);
 static void    hyscan_sonar_client_set_property                (GObject                       *object,
                                                                 guint                          prop_id,
                                                                 const GValue                  *value,
@@ -112,7 +386,123 @@ static void    hyscan_sonar_client_set_property                (GObject
 static void    hyscan_sonar_client_object_constructed          (GObject                       *object);
 static void    hyscan_sonar_client_object_finalize             (GObject                       *object);
 
+static gboolean hyscan_sonar_client_initable_init              (GInitable                     *initable,
+                                                                GCancellable                  *cancellable,
+                                                                GError                       **error);
+static void    hyscan_sonar_client_init_thread                 (GTask                         *task,
+                                                                gpointer                       source_object,
+                                                                gpointer                       task_data,
+                                                                GCancellable                  *cancellable);
+static void    hyscan_sonar_client_init_async                  (GAsyncInitable                *initable,
+                                                                gint                           io_priority,
+                                                                GCancellable                  *cancellable,
+                                                                GAsyncReadyCallback            callback,
+                                                                gpointer                       user_data);
+static gboolean hyscan_sonar_client_init_finish                (GAsyncInitable                *initable,
+                                                                GAsyncResult                  *result,
+                                                                GError                       **error);
+static gpointer hyscan_sonar_client_connector                  (gpointer                       data);
+static gboolean hyscan_sonar_client_progress_dispatch          (gpointer                       data);
+static void    hyscan_sonar_client_progress                    (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientStage         stage);
+static void    hyscan_sonar_client_start_threads               (HyScanSonarClientPrivate      *priv);
+static void    hyscan_sonar_client_wait_threads                (HyScanSonarClientPrivate      *priv);
+static void    hyscan_sonar_client_thread_started              (HyScanSonarClientPrivate      *priv);
+
 static void    hyscan_sonar_client_free_buffer                 (gpointer                       data);
+static void    hyscan_sonar_client_free_request                (gpointer                       data);
+
+static void    hyscan_sonar_client_arena_init                  (HyScanSonarClientArena        *arena,
+                                                                gsize                          size,
+                                                                gboolean                       huge_pages);
+static void    hyscan_sonar_client_arena_clear                 (HyScanSonarClientArena        *arena);
+static HyScanSonarClientPool *
+               hyscan_sonar_client_pool_new                    (guint                          n_buffers);
+static HyScanSonarClientPool *
+               hyscan_sonar_client_pool_ref                    (HyScanSonarClientPool         *pool);
+static void    hyscan_sonar_client_pool_unref                  (HyScanSonarClientPool         *pool);
+
+static uRpcClient *
+               hyscan_sonar_client_connect                     (HyScanSonarClientPrivate      *priv);
+static uRpcClient *
+               hyscan_sonar_client_pop_session                 (HyScanSonarClientPrivate      *priv,
+                                                                gint64                         deadline,
+                                                                GCancellable                  *cancellable);
+static HyScanSonarClientBuffer *
+               hyscan_sonar_client_pop_buffer                  (HyScanSonarClientPrivate      *priv);
+static void    hyscan_sonar_client_push_buffer                 (HyScanSonarClientPool         *pool,
+                                                                HyScanSonarClientBuffer       *buffer);
+static void    hyscan_sonar_client_send_buffer                 (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientBuffer       *buffer);
+static void    hyscan_sonar_client_flush_buffer                (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientBuffer       *buffer);
+static GSocket *hyscan_sonar_client_open_socket                (HyScanSonarClientPrivate      *priv);
+static HyScanSonarClientReception *
+               hyscan_sonar_client_reception_new               (HyScanSonarClientPrivate      *priv);
+static void    hyscan_sonar_client_reception_free              (HyScanSonarClientReception    *rx);
+static gint64  hyscan_sonar_client_reception_timers            (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientReception    *rx,
+                                                                gint64                         cur_time);
+static void    hyscan_sonar_client_receive_packet              (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientReception    *rx);
+static gint64  hyscan_sonar_client_receive_shared              (gpointer                       data,
+                                                                gint64                         cur_time);
+static void    hyscan_sonar_client_deliver                     (gpointer                       owner,
+                                                                gpointer                       data);
+static void    hyscan_sonar_client_deliver_batch               (HyScanSonarClient             *sonar_client,
+                                                                HyScanSonarClientBuffer      **buffers,
+                                                                guint                          n_buffers);
+static HyScanSonarClientSink *
+               hyscan_sonar_client_sink_ref                    (HyScanSonarClientSink         *sink);
+static void    hyscan_sonar_client_sink_unref                  (gpointer                       data);
+static gssize  hyscan_sonar_client_socket_receive              (GSocket                       *socket,
+                                                                GInputVector                  *vectors,
+                                                                guint                          n_vectors,
+                                                                gint                           flags,
+                                                                gint64                        *time);
+static gboolean hyscan_sonar_client_input_wait                 (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientInput        *input,
+                                                                gint64                         timeout);
+static gssize  hyscan_sonar_client_input_receive               (HyScanSonarClientInput        *input,
+                                                                GInputVector                  *vectors,
+                                                                guint                          n_vectors,
+                                                                gboolean                       peek,
+                                                                gint64                        *time);
+static void    hyscan_sonar_client_input_drop                  (HyScanSonarClientInput        *input);
+static void    hyscan_sonar_client_capture_packet              (HyScanSonarClientPrivate      *priv,
+                                                                GSocket                       *socket);
+static HyScanSonarClientSource *
+               hyscan_sonar_client_source_lookup               (HyScanSonarClientPrivate      *priv,
+                                                                GHashTable                    *sources,
+                                                                guint32                        id);
+static void    hyscan_sonar_client_stats_begin                 (gint                          *seq);
+static void    hyscan_sonar_client_stats_end                   (gint                          *seq);
+static void    hyscan_sonar_client_source_packet               (HyScanSonarClientSource       *source,
+                                                                guint32                        index,
+                                                                guint32                        part_size);
+static void    hyscan_sonar_client_source_read                 (HyScanSonarClientSource       *source,
+                                                                HyScanSonarClientStats        *stats,
+                                                                guint64                       *latency,
+                                                                guint64                       *n_latency);
+static void    hyscan_sonar_client_sequence_packet             (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientSequence     *sequence,
+                                                                guint32                        index);
+static void    hyscan_sonar_client_report                      (HyScanSonarClientPrivate      *priv,
+                                                                gint64                         interval);
+static GVariant *
+               hyscan_sonar_client_stats_value                 (HyScanSonarClientPrivate      *priv,
+                                                                const gchar                   *name);
+static void    hyscan_sonar_client_wheel_insert                (HyScanSonarClientWheel        *wheel,
+                                                                HyScanSonarClientBuffer       *buffer);
+static void    hyscan_sonar_client_wheel_remove                (HyScanSonarClientWheel        *wheel,
+                                                                HyScanSonarClientBuffer       *buffer);
+static void    hyscan_sonar_client_wheel_expire                (HyScanSonarClientPrivate      *priv,
+                                                                HyScanSonarClientWheel        *wheel,
+                                                                GHashTable                    *buffers,
+                                                                gint64                         cur_time);
+static gboolean hyscan_sonar_client_check_crc                  (HyScanSonarRpcPacket          *header,
+                                                                gconstpointer                  data,
+                                                                guint32                        part_size);
 
 static guint32 hyscan_sonar_client_rpc_check_version           (uRpcClient                    *rpc);
 static guint32 hyscan_sonar_client_rpc_get_schema              (uRpcClient                    *rpc,
@@ -121,13 +511,45 @@ static guint32 hyscan_sonar_client_rpc_get_schema              (uRpcClient
 static guint32 hyscan_sonar_client_rpc_set_master              (uRpcClient                    *rpc,
                                                                 gchar                         *host,
                                                                 guint16                        port);
-static guint32 hyscan_sonar_client_rpc_set                     (HyScanSonarClientPrivate      *priv,
+static guint32 hyscan_sonar_client_rpc_set                     (uRpcClient                    *rpc,
                                                                 const gchar *const            *names,
                                                                 GVariant                     **values);
-static guint32 hyscan_sonar_client_rpc_get                     (HyScanSonarClientPrivate      *priv,
+static guint32 hyscan_sonar_client_rpc_get                     (uRpcClient                    *rpc,
                                                                 const gchar *const            *names,
                                                                 GVariant                     **values);
 
+static void    hyscan_sonar_client_attempt_free                (gpointer                       data);
+static void    hyscan_sonar_client_attempt_exec                (gpointer                       data,
+                                                                gpointer                       user_data);
+static void    hyscan_sonar_client_rtt_update                  (HyScanSonarClientPrivate      *priv,
+                                                                gint64                         rtt);
+static void    hyscan_sonar_client_histogram_add               (guint64                       *histogram,
+                                                                gint64                         value);
+static gdouble hyscan_sonar_client_histogram_percentile        (const guint64                 *histogram,
+                                                                guint64                        n_samples,
+                                                                gdouble                        percentile);
+static void    hyscan_sonar_client_loss_signal                 (HyScanSonarClientPrivate      *priv);
+static guint32 hyscan_sonar_client_exec_rpc                    (HyScanSonarClientPrivate      *priv,
+                                                                gboolean                       set,
+                                                                const gchar *const            *names,
+                                                                GVariant                     **values,
+                                                                gint64                         deadline,
+                                                                GCancellable                  *cancellable);
+static guint32 hyscan_sonar_client_exec_set                    (HyScanSonarClientPrivate      *priv,
+                                                                const gchar *const            *names,
+                                                                GVariant                     **values,
+                                                                gint64                         deadline,
+                                                                GCancellable                  *cancellable);
+static guint32 hyscan_sonar_client_exec_get                    (HyScanSonarClientPrivate      *priv,
+                                                                const gchar *const            *names,
+                                                                GVariant                     **values,
+                                                                gint64                         deadline,
+                                                                GCancellable                  *cancellable);
+
+static void    hyscan_sonar_client_cache_store                 (HyScanSonarClientPrivate      *priv,
+                                                                const gchar                   *name,
+                                                                GVariant                      *value);
+
 static gpointer hyscan_sonar_client_receiver                   (gpointer                       data);
 static gpointer hyscan_sonar_client_emitter                    (gpointer                       data);
 
@@ -135,6 +557,8 @@ static guint   hyscan_sonar_client_signals[SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE_WITH_CODE (HyScanSonarClient, hyscan_sonar_client, G_TYPE_OBJECT,
                          G_ADD_PRIVATE (HyScanSonarClient)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, hyscan_sonar_client_initable_iface_init)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_ASYNC_INITABLE, hyscan_sonar_client_async_initable_iface_init)
                          G_IMPLEMENT_INTERFACE (HYSCAN_TYPE_PARAM, hyscan_sonar_client_interface_init))
 
 static void hyscan_sonar_client_class_init (HyScanSonarClientClass *klass)
@@ -176,6 +600,25 @@ static void hyscan_sonar_client_class_init (HyScanSonarClientClass *klass)
                        HYSCAN_SONAR_CLIENT_DEFAULT_N_BUFFERS,
                        G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
 
+  g_object_class_install_property (object_class, PROP_N_WORKERS,
+    g_param_spec_uint ("n-workers", "NWorkers", "Number of message delivery threads",
+                       HYSCAN_SONAR_CLIENT_MIN_N_WORKERS,
+                       HYSCAN_SONAR_CLIENT_MAX_N_WORKERS,
+                       HYSCAN_SONAR_CLIENT_DEFAULT_N_WORKERS,
+                       G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_N_SESSIONS,
+    g_param_spec_uint ("n-sessions", "NSessions", "Number of RPC sessions",
+                       HYSCAN_SONAR_CLIENT_MIN_N_SESSIONS,
+                       HYSCAN_SONAR_CLIENT_MAX_N_SESSIONS,
+                       HYSCAN_SONAR_CLIENT_DEFAULT_N_SESSIONS,
+                       G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_RECEIVER,
+    g_param_spec_object ("receiver", "Receiver", "Shared sonar data receiver",
+                         HYSCAN_TYPE_SONAR_RECEIVER,
+                         G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+
   hyscan_sonar_client_signals[SIGNAL_DATA] =
     g_signal_new ("data", HYSCAN_TYPE_SONAR_CLIENT, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
                   g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
@@ -218,6 +661,18 @@ hyscan_sonar_client_set_property (GObject      *object,
       priv->n_buffers = g_value_get_uint (value);
       break;
 
+    case PROP_N_WORKERS:
+      priv->n_workers = g_value_get_uint (value);
+      break;
+
+    case PROP_N_SESSIONS:
+      priv->n_sessions = g_value_get_uint (value);
+      break;
+
+    case PROP_RECEIVER:
+      priv->shared = g_value_dup_object (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -230,51 +685,112 @@ hyscan_sonar_client_object_constructed (GObject *object)
   HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (object);
   HyScanSonarClientPrivate *priv = sonar_client->priv;
 
-  gchar *schema_data = NULL;
-  gchar *schema_id = NULL;
-
-  guint32 rpc_status = URPC_STATUS_FAIL;
   guint i;
 
   G_OBJECT_CLASS (hyscan_sonar_client_parent_class)->constructed (object);
 
-  /* Буферы данных. */
-  g_rw_lock_init (&priv->b_lock);
-  for (i = 0; i < priv->n_buffers; i++)
-    hyscan_slice_pool_push (&priv->buffers, g_new0 (HyScanSonarRpcPacket, 1));
+  priv->client = sonar_client;
 
-  /* Очередь пакетов. */
-  priv->queue = g_queue_new ();
+  g_mutex_init (&priv->started_lock);
+  g_cond_init (&priv->started_cond);
+  g_mutex_init (&priv->rtt_lock);
+  g_mutex_init (&priv->capture_lock);
+  g_mutex_init (&priv->policy_lock);
+  g_mutex_init (&priv->cache_lock);
 
-  /* Подключаемся к RPC серверу. Если с первого раза подключиться не удалось,
-     можно повторить попытку. Всего priv->n_exec раз. */
-  for (i = 0; i < priv->n_exec; i++)
+  /* При использовании общего приёмника сообщения доставляются его потоками. */
+  if (priv->shared != NULL)
+    priv->n_workers = 0;
+
+  /* Куча буферов. */
+  priv->pool = hyscan_sonar_client_pool_new (priv->n_buffers);
+
+  /* Функции приёма данных. */
+  g_mutex_init (&priv->sinks_lock);
+  priv->sinks = g_ptr_array_new_with_free_func (hyscan_sonar_client_sink_unref);
+
+  /* Правила сборки сообщений по источникам данных. */
+  priv->policies = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+  /* Кэш значений параметров только для чтения. */
+  priv->cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       g_free, (GDestroyNotify)g_variant_unref);
+
+  /* Очереди собранных сообщений. */
+  priv->workers = g_new0 (HyScanSonarClientWorker, priv->n_workers);
+  for (i = 0; i < priv->n_workers; i++)
     {
-      gchar *uri;
+      priv->workers[i].client = sonar_client;
+      priv->workers[i].queue = g_queue_new ();
+      g_mutex_init (&priv->workers[i].queue_lock);
+      g_cond_init (&priv->workers[i].queue_cond);
+    }
 
-      uri = g_strdup_printf ("udp://%s:%d", priv->host, HYSCAN_SONAR_RPC_UDP_PORT);
-      priv->rpc = urpc_client_create (uri, URPC_DEFAULT_DATA_SIZE, priv->timeout);
-      g_free (uri);
+  /* Свободные RPC сессии и пул потоков выполнения запросов. */
+  priv->sessions = g_async_queue_new ();
+  priv->attempts = g_thread_pool_new (hyscan_sonar_client_attempt_exec, priv,
+                                      priv->n_sessions, FALSE, NULL);
+  priv->rto = priv->timeout;
+}
 
-      /* Если подключение не удалось, попробуем еще. */
-      if (priv->rpc == NULL || urpc_client_connect (priv->rpc) != 0)
-        {
-          g_clear_pointer (&priv->rpc, urpc_client_destroy);
-          continue;
-        }
+/* Функция подключается к гидролокатору, загружает схему данных и запускает потоки
+ * приёма сообщений. Дополнительные RPC сессии подключаются параллельно с проверкой
+ * версии сервера и загрузкой схемы данных. */
+static gboolean
+hyscan_sonar_client_initable_init (GInitable     *initable,
+                                   GCancellable  *cancellable,
+                                   GError       **error)
+{
+  HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (initable);
+  HyScanSonarClientPrivate *priv = sonar_client->priv;
 
-      break;
+  GThread **connectors;
+  gchar *schema_data = NULL;
+  gchar *schema_id = NULL;
+
+  guint32 rpc_status = URPC_STATUS_FAIL;
+  guint i;
+
+  /* Повторная инициализация. */
+  if (priv->initialized)
+    {
+      if (priv->rpc == NULL)
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                     "sonar '%s' is not connected", priv->host);
+
+      return (priv->rpc != NULL);
     }
 
+  priv->initialized = TRUE;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return FALSE;
+
+  /* Подключаемся к RPC серверу. */
+  priv->rpc = hyscan_sonar_client_connect (priv);
   if (priv->rpc == NULL)
     {
       g_warning ("HyScanSonarClient: can't connect to sonar '%s'", priv->host);
-      return;
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE,
+                   "can't connect to sonar '%s'", priv->host);
+      return FALSE;
     }
 
+  priv->self_address = urpc_client_get_self_address (priv->rpc);
+  hyscan_sonar_client_progress (priv, HYSCAN_SONAR_CLIENT_STAGE_CONNECTED);
+
+  /* Дополнительные RPC сессии, позволяющие выполнять несколько запросов одновременно,
+     подключаются в отдельных потоках. */
+  connectors = g_new0 (GThread*, priv->n_sessions);
+  for (i = 1; i < priv->n_sessions; i++)
+    connectors[i] = g_thread_new ("sonar-client-connect", hyscan_sonar_client_connector, priv);
+
   /* Проверяем версию сервера. */
   for (i = 0; i < priv->n_exec; i++)
     {
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
       rpc_status = hyscan_sonar_client_rpc_check_version (priv->rpc);
       if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
         break;
@@ -283,9 +799,14 @@ hyscan_sonar_client_object_constructed (GObject *object)
   if (rpc_status != URPC_STATUS_OK)
     goto exit;
 
+  hyscan_sonar_client_progress (priv, HYSCAN_SONAR_CLIENT_STAGE_VERSION);
+
   /* Загружаем схему данных гидролокатора. */
   for (i = 0; i < priv->n_exec; i++)
     {
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
       rpc_status = hyscan_sonar_client_rpc_get_schema (priv->rpc, &schema_data, &schema_id);
       if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
         break;
@@ -299,24 +820,199 @@ hyscan_sonar_client_object_constructed (GObject *object)
   g_free (schema_data);
   g_free (schema_id);
 
-  priv->self_address = urpc_client_get_self_address (priv->rpc);
+  hyscan_sonar_client_progress (priv, HYSCAN_SONAR_CLIENT_STAGE_SCHEMA);
 
   /* Потоки приёма и обработки сообщений от гидролокатора.
      Для приёма данных от гидролокатора используется поток hyscan_sonar_client_receiver.
      В нём создаётся принимающий UDP сокет связанный с IP адресом клиента и случайно выбранным
      UDP портом. Этот адрес и порт автоматически передаются на сервер при вызове функции lock.
-     Задача потока приёма - макимально быстро принять данные и сохранить их в очереди на обработку.
-     Обработка принятых данных (объединение) происходит в потоке hyscan_sonar_client_emitter.
-     Также, этот поток используется для отправки сигналов с принятыми сообщениями. */
-  priv->receiver = g_thread_new ("sonar-client-receiver", hyscan_sonar_client_receiver, priv);
-  priv->emitter = g_thread_new ("sonar-client-emitter", hyscan_sonar_client_emitter, sonar_client);
-  while (g_atomic_int_get (&priv->started) != 2)
-    g_usleep (1000);
+     Поток приёма считывает заголовок каждого пакета и принимает данные сразу в буфер
+     сборки сообщения по смещению фрагмента, без промежуточного копирования. Собранные
+     сообщения передаются в потоки hyscan_sonar_client_emitter, которые отправляют
+     сигналы с принятыми сообщениями. Сообщения одного источника данных всегда
+     обрабатываются одним и тем же потоком, что сохраняет порядок их доставки.
+     Потоки запускаются после загрузки схемы данных, параллельно с подключением
+     дополнительных RPC сессий. При ошибке подключения потоки не запускаются. */
+  hyscan_sonar_client_start_threads (priv);
+
+  /* Основная сессия также используется для запросов. */
+  g_async_queue_push (priv->sessions, priv->rpc);
+  for (i = 1; i < priv->n_sessions; i++)
+    {
+      uRpcClient *rpc = g_thread_join (connectors[i]);
+
+      if (rpc == NULL)
+        {
+          g_warning ("HyScanSonarClient: can't create additional session to sonar '%s'", priv->host);
+          continue;
+        }
+
+      g_async_queue_push (priv->sessions, rpc);
+    }
+  g_free (connectors);
 
-  return;
+  hyscan_sonar_client_progress (priv, HYSCAN_SONAR_CLIENT_STAGE_SESSIONS);
+
+  /* Ожидаем запуска потоков приёма и обработки сообщений. */
+  hyscan_sonar_client_wait_threads (priv);
+
+  hyscan_sonar_client_progress (priv, HYSCAN_SONAR_CLIENT_STAGE_READY);
+
+  return TRUE;
 
 exit:
+  for (i = 1; i < priv->n_sessions; i++)
+    {
+      uRpcClient *rpc = g_thread_join (connectors[i]);
+
+      if (rpc != NULL)
+        urpc_client_destroy (rpc);
+    }
+  g_free (connectors);
+
   g_clear_pointer (&priv->rpc, urpc_client_destroy);
+  priv->self_address = NULL;
+
+  if (!g_cancellable_set_error_if_cancelled (cancellable, error))
+    {
+      g_warning ("HyScanSonarClient: can't initialize connection to sonar '%s'", priv->host);
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "can't initialize connection to sonar '%s'", priv->host);
+    }
+
+  return FALSE;
+}
+
+/* Поток асинхронной инициализации подключения к гидролокатору. */
+static void
+hyscan_sonar_client_init_thread (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+  GError *error = NULL;
+
+  if (hyscan_sonar_client_initable_init (source_object, cancellable, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+}
+
+/* Функция запускает асинхронную инициализацию подключения к гидролокатору. */
+static void
+hyscan_sonar_client_init_async (GAsyncInitable      *initable,
+                                gint                 io_priority,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (initable, cancellable, callback, user_data);
+  g_task_set_priority (task, io_priority);
+  g_task_run_in_thread (task, hyscan_sonar_client_init_thread);
+  g_object_unref (task);
+}
+
+/* Функция завершает асинхронную инициализацию подключения к гидролокатору. */
+static gboolean
+hyscan_sonar_client_init_finish (GAsyncInitable  *initable,
+                                 GAsyncResult    *result,
+                                 GError         **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, initable), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* Поток подключения дополнительной RPC сессии. */
+static gpointer
+hyscan_sonar_client_connector (gpointer data)
+{
+  return hyscan_sonar_client_connect (data);
+}
+
+/* Функция вызывает пользовательскую функцию уведомления о ходе подключения
+ * в контексте, в котором было запущено асинхронное подключение. */
+static gboolean
+hyscan_sonar_client_progress_dispatch (gpointer data)
+{
+  HyScanSonarClientProgress *progress = data;
+
+  progress->func (progress->stage, progress->data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Функция уведомляет о ходе подключения к гидролокатору. */
+static void
+hyscan_sonar_client_progress (HyScanSonarClientPrivate *priv,
+                              HyScanSonarClientStage    stage)
+{
+  HyScanSonarClientProgress *progress;
+
+  if (priv->progress_func == NULL)
+    return;
+
+  progress = g_new (HyScanSonarClientProgress, 1);
+  progress->func = priv->progress_func;
+  progress->data = priv->progress_data;
+  progress->stage = stage;
+
+  g_main_context_invoke_full (priv->progress_context, G_PRIORITY_DEFAULT,
+                              hyscan_sonar_client_progress_dispatch, progress, g_free);
+}
+
+/* Функция запускает потоки приёма и обработки сообщений. При использовании
+ * общего приёмника собственные потоки не запускаются, а сокет приёма
+ * добавляется в список опрашиваемых общим приёмником. */
+static void
+hyscan_sonar_client_start_threads (HyScanSonarClientPrivate *priv)
+{
+  guint i;
+
+  if (priv->shared != NULL)
+    {
+      priv->reception = hyscan_sonar_client_reception_new (priv);
+      if (priv->reception == NULL)
+        {
+          g_warning ("HyScanSonarClient: can't setup receiver");
+          return;
+        }
+
+      priv->shared_id = hyscan_sonar_receiver_attach (priv->shared, priv->reception->input.socket,
+                                                      hyscan_sonar_client_receive_shared, priv);
+      return;
+    }
+
+  priv->n_threads = priv->n_workers + 1;
+  priv->receiver = g_thread_new ("sonar-client-receiver", hyscan_sonar_client_receiver, priv);
+  for (i = 0; i < priv->n_workers; i++)
+    {
+      priv->workers[i].emitter = g_thread_new ("sonar-client-emitter",
+                                               hyscan_sonar_client_emitter,
+                                               &priv->workers[i]);
+    }
+}
+
+/* Функция ожидает запуска потоков приёма и обработки сообщений. */
+static void
+hyscan_sonar_client_wait_threads (HyScanSonarClientPrivate *priv)
+{
+  g_mutex_lock (&priv->started_lock);
+  while (priv->started != priv->n_threads)
+    g_cond_wait (&priv->started_cond, &priv->started_lock);
+  g_mutex_unlock (&priv->started_lock);
+}
+
+/* Функция отмечает запуск потока приёма или обработки сообщений. */
+static void
+hyscan_sonar_client_thread_started (HyScanSonarClientPrivate *priv)
+{
+  g_mutex_lock (&priv->started_lock);
+  priv->started += 1;
+  g_cond_broadcast (&priv->started_cond);
+  g_mutex_unlock (&priv->started_lock);
 }
 
 static void
@@ -325,22 +1021,70 @@ hyscan_sonar_client_object_finalize (GObject *object)
   HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (object);
   HyScanSonarClientPrivate *priv = sonar_client->priv;
 
-  gpointer buffer;
+  uRpcClient *rpc;
+  guint i;
 
   g_atomic_int_set (&priv->shutdown, 1);
   g_clear_pointer (&priv->receiver, g_thread_join);
-  g_clear_pointer (&priv->emitter, g_thread_join);
+  for (i = 0; i < priv->n_workers; i++)
+    g_clear_pointer (&priv->workers[i].emitter, g_thread_join);
+
+  if (priv->shared != NULL)
+    {
+      if (priv->shared_id != 0)
+        hyscan_sonar_receiver_detach (priv->shared, priv->shared_id);
+      hyscan_sonar_receiver_cancel (priv->shared, sonar_client, hyscan_sonar_client_free_buffer);
+      g_clear_pointer (&priv->reception, hyscan_sonar_client_reception_free);
+    }
+
+  g_thread_pool_free (priv->attempts, FALSE, TRUE);
+  while ((rpc = g_async_queue_try_pop (priv->sessions)) != NULL)
+    if (rpc != priv->rpc)
+      urpc_client_destroy (rpc);
+  g_async_queue_unref (priv->sessions);
 
   g_clear_pointer (&priv->rpc, urpc_client_destroy);
 
+  hyscan_sonar_client_stop_capture (sonar_client);
+  g_clear_object (&priv->replay);
+  g_free (priv->capture_buffer);
+
   g_clear_object (&priv->schema);
+  g_clear_pointer (&priv->progress_context, g_main_context_unref);
+  g_hash_table_unref (priv->cache);
+  g_hash_table_unref (priv->policies);
+  g_ptr_array_unref (priv->sinks);
+  g_mutex_clear (&priv->sinks_lock);
+
+  while (priv->sources != NULL)
+    {
+      HyScanSonarClientSource *source = priv->sources;
+
+      priv->sources = source->next;
+      g_free (source);
+    }
   g_free (priv->receiver_host);
   g_free (priv->host);
 
-  g_rw_lock_clear (&priv->b_lock);
-  g_queue_free_full (priv->queue, g_free);
-  while ((buffer = hyscan_slice_pool_pop (&priv->buffers)) != NULL)
-    g_free (buffer);
+  for (i = 0; i < priv->n_workers; i++)
+    {
+      g_queue_free_full (priv->workers[i].queue, hyscan_sonar_client_free_buffer);
+      g_mutex_clear (&priv->workers[i].queue_lock);
+      g_cond_clear (&priv->workers[i].queue_cond);
+    }
+  g_free (priv->workers);
+
+  g_mutex_clear (&priv->started_lock);
+  g_cond_clear (&priv->started_cond);
+  g_mutex_clear (&priv->rtt_lock);
+  g_mutex_clear (&priv->capture_lock);
+  g_mutex_clear (&priv->policy_lock);
+  g_mutex_clear (&priv->cache_lock);
+
+  /* Куча освобождается после освобождения всех ссылок на сообщения. */
+  hyscan_sonar_client_pool_unref (priv->pool);
+
+  g_clear_object (&priv->shared);
 
   G_OBJECT_CLASS (hyscan_sonar_client_parent_class)->finalize (object);
 }
@@ -351,65 +1095,249 @@ hyscan_sonar_client_free_buffer (gpointer data)
 {
   HyScanSonarClientBuffer *sdata = data;
 
-  g_timer_destroy (sdata->timer);
-  g_free (sdata->buffer);
+  /* Пакеты и буферы из общей области памяти освобождаются вместе с ней. */
+  if (!sdata->in_arena)
+    g_free (sdata->buffer);
+  g_free (sdata->parts);
 
   g_free (sdata);
 }
 
-/* Функция проверяет версию сервера. */
-static guint32
-hyscan_sonar_client_rpc_check_version (uRpcClient *rpc)
+/* Функция освобождает память занятую структурой HyScanSonarClientRequest. */
+static void
+hyscan_sonar_client_free_request (gpointer data)
 {
-  uRpcData *data;
-  guint32 rpc_status = URPC_STATUS_FAIL;
+  HyScanSonarClientRequest *request = data;
+  guint i;
 
-  guint32 version;
-  guint32 magic;
+  for (i = 0; request->names[i] != NULL; i++)
+    g_clear_pointer (&request->values[i], g_variant_unref);
 
-  data = urpc_client_lock (rpc);
-  if (data == NULL)
-    hyscan_sonar_client_lock_error ();
+  g_strfreev (request->names);
+  g_free (request->values);
 
-  rpc_status = urpc_client_exec (rpc, HYSCAN_SONAR_RPC_PROC_VERSION);
-  if (rpc_status != URPC_STATUS_OK)
-    hyscan_sonar_client_exec_error (rpc_status);
+  g_free (request);
+}
 
-  rpc_status = URPC_STATUS_FAIL;
+/* Функция выделяет область памяти для размещения буферов. Если запрошено
+ * использование больших страниц памяти, область по возможности размещается
+ * в них, что уменьшает число промахов TLB и страничных прерываний при интенсивном
+ * приёме данных. Если большие страницы недоступны или не запрошены, память
+ * выделяется обычным образом. */
+static void
+hyscan_sonar_client_arena_init (HyScanSonarClientArena *arena,
+                                gsize                   size,
+                                gboolean                huge_pages)
+{
+#ifdef G_OS_UNIX
+  gpointer data;
 
-  if (urpc_data_get_uint32 (data, HYSCAN_SONAR_RPC_PARAM_VERSION, &version) != 0 )
-    hyscan_sonar_client_get_error ("version");
-  if (urpc_data_get_uint32 (data, HYSCAN_SONAR_RPC_PARAM_MAGIC, &magic) != 0 )
-    hyscan_sonar_client_get_error ("magic");
+  if (!huge_pages)
+    goto fallback;
 
-  if (version != HYSCAN_SONAR_RPC_VERSION || magic != HYSCAN_SONAR_RPC_MAGIC)
+  size = (size + HYSCAN_SONAR_CLIENT_HUGE_PAGE_SIZE - 1) & ~(gsize)(HYSCAN_SONAR_CLIENT_HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (data == MAP_FAILED)
+#endif
+    data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (data != MAP_FAILED)
     {
-      g_warning ("HyScanSonarClient: server version mismatch");
-      goto exit;
+#ifdef MADV_HUGEPAGE
+      madvise (data, size, MADV_HUGEPAGE);
+#endif
+      arena->data = data;
+      arena->size = size;
+      arena->mapped = TRUE;
+      return;
     }
 
-  rpc_status = URPC_STATUS_OK;
-
-exit:
-  urpc_client_unlock (rpc);
+fallback:
+#endif
 
-  return rpc_status;
+  arena->data = g_malloc0 (size);
+  arena->size = size;
+  arena->mapped = FALSE;
 }
 
-/* Функция считывает схему данных гидролокатора. */
-static guint32
-hyscan_sonar_client_rpc_get_schema (uRpcClient  *rpc,
-                                    gchar      **schema_data,
-                                    gchar      **schema_id)
+/* Функция освобождает область памяти буферов. */
+static void
+hyscan_sonar_client_arena_clear (HyScanSonarClientArena *arena)
 {
-  uRpcData *data;
-  guint32 rpc_status = URPC_STATUS_FAIL;
-  guint32 exec_status;
+  if (arena->data == NULL)
+    return;
 
-  const gchar *rpc_schema_data;
-  guint32 rpc_schema_size;
+#ifdef G_OS_UNIX
+  if (arena->mapped)
+    munmap (arena->data, arena->size);
+  else
+#endif
+    g_free (arena->data);
 
-  gchar *dec_schema_data;
+  arena->data = NULL;
+  arena->size = 0;
+}
+
+/* Функция создаёт кучу буферов. Буферы данных размещаются в одной области памяти. */
+static HyScanSonarClientPool *
+hyscan_sonar_client_pool_new (guint n_buffers)
+{
+  HyScanSonarClientPool *pool;
+  guint i;
+
+  pool = g_new0 (HyScanSonarClientPool, 1);
+  pool->ref_count = 1;
+  g_rw_lock_init (&pool->lock);
+
+  hyscan_sonar_client_arena_init (&pool->packet_arena, n_buffers * HYSCAN_SONAR_CLIENT_SLOT_SIZE, FALSE);
+  for (i = 0; i < n_buffers; i++)
+    {
+      HyScanSonarClientBuffer *buffer = g_new0 (HyScanSonarClientBuffer, 1);
+
+      buffer->pool = pool;
+      hyscan_slice_pool_push (&pool->buffers, pool->packet_arena.data + i * HYSCAN_SONAR_CLIENT_SLOT_SIZE);
+      hyscan_slice_pool_push (&pool->messages, buffer);
+    }
+
+  return pool;
+}
+
+/* Функция увеличивает счётчик ссылок на кучу буферов. */
+static HyScanSonarClientPool *
+hyscan_sonar_client_pool_ref (HyScanSonarClientPool *pool)
+{
+  g_atomic_int_inc (&pool->ref_count);
+
+  return pool;
+}
+
+/* Функция уменьшает счётчик ссылок на кучу буферов и освобождает её
+ * после освобождения последней ссылки. */
+static void
+hyscan_sonar_client_pool_unref (HyScanSonarClientPool *pool)
+{
+  gpointer buffer;
+
+  if (!g_atomic_int_dec_and_test (&pool->ref_count))
+    return;
+
+  while ((buffer = hyscan_slice_pool_pop (&pool->messages)) != NULL)
+    hyscan_sonar_client_free_buffer (buffer);
+  while (hyscan_slice_pool_pop (&pool->buffers) != NULL);
+
+  hyscan_sonar_client_arena_clear (&pool->packet_arena);
+  hyscan_sonar_client_arena_clear (&pool->message_arena);
+  g_rw_lock_clear (&pool->lock);
+
+  g_free (pool);
+}
+
+/* Функция создаёт RPC сессию и подключается к серверу. Если с первого раза
+ * подключиться не удалось, можно повторить попытку. Всего priv->n_exec раз. */
+static uRpcClient *
+hyscan_sonar_client_connect (HyScanSonarClientPrivate *priv)
+{
+  uRpcClient *rpc = NULL;
+  guint i;
+
+  for (i = 0; i < priv->n_exec; i++)
+    {
+      gchar *uri;
+
+      uri = g_strdup_printf ("udp://%s:%d", priv->host, HYSCAN_SONAR_RPC_UDP_PORT);
+      rpc = urpc_client_create (uri, URPC_DEFAULT_DATA_SIZE, priv->timeout);
+      g_free (uri);
+
+      /* Если подключение не удалось, попробуем еще. */
+      if (rpc == NULL || urpc_client_connect (rpc) != 0)
+        {
+          g_clear_pointer (&rpc, urpc_client_destroy);
+          continue;
+        }
+
+      break;
+    }
+
+  return rpc;
+}
+
+/* Функция ожидает освобождения одной из RPC сессий. */
+static uRpcClient *
+hyscan_sonar_client_pop_session (HyScanSonarClientPrivate *priv,
+                                 gint64                    deadline,
+                                 GCancellable             *cancellable)
+{
+  uRpcClient *rpc = NULL;
+
+  while (rpc == NULL)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      if ((deadline > 0) && (g_get_monotonic_time () >= deadline))
+        break;
+
+      rpc = g_async_queue_timeout_pop (priv->sessions, 100 * G_TIME_SPAN_MILLISECOND);
+    }
+
+  return rpc;
+}
+
+/* Функция проверяет версию сервера. */
+static guint32
+hyscan_sonar_client_rpc_check_version (uRpcClient *rpc)
+{
+  uRpcData *data;
+  guint32 rpc_status = URPC_STATUS_FAIL;
+
+  guint32 version;
+  guint32 magic;
+
+  data = urpc_client_lock (rpc);
+  if (data == NULL)
+    hyscan_sonar_client_lock_error ();
+
+  rpc_status = urpc_client_exec (rpc, HYSCAN_SONAR_RPC_PROC_VERSION);
+  if (rpc_status != URPC_STATUS_OK)
+    hyscan_sonar_client_exec_error (rpc_status);
+
+  rpc_status = URPC_STATUS_FAIL;
+
+  if (urpc_data_get_uint32 (data, HYSCAN_SONAR_RPC_PARAM_VERSION, &version) != 0 )
+    hyscan_sonar_client_get_error ("version");
+  if (urpc_data_get_uint32 (data, HYSCAN_SONAR_RPC_PARAM_MAGIC, &magic) != 0 )
+    hyscan_sonar_client_get_error ("magic");
+
+  if (version != HYSCAN_SONAR_RPC_VERSION || magic != HYSCAN_SONAR_RPC_MAGIC)
+    {
+      g_warning ("HyScanSonarClient: server version mismatch");
+      goto exit;
+    }
+
+  rpc_status = URPC_STATUS_OK;
+
+exit:
+  urpc_client_unlock (rpc);
+
+  return rpc_status;
+}
+
+/* Функция считывает схему данных гидролокатора. */
+static guint32
+hyscan_sonar_client_rpc_get_schema (uRpcClient  *rpc,
+                                    gchar      **schema_data,
+                                    gchar      **schema_id)
+{
+  uRpcData *data;
+  guint32 rpc_status = URPC_STATUS_FAIL;
+  guint32 exec_status;
+
+  const gchar *rpc_schema_data;
+  guint32 rpc_schema_size;
+
+  gchar *dec_schema_data;
   guint32 schema_size;
 
   GConverterResult converter_result;
@@ -508,7 +1436,7 @@ exit:
 
 /* Функция устанавливает значение параметра гидролокатора. */
 static guint32
-hyscan_sonar_client_rpc_set (HyScanSonarClientPrivate  *priv,
+hyscan_sonar_client_rpc_set (uRpcClient                *rpc,
                              const gchar *const        *names,
                              GVariant                 **values)
 {
@@ -518,7 +1446,7 @@ hyscan_sonar_client_rpc_set (HyScanSonarClientPrivate  *priv,
 
   gint i;
 
-  urpc_data = urpc_client_lock (priv->rpc);
+  urpc_data = urpc_client_lock (rpc);
   if (urpc_data == NULL)
     hyscan_sonar_client_lock_error ();
 
@@ -596,7 +1524,7 @@ hyscan_sonar_client_rpc_set (HyScanSonarClientPrivate  *priv,
         }
     }
 
-  rpc_status = urpc_client_exec (priv->rpc, HYSCAN_SONAR_RPC_PROC_SET);
+  rpc_status = urpc_client_exec (rpc, HYSCAN_SONAR_RPC_PROC_SET);
   if (rpc_status != URPC_STATUS_OK)
     hyscan_sonar_client_exec_error (rpc_status);
 
@@ -610,14 +1538,14 @@ hyscan_sonar_client_rpc_set (HyScanSonarClientPrivate  *priv,
   rpc_status = URPC_STATUS_OK;
 
 exit:
-  urpc_client_unlock (priv->rpc);
+  urpc_client_unlock (rpc);
 
   return rpc_status;
 }
 
 /* Функция считывает значение параметра гидролокатора. */
 static guint32
-hyscan_sonar_client_rpc_get (HyScanSonarClientPrivate  *priv,
+hyscan_sonar_client_rpc_get (uRpcClient                *rpc,
                              const gchar *const        *names,
                              GVariant                 **values)
 {
@@ -627,7 +1555,7 @@ hyscan_sonar_client_rpc_get (HyScanSonarClientPrivate  *priv,
 
   gint i;
 
-  urpc_data = urpc_client_lock (priv->rpc);
+  urpc_data = urpc_client_lock (rpc);
   if (urpc_data == NULL)
     hyscan_sonar_client_lock_error ();
 
@@ -640,7 +1568,7 @@ hyscan_sonar_client_rpc_get (HyScanSonarClientPrivate  *priv,
         hyscan_sonar_client_set_error ("name");
     }
 
-  rpc_status = urpc_client_exec (priv->rpc, HYSCAN_SONAR_RPC_PROC_GET);
+  rpc_status = urpc_client_exec (rpc, HYSCAN_SONAR_RPC_PROC_GET);
   if (rpc_status != URPC_STATUS_OK)
     hyscan_sonar_client_exec_error (rpc_status);
 
@@ -756,485 +1684,2491 @@ hyscan_sonar_client_rpc_get (HyScanSonarClientPrivate  *priv,
   rpc_status = URPC_STATUS_OK;
 
 exit:
-  urpc_client_unlock (priv->rpc);
+  urpc_client_unlock (rpc);
 
   return rpc_status;
 }
 
-/* Поток приёма сообщений от гидролокатора. */
-static gpointer
-hyscan_sonar_client_receiver (gpointer data)
+/* Функция сохраняет значение параметра в кэше. Кэшируются только значения параметров,
+ * доступных только для чтения: они не изменяются во время работы гидролокатора.
+ * Значения изменяемых параметров всегда запрашиваются у сервера, так как их может
+ * изменить другой клиент. Вызывается с заблокированным cache_lock. */
+static void
+hyscan_sonar_client_cache_store (HyScanSonarClientPrivate *priv,
+                                 const gchar              *name,
+                                 GVariant                 *value)
 {
-  HyScanSonarClientPrivate *priv = data;
+  if (!hyscan_data_schema_has_key (priv->schema, name))
+    return;
 
-  gchar receiver_host[1024];
-  const gchar *uri;
-  const gchar *end;
+  if (hyscan_data_schema_key_get_access (priv->schema, name) != HYSCAN_DATA_SCHEMA_ACCESS_READONLY)
+    return;
 
-  GSocket *socket = NULL;
-  GSocketAddress *address = NULL;
+  g_hash_table_replace (priv->cache, g_strdup (name), g_variant_ref (value));
+}
 
-  HyScanSonarRpcPacket *packet = NULL;
-  gssize received;
+/* Функция извлекает буфер сборки сообщения из кучи. */
+static HyScanSonarClientBuffer *
+hyscan_sonar_client_pop_buffer (HyScanSonarClientPrivate *priv)
+{
+  HyScanSonarClientBuffer *buffer;
 
-  /* Локальный IP адрес с которого подключились к гидролокатору. */
-  uri = priv->self_address + 6;
-  if (uri[0] == '[')
-    {
-      uri = uri + 1;
-      end = strstr (uri, "]:");
-    }
-  else
-    {
-      end = strstr (uri, ":");
-    }
+  g_rw_lock_writer_lock (&priv->pool->lock);
+  buffer = hyscan_slice_pool_pop (&priv->pool->messages);
+  g_rw_lock_writer_unlock (&priv->pool->lock);
 
-  memset (receiver_host, 0, sizeof (receiver_host));
-  memcpy (receiver_host, uri, end - uri);
-  priv->receiver_host = g_strdup (receiver_host);
+  return buffer;
+}
 
-  /* Сокет приёма сообщений от гидролокатора. */
-  do
-    {
-      GError *error;
-      gint error_code;
-      gboolean status;
+/* Функция возвращает буфер сборки сообщения в кучу. */
+static void
+hyscan_sonar_client_push_buffer (HyScanSonarClientPool   *pool,
+                                 HyScanSonarClientBuffer *buffer)
+{
+  g_rw_lock_writer_lock (&pool->lock);
 
-      /* Выбираем случайный порт. */
-      priv->receiver_port = g_random_int_range (HYSCAN_SONAR_RPC_MIN_PORT, HYSCAN_SONAR_RPC_MAX_PORT);
+  if (buffer->packet != NULL)
+    hyscan_slice_pool_push (&pool->buffers, buffer->packet);
 
-      /* Создаём и подключаем к нему сокет. */
-      address = g_inet_socket_address_new_from_string (priv->receiver_host, priv->receiver_port);
-      if (address == NULL)
-        break;
+  buffer->packet = NULL;
+  buffer->n_parts = 0;
+  buffer->n_received = 0;
+  buffer->size = 0;
+  buffer->type = 0;
+  buffer->rate = 0.0;
 
-      socket = g_socket_new (g_socket_address_get_family (address),
-                             G_SOCKET_TYPE_DATAGRAM,
-                             G_SOCKET_PROTOCOL_UDP,
-                             NULL);
-      if (socket == NULL)
-        break;
+  hyscan_slice_pool_push (&pool->messages, buffer);
 
-      status = g_socket_bind (socket, address, FALSE, &error);
-      g_clear_object (&address);
+  g_rw_lock_writer_unlock (&pool->lock);
+}
 
-      /* Успешно подключились. */
-      if (status)
-        break;
+/* Функция передаёт собранное сообщение в поток отправки сигналов, выбираемый по
+ * идентификатору источника данных. При использовании общего приёмника сообщение
+ * передаётся в его поток доставки. В неполном сообщении обнуляются данные
+ * непринятых фрагментов. */
+static void
+hyscan_sonar_client_send_buffer (HyScanSonarClientPrivate *priv,
+                                 HyScanSonarClientBuffer  *buffer)
+{
+  HyScanSonarClientWorker *worker;
+  guint32 offset;
+  guint32 i;
 
-      /* Потом создадим сокет еще раз. */
-      g_clear_object (&socket);
+  if (buffer->n_received < buffer->n_parts)
+    {
+      hyscan_sonar_client_loss_signal (priv);
 
-      error_code = error->code;
-      g_error_free (error);
+      hyscan_sonar_client_stats_begin (&buffer->source->rx_seq);
+      buffer->source->n_incomplete += 1;
+      buffer->source->n_lost += buffer->n_parts - buffer->n_received;
+      hyscan_sonar_client_stats_end (&buffer->source->rx_seq);
 
-      /* Порт уже используется, выберем другой. */
-      if (error_code == G_IO_ERROR_ADDRESS_IN_USE)
-        continue;
+      for (i = 0; i < buffer->n_parts; i++)
+        {
+          if (buffer->parts[i / 32] & (1u << (i % 32)))
+            continue;
 
-      /* Другая ошибка, печалька... */
-      break;
+          offset = i * HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+          memset (buffer->buffer + offset, 0, MIN (HYSCAN_SONAR_MSG_DATA_PART_SIZE, buffer->size - offset));
+        }
+    }
+
+  if (priv->shared != NULL)
+    {
+      hyscan_sonar_receiver_deliver (priv->shared, priv->client, buffer->id,
+                                     hyscan_sonar_client_deliver, buffer);
+      return;
     }
-  while (TRUE);
 
-  g_atomic_int_inc (&priv->started);
+  worker = &priv->workers[buffer->id % priv->n_workers];
 
-  /* Поток запустился с ошибкой */
-  if (socket == NULL)
+  g_mutex_lock (&worker->queue_lock);
+  g_queue_push_tail (worker->queue, buffer);
+  g_cond_signal (&worker->queue_cond);
+  g_mutex_unlock (&worker->queue_lock);
+}
+
+/* Функция завершает сборку неполного сообщения. В зависимости от правила сборки
+ * для источника данных сообщение доставляется с обнулёнными недостающими
+ * фрагментами или отбрасывается. */
+static void
+hyscan_sonar_client_flush_buffer (HyScanSonarClientPrivate *priv,
+                                  HyScanSonarClientBuffer  *buffer)
+{
+  if ((buffer->n_received > 0) && buffer->deliver)
     {
-      g_warning ("HyScanSonarClient: can't setup receiver thread");
-      g_clear_pointer (&priv->receiver_host, g_free);
-      priv->receiver_port = 0;
-      return NULL;
+      hyscan_sonar_client_send_buffer (priv, buffer);
     }
+  else
+    {
+      if (buffer->n_received > 0)
+        hyscan_sonar_client_loss_signal (priv);
 
-  /* Приём данных. */
-  while (g_atomic_int_get (&priv->shutdown) != 1)
+      hyscan_sonar_client_stats_begin (&buffer->source->rx_seq);
+      buffer->source->n_lost += buffer->n_parts - buffer->n_received;
+      hyscan_sonar_client_stats_end (&buffer->source->rx_seq);
+      hyscan_sonar_client_push_buffer (priv->pool, buffer);
+    }
+}
+
+/* Функция ожидает поступления очередного пакета в течение timeout микросекунд.
+ * При записи принятых пакетов пакет копируется в файл записи. При воспроизведении
+ * пакет считывается из файла и становится доступен в момент времени, соответствующий
+ * времени его приёма с учётом скорости воспроизведения. */
+static gboolean
+hyscan_sonar_client_input_wait (HyScanSonarClientPrivate *priv,
+                                HyScanSonarClientInput   *input,
+                                gint64                    timeout)
+{
+  gint64 due_time;
+  gint64 cur_time;
+
+  if (input->socket != NULL)
     {
-      /* Проверка наличия входных данных. */
-      if (!g_socket_condition_timed_wait (socket, G_IO_IN, 100000, NULL, NULL))
-        continue;
+      if (!g_socket_condition_timed_wait (input->socket, G_IO_IN, timeout, NULL, NULL))
+        return FALSE;
 
-      /* Память для пакета с данными. */
-      if (packet == NULL)
-        {
-          g_rw_lock_writer_lock (&priv->b_lock);
-          packet = hyscan_slice_pool_pop (&priv->buffers);
-          g_rw_lock_writer_unlock (&priv->b_lock);
-        }
+      if (g_atomic_pointer_get (&priv->capture) != NULL)
+        hyscan_sonar_client_capture_packet (priv, input->socket);
 
-      if (packet == NULL)
-        {
-          g_warning ("HyScanSonarClient: buffer overrun");
+      return TRUE;
+    }
 
-          continue;
+  /* Считываем очередной пакет из файла. */
+  if (!input->pending)
+    {
+      guint8 record[HYSCAN_SONAR_CLIENT_CAPTURE_RECORD_SIZE];
+      guint32 size;
+      gsize n_read;
+
+      if (!g_input_stream_read_all (input->replay, record, sizeof (record), &n_read, NULL, NULL) ||
+          (n_read != sizeof (record)))
+        {
+          g_atomic_int_set (&priv->replay_done, 1);
+          g_usleep (timeout);
+          return FALSE;
         }
 
-      /* Принимаем пакет с данными. */
-      received = g_socket_receive_from (socket, NULL, (gpointer)packet, HYSCAN_SONAR_MSG_MAX_SIZE, NULL, NULL);
-      if (received <= 0)
-        continue;
+      memcpy (&input->time, record, sizeof (input->time));
+      memcpy (&size, record + sizeof (input->time), sizeof (size));
+      input->time = GINT64_FROM_LE (input->time);
+      input->size = MIN (GUINT32_FROM_LE (size), HYSCAN_SONAR_MSG_MAX_SIZE);
 
-      /* Проверяем пакет с данными. */
-      if ((received <= offsetof (HyScanSonarRpcPacket, data)) ||
-          (GUINT32_FROM_LE (packet->magic) != HYSCAN_SONAR_RPC_MAGIC) ||
-          (GUINT32_FROM_LE (packet->version) != HYSCAN_SONAR_RPC_VERSION))
+      if (!g_input_stream_read_all (input->replay, input->datagram, input->size, &n_read, NULL, NULL) ||
+          (n_read != input->size))
         {
-          g_warning ("HyScanSonarClient: unsupported packet format");
-          continue;
+          g_atomic_int_set (&priv->replay_done, 1);
+          return FALSE;
         }
 
-      if ((GUINT32_FROM_LE (packet->part_size) + GUINT32_FROM_LE (packet->offset) > GUINT32_FROM_LE (packet->size)) ||
-          (received - offsetof (HyScanSonarRpcPacket, data) != GUINT32_FROM_LE (packet->part_size)))
+      if (input->start_time == 0)
         {
-          g_warning ("HyScanSonarClient: packet %d size mismatch", packet->index);
-          continue;
+          input->start_time = g_get_monotonic_time ();
+          input->first_time = input->time;
         }
 
-      /* Отправляем пакет в обработку. */
-      g_mutex_lock (&priv->queue_lock);
-      g_queue_push_tail (priv->queue, packet);
-      g_cond_signal (&priv->queue_cond);
-      g_mutex_unlock (&priv->queue_lock);
-
-      packet = NULL;
+      input->pending = TRUE;
     }
 
-  g_clear_pointer (&packet, g_free);
-  g_clear_object (&socket);
+  /* Воспроизведение с максимальной скоростью. */
+  if (input->speed <= 0.0)
+    return TRUE;
 
-  return NULL;
+  /* Ожидаем времени поступления пакета. */
+  due_time = input->start_time + (input->time - input->first_time) / input->speed;
+  cur_time = g_get_monotonic_time ();
+  if (due_time > cur_time)
+    {
+      g_usleep (MIN (due_time - cur_time, timeout));
+      if (due_time > g_get_monotonic_time ())
+        return FALSE;
+    }
+
+  return TRUE;
 }
 
-/* Поток обработки принятых пакетов. */
-static gpointer
-hyscan_sonar_client_emitter (gpointer data)
+/* Функция считывает очередной пакет в массив векторов. Если peek равен TRUE,
+ * пакет остаётся доступным для последующего чтения. Если time не равен NULL,
+ * в него записывается время приёма пакета. */
+static gssize
+hyscan_sonar_client_input_receive (HyScanSonarClientInput *input,
+                                   GInputVector           *vectors,
+                                   guint                   n_vectors,
+                                   gboolean                peek,
+                                   gint64                 *time)
 {
-  HyScanSonarClient *sonar_client = data;
-  HyScanSonarClientPrivate *priv = sonar_client->priv;
+  gssize received = 0;
+  guint i;
+
+  if (input->socket != NULL)
+    {
+      gint flags = peek ? G_SOCKET_MSG_PEEK : G_SOCKET_MSG_NONE;
+
+      received = hyscan_sonar_client_socket_receive (input->socket, vectors, n_vectors, flags, time);
 
-  GHashTable *buffers;
-  guint32 next_index = 0;
+      /* В Windows чтение части датаграммы завершается ошибкой, но заголовок
+       * при этом считывается, поэтому проверяем только его содержимое. */
+#ifdef G_OS_WIN32
+      if (peek && (received < 0))
+        received = vectors[0].size;
+#endif
 
-  /* Буферы для данных. */
-  buffers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                   NULL, hyscan_sonar_client_free_buffer);
+      return received;
+    }
 
-  g_atomic_int_inc (&priv->started);
+  if (!input->pending)
+    return -1;
 
-  /* Обработка данных. */
-  while (g_atomic_int_get (&priv->shutdown) != 1)
+  if (time != NULL)
+    *time = input->time;
+
+  for (i = 0; (i < n_vectors) && ((gsize)received < input->size); i++)
     {
-      HyScanSonarRpcPacket *packet = NULL;
-      HyScanSonarClientBuffer *buffer;
-      HyScanSonarMessage message;
+      gsize size = MIN (vectors[i].size, input->size - received);
 
-      GHashTableIter iter;
-      gpointer data;
+      memcpy (vectors[i].buffer, input->datagram + received, size);
+      received += size;
+    }
 
-      guint32 id;
-      gint64 time;
-      guint32 type;
-      gfloat rate;
-      guint32 size;
-      guint32 offset;
-      guint32 part_size;
-      guint32 buffer_size;
-      guint32 crc1, crc2;
+  if (!peek)
+    input->pending = FALSE;
 
-      gint64 cond_time;
-      guint queue_len;
-      guint i;
+  return received;
+}
 
-      /* Отправим незавершённые сообщения, находящиеся в очереди дольше 1 секунды. */
-      g_hash_table_iter_init (&iter, buffers);
-      while (g_hash_table_iter_next (&iter, NULL, &data))
-        {
-          buffer = data;
+/* Функция извлекает и отбрасывает очередной пакет. */
+static void
+hyscan_sonar_client_input_drop (HyScanSonarClientInput *input)
+{
+  guint8 dummy;
 
-          if ((buffer->cur_size == 0) || (g_timer_elapsed (buffer->timer, NULL) < 1.0))
-            continue;
+  if (input->socket != NULL)
+    g_socket_receive (input->socket, (gpointer)&dummy, sizeof (dummy), NULL, NULL);
+  else
+    input->pending = FALSE;
+}
 
-          message.time = buffer->time;
-          message.id = buffer->id;
-          message.type = buffer->type;
-          message.rate = buffer->rate;
-          message.size = buffer->size;
-          message.data = buffer->buffer;
-
-          g_signal_emit (sonar_client, hyscan_sonar_client_signals[SIGNAL_DATA], 0, &message);
-          memset (buffer->buffer, 0, buffer->size);
-          buffer->cur_size = 0;
-          buffer->size = 0;
-          buffer->type = 0;
-          buffer->rate = 0.0;
-        }
+/* Функция записывает очередной пакет из сокета в файл записи принятых пакетов. */
+static void
+hyscan_sonar_client_capture_packet (HyScanSonarClientPrivate *priv,
+                                    GSocket                  *socket)
+{
+  guint8 record[HYSCAN_SONAR_CLIENT_CAPTURE_RECORD_SIZE];
+  GInputVector vector;
+  gint64 time;
+  guint32 size;
+  gssize received;
 
-      /* Ждём пакеты в очереди. */
-      g_mutex_lock (&priv->queue_lock);
-      cond_time = g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND;
-      if (priv->queue->length == 0)
-        if (!g_cond_wait_until (&priv->queue_cond, &priv->queue_lock, cond_time))
-          {
-            g_mutex_unlock (&priv->queue_lock);
-            continue;
-          }
-      queue_len = priv->queue->length;
-      g_mutex_unlock (&priv->queue_lock);
+  vector.buffer = priv->capture_buffer;
+  vector.size = HYSCAN_SONAR_MSG_MAX_SIZE;
+  received = hyscan_sonar_client_socket_receive (socket, &vector, 1, G_SOCKET_MSG_PEEK, &time);
+  if (received <= 0)
+    return;
 
-      /* Очередь пустая. */
-      if (queue_len == 0)
-        continue;
+  time = GINT64_TO_LE (time);
+  size = GUINT32_TO_LE (received);
+  memcpy (record, &time, sizeof (time));
+  memcpy (record + sizeof (time), &size, sizeof (size));
 
-      /* Обрабатываем все пакеты в очереди. */
-      while (queue_len > 0)
+  g_mutex_lock (&priv->capture_lock);
+  if (priv->capture != NULL)
+    {
+      if (!g_output_stream_write_all (priv->capture, record, sizeof (record), NULL, NULL, NULL) ||
+          !g_output_stream_write_all (priv->capture, priv->capture_buffer, received, NULL, NULL, NULL))
         {
-          /* Ищем пакет с индексом next_index. */
-          g_mutex_lock (&priv->queue_lock);
-          for (i = 0; i < queue_len; i++)
-            {
-              packet = g_queue_peek_nth (priv->queue, i);
-              if (GUINT32_FROM_LE (packet->index) == next_index)
-                break;
-            }
-          g_mutex_unlock (&priv->queue_lock);
+          g_warning ("HyScanSonarClient: can't write capture file");
+          g_output_stream_close (priv->capture, NULL, NULL);
+          g_clear_object (&priv->capture);
+        }
+    }
+  g_mutex_unlock (&priv->capture_lock);
+}
+
+/* Функция возвращает статистику источника данных. Статистика для нового источника
+ * создаётся и добавляется в общий список. Вызывается только из потока приёма. */
+static HyScanSonarClientSource *
+hyscan_sonar_client_source_lookup (HyScanSonarClientPrivate *priv,
+                                   GHashTable               *sources,
+                                   guint32                   id)
+{
+  HyScanSonarClientSource *source;
+
+  source = g_hash_table_lookup (sources, GINT_TO_POINTER (id));
+  if (source != NULL)
+    return source;
+
+  source = g_new0 (HyScanSonarClientSource, 1);
+  source->id = id;
+  source->next = priv->sources;
+  g_atomic_pointer_set (&priv->sources, source);
+
+  g_hash_table_insert (sources, GINT_TO_POINTER (id), source);
+
+  return source;
+}
+
+/* Функция учитывает принятый пакет в статистике источника данных. Номера пакетов
+ * сквозные для всех источников, поэтому уменьшение номера означает нарушение
+ * порядка доставки пакетов. */
+static void
+hyscan_sonar_client_source_packet (HyScanSonarClientSource *source,
+                                   guint32                  index,
+                                   guint32                  part_size)
+{
+  hyscan_sonar_client_stats_begin (&source->rx_seq);
+
+  source->n_packets += 1;
+  source->n_bytes += part_size;
+
+  if ((source->n_packets > 1) && (index < source->last_index))
+    source->max_reorder = MAX (source->max_reorder, source->last_index - index);
+  else
+    source->last_index = index;
+
+  hyscan_sonar_client_stats_end (&source->rx_seq);
+}
+
+/* Функции начала и завершения изменения группы счётчиков статистики. Счётчики
+ * изменяет один поток, поэтому вместо блокировки номер изменения увеличивается
+ * до и после изменения: нечётный номер означает незавершённое изменение. */
+static void
+hyscan_sonar_client_stats_begin (gint *seq)
+{
+  g_atomic_int_inc (seq);
+}
+
+static void
+hyscan_sonar_client_stats_end (gint *seq)
+{
+  g_atomic_int_inc (seq);
+}
+
+/* Функция считывает согласованные значения счётчиков статистики источника данных
+ * и гистограмму задержки доставки из любого потока. */
+static void
+hyscan_sonar_client_source_read (HyScanSonarClientSource *source,
+                                 HyScanSonarClientStats  *stats,
+                                 guint64                 *latency,
+                                 guint64                 *n_latency)
+{
+  gint seq;
+
+  do
+    {
+      while ((seq = g_atomic_int_get (&source->rx_seq)) & 1)
+        g_thread_yield ();
+
+      stats->n_packets = source->n_packets;
+      stats->n_bytes = source->n_bytes;
+      stats->n_lost = source->n_lost;
+      stats->n_crc_errors = source->n_crc_errors;
+      stats->n_malformed = source->n_malformed;
+      stats->n_duplicates = source->n_duplicates;
+      stats->n_overruns = source->n_overruns;
+      stats->n_incomplete = source->n_incomplete;
+      stats->max_reorder = source->max_reorder;
+    }
+  while (seq != g_atomic_int_get (&source->rx_seq));
+
+  do
+    {
+      while ((seq = g_atomic_int_get (&source->latency_seq)) & 1)
+        g_thread_yield ();
+
+      memcpy (latency, source->latency, sizeof (source->latency));
+      *n_latency = source->n_latency;
+    }
+  while (seq != g_atomic_int_get (&source->latency_seq));
+
+  stats->latency_median = hyscan_sonar_client_histogram_percentile (latency, *n_latency, 0.5);
+  stats->latency_p99 = hyscan_sonar_client_histogram_percentile (latency, *n_latency, 0.99);
+}
+
+/* Функция учитывает номер пакета с верной контрольной суммой. Номера, пропущенные
+ * при увеличении наибольшего принятого номера, сразу учитываются как потерянные.
+ * Если пропущенный пакет приходит позже, но в пределах окна, он исключается из
+ * числа потерянных. Пакет с ошибкой контрольной суммы остаётся пропущенным, даже
+ * если по нему не удалось определить источник или начать сборку сообщения. Резкое
+ * уменьшение номера означает перезапуск нумерации сервером. */
+static void
+hyscan_sonar_client_sequence_packet (HyScanSonarClientPrivate  *priv,
+                                     HyScanSonarClientSequence *sequence,
+                                     guint32                    index)
+{
+  guint32 slot = index % HYSCAN_SONAR_CLIENT_SEQ_WINDOW;
+  guint32 mask = 1u << (slot % 32);
+  guint32 n_advance;
+  guint32 i;
+  gint32 delta;
+
+  delta = (gint32)(index - sequence->next);
+
+  if (!sequence->started || (delta < -HYSCAN_SONAR_CLIENT_SEQ_RESET))
+    {
+      memset (sequence->received, 0xff, sizeof (sequence->received));
+      sequence->next = index + 1;
+      sequence->started = TRUE;
+      return;
+    }
+
+  /* Пакет из окна, учтённый как пропущенный. */
+  if (delta < 0)
+    {
+      if ((delta >= -HYSCAN_SONAR_CLIENT_SEQ_WINDOW) && !(sequence->received[slot / 32] & mask))
+        {
+          sequence->received[slot / 32] |= mask;
+
+          hyscan_sonar_client_stats_begin (&priv->missing_seq);
+          priv->n_missing -= 1;
+          hyscan_sonar_client_stats_end (&priv->missing_seq);
+        }
+
+      return;
+    }
+
+  /* Новые номера занимают в окне места самых старых. */
+  n_advance = MIN ((guint32)delta + 1, HYSCAN_SONAR_CLIENT_SEQ_WINDOW);
+  for (i = 0; i < n_advance; i++)
+    {
+      guint32 old_slot = (sequence->next + i) % HYSCAN_SONAR_CLIENT_SEQ_WINDOW;
+
+      sequence->received[old_slot / 32] &= ~(1u << (old_slot % 32));
+    }
+
+  sequence->received[slot / 32] |= mask;
+  sequence->next = index + 1;
+
+  if (delta > 0)
+    {
+      hyscan_sonar_client_stats_begin (&priv->missing_seq);
+      priv->n_missing += delta;
+      hyscan_sonar_client_stats_end (&priv->missing_seq);
+    }
+}
+
+/* Функция выводит сводку ошибок приёма данных, обнаруженных за интервал времени. */
+static void
+hyscan_sonar_client_report (HyScanSonarClientPrivate *priv,
+                            gint64                    interval)
+{
+  HyScanSonarClientSource *source;
+  gint seconds = interval / G_TIME_SPAN_SECOND;
+
+  if (priv->n_format_errors != priv->reported_format_errors)
+    {
+      g_warning ("HyScanSonarClient: %" G_GUINT64_FORMAT " packets of unsupported format in last %d seconds",
+                 priv->n_format_errors - priv->reported_format_errors, seconds);
+      priv->reported_format_errors = priv->n_format_errors;
+    }
+
+  for (source = priv->sources; source != NULL; source = source->next)
+    {
+      guint64 counters[6];
+      guint64 deltas[6];
+      gboolean changed = FALSE;
+      guint i;
+
+      counters[0] = source->n_lost;
+      counters[1] = source->n_crc_errors;
+      counters[2] = source->n_malformed;
+      counters[3] = source->n_duplicates;
+      counters[4] = source->n_overruns;
+      counters[5] = source->n_incomplete;
+
+      for (i = 0; i < G_N_ELEMENTS (counters); i++)
+        {
+          deltas[i] = counters[i] - source->reported[i];
+          changed |= (deltas[i] != 0);
+        }
+
+      if (changed)
+        {
+          g_warning ("HyScanSonarClient: source %d: %" G_GUINT64_FORMAT " lost, "
+                     "%" G_GUINT64_FORMAT " crc errors, %" G_GUINT64_FORMAT " malformed, "
+                     "%" G_GUINT64_FORMAT " duplicates, %" G_GUINT64_FORMAT " overruns, "
+                     "%" G_GUINT64_FORMAT " incomplete messages in last %d seconds",
+                     source->id, deltas[0], deltas[1], deltas[2],
+                     deltas[3], deltas[4], deltas[5], seconds);
+        }
+
+      memcpy (source->reported, counters, sizeof (counters));
+    }
+}
+
+/* Функция помещает сообщение в ячейку таймера, соответствующую времени окончания
+ * ожидания его фрагментов. Время, выходящее за пределы таймера, ограничивается
+ * последней ячейкой, при её обработке сообщение будет перемещено повторно. */
+static void
+hyscan_sonar_client_wheel_insert (HyScanSonarClientWheel  *wheel,
+                                  HyScanSonarClientBuffer *buffer)
+{
+  gint64 tick;
+
+  tick = (buffer->update_time + buffer->flush_timeout) / HYSCAN_SONAR_CLIENT_WHEEL_TICK;
+  tick = CLAMP (tick, wheel->tick + 1, wheel->tick + HYSCAN_SONAR_CLIENT_WHEEL_SLOTS - 1);
+
+  buffer->wheel_link.data = buffer;
+  buffer->wheel_slot = tick % HYSCAN_SONAR_CLIENT_WHEEL_SLOTS;
+  g_queue_push_tail_link (&wheel->slots[buffer->wheel_slot], &buffer->wheel_link);
+  wheel->n_entries += 1;
+}
+
+/* Функция удаляет сообщение из таймера. */
+static void
+hyscan_sonar_client_wheel_remove (HyScanSonarClientWheel  *wheel,
+                                  HyScanSonarClientBuffer *buffer)
+{
+  g_queue_unlink (&wheel->slots[buffer->wheel_slot], &buffer->wheel_link);
+  wheel->n_entries -= 1;
+}
+
+/* Функция обрабатывает ячейки таймера, время которых истекло. Сообщения, фрагменты
+ * которых принимались после помещения в таймер, перемещаются в новые ячейки, сборка
+ * остальных сообщений завершается. */
+static void
+hyscan_sonar_client_wheel_expire (HyScanSonarClientPrivate *priv,
+                                  HyScanSonarClientWheel   *wheel,
+                                  GHashTable               *buffers,
+                                  gint64                    cur_time)
+{
+  gint64 cur_tick = cur_time / HYSCAN_SONAR_CLIENT_WHEEL_TICK;
+
+  /* Все ячейки таймера проверяются не более одного раза. */
+  if (cur_tick - wheel->tick > HYSCAN_SONAR_CLIENT_WHEEL_SLOTS)
+    wheel->tick = cur_tick - HYSCAN_SONAR_CLIENT_WHEEL_SLOTS;
+
+  while (wheel->tick < cur_tick)
+    {
+      GQueue *slot;
+      GList *link;
+
+      wheel->tick += 1;
+      slot = &wheel->slots[wheel->tick % HYSCAN_SONAR_CLIENT_WHEEL_SLOTS];
+
+      while ((link = g_queue_pop_head_link (slot)) != NULL)
+        {
+          HyScanSonarClientBuffer *buffer = link->data;
+
+          wheel->n_entries -= 1;
+
+          if (buffer->update_time + buffer->flush_timeout > cur_time)
+            {
+              hyscan_sonar_client_wheel_insert (wheel, buffer);
+              continue;
+            }
+
+          g_hash_table_steal (buffers, GINT_TO_POINTER (buffer->id));
+          hyscan_sonar_client_flush_buffer (priv, buffer);
+        }
+    }
+}
+
+/* Функция проверяет контрольную сумму пакета, данные которого расположены в data. */
+static gboolean
+hyscan_sonar_client_check_crc (HyScanSonarRpcPacket *header,
+                               gconstpointer         data,
+                               guint32               part_size)
+{
+  guint32 crc1, crc2;
+
+  crc1 = header->crc32;
+  header->crc32 = 0;
+
+  crc2 = crc32 (0L, Z_NULL, 0);
+  crc2 = crc32 (crc2, (gpointer)header, HYSCAN_SONAR_CLIENT_HEADER_SIZE);
+  crc2 = crc32 (crc2, data, part_size);
+
+  return (crc1 == crc2);
+}
+
+/* Функция создаёт UDP сокет приёма сообщений от гидролокатора. Сокет связывается
+ * с локальным IP адресом RPC клиента и случайно выбранным UDP портом. */
+static GSocket *
+hyscan_sonar_client_open_socket (HyScanSonarClientPrivate *priv)
+{
+  gchar receiver_host[1024];
+  const gchar *uri;
+  const gchar *end;
+
+  GSocket *socket = NULL;
+  GSocketAddress *address = NULL;
+
+  /* Локальный IP адрес с которого подключились к гидролокатору. */
+  uri = priv->self_address + 6;
+  if (uri[0] == '[')
+    {
+      uri = uri + 1;
+      end = strstr (uri, "]:");
+    }
+  else
+    {
+      end = strstr (uri, ":");
+    }
+
+  memset (receiver_host, 0, sizeof (receiver_host));
+  memcpy (receiver_host, uri, end - uri);
+  priv->receiver_host = g_strdup (receiver_host);
+
+  /* Сокет приёма сообщений от гидролокатора. */
+  do
+    {
+      GError *error;
+      gint error_code;
+      gboolean status;
+
+      /* Выбираем случайный порт. */
+      priv->receiver_port = g_random_int_range (HYSCAN_SONAR_RPC_MIN_PORT, HYSCAN_SONAR_RPC_MAX_PORT);
+
+      /* Создаём и подключаем к нему сокет. */
+      address = g_inet_socket_address_new_from_string (priv->receiver_host, priv->receiver_port);
+      if (address == NULL)
+        break;
+
+      socket = g_socket_new (g_socket_address_get_family (address),
+                             G_SOCKET_TYPE_DATAGRAM,
+                             G_SOCKET_PROTOCOL_UDP,
+                             NULL);
+      if (socket == NULL)
+        break;
+
+      status = g_socket_bind (socket, address, FALSE, &error);
+      g_clear_object (&address);
+
+      /* Успешно подключились. Включаем метки времени приёма датаграмм ядром,
+       * если это невозможно, время приёма определяется при чтении пакета. */
+      if (status)
+        {
+#ifdef HYSCAN_SONAR_CLIENT_SO_TIMESTAMP
+          g_socket_set_option (socket, SOL_SOCKET, HYSCAN_SONAR_CLIENT_SO_TIMESTAMP, 1, NULL);
+#endif
+          break;
+        }
+
+      /* Потом создадим сокет еще раз. */
+      g_clear_object (&socket);
+
+      error_code = error->code;
+      g_error_free (error);
+
+      /* Порт уже используется, выберем другой. */
+      if (error_code == G_IO_ERROR_ADDRESS_IN_USE)
+        continue;
+
+      /* Другая ошибка, печалька... */
+      break;
+    }
+  while (TRUE);
+
+  return socket;
+}
+
+/* Функция считывает датаграмму из сокета в массив векторов. Если time не равен NULL,
+ * в него записывается время приёма датаграммы, UTC в микросекундах. Время берётся
+ * из метки времени ядра, а при её отсутствии используется текущее время. Метка
+ * ядра не включает время ожидания датаграммы в очереди сокета. */
+static gssize
+hyscan_sonar_client_socket_receive (GSocket      *socket,
+                                    GInputVector *vectors,
+                                    guint         n_vectors,
+                                    gint          flags,
+                                    gint64       *time)
+{
+  gssize received;
+
+#ifdef HYSCAN_SONAR_CLIENT_SO_TIMESTAMP
+  union
+  {
+    struct cmsghdr     header;
+    guint8             data[CMSG_SPACE (sizeof (HyScanSonarClientTimestamp))];
+  } control;
+
+  struct iovec iov[HYSCAN_SONAR_CLIENT_MAX_VECTORS];
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  guint i;
+
+  n_vectors = MIN (n_vectors, HYSCAN_SONAR_CLIENT_MAX_VECTORS);
+  for (i = 0; i < n_vectors; i++)
+    {
+      iov[i].iov_base = vectors[i].buffer;
+      iov[i].iov_len = vectors[i].size;
+    }
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = n_vectors;
+  msg.msg_control = &control;
+  msg.msg_controllen = sizeof (control);
+
+  do
+    received = recvmsg (g_socket_get_fd (socket), &msg, flags);
+  while ((received < 0) && (errno == EINTR));
+
+  if (time == NULL)
+    return received;
+
+  *time = 0;
+  if (received >= 0)
+    {
+      for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg))
+        {
+          HyScanSonarClientTimestamp timestamp;
+
+          if ((cmsg->cmsg_level != SOL_SOCKET) ||
+              (cmsg->cmsg_type != HYSCAN_SONAR_CLIENT_SCM_TIMESTAMP))
+            {
+              continue;
+            }
+
+          memcpy (&timestamp, CMSG_DATA (cmsg), sizeof (timestamp));
+          *time = HYSCAN_SONAR_CLIENT_TIMESTAMP_USEC (timestamp);
+        }
+    }
+
+  if (*time == 0)
+    *time = g_get_real_time ();
+#else
+  received = g_socket_receive_message (socket, NULL, vectors, n_vectors,
+                                       NULL, NULL, &flags, NULL, NULL);
+
+  if (time != NULL)
+    *time = g_get_real_time ();
+#endif
+
+  return received;
+}
+
+/* Функция создаёт состояние приёма сообщений: источник пакетов, буферы сборки
+ * сообщений и таймер ожидания их фрагментов. */
+static HyScanSonarClientReception *
+hyscan_sonar_client_reception_new (HyScanSonarClientPrivate *priv)
+{
+  HyScanSonarClientReception *rx;
+
+  rx = g_new0 (HyScanSonarClientReception, 1);
+
+  /* Источник пакетов: сокет или файл записанных пакетов. */
+  if (priv->replay != NULL)
+    {
+      rx->input.replay = priv->replay;
+      rx->input.speed = priv->replay_speed;
+      rx->input.datagram = g_malloc (HYSCAN_SONAR_MSG_MAX_SIZE);
+    }
+  else
+    {
+      rx->input.socket = hyscan_sonar_client_open_socket (priv);
+      if (rx->input.socket == NULL)
+        {
+          g_clear_pointer (&priv->receiver_host, g_free);
+          priv->receiver_port = 0;
+          g_free (rx);
+          return NULL;
+        }
+    }
+
+  /* Буферы сборки сообщений по источникам данных и таймер ожидания их фрагментов. */
+  rx->buffers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                       NULL, hyscan_sonar_client_free_buffer);
+  rx->wheel.tick = g_get_monotonic_time () / HYSCAN_SONAR_CLIENT_WHEEL_TICK;
+
+  /* Статистика приёма данных по источникам. */
+  rx->sources = g_hash_table_new (g_direct_hash, g_direct_equal);
+  rx->report_time = g_get_monotonic_time ();
+
+  return rx;
+}
+
+/* Функция освобождает состояние приёма сообщений. */
+static void
+hyscan_sonar_client_reception_free (HyScanSonarClientReception *rx)
+{
+  g_hash_table_unref (rx->buffers);
+  g_hash_table_unref (rx->sources);
+  g_free (rx->input.datagram);
+  g_clear_object (&rx->input.socket);
+
+  g_free (rx);
+}
+
+/* Функция завершает сборку сообщений, время ожидания фрагментов которых истекло,
+ * и выводит сводку ошибок приёма данных. Ошибки не выводятся для каждого пакета,
+ * чтобы при большом числе потерь не перегружать журнал. Функция возвращает время
+ * следующей проверки: пока есть незавершённые сообщения - через интервал таймера. */
+static gint64
+hyscan_sonar_client_reception_timers (HyScanSonarClientPrivate   *priv,
+                                      HyScanSonarClientReception *rx,
+                                      gint64                      cur_time)
+{
+  hyscan_sonar_client_wheel_expire (priv, &rx->wheel, rx->buffers, cur_time);
+
+  if (cur_time - rx->report_time >= HYSCAN_SONAR_CLIENT_REPORT_INTERVAL)
+    {
+      hyscan_sonar_client_report (priv, cur_time - rx->report_time);
+      rx->report_time = cur_time;
+    }
+
+  if (rx->wheel.n_entries > 0)
+    return (rx->wheel.tick + 1) * HYSCAN_SONAR_CLIENT_WHEEL_TICK;
+
+  return rx->report_time + HYSCAN_SONAR_CLIENT_REPORT_INTERVAL;
+}
+
+/* Функция принимает и обрабатывает очередной пакет. Вызывается, когда пакет
+ * доступен для чтения. */
+static void
+hyscan_sonar_client_receive_packet (HyScanSonarClientPrivate   *priv,
+                                    HyScanSonarClientReception *rx)
+{
+  HyScanSonarRpcPacket header;
+  HyScanSonarRpcPacket *packet;
+  HyScanSonarClientBuffer *buffer;
+
+  GInputVector vectors[3];
+  guint8 tail;
+
+  HyScanSonarClientFlushPolicy *policy;
+  HyScanSonarClientSource *source;
+  gssize received;
+  gint64 cur_time;
+  gint64 arrival_time;
+
+  guint32 id;
+  gint64 time;
+  guint32 type;
+  gfloat rate;
+  guint32 size;
+  guint32 index;
+  guint32 offset;
+  guint32 part_size;
+  guint32 part_index;
+  guint32 part_mask;
+  guint32 buffer_size;
+  guint32 parts_size;
+
+  /* Время приёма пакета. */
+  cur_time = g_get_monotonic_time ();
+
+  /* Считываем заголовок пакета, не извлекая датаграмму из сокета. */
+  header.magic = 0;
+  vectors[0].buffer = &header;
+  vectors[0].size = HYSCAN_SONAR_CLIENT_HEADER_SIZE;
+  received = hyscan_sonar_client_input_receive (&rx->input, vectors, 1, TRUE, NULL);
+
+  /* Проверяем заголовок пакета. */
+  if ((received < (gssize)HYSCAN_SONAR_CLIENT_HEADER_SIZE) ||
+      (GUINT32_FROM_LE (header.magic) != HYSCAN_SONAR_RPC_MAGIC) ||
+      (GUINT32_FROM_LE (header.version) != HYSCAN_SONAR_RPC_VERSION))
+    {
+      priv->n_format_errors += 1;
+      hyscan_sonar_client_input_drop (&rx->input);
+      return;
+    }
+
+  /* Параметры данных из пакета. */
+  id = GUINT32_FROM_LE (header.id);
+  time = GINT64_FROM_LE (header.time);
+  type = GUINT32_FROM_LE (header.type);
+  rate = hyscan_sonar_rpc_float_from_le (header.rate);
+  size = GUINT32_FROM_LE (header.size);
+  index = GUINT32_FROM_LE (header.index);
+  part_size = GUINT32_FROM_LE (header.part_size);
+  offset = GUINT32_FROM_LE (header.offset);
+
+  source = hyscan_sonar_client_source_lookup (priv, rx->sources, id);
+
+  /* Данные разбиваются на фрагменты фиксированного размера, кроме последнего. */
+  if ((offset >= size) ||
+      (offset % HYSCAN_SONAR_MSG_DATA_PART_SIZE != 0) ||
+      (part_size != MIN (HYSCAN_SONAR_MSG_DATA_PART_SIZE, size - offset)))
+    {
+      hyscan_sonar_client_stats_begin (&source->rx_seq);
+      source->n_malformed += 1;
+      hyscan_sonar_client_stats_end (&source->rx_seq);
+      hyscan_sonar_client_input_drop (&rx->input);
+      return;
+    }
+
+  /* Сообщение из одного фрагмента принимаем целиком в пакет и передаём
+   * на обработку без копирования. */
+  if ((offset == 0) && (part_size == size))
+    {
+      g_rw_lock_writer_lock (&priv->pool->lock);
+      packet = hyscan_slice_pool_pop (&priv->pool->buffers);
+      g_rw_lock_writer_unlock (&priv->pool->lock);
+
+      buffer = (packet != NULL) ? hyscan_sonar_client_pop_buffer (priv) : NULL;
+      if (buffer == NULL)
+        {
+          hyscan_sonar_client_stats_begin (&source->rx_seq);
+          source->n_overruns += 1;
+          hyscan_sonar_client_stats_end (&source->rx_seq);
+          hyscan_sonar_client_input_drop (&rx->input);
+
+          if (packet != NULL)
+            {
+              g_rw_lock_writer_lock (&priv->pool->lock);
+              hyscan_slice_pool_push (&priv->pool->buffers, packet);
+              g_rw_lock_writer_unlock (&priv->pool->lock);
+            }
+
+          return;
+        }
+
+      buffer->packet = packet;
+      buffer->source = source;
+
+      vectors[0].buffer = packet;
+      vectors[0].size = HYSCAN_SONAR_MSG_MAX_SIZE;
+      received = hyscan_sonar_client_input_receive (&rx->input, vectors, 1, FALSE, &arrival_time);
+      if (received - (gssize)HYSCAN_SONAR_CLIENT_HEADER_SIZE != (gssize)part_size)
+        {
+          hyscan_sonar_client_stats_begin (&source->rx_seq);
+          source->n_malformed += 1;
+          hyscan_sonar_client_stats_end (&source->rx_seq);
+          hyscan_sonar_client_push_buffer (priv->pool, buffer);
+          return;
+        }
+
+      if (!hyscan_sonar_client_check_crc (packet, packet->data, part_size))
+        {
+          hyscan_sonar_client_stats_begin (&source->rx_seq);
+          source->n_crc_errors += 1;
+          hyscan_sonar_client_stats_end (&source->rx_seq);
+          hyscan_sonar_client_push_buffer (priv->pool, buffer);
+          return;
+        }
+
+      hyscan_sonar_client_source_packet (source, index, part_size);
+      hyscan_sonar_client_sequence_packet (priv, &rx->sequence, index);
+
+      buffer->id = id;
+      buffer->time = time;
+      buffer->type = type;
+      buffer->rate = rate;
+      buffer->size = size;
+      buffer->n_parts = 1;
+      buffer->n_received = 1;
+      buffer->update_time = cur_time;
+      buffer->arrival_time = arrival_time;
+
+      hyscan_sonar_client_send_buffer (priv, buffer);
+
+      return;
+    }
+
+  /* Буфер сборки сообщения. */
+  buffer = g_hash_table_lookup (rx->buffers, GINT_TO_POINTER (id));
+
+  /* Изменилось время, завершаем сборку неполного сообщения. */
+  if ((buffer != NULL) && (time > buffer->time))
+    {
+      g_hash_table_steal (rx->buffers, GINT_TO_POINTER (id));
+      hyscan_sonar_client_wheel_remove (&rx->wheel, buffer);
+      hyscan_sonar_client_flush_buffer (priv, buffer);
+
+      buffer = NULL;
+    }
+
+  /* Обрабатываем только актуальные пакеты. */
+  if ((buffer != NULL) &&
+      ((buffer->time != time) || (buffer->size != size) ||
+       (buffer->type != type) || (buffer->rate != rate)))
+    {
+      hyscan_sonar_client_stats_begin (&source->rx_seq);
+      source->n_malformed += 1;
+      hyscan_sonar_client_stats_end (&source->rx_seq);
+      hyscan_sonar_client_input_drop (&rx->input);
+      return;
+    }
+
+  /* Новое сообщение. */
+  if (buffer == NULL)
+    {
+      buffer = hyscan_sonar_client_pop_buffer (priv);
+      if (buffer == NULL)
+        {
+          hyscan_sonar_client_stats_begin (&source->rx_seq);
+          source->n_overruns += 1;
+          hyscan_sonar_client_stats_end (&source->rx_seq);
+          hyscan_sonar_client_input_drop (&rx->input);
+          return;
+        }
+
+      /* Корректируем размер буфера для данных. */
+      if (size > buffer->buffer_size)
+        {
+          buffer_size = size / HYSCAN_SONAR_CLIENT_SLAB_ALIGN;
+          buffer_size += (size % HYSCAN_SONAR_CLIENT_SLAB_ALIGN) ? 1 : 0;
+          buffer_size *= HYSCAN_SONAR_CLIENT_SLAB_ALIGN;
+
+          if (!buffer->in_arena)
+            g_free (buffer->buffer);
+          buffer->buffer = g_malloc (buffer_size);
+          buffer->buffer_size = buffer_size;
+          buffer->in_arena = FALSE;
+        }
+
+      /* Битовая маска принятых фрагментов. */
+      buffer->n_parts = size / HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+      buffer->n_parts += (size % HYSCAN_SONAR_MSG_DATA_PART_SIZE) ? 1 : 0;
+      parts_size = (buffer->n_parts + 31) / 32;
+      if (parts_size > buffer->parts_size)
+        {
+          g_free (buffer->parts);
+          buffer->parts = g_new (guint32, parts_size);
+          buffer->parts_size = parts_size;
+        }
+      memset (buffer->parts, 0, parts_size * sizeof (guint32));
+      buffer->n_received = 0;
+
+      buffer->id = id;
+      buffer->source = source;
+      buffer->time = time;
+      buffer->type = type;
+      buffer->rate = rate;
+      buffer->size = size;
+      buffer->update_time = cur_time;
+
+      /* Правило сборки сообщений источника данных. */
+      g_mutex_lock (&priv->policy_lock);
+      policy = g_hash_table_lookup (priv->policies, GINT_TO_POINTER (id));
+      buffer->flush_timeout = (policy != NULL) ? policy->timeout :
+                              HYSCAN_SONAR_CLIENT_DEFAULT_FLUSH_TIMEOUT * G_TIME_SPAN_SECOND;
+      buffer->deliver = (policy != NULL) ? policy->deliver : TRUE;
+      g_mutex_unlock (&priv->policy_lock);
+
+      g_hash_table_insert (rx->buffers, GINT_TO_POINTER (id), buffer);
+      hyscan_sonar_client_wheel_insert (&rx->wheel, buffer);
+    }
+
+  /* Повторно принятый фрагмент пропускаем. */
+  part_index = offset / HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+  part_mask = 1u << (part_index % 32);
+  if (buffer->parts[part_index / 32] & part_mask)
+    {
+      hyscan_sonar_client_stats_begin (&source->rx_seq);
+      source->n_duplicates += 1;
+      hyscan_sonar_client_stats_end (&source->rx_seq);
+      hyscan_sonar_client_input_drop (&rx->input);
+      return;
+    }
+
+  /* Принимаем данные сразу в буфер сборки по смещению фрагмента. Последний вектор
+   * нужен для обнаружения датаграмм, размер которых больше заявленного. */
+  vectors[0].buffer = &header;
+  vectors[0].size = HYSCAN_SONAR_CLIENT_HEADER_SIZE;
+  vectors[1].buffer = buffer->buffer + offset;
+  vectors[1].size = part_size;
+  vectors[2].buffer = &tail;
+  vectors[2].size = sizeof (tail);
+
+  received = hyscan_sonar_client_input_receive (&rx->input, vectors, 3, FALSE, &arrival_time);
+  if (received - (gssize)HYSCAN_SONAR_CLIENT_HEADER_SIZE != (gssize)part_size)
+    {
+      hyscan_sonar_client_stats_begin (&source->rx_seq);
+      source->n_malformed += 1;
+      hyscan_sonar_client_stats_end (&source->rx_seq);
+      return;
+    }
+
+  if (!hyscan_sonar_client_check_crc (&header, buffer->buffer + offset, part_size))
+    {
+      hyscan_sonar_client_stats_begin (&source->rx_seq);
+      source->n_crc_errors += 1;
+      hyscan_sonar_client_stats_end (&source->rx_seq);
+      hyscan_sonar_client_loss_signal (priv);
+      return;
+    }
+
+  hyscan_sonar_client_source_packet (source, index, part_size);
+  hyscan_sonar_client_sequence_packet (priv, &rx->sequence, index);
+
+  buffer->parts[part_index / 32] |= part_mask;
+  buffer->n_received += 1;
+  buffer->update_time = cur_time;
+  buffer->arrival_time = arrival_time;
+
+  /* Собрали все данные. */
+  if (buffer->n_received == buffer->n_parts)
+    {
+      g_hash_table_steal (rx->buffers, GINT_TO_POINTER (id));
+      hyscan_sonar_client_wheel_remove (&rx->wheel, buffer);
+      hyscan_sonar_client_send_buffer (priv, buffer);
+    }
+}
+
+/* Поток приёма сообщений от гидролокатора. */
+static gpointer
+hyscan_sonar_client_receiver (gpointer data)
+{
+  HyScanSonarClientPrivate *priv = data;
+  HyScanSonarClientReception *rx;
+
+  rx = hyscan_sonar_client_reception_new (priv);
+
+  hyscan_sonar_client_thread_started (priv);
+
+  /* Поток запустился с ошибкой */
+  if (rx == NULL)
+    {
+      g_warning ("HyScanSonarClient: can't setup receiver thread");
+      return NULL;
+    }
+
+  /* Приём данных. */
+  while (g_atomic_int_get (&priv->shutdown) != 1)
+    {
+      hyscan_sonar_client_reception_timers (priv, rx, g_get_monotonic_time ());
+
+      /* Проверка наличия входных данных. Если есть незавершённые сообщения,
+       * ожидание ограничивается интервалом таймера. */
+      if (!hyscan_sonar_client_input_wait (priv, &rx->input,
+                                           (rx->wheel.n_entries > 0) ? HYSCAN_SONAR_CLIENT_WHEEL_TICK : 100000))
+        {
+          continue;
+        }
+
+      hyscan_sonar_client_receive_packet (priv, rx);
+    }
+
+  hyscan_sonar_client_reception_free (rx);
+
+  return NULL;
+}
+
+/* Функция обработки событий подключения в общем приёмнике. За один вызов считывается
+ * не более HYSCAN_SONAR_CLIENT_RECEIVE_BATCH пакетов, чтобы не задерживать приём данных
+ * других клиентов. Оставшиеся пакеты будут считаны при следующем вызове. */
+static gint64
+hyscan_sonar_client_receive_shared (gpointer data,
+                                    gint64   cur_time)
+{
+  HyScanSonarClientPrivate *priv = data;
+  HyScanSonarClientReception *rx = priv->reception;
+  guint i;
+
+  for (i = 0; i < HYSCAN_SONAR_CLIENT_RECEIVE_BATCH; i++)
+    {
+      if ((g_socket_condition_check (rx->input.socket, G_IO_IN) & G_IO_IN) == 0)
+        break;
+
+      if (g_atomic_pointer_get (&priv->capture) != NULL)
+        hyscan_sonar_client_capture_packet (priv, rx->input.socket);
+
+      hyscan_sonar_client_receive_packet (priv, rx);
+    }
+
+  return hyscan_sonar_client_reception_timers (priv, rx, g_get_monotonic_time ());
+}
+
+/* Функция доставляет собранное сообщение. Используется потоками доставки
+ * общего приёмника. */
+static void
+hyscan_sonar_client_deliver (gpointer owner,
+                             gpointer data)
+{
+  HyScanSonarClientBuffer *buffer = data;
+
+  hyscan_sonar_client_deliver_batch (owner, &buffer, 1);
+}
+
+/* Функция доставляет пакет собранных сообщений. Каждой функции приёма данных
+ * подходящие сообщения передаются одним вызовом. Сигналы "data" отправляются,
+ * только если к ним подключены обработчики. Буферы сообщений возвращаются в кучу,
+ * если получатели не сохранили ссылки на сообщения. */
+static void
+hyscan_sonar_client_deliver_batch (HyScanSonarClient        *sonar_client,
+                                   HyScanSonarClientBuffer **buffers,
+                                   guint                     n_buffers)
+{
+  HyScanSonarClientPrivate *priv = sonar_client->priv;
+  HyScanSonarMessage *messages[HYSCAN_SONAR_CLIENT_DELIVER_BATCH];
+  GPtrArray *sinks;
+  guint i, j;
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      HyScanSonarClientBuffer *buffer = buffers[i];
+      HyScanSonarMessage *message = &buffer->message;
+
+      message->time = buffer->time;
+      message->arrival_time = buffer->arrival_time;
+      message->id = buffer->id;
+      message->type = buffer->type;
+      message->rate = buffer->rate;
+      message->size = buffer->size;
+      message->data = (buffer->packet != NULL) ? (gpointer)buffer->packet->data : (gpointer)buffer->buffer;
+      message->n_parts = (buffer->n_received < buffer->n_parts) ? buffer->n_parts : 0;
+      message->part_size = HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+      message->parts = buffer->parts;
+      buffer->ref_count = 1;
+
+      /* Задержка от приёма последнего фрагмента сообщения ядром до начала его доставки,
+       * включая время ожидания в очереди сокета. При воспроизведении записи время
+       * приёма взято из файла и задержка не учитывается. */
+      if (priv->replay == NULL)
+        {
+          hyscan_sonar_client_stats_begin (&buffer->source->latency_seq);
+          hyscan_sonar_client_histogram_add (buffer->source->latency, g_get_real_time () - buffer->arrival_time);
+          buffer->source->n_latency += 1;
+          hyscan_sonar_client_stats_end (&buffer->source->latency_seq);
+        }
+    }
+
+  /* Функции приёма данных. */
+  g_mutex_lock (&priv->sinks_lock);
+  sinks = g_ptr_array_ref (priv->sinks);
+  g_mutex_unlock (&priv->sinks_lock);
+
+  for (i = 0; i < sinks->len; i++)
+    {
+      HyScanSonarClientSink *sink = g_ptr_array_index (sinks, i);
+      guint n_messages = 0;
+
+      for (j = 0; j < n_buffers; j++)
+        {
+          HyScanSonarMessage *message = &buffers[j]->message;
+
+          if ((sink->source != HYSCAN_SONAR_CLIENT_ANY_SOURCE) && (sink->source != message->id))
+            continue;
+          if ((sink->type != HYSCAN_SONAR_CLIENT_ANY_TYPE) && (sink->type != message->type))
+            continue;
+
+          messages[n_messages++] = message;
+        }
+
+      if (n_messages > 0)
+        sink->func (sonar_client, (HyScanSonarMessage * const *)messages, n_messages, sink->user_data);
+    }
+
+  g_ptr_array_unref (sinks);
+
+  /* Сигналы "data". */
+  if (g_signal_has_handler_pending (sonar_client, hyscan_sonar_client_signals[SIGNAL_DATA], 0, TRUE))
+    {
+      for (i = 0; i < n_buffers; i++)
+        g_signal_emit (sonar_client, hyscan_sonar_client_signals[SIGNAL_DATA], 0, &buffers[i]->message);
+    }
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      if (g_atomic_int_dec_and_test (&buffers[i]->ref_count))
+        hyscan_sonar_client_push_buffer (priv->pool, buffers[i]);
+    }
+}
+
+/* Функция увеличивает счётчик ссылок на функцию приёма данных. */
+static HyScanSonarClientSink *
+hyscan_sonar_client_sink_ref (HyScanSonarClientSink *sink)
+{
+  g_atomic_int_inc (&sink->ref_count);
+
+  return sink;
+}
+
+/* Функция уменьшает счётчик ссылок на функцию приёма данных. */
+static void
+hyscan_sonar_client_sink_unref (gpointer data)
+{
+  HyScanSonarClientSink *sink = data;
+
+  if (!g_atomic_int_dec_and_test (&sink->ref_count))
+    return;
+
+  if (sink->destroy != NULL)
+    sink->destroy (sink->user_data);
+
+  g_free (sink);
+}
+
+/* Поток отправки сигналов с принятыми сообщениями. */
+static gpointer
+hyscan_sonar_client_emitter (gpointer data)
+{
+  HyScanSonarClientWorker *worker = data;
+  HyScanSonarClient *sonar_client = worker->client;
+  HyScanSonarClientPrivate *priv = sonar_client->priv;
+
+  hyscan_sonar_client_thread_started (priv);
+
+  while (g_atomic_int_get (&priv->shutdown) != 1)
+    {
+      HyScanSonarClientBuffer *buffers[HYSCAN_SONAR_CLIENT_DELIVER_BATCH];
+      HyScanSonarClientBuffer *buffer;
+      guint n_buffers = 0;
+      gint64 cond_time;
+
+      /* Ждём сообщения в очереди и забираем все накопившиеся сообщения. */
+      g_mutex_lock (&worker->queue_lock);
+      if (g_queue_is_empty (worker->queue))
+        {
+          cond_time = g_get_monotonic_time () + 100 * G_TIME_SPAN_MILLISECOND;
+          g_cond_wait_until (&worker->queue_cond, &worker->queue_lock, cond_time);
+        }
+      while ((n_buffers < HYSCAN_SONAR_CLIENT_DELIVER_BATCH) &&
+             ((buffer = g_queue_pop_head (worker->queue)) != NULL))
+        {
+          buffers[n_buffers++] = buffer;
+        }
+      g_mutex_unlock (&worker->queue_lock);
+
+      if (n_buffers == 0)
+        continue;
+
+      hyscan_sonar_client_deliver_batch (sonar_client, buffers, n_buffers);
+    }
+
+  return NULL;
+}
+
+/* Функция создаёт новый объект HyScanSonarClient. */
+HyScanSonarClient *
+hyscan_sonar_client_new (const gchar *host)
+{
+  return hyscan_sonar_client_new_full (host,
+                                       HYSCAN_SONAR_CLIENT_DEFAULT_TIMEOUT,
+                                       HYSCAN_SONAR_CLIENT_DEFAULT_EXEC,
+                                       HYSCAN_SONAR_CLIENT_DEFAULT_N_BUFFERS);
+}
+
+/* Функция создаёт новый объект HyScanSonarClient. */
+HyScanSonarClient *
+hyscan_sonar_client_new_full (const gchar *host,
+                              gdouble      timeout,
+                              guint        n_exec,
+                              guint        n_buffers)
+{
+  HyScanSonarClient *client;
+
+  if (timeout < HYSCAN_SONAR_CLIENT_MIN_TIMEOUT)
+    timeout = HYSCAN_SONAR_CLIENT_MIN_TIMEOUT;
+
+  if (timeout > HYSCAN_SONAR_CLIENT_MAX_TIMEOUT)
+    timeout = HYSCAN_SONAR_CLIENT_MAX_TIMEOUT;
+
+  client = g_object_new (HYSCAN_TYPE_SONAR_CLIENT,
+                         "host", host,
+                         "timeout", timeout,
+                         "n-exec", n_exec,
+                         "n-buffers", n_buffers,
+                         NULL);
+
+  /* При ошибке подключения объект возвращается неподключенным,
+   * все запросы к гидролокатору будут завершаться ошибкой. */
+  g_initable_init (G_INITABLE (client), NULL, NULL);
+
+  return client;
+}
+
+/* Функция асинхронно создаёт новый объект HyScanSonarClient. */
+void
+hyscan_sonar_client_new_async (const gchar                   *host,
+                               gdouble                        timeout,
+                               guint                          n_exec,
+                               guint                          n_buffers,
+                               HyScanSonarClientProgressFunc  progress_func,
+                               gpointer                       progress_data,
+                               GCancellable                  *cancellable,
+                               GAsyncReadyCallback            callback,
+                               gpointer                       user_data)
+{
+  HyScanSonarClient *client;
+
+  timeout = CLAMP (timeout, HYSCAN_SONAR_CLIENT_MIN_TIMEOUT, HYSCAN_SONAR_CLIENT_MAX_TIMEOUT);
+
+  client = g_object_new (HYSCAN_TYPE_SONAR_CLIENT,
+                         "host", host,
+                         "timeout", timeout,
+                         "n-exec", n_exec,
+                         "n-buffers", n_buffers,
+                         NULL);
+
+  client->priv->progress_func = progress_func;
+  client->priv->progress_data = progress_data;
+  client->priv->progress_context = g_main_context_ref_thread_default ();
+
+  g_async_initable_init_async (G_ASYNC_INITABLE (client), G_PRIORITY_DEFAULT,
+                               cancellable, callback, user_data);
+
+  g_object_unref (client);
+}
+
+/* Функция завершает асинхронное создание объекта HyScanSonarClient. */
+HyScanSonarClient *
+hyscan_sonar_client_new_finish (GAsyncResult  *result,
+                                GError       **error)
+{
+  GObject *client;
+
+  client = g_async_result_get_source_object (result);
+  if (client == NULL)
+    return NULL;
+
+  if (!g_async_initable_init_finish (G_ASYNC_INITABLE (client), result, error))
+    {
+      g_object_unref (client);
+      return NULL;
+    }
+
+  return HYSCAN_SONAR_CLIENT (client);
+}
+
+/* Функция создаёт объект HyScanSonarClient, воспроизводящий записанные пакеты. */
+HyScanSonarClient *
+hyscan_sonar_client_new_replay (const gchar *path,
+                                gdouble      speed,
+                                guint        n_buffers,
+                                guint        n_workers)
+{
+  HyScanSonarClient *client;
+  GInputStream *replay;
+  GFile *file;
+
+  guint32 header[2];
+  gsize n_read;
+
+  /* Открываем файл и проверяем его формат. */
+  file = g_file_new_for_path (path);
+  replay = G_INPUT_STREAM (g_file_read (file, NULL, NULL));
+  g_object_unref (file);
+
+  if (replay == NULL)
+    {
+      g_warning ("HyScanSonarClient: can't open capture file '%s'", path);
+      return NULL;
+    }
+
+  if (!g_input_stream_read_all (replay, header, sizeof (header), &n_read, NULL, NULL) ||
+      (n_read != sizeof (header)) ||
+      (GUINT32_FROM_LE (header[0]) != HYSCAN_SONAR_CLIENT_CAPTURE_MAGIC) ||
+      (GUINT32_FROM_LE (header[1]) != HYSCAN_SONAR_CLIENT_CAPTURE_VERSION))
+    {
+      g_warning ("HyScanSonarClient: unsupported capture file '%s'", path);
+      g_object_unref (replay);
+      return NULL;
+    }
+
+  client = g_object_new (HYSCAN_TYPE_SONAR_CLIENT,
+                         "n-buffers", n_buffers,
+                         "n-workers", n_workers,
+                         NULL);
+
+  /* Клиент не подключается к гидролокатору, пакеты считываются из файла. */
+  client->priv->initialized = TRUE;
+  client->priv->replay = G_INPUT_STREAM (g_buffered_input_stream_new_sized (replay, 1024 * 1024));
+  client->priv->replay_speed = speed;
+  g_object_unref (replay);
+
+  hyscan_sonar_client_start_threads (client->priv);
+  hyscan_sonar_client_wait_threads (client->priv);
+
+  return client;
+}
+
+/* Функция возвращает максимальный размер сообщения по схеме гидролокатора. */
+static guint32
+hyscan_sonar_client_get_max_size (HyScanSonarClientPrivate *priv)
+{
+  guint32 max_size = 0;
+  gchar **keys;
+  guint i;
+
+  if (priv->schema == NULL)
+    return 0;
+
+  keys = hyscan_data_schema_list_keys (priv->schema);
+  if (keys == NULL)
+    return 0;
+
+  for (i = 0; keys[i] != NULL; i++)
+    {
+      GVariant *value;
+      gint64 size;
+
+      if (!g_str_has_prefix (keys[i], "/sources/") ||
+          !g_str_has_suffix (keys[i], "/data/max-size"))
+        {
+          continue;
+        }
+
+      value = hyscan_data_schema_key_get_default (priv->schema, keys[i]);
+      if (value == NULL)
+        continue;
+
+      size = g_variant_get_int64 (value);
+      if ((size > 0) && (size <= G_MAXUINT32))
+        max_size = MAX (max_size, size);
+
+      g_variant_unref (value);
+    }
+
+  g_strfreev (keys);
+
+  return max_size;
+}
+
+/* Функция выделяет буферы сборки сообщений по максимальному размеру сообщения
+ * из схемы гидролокатора и заранее отображает в память все буферы клиента. */
+gboolean
+hyscan_sonar_client_warm_up (HyScanSonarClient *client,
+                             gboolean           huge_pages)
+{
+  HyScanSonarClientPool *pool;
+  HyScanSonarClientBuffer *buffer;
+  HyScanSonarRpcPacket *packet;
+  GSList *buffers = NULL;
+  GSList *packets = NULL;
+  GSList *link;
+  gsize slab_size;
+  guint32 message_size;
+  guint32 parts_size;
+  guint i;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+
+  pool = client->priv->pool;
+
+  /* Если размер сообщений в схеме не указан, буферы размещаются блоками
+   * минимального размера, а сообщения большего размера собираются
+   * в динамически выделяемых буферах. */
+  message_size = hyscan_sonar_client_get_max_size (client->priv);
+
+  g_rw_lock_writer_lock (&pool->lock);
+
+  /* Буферы сборки уже размещены. */
+  if (pool->message_arena.data != NULL)
+    {
+      g_rw_lock_writer_unlock (&pool->lock);
+      return FALSE;
+    }
+
+  /* Буферы размещаются блоками, кратными HYSCAN_SONAR_CLIENT_SLAB_ALIGN. */
+  slab_size = message_size / HYSCAN_SONAR_CLIENT_SLAB_ALIGN;
+  slab_size += (message_size % HYSCAN_SONAR_CLIENT_SLAB_ALIGN) ? 1 : 0;
+  slab_size = MAX (slab_size, 1) * HYSCAN_SONAR_CLIENT_SLAB_ALIGN;
+
+  parts_size = (slab_size / HYSCAN_SONAR_MSG_DATA_PART_SIZE + 32) / 32;
+
+  hyscan_sonar_client_arena_init (&pool->message_arena, client->priv->n_buffers * slab_size, huge_pages);
+
+  /* Свободным буферам сборки назначаются блоки общей области памяти. Буферы,
+   * занятые в данный момент, сохраняют свою память. */
+  while ((buffer = hyscan_slice_pool_pop (&pool->messages)) != NULL)
+    buffers = g_slist_prepend (buffers, buffer);
+
+  for (link = buffers, i = 0; link != NULL; link = link->next, i++)
+    {
+      buffer = link->data;
+
+      if (!buffer->in_arena)
+        g_free (buffer->buffer);
+      buffer->buffer = (gchar*)pool->message_arena.data + i * slab_size;
+      buffer->buffer_size = slab_size;
+      buffer->in_arena = TRUE;
+
+      if (parts_size > buffer->parts_size)
+        {
+          g_free (buffer->parts);
+          buffer->parts = g_new0 (guint32, parts_size);
+          buffer->parts_size = parts_size;
+        }
+
+      hyscan_slice_pool_push (&pool->messages, buffer);
+    }
+
+  g_slist_free (buffers);
+
+  /* Обращаемся ко всем страницам памяти, чтобы они были отображены до начала приёма.
+   * Пакеты, занятые в данный момент, не изменяются. */
+  memset (pool->message_arena.data, 0, pool->message_arena.size);
+
+  while ((packet = hyscan_slice_pool_pop (&pool->buffers)) != NULL)
+    packets = g_slist_prepend (packets, packet);
+
+  for (link = packets; link != NULL; link = link->next)
+    {
+      memset (link->data, 0, HYSCAN_SONAR_CLIENT_SLOT_SIZE);
+      hyscan_slice_pool_push (&pool->buffers, link->data);
+    }
+
+  g_slist_free (packets);
+
+  g_rw_lock_writer_unlock (&pool->lock);
+
+  return TRUE;
+}
+
+/* Функция увеличивает счётчик ссылок на сообщение. Ссылка на объект клиента не
+ * берётся: иначе освобождение последней ссылки на сообщение в функции приёма данных
+ * могло бы привести к удалению клиента из его же потока доставки. Вместо этого
+ * ссылка берётся на кучу буферов, которая переживает клиента. */
+HyScanSonarMessage *
+hyscan_sonar_client_message_ref (HyScanSonarMessage *message)
+{
+  HyScanSonarClientBuffer *buffer = (HyScanSonarClientBuffer *)message;
+
+  g_return_val_if_fail (message != NULL, NULL);
+  g_return_val_if_fail (g_atomic_int_get (&buffer->ref_count) > 0, NULL);
+
+  g_atomic_int_inc (&buffer->ref_count);
+  hyscan_sonar_client_pool_ref (buffer->pool);
+
+  return message;
+}
+
+/* Функция уменьшает счётчик ссылок на сообщение. После освобождения последней
+ * ссылки буфер сообщения возвращается в кучу. */
+void
+hyscan_sonar_client_message_unref (HyScanSonarMessage *message)
+{
+  HyScanSonarClientBuffer *buffer = (HyScanSonarClientBuffer *)message;
+  HyScanSonarClientPool *pool;
+
+  g_return_if_fail (message != NULL);
+  g_return_if_fail (g_atomic_int_get (&buffer->ref_count) > 0);
+
+  pool = buffer->pool;
+  if (g_atomic_int_dec_and_test (&buffer->ref_count))
+    hyscan_sonar_client_push_buffer (pool, buffer);
+  hyscan_sonar_client_pool_unref (pool);
+}
+
+/* Функция добавляет функцию приёма данных. Список функций не изменяется,
+ * а заменяется копией, поэтому доставка сообщений не блокируется. */
+guint
+hyscan_sonar_client_add_sink (HyScanSonarClient         *client,
+                              guint32                    source,
+                              guint32                    type,
+                              HyScanSonarClientSinkFunc  func,
+                              gpointer                   user_data,
+                              GDestroyNotify             destroy)
+{
+  HyScanSonarClientPrivate *priv;
+  HyScanSonarClientSink *sink;
+  GPtrArray *sinks;
+  GPtrArray *old_sinks;
+  guint id;
+  guint i;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  priv = client->priv;
+
+  sink = g_new0 (HyScanSonarClientSink, 1);
+  sink->ref_count = 1;
+  sink->source = source;
+  sink->type = type;
+  sink->func = func;
+  sink->user_data = user_data;
+  sink->destroy = destroy;
+
+  g_mutex_lock (&priv->sinks_lock);
+
+  id = sink->id = ++priv->sink_id;
+
+  old_sinks = priv->sinks;
+  sinks = g_ptr_array_new_full (old_sinks->len + 1, hyscan_sonar_client_sink_unref);
+  for (i = 0; i < old_sinks->len; i++)
+    g_ptr_array_add (sinks, hyscan_sonar_client_sink_ref (g_ptr_array_index (old_sinks, i)));
+  g_ptr_array_add (sinks, sink);
+  priv->sinks = sinks;
+
+  g_mutex_unlock (&priv->sinks_lock);
+
+  g_ptr_array_unref (old_sinks);
+
+  return id;
+}
+
+/* Функция удаляет функцию приёма данных. */
+gboolean
+hyscan_sonar_client_remove_sink (HyScanSonarClient *client,
+                                 guint              id)
+{
+  HyScanSonarClientPrivate *priv;
+  GPtrArray *sinks;
+  GPtrArray *old_sinks;
+  gboolean found = FALSE;
+  guint i;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+
+  priv = client->priv;
+
+  g_mutex_lock (&priv->sinks_lock);
+
+  old_sinks = priv->sinks;
+  sinks = g_ptr_array_new_full (old_sinks->len, hyscan_sonar_client_sink_unref);
+  for (i = 0; i < old_sinks->len; i++)
+    {
+      HyScanSonarClientSink *sink = g_ptr_array_index (old_sinks, i);
+
+      if (sink->id == id)
+        found = TRUE;
+      else
+        g_ptr_array_add (sinks, hyscan_sonar_client_sink_ref (sink));
+    }
+  priv->sinks = sinks;
+
+  g_mutex_unlock (&priv->sinks_lock);
+
+  g_ptr_array_unref (old_sinks);
+
+  return found;
+}
+
+/* Функция проверяет завершение воспроизведения записанных пакетов. */
+gboolean
+hyscan_sonar_client_replay_done (HyScanSonarClient *client)
+{
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+
+  return g_atomic_int_get (&client->priv->replay_done) != 0;
+}
+
+/* Функция начинает запись принятых пакетов в файл. */
+gboolean
+hyscan_sonar_client_start_capture (HyScanSonarClient *client,
+                                   const gchar       *path)
+{
+  HyScanSonarClientPrivate *priv;
+  GOutputStream *capture;
+  GFile *file;
+  guint32 header[2];
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+
+  priv = client->priv;
+
+  file = g_file_new_for_path (path);
+  capture = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL));
+  g_object_unref (file);
+
+  if (capture == NULL)
+    {
+      g_warning ("HyScanSonarClient: can't create capture file '%s'", path);
+      return FALSE;
+    }
+
+  header[0] = GUINT32_TO_LE (HYSCAN_SONAR_CLIENT_CAPTURE_MAGIC);
+  header[1] = GUINT32_TO_LE (HYSCAN_SONAR_CLIENT_CAPTURE_VERSION);
+  if (!g_output_stream_write_all (capture, header, sizeof (header), NULL, NULL, NULL))
+    {
+      g_warning ("HyScanSonarClient: can't write capture file '%s'", path);
+      g_object_unref (capture);
+      return FALSE;
+    }
+
+  hyscan_sonar_client_stop_capture (client);
+
+  g_mutex_lock (&priv->capture_lock);
+  if (priv->capture_buffer == NULL)
+    priv->capture_buffer = g_malloc (HYSCAN_SONAR_MSG_MAX_SIZE);
+  g_atomic_pointer_set (&priv->capture, g_buffered_output_stream_new_sized (capture, 1024 * 1024));
+  g_mutex_unlock (&priv->capture_lock);
+
+  g_object_unref (capture);
+
+  return TRUE;
+}
+
+/* Функция завершает запись принятых пакетов. */
+void
+hyscan_sonar_client_stop_capture (HyScanSonarClient *client)
+{
+  HyScanSonarClientPrivate *priv;
+  GOutputStream *capture;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+
+  priv = client->priv;
+
+  g_mutex_lock (&priv->capture_lock);
+  capture = priv->capture;
+  priv->capture = NULL;
+  g_mutex_unlock (&priv->capture_lock);
+
+  if (capture == NULL)
+    return;
+
+  g_output_stream_close (capture, NULL, NULL);
+  g_object_unref (capture);
+}
+
+/* Функция переводит подключение к гидролокатору в активный режим. */
+gboolean
+hyscan_sonar_client_set_master (HyScanSonarClient *client)
+{
+  HyScanSonarClientPrivate *priv;
+
+  guint32 rpc_status = URPC_STATUS_FAIL;
+  guint i;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+
+  priv = client->priv;
+
+  if (priv->rpc == NULL)
+    return FALSE;
+
+  for (i = 0; i < priv->n_exec; i++)
+    {
+      rpc_status = hyscan_sonar_client_rpc_set_master (priv->rpc, priv->receiver_host, priv->receiver_port);
+      if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
+        break;
+    }
+
+  if (rpc_status == URPC_STATUS_OK)
+    return TRUE;
+
+  return FALSE;
+}
+
+/* Функция возвращает схему данных гидролокатора. */
+static HyScanDataSchema *
+hyscan_sonar_client_schema (HyScanParam *sonar)
+{
+  HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (sonar);
+  HyScanSonarClientPrivate *priv = sonar_client->priv;
+
+  if (priv->rpc == NULL)
+    return NULL;
+
+  return g_object_ref (priv->schema);
+}
+
+/* Функция освобождает память, занятую попыткой выполнения запроса. */
+static void
+hyscan_sonar_client_attempt_free (gpointer data)
+{
+  HyScanSonarClientAttempt *attempt = data;
+  guint i;
+
+  for (i = 0; attempt->names[i] != NULL; i++)
+    g_clear_pointer (&attempt->values[i], g_variant_unref);
+
+  g_strfreev (attempt->names);
+  g_free (attempt->values);
+
+  g_free (attempt);
+}
+
+/* Функция выполняет одну попытку RPC запроса в пуле потоков. Результат попытки
+ * помещается в очередь результатов запроса. Если запрос уже завершён, попытка
+ * освобождается вместе с очередью. */
+static void
+hyscan_sonar_client_attempt_exec (gpointer data,
+                                  gpointer user_data)
+{
+  HyScanSonarClientAttempt *attempt = data;
+  HyScanSonarClientPrivate *priv = user_data;
+  const gchar *const *names = (const gchar *const *)attempt->names;
+  GAsyncQueue *results;
+
+  if (attempt->set)
+    attempt->status = hyscan_sonar_client_rpc_set (attempt->rpc, names, attempt->values);
+  else
+    attempt->status = hyscan_sonar_client_rpc_get (attempt->rpc, names, attempt->values);
+
+  attempt->rtt = g_get_monotonic_time () - attempt->start;
+
+  g_async_queue_push (priv->sessions, attempt->rpc);
+  attempt->rpc = NULL;
+
+  results = attempt->results;
+  attempt->results = NULL;
+
+  g_async_queue_push (results, attempt);
+  g_async_queue_unref (results);
+}
+
+/* Функция уточняет оценку времени обращения к серверу и таймаут повтора запроса
+ * по алгоритму RFC 6298. Вызывается с заблокированным rtt_lock. */
+static void
+hyscan_sonar_client_rtt_update (HyScanSonarClientPrivate *priv,
+                                gint64                    rtt)
+{
+  gdouble sample = (gdouble)rtt / G_TIME_SPAN_SECOND;
+
+  if (priv->rtt_samples == 0)
+    {
+      priv->srtt = sample;
+      priv->rttvar = sample / 2.0;
+    }
+  else
+    {
+      priv->rttvar = 0.75 * priv->rttvar + 0.25 * ABS (priv->srtt - sample);
+      priv->srtt = 0.875 * priv->srtt + 0.125 * sample;
+    }
+
+  priv->rto = priv->srtt + MAX (HYSCAN_SONAR_CLIENT_RTO_GRANULARITY, 4.0 * priv->rttvar);
+  priv->rto = CLAMP (priv->rto, HYSCAN_SONAR_CLIENT_MIN_RTO, priv->timeout);
+  priv->rtt_samples += 1;
+
+  hyscan_sonar_client_histogram_add (priv->rtt_histogram, rtt);
+}
+
+/* Функция добавляет значение времени, в микросекундах, в гистограмму. Гистограмма
+ * содержит четыре интервала на каждую степень двойки микросекунд. */
+static void
+hyscan_sonar_client_histogram_add (guint64 *histogram,
+                                   gint64   value)
+{
+  guint index = 0;
+  guint order;
+
+  if (value >= 4)
+    {
+      order = g_bit_storage (value) - 1;
+      index = 4 * order + ((value >> (order - 2)) & 3);
+    }
+
+  index = MIN (index, HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE - 1);
+  histogram[index] += 1;
+}
+
+/* Функция возвращает значение времени, в секундах, для заданного процентиля. */
+static gdouble
+hyscan_sonar_client_histogram_percentile (const guint64 *histogram,
+                                          guint64        n_samples,
+                                          gdouble        percentile)
+{
+  guint64 limit;
+  guint64 count = 0;
+  guint i;
+
+  if (n_samples == 0)
+    return 0.0;
+
+  limit = MAX (1, percentile * n_samples);
+  for (i = 0; i < HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE; i++)
+    {
+      count += histogram[i];
+      if (count >= limit)
+        break;
+    }
+
+  /* Верхняя граница интервала гистограммы. */
+  return (gdouble)((G_GUINT64_CONSTANT (5) + (i % 4)) << (i / 4)) / 4.0 / G_TIME_SPAN_SECOND;
+}
+
+/* Функция отмечает обнаружение потерь пакетов в канале связи с гидролокатором. */
+static void
+hyscan_sonar_client_loss_signal (HyScanSonarClientPrivate *priv)
+{
+  g_mutex_lock (&priv->rtt_lock);
+  priv->loss_time = g_get_monotonic_time ();
+  g_mutex_unlock (&priv->rtt_lock);
+}
+
+/* Функция выполняет RPC запрос установки или чтения значений параметров.
+ *
+ * Каждая попытка выполняется в отдельной RPC сессии. Если ответ на попытку не получен
+ * за время RTO, запрос повторяется в другой свободной сессии, при этом интервал до
+ * следующего повтора удваивается. Если после отправки запроса обнаружены потери пакетов
+ * данных, повтор выполняется раньше - через SRTT + RTTVAR. Результатом запроса является
+ * первый полученный ответ. Всего выполняется не более priv->n_exec попыток. Повтор
+ * отправляется только при наличии свободной сессии, поэтому число параллельных попыток
+ * ограничено числом сессий priv->n_sessions.
+ *
+ * Параллельные попытки выполняются только для запросов чтения. Запрос установки
+ * значений выполняется последовательно: повторная попытка отправляется только после
+ * завершения предыдущей (в том числе по тайм-ауту сессии), чтобы дубликат запроса
+ * не был выполнен сервером после следующего запроса клиента. */
+static guint32
+hyscan_sonar_client_exec_rpc (HyScanSonarClientPrivate  *priv,
+                              gboolean                   set,
+                              const gchar *const        *names,
+                              GVariant                 **values,
+                              gint64                     deadline,
+                              GCancellable              *cancellable)
+{
+  GAsyncQueue *results;
+  guint32 rpc_status = URPC_STATUS_TIMEOUT;
+
+  gint64 send_time = 0;
+  gint64 retry_time = 0;
+  gdouble rto;
+
+  guint n_names;
+  guint n_sent = 0;
+  guint n_running = 0;
+  guint i;
+
+  results = g_async_queue_new_full (hyscan_sonar_client_attempt_free);
+  n_names = g_strv_length ((gchar**)names);
+
+  g_mutex_lock (&priv->rtt_lock);
+  priv->n_requests += 1;
+  rto = priv->rto;
+  g_mutex_unlock (&priv->rtt_lock);
+
+  while (TRUE)
+    {
+      HyScanSonarClientAttempt *attempt;
+      gint64 cur_time = g_get_monotonic_time ();
+      gint64 wait_time;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      /* Время выполнения запроса истекло, незавершённые попытки не ожидаем. */
+      if ((deadline > 0) && (cur_time >= deadline))
+        {
+          rpc_status = URPC_STATUS_TIMEOUT;
+          break;
+        }
+
+      /* Время повтора запроса чтения при обнаружении потерь. */
+      if (!set && (n_running > 0))
+        {
+          g_mutex_lock (&priv->rtt_lock);
+          if ((priv->loss_time >= send_time) && (priv->rtt_samples > 0))
+            retry_time = MIN (retry_time, send_time + (priv->srtt + priv->rttvar) * G_TIME_SPAN_SECOND);
+          g_mutex_unlock (&priv->rtt_lock);
+        }
+
+      /* Отправляем очередную попытку. */
+      if ((n_sent < priv->n_exec) &&
+          ((n_running == 0) || (!set && (cur_time >= retry_time))) &&
+          ((n_sent == 0) || (deadline == 0) || (cur_time < deadline)))
+        {
+          uRpcClient *rpc;
+
+          if (n_running == 0)
+            rpc = hyscan_sonar_client_pop_session (priv, deadline, cancellable);
+          else
+            rpc = g_async_queue_try_pop (priv->sessions);
+
+          if (rpc != NULL)
+            {
+              attempt = g_new0 (HyScanSonarClientAttempt, 1);
+              attempt->set = set;
+              attempt->rpc = rpc;
+              attempt->names = g_strdupv ((gchar**)names);
+              attempt->values = g_new0 (GVariant*, n_names + 1);
+              attempt->results = g_async_queue_ref (results);
+              attempt->start = cur_time;
+
+              if (set)
+                for (i = 0; i < n_names; i++)
+                  if (values[i] != NULL)
+                    attempt->values[i] = g_variant_ref (values[i]);
+
+              g_thread_pool_push (priv->attempts, attempt, NULL);
+
+              if (n_sent > 0)
+                {
+                  g_mutex_lock (&priv->rtt_lock);
+                  priv->n_retransmits += 1;
+                  g_mutex_unlock (&priv->rtt_lock);
+                }
+
+              send_time = cur_time;
+              retry_time = cur_time + MIN (rto * (1 << n_sent), priv->timeout) * G_TIME_SPAN_SECOND;
+              n_sent += 1;
+              n_running += 1;
+            }
+          else if (n_running == 0)
+            {
+              break;
+            }
+        }
+
+      /* Все попытки завершились. */
+      if (n_running == 0)
+        break;
+
+      /* Ждём результат одной из попыток. */
+      wait_time = 10 * G_TIME_SPAN_MILLISECOND;
+      if (n_sent == priv->n_exec)
+        wait_time = 100 * G_TIME_SPAN_MILLISECOND;
+      if (deadline > 0)
+        wait_time = CLAMP (deadline - cur_time, 0, wait_time);
+
+      attempt = g_async_queue_timeout_pop (results, wait_time);
+      if (attempt == NULL)
+        continue;
 
-          /* Пакет с требуемым индексом не найден. */
-          if (GUINT32_FROM_LE(packet->index) != next_index)
-            {
-              HyScanSonarRpcPacket *packet_lt = NULL;
-              HyScanSonarRpcPacket *packet_gt = NULL;
-              guint32 index_lt = G_MAXUINT32;
-              guint32 index_gt = G_MAXUINT32;
-
-              /* Очередь заполнена менее чем на четверть, подождём - может придёт. */
-              if (queue_len < priv->n_buffers / 4)
-                break;
-
-              g_warning ("HyScanSonarClient: packet %d lost", packet->index);
-
-              /* Нужно выбирать другой пакет на обработку.
-               * Ищем пакет с минимальным индексом большим требуемого и
-               * минимальным индексом меньшим требуемого. */
-              g_mutex_lock (&priv->queue_lock);
-              for (i = 0; i < queue_len; i++)
-                {
-                  guint32 cur_index;
-
-                  packet = g_queue_peek_nth (priv->queue, i);
-                  cur_index = GUINT32_FROM_LE (packet->index);
-
-                  if (cur_index < next_index && cur_index < index_lt)
-                    {
-                      index_lt = cur_index;
-                      packet_lt = packet;
-                    }
-
-                  if (cur_index > next_index && cur_index < index_gt)
-                    {
-                      index_gt = cur_index;
-                      packet_gt = packet;
-                    }
-                }
-              g_mutex_unlock (&priv->queue_lock);
+      n_running -= 1;
+      rpc_status = attempt->status;
 
-              packet = (packet_gt != NULL) ? packet_gt : packet_lt;
-            }
+      g_mutex_lock (&priv->rtt_lock);
+      if (rpc_status == URPC_STATUS_OK)
+        hyscan_sonar_client_rtt_update (priv, attempt->rtt);
+      else if (rpc_status == URPC_STATUS_TIMEOUT)
+        priv->n_timeouts += 1;
+      g_mutex_unlock (&priv->rtt_lock);
 
-          /* Параметры данных из пакета. */
-          id = GUINT32_FROM_LE (packet->id);
-          time = GINT64_FROM_LE (packet->time);
-          type = GUINT32_FROM_LE (packet->type);
-          rate = hyscan_sonar_rpc_float_from_le (packet->rate);
-          size = GUINT32_FROM_LE (packet->size);
-          part_size = GUINT32_FROM_LE (packet->part_size);
-          offset = GUINT32_FROM_LE (packet->offset);
-
-          /* Проверяем контрольную сумму. */
-          crc1 = packet->crc32;
-          packet->crc32 = 0;
-
-          crc2 = crc32 (0L, Z_NULL, 0);
-          crc2 = crc32 (crc2, (gpointer)packet, part_size + offsetof (HyScanSonarRpcPacket, data));
-          if (crc1 != crc2)
-            g_warning ("HyScanSonarClient: packet %d crc mismatch", packet->index);
-
-          /* Буфер для данных. */
-          buffer = g_hash_table_lookup (buffers, GINT_TO_POINTER (id));
-          if (buffer == NULL)
+      /* Получен ответ сервера. */
+      if ((rpc_status == URPC_STATUS_OK) && !set)
+        {
+          for (i = 0; i < n_names; i++)
             {
-              buffer = g_new0 (HyScanSonarClientBuffer, 1);
-              buffer->id = id;
-              buffer->timer = g_timer_new ();
-              g_hash_table_insert (buffers, GINT_TO_POINTER (id), buffer);
+              values[i] = attempt->values[i];
+              attempt->values[i] = NULL;
             }
+        }
 
-          /* Корректируем размер буфера для данных. */
-          if ((buffer->size == 0) && (size > buffer->buffer_size))
-            {
-              buffer_size = size / 65536;
-              buffer_size += (size % 65536) ? 1 : 0;
-              buffer_size *= 65536;
+      hyscan_sonar_client_attempt_free (attempt);
 
-              g_free (buffer->buffer);
-              buffer->buffer = g_malloc0 (buffer_size);
-              buffer->buffer_size = buffer_size;
-            }
+      if (rpc_status != URPC_STATUS_TIMEOUT)
+        break;
+    }
 
-          /* Обрабатываем только актуальные пакеты. */
-          if ((size <= buffer->buffer_size) &&
-              (buffer->size == 0 || buffer->size == size) &&
-              (buffer->type == 0 || buffer->type == type) &&
-              (buffer->rate == 0.0 || buffer->rate == rate) &&
-              (time >= buffer->time) && (crc1 == crc2))
-            {
-              /* Изменилось время, отправляем неполный пакет. */
-              if ((buffer->cur_size > 0) && (buffer->time != time))
-                {
-                  message.time = buffer->time;
-                  message.id = buffer->id;
-                  message.type = buffer->type;
-                  message.rate = buffer->rate;
-                  message.size = buffer->size;
-                  message.data = buffer->buffer;
-
-                  g_signal_emit (sonar_client, hyscan_sonar_client_signals[SIGNAL_DATA], 0, &message);
-                  memset (buffer->buffer, 0, buffer->size);
-                  buffer->cur_size = 0;
-                  buffer->size = 0;
-                  buffer->type = 0;
-                  buffer->rate = 0.0;
-                }
+  /* Незавершённые попытки будут освобождены вместе с очередью результатов. */
+  g_async_queue_unref (results);
 
-              /* Сохраняем данные в буфере. */
-              buffer->time = time;
-              buffer->type = type;
-              buffer->rate = rate;
-              buffer->size = size;
-              buffer->cur_size += part_size;
-              memcpy (buffer->buffer + offset, packet->data, part_size);
-              g_timer_start (buffer->timer);
-
-              /* Собрали все данные. */
-              if (buffer->cur_size == size)
-                {
-                  message.time = buffer->time;
-                  message.id = buffer->id;
-                  message.type = buffer->type;
-                  message.rate = buffer->rate;
-                  message.size = buffer->size;
-                  message.data = buffer->buffer;
-
-                  g_signal_emit (sonar_client, hyscan_sonar_client_signals[SIGNAL_DATA], 0, &message);
-                  memset (buffer->buffer, 0, buffer->size);
-                  buffer->cur_size = 0;
-                  buffer->size = 0;
-                  buffer->type = 0;
-                  buffer->rate = 0.0;
-                }
+  return rpc_status;
+}
 
-              /* Следующий индекс пакета. */
-              next_index = GUINT32_FROM_LE (packet->index);
-              if (next_index == G_MAXUINT32)
-                next_index = 0;
-              else
-                next_index += 1;
-            }
-          else
-            {
-              g_warning ("HyScanSonarClient: corrupted packet");
-            }
+/* Функция возвращает значение параметра статистики приёма данных вида
+ * /stats/<идентификатор источника>/<счётчик>. */
+static GVariant *
+hyscan_sonar_client_stats_value (HyScanSonarClientPrivate *priv,
+                                 const gchar              *name)
+{
+  HyScanSonarClientStats stats;
+  const gchar *counter;
+  gchar *end;
+  guint64 id;
+
+  name += strlen (HYSCAN_SONAR_CLIENT_STATS_PREFIX);
+  id = g_ascii_strtoull (name, &end, 10);
+  if ((end == name) || (*end != '/') || (id > G_MAXUINT32))
+    return NULL;
+
+  counter = end + 1;
+
+  if (!hyscan_sonar_client_get_stats (priv->client, id, &stats))
+    return NULL;
+
+  if (g_strcmp0 (counter, "packets") == 0)
+    return g_variant_new_int64 (stats.n_packets);
+  if (g_strcmp0 (counter, "bytes") == 0)
+    return g_variant_new_int64 (stats.n_bytes);
+  if (g_strcmp0 (counter, "lost") == 0)
+    return g_variant_new_int64 (stats.n_lost);
+  if (g_strcmp0 (counter, "crc-errors") == 0)
+    return g_variant_new_int64 (stats.n_crc_errors);
+  if (g_strcmp0 (counter, "malformed") == 0)
+    return g_variant_new_int64 (stats.n_malformed);
+  if (g_strcmp0 (counter, "duplicates") == 0)
+    return g_variant_new_int64 (stats.n_duplicates);
+  if (g_strcmp0 (counter, "overruns") == 0)
+    return g_variant_new_int64 (stats.n_overruns);
+  if (g_strcmp0 (counter, "incomplete") == 0)
+    return g_variant_new_int64 (stats.n_incomplete);
+  if (g_strcmp0 (counter, "reorder") == 0)
+    return g_variant_new_int64 (stats.max_reorder);
+  if (g_strcmp0 (counter, "latency-median") == 0)
+    return g_variant_new_double (stats.latency_median);
+  if (g_strcmp0 (counter, "latency-p99") == 0)
+    return g_variant_new_double (stats.latency_p99);
+
+  return NULL;
+}
+
+/* Функция устанавливает значение параметра гидролокатора, используя одну из
+ * свободных RPC сессий. Если deadline больше нуля, повторные попытки выполнения
+ * запроса производятся только до этого момента времени. */
+static guint32
+hyscan_sonar_client_exec_set (HyScanSonarClientPrivate  *priv,
+                              const gchar *const        *names,
+                              GVariant                 **values,
+                              gint64                     deadline,
+                              GCancellable              *cancellable)
+{
+  guint32 rpc_status;
+  guint i;
+
+  rpc_status = hyscan_sonar_client_exec_rpc (priv, TRUE, names, values, deadline, cancellable);
+
+  if (rpc_status == URPC_STATUS_OK)
+    {
+      for (i = 0; names[i] != NULL; i++)
+        g_clear_pointer (&values[i], g_variant_unref);
+    }
+
+  return rpc_status;
+}
+
+/* Функция считывает значение параметра гидролокатора, используя одну из
+ * свободных RPC сессий. Значения, имеющиеся в кэше, возвращаются без
+ * обращения к серверу. */
+static guint32
+hyscan_sonar_client_exec_get (HyScanSonarClientPrivate  *priv,
+                              const gchar *const        *names,
+                              GVariant                 **values,
+                              gint64                     deadline,
+                              GCancellable              *cancellable)
+{
+  const gchar **miss_names;
+  GVariant **miss_values;
+  guint *miss_index;
+  guint n_names;
+  guint n_miss;
+
+  guint32 rpc_status = URPC_STATUS_TIMEOUT;
+  gboolean stats_error = FALSE;
+  guint i;
+
+  n_names = g_strv_length ((gchar**)names);
+  miss_names = g_new0 (const gchar*, n_names + 1);
+  miss_values = g_new0 (GVariant*, n_names + 1);
+  miss_index = g_new0 (guint, n_names + 1);
+
+  g_mutex_lock (&priv->cache_lock);
+  for (i = 0, n_miss = 0; i < n_names; i++)
+    {
+      GVariant *value;
 
-          /* Убираем пакет из очереди. */
-          g_mutex_lock (&priv->queue_lock);
-          g_queue_remove (priv->queue, packet);
-          g_mutex_unlock (&priv->queue_lock);
+      /* Статистика приёма данных формируется клиентом. */
+      if (g_str_has_prefix (names[i], HYSCAN_SONAR_CLIENT_STATS_PREFIX))
+        {
+          values[i] = hyscan_sonar_client_stats_value (priv, names[i]);
+          if (values[i] == NULL)
+            stats_error = TRUE;
 
-          /* Освобождаем буфер. */
-          g_rw_lock_writer_lock (&priv->b_lock);
-          hyscan_slice_pool_push (&priv->buffers, packet);
-          g_rw_lock_writer_unlock (&priv->b_lock);
+          continue;
+        }
 
-          queue_len -= 1;
+      value = g_hash_table_lookup (priv->cache, names[i]);
+      if (value != NULL)
+        {
+          values[i] = g_variant_ref (value);
+          priv->cache_hits += 1;
+          continue;
         }
+
+      miss_names[n_miss] = names[i];
+      miss_index[n_miss] = i;
+      n_miss += 1;
     }
+  priv->cache_misses += n_miss;
+  g_mutex_unlock (&priv->cache_lock);
+
+  /* Запрошен неизвестный параметр статистики. */
+  if (stats_error)
+    {
+      for (i = 0; i < n_names; i++)
+        g_clear_pointer (&values[i], g_variant_unref);
 
-  g_hash_table_unref (buffers);
+      rpc_status = URPC_STATUS_FAIL;
+      goto exit;
+    }
 
-  return NULL;
+  /* Все значения есть в кэше. */
+  if (n_miss == 0)
+    {
+      rpc_status = URPC_STATUS_OK;
+      goto exit;
+    }
+
+  rpc_status = hyscan_sonar_client_exec_rpc (priv, FALSE, miss_names, miss_values, deadline, cancellable);
+
+  if (rpc_status != URPC_STATUS_OK)
+    {
+      for (i = 0; i < n_names; i++)
+        g_clear_pointer (&values[i], g_variant_unref);
+
+      goto exit;
+    }
+
+  /* Сохраняем считанные значения в кэше. */
+  g_mutex_lock (&priv->cache_lock);
+  for (i = 0; i < n_miss; i++)
+    {
+      if (miss_values[i] == NULL)
+        continue;
+
+      values[miss_index[i]] = g_variant_ref_sink (miss_values[i]);
+      hyscan_sonar_client_cache_store (priv, miss_names[i], miss_values[i]);
+    }
+  g_mutex_unlock (&priv->cache_lock);
+
+exit:
+  g_free (miss_names);
+  g_free (miss_values);
+  g_free (miss_index);
+
+  return rpc_status;
 }
 
-/* Функция создаёт новый объект HyScanSonarClient. */
-HyScanSonarClient *
-hyscan_sonar_client_new (const gchar *host)
+/* Функция завершает асинхронный запрос с ошибкой, соответствующей статусу RPC. */
+static void
+hyscan_sonar_client_return_error (GTask   *task,
+                                  guint32  rpc_status)
 {
-  return hyscan_sonar_client_new_full (host,
-                                       HYSCAN_SONAR_CLIENT_DEFAULT_TIMEOUT,
-                                       HYSCAN_SONAR_CLIENT_DEFAULT_EXEC,
-                                       HYSCAN_SONAR_CLIENT_DEFAULT_N_BUFFERS);
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (rpc_status == URPC_STATUS_TIMEOUT)
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "sonar request timeout");
+  else
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "sonar request failed");
 }
 
-/* Функция создаёт новый объект HyScanSonarClient. */
-HyScanSonarClient *
-hyscan_sonar_client_new_full (const gchar *host,
-                              gdouble      timeout,
-                              guint        n_exec,
-                              guint        n_buffers)
+/* Поток выполнения асинхронного запроса установки значений параметров. */
+static void
+hyscan_sonar_client_set_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
 {
-  if (timeout < HYSCAN_SONAR_CLIENT_MIN_TIMEOUT)
-    timeout = HYSCAN_SONAR_CLIENT_MIN_TIMEOUT;
+  HyScanSonarClient *client = source_object;
+  HyScanSonarClientRequest *request = task_data;
+  guint32 rpc_status;
 
-  if (timeout > HYSCAN_SONAR_CLIENT_MAX_TIMEOUT)
-    timeout = HYSCAN_SONAR_CLIENT_MAX_TIMEOUT;
+  rpc_status = hyscan_sonar_client_exec_set (client->priv,
+                                             (const gchar *const *)request->names, request->values,
+                                             request->deadline, cancellable);
 
-  return g_object_new (HYSCAN_TYPE_SONAR_CLIENT,
-                       "host", host,
-                       "timeout", timeout,
-                       "n-exec", n_exec,
-                       "n-buffers", n_buffers,
-                       NULL);
+  if (rpc_status == URPC_STATUS_OK)
+    g_task_return_boolean (task, TRUE);
+  else
+    hyscan_sonar_client_return_error (task, rpc_status);
 }
 
-/* Функция переводит подключение к гидролокатору в активный режим. */
-gboolean
-hyscan_sonar_client_set_master (HyScanSonarClient *client)
+/* Поток выполнения асинхронного запроса чтения значений параметров. */
+static void
+hyscan_sonar_client_get_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
 {
-  HyScanSonarClientPrivate *priv;
+  HyScanSonarClient *client = source_object;
+  HyScanSonarClientRequest *request = task_data;
+  guint32 rpc_status;
 
-  guint32 rpc_status = URPC_STATUS_FAIL;
-  guint i;
+  rpc_status = hyscan_sonar_client_exec_get (client->priv,
+                                             (const gchar *const *)request->names, request->values,
+                                             request->deadline, cancellable);
 
-  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+  if (rpc_status == URPC_STATUS_OK)
+    g_task_return_boolean (task, TRUE);
+  else
+    hyscan_sonar_client_return_error (task, rpc_status);
+}
 
-  priv = client->priv;
+/* Функция создаёт асинхронный запрос. */
+static GTask *
+hyscan_sonar_client_new_request (HyScanSonarClient   *client,
+                                 const gchar *const  *names,
+                                 gdouble              timeout,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  HyScanSonarClientRequest *request;
+  GTask *task;
 
-  if (priv->rpc == NULL)
-    return FALSE;
+  request = g_new0 (HyScanSonarClientRequest, 1);
+  request->names = g_strdupv ((gchar**)names);
+  request->values = g_new0 (GVariant*, g_strv_length (request->names) + 1);
+  if (timeout > 0.0)
+    request->deadline = g_get_monotonic_time () + timeout * G_TIME_SPAN_SECOND;
 
-  for (i = 0; i < priv->n_exec; i++)
+  task = g_task_new (client, cancellable, callback, user_data);
+  g_task_set_task_data (task, request, hyscan_sonar_client_free_request);
+
+  return task;
+}
+
+/* Функция асинхронно устанавливает значения параметров гидролокатора. */
+void
+hyscan_sonar_client_set_async (HyScanSonarClient   *client,
+                               const gchar *const  *names,
+                               GVariant           **values,
+                               gdouble              timeout,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  HyScanSonarClientRequest *request;
+  GTask *task;
+  guint i;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+  g_return_if_fail (names != NULL && values != NULL);
+
+  task = hyscan_sonar_client_new_request (client, names, timeout, cancellable, callback, user_data);
+  request = g_task_get_task_data (task);
+
+  for (i = 0; names[i] != NULL; i++)
     {
-      rpc_status = hyscan_sonar_client_rpc_set_master (priv->rpc, priv->receiver_host, priv->receiver_port);
-      if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
-        break;
+      if (values[i] != NULL)
+        request->values[i] = g_variant_take_ref (values[i]);
+      values[i] = NULL;
     }
 
-  if (rpc_status == URPC_STATUS_OK)
-    return TRUE;
+  if (client->priv->rpc == NULL)
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED, "sonar not connected");
+  else
+    g_task_run_in_thread (task, hyscan_sonar_client_set_thread);
 
-  return FALSE;
+  g_object_unref (task);
 }
 
-/* Функция возвращает схему данных гидролокатора. */
-static HyScanDataSchema *
-hyscan_sonar_client_schema (HyScanParam *sonar)
+/* Функция завершает асинхронную установку значений параметров гидролокатора. */
+gboolean
+hyscan_sonar_client_set_finish (HyScanSonarClient  *client,
+                                GAsyncResult       *result,
+                                GError            **error)
 {
-  HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (sonar);
-  HyScanSonarClientPrivate *priv = sonar_client->priv;
+  g_return_val_if_fail (g_task_is_valid (result, client), FALSE);
 
-  if (priv->rpc == NULL)
-    return NULL;
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-  return g_object_ref (priv->schema);
+/* Функция асинхронно считывает значения параметров гидролокатора. */
+void
+hyscan_sonar_client_get_async (HyScanSonarClient   *client,
+                               const gchar *const  *names,
+                               gdouble              timeout,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+  g_return_if_fail (names != NULL);
+
+  task = hyscan_sonar_client_new_request (client, names, timeout, cancellable, callback, user_data);
+
+  if (client->priv->rpc == NULL)
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED, "sonar not connected");
+  else
+    g_task_run_in_thread (task, hyscan_sonar_client_get_thread);
+
+  g_object_unref (task);
+}
+
+/* Функция завершает асинхронное чтение значений параметров гидролокатора. */
+gboolean
+hyscan_sonar_client_get_finish (HyScanSonarClient  *client,
+                                GAsyncResult       *result,
+                                GVariant          **values,
+                                GError            **error)
+{
+  HyScanSonarClientRequest *request;
+  guint i;
+
+  g_return_val_if_fail (g_task_is_valid (result, client), FALSE);
+
+  if (!g_task_propagate_boolean (G_TASK (result), error))
+    return FALSE;
+
+  request = g_task_get_task_data (G_TASK (result));
+  for (i = 0; request->names[i] != NULL; i++)
+    {
+      values[i] = request->values[i];
+      request->values[i] = NULL;
+    }
+
+  return TRUE;
 }
 
 /* Функция устанавливает значение параметра гидролокатора. */
@@ -1246,28 +4180,10 @@ hyscan_sonar_client_set (HyScanParam         *sonar,
   HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (sonar);
   HyScanSonarClientPrivate *priv = sonar_client->priv;
 
-  guint32 rpc_status = URPC_STATUS_FAIL;
-  guint i;
-
   if (priv->rpc == NULL)
     return FALSE;
 
-  for (i = 0; i < priv->n_exec; i++)
-    {
-      rpc_status = hyscan_sonar_client_rpc_set (priv, names, values);
-      if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
-        break;
-    }
-
-  if (rpc_status == URPC_STATUS_OK)
-    {
-      for (i = 0; names[i] != NULL; i++)
-        g_clear_pointer (&values[i], g_variant_unref);
-
-      return TRUE;
-    }
-
-  return FALSE;
+  return (hyscan_sonar_client_exec_set (priv, names, values, 0, NULL) == URPC_STATUS_OK);
 }
 
 /* Функция считывает значение параметра гидролокатора. */
@@ -1279,23 +4195,176 @@ hyscan_sonar_client_get (HyScanParam         *sonar,
   HyScanSonarClient *sonar_client = HYSCAN_SONAR_CLIENT (sonar);
   HyScanSonarClientPrivate *priv = sonar_client->priv;
 
-  guint32 rpc_status = URPC_STATUS_FAIL;
+  if (priv->rpc == NULL)
+    return FALSE;
+
+  return (hyscan_sonar_client_exec_get (priv, names, values, 0, NULL) == URPC_STATUS_OK);
+}
+
+/* Функция возвращает статистику использования кэша параметров. */
+void
+hyscan_sonar_client_get_cache_stats (HyScanSonarClient *client,
+                                     guint64           *hits,
+                                     guint64           *misses)
+{
+  HyScanSonarClientPrivate *priv;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+
+  priv = client->priv;
+
+  g_mutex_lock (&priv->cache_lock);
+
+  if (hits != NULL)
+    *hits = priv->cache_hits;
+  if (misses != NULL)
+    *misses = priv->cache_misses;
+
+  g_mutex_unlock (&priv->cache_lock);
+}
+
+/* Функция возвращает статистику приёма данных источника. Для всех источников
+ * счётчики суммируются, гистограммы задержки объединяются, а число потерь
+ * определяется по пропускам в последовательности номеров пакетов. */
+gboolean
+hyscan_sonar_client_get_stats (HyScanSonarClient      *client,
+                               guint32                 source_id,
+                               HyScanSonarClientStats *stats)
+{
+  HyScanSonarClientPrivate *priv;
+  HyScanSonarClientSource *source;
+  HyScanSonarClientStats source_stats;
+  guint64 latency[HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE];
+  guint64 total_latency[HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE];
+  guint64 n_latency;
+  guint64 n_total_latency = 0;
+  gboolean found = FALSE;
+  gint seq;
   guint i;
 
-  if (priv->rpc == NULL)
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CLIENT (client), FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  priv = client->priv;
+
+  if (source_id != HYSCAN_SONAR_CLIENT_ANY_SOURCE)
+    {
+      source = g_atomic_pointer_get (&priv->sources);
+      while ((source != NULL) && (source->id != source_id))
+        source = source->next;
+
+      if (source == NULL)
+        return FALSE;
+
+      hyscan_sonar_client_source_read (source, stats, latency, &n_latency);
+
+      return TRUE;
+    }
+
+  memset (stats, 0, sizeof (HyScanSonarClientStats));
+  memset (total_latency, 0, sizeof (total_latency));
+
+  for (source = g_atomic_pointer_get (&priv->sources); source != NULL; source = source->next)
+    {
+      hyscan_sonar_client_source_read (source, &source_stats, latency, &n_latency);
+
+      stats->n_packets += source_stats.n_packets;
+      stats->n_bytes += source_stats.n_bytes;
+      stats->n_crc_errors += source_stats.n_crc_errors;
+      stats->n_malformed += source_stats.n_malformed;
+      stats->n_duplicates += source_stats.n_duplicates;
+      stats->n_overruns += source_stats.n_overruns;
+      stats->n_incomplete += source_stats.n_incomplete;
+      stats->max_reorder = MAX (stats->max_reorder, source_stats.max_reorder);
+
+      for (i = 0; i < HYSCAN_SONAR_CLIENT_HISTOGRAM_SIZE; i++)
+        total_latency[i] += latency[i];
+      n_total_latency += n_latency;
+
+      found = TRUE;
+    }
+
+  if (!found)
     return FALSE;
 
-  for (i = 0; i < priv->n_exec; i++)
+  do
     {
-      rpc_status = hyscan_sonar_client_rpc_get (priv, names, values);
-      if (rpc_status == URPC_STATUS_OK || rpc_status != URPC_STATUS_TIMEOUT)
-        break;
+      while ((seq = g_atomic_int_get (&priv->missing_seq)) & 1)
+        g_thread_yield ();
+
+      stats->n_lost = priv->n_missing;
     }
+  while (seq != g_atomic_int_get (&priv->missing_seq));
 
-  if (rpc_status == URPC_STATUS_OK)
-    return TRUE;
+  stats->latency_median = hyscan_sonar_client_histogram_percentile (total_latency, n_total_latency, 0.5);
+  stats->latency_p99 = hyscan_sonar_client_histogram_percentile (total_latency, n_total_latency, 0.99);
 
-  return FALSE;
+  return TRUE;
+}
+
+/* Функция задаёт правило сборки сообщений источника данных. */
+void
+hyscan_sonar_client_set_flush_policy (HyScanSonarClient *client,
+                                      guint32            source,
+                                      gdouble            timeout,
+                                      gboolean           deliver)
+{
+  HyScanSonarClientPrivate *priv;
+  HyScanSonarClientFlushPolicy *policy;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+
+  priv = client->priv;
+
+  timeout = CLAMP (timeout, HYSCAN_SONAR_CLIENT_MIN_FLUSH_TIMEOUT, HYSCAN_SONAR_CLIENT_MAX_FLUSH_TIMEOUT);
+
+  policy = g_new (HyScanSonarClientFlushPolicy, 1);
+  policy->timeout = timeout * G_TIME_SPAN_SECOND;
+  policy->deliver = deliver;
+
+  g_mutex_lock (&priv->policy_lock);
+  g_hash_table_replace (priv->policies, GINT_TO_POINTER (source), policy);
+  g_mutex_unlock (&priv->policy_lock);
+}
+
+/* Функция возвращает статистику выполнения RPC запросов. */
+void
+hyscan_sonar_client_get_rpc_stats (HyScanSonarClient         *client,
+                                   HyScanSonarClientRpcStats *stats)
+{
+  HyScanSonarClientPrivate *priv;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_CLIENT (client));
+  g_return_if_fail (stats != NULL);
+
+  priv = client->priv;
+
+  g_mutex_lock (&priv->rtt_lock);
+
+  stats->srtt = priv->srtt;
+  stats->rttvar = priv->rttvar;
+  stats->rto = priv->rto;
+  stats->median = hyscan_sonar_client_histogram_percentile (priv->rtt_histogram, priv->rtt_samples, 0.5);
+  stats->p99 = hyscan_sonar_client_histogram_percentile (priv->rtt_histogram, priv->rtt_samples, 0.99);
+  stats->n_requests = priv->n_requests;
+  stats->n_samples = priv->rtt_samples;
+  stats->n_retransmits = priv->n_retransmits;
+  stats->n_timeouts = priv->n_timeouts;
+
+  g_mutex_unlock (&priv->rtt_lock);
+}
+
+static void
+hyscan_sonar_client_initable_iface_init (GInitableIface *iface)
+{
+  iface->init = hyscan_sonar_client_initable_init;
+}
+
+static void
+hyscan_sonar_client_async_initable_iface_init (GAsyncInitableIface *iface)
+{
+  iface->init_async = hyscan_sonar_client_init_async;
+  iface->init_finish = hyscan_sonar_client_init_finish;
 }
 
 static void
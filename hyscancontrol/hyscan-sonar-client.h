@@ -27,6 +27,61 @@
  * Эти параметры можно изменить при подключении к гидролокатору функцией
  * #hyscan_sonar_client_new_full.
  *
+ * Сборка принятых сообщений производится в потоке приёма данных, а отправка сигналов
+ * "data" - в отдельных потоках доставки. Сообщения одного источника данных всегда
+ * доставляются одним потоком в порядке их приёма, при этом сообщения разных источников
+ * могут доставляться параллельно. Число потоков доставки задаётся свойством "n-workers"
+ * при создании объекта, по умолчанию используется #HYSCAN_SONAR_CLIENT_DEFAULT_N_WORKERS
+ * поток. При использовании нескольких потоков обработчики сигнала "data" должны быть
+ * потокобезопасными. Проверка контрольных сумм пакетов и сборка сообщений всех источников
+ * всегда выполняются одним потоком приёма, поэтому увеличение числа потоков доставки
+ * ускоряет только обработку сообщений в обработчиках сигнала, но не приём пакетов.
+ *
+ * Несколько клиентов могут использовать общие потоки приёма и доставки данных
+ * \link HyScanSonarReceiver \endlink, который задаётся свойством "receiver" при создании
+ * объекта. В этом случае клиент не запускает собственных потоков, а свойство "n-workers"
+ * не используется. Воспроизводящий клиент всегда использует собственные потоки.
+ *
+ * Класс реализует интерфейсы GInitable и GAsyncInitable. Функции #hyscan_sonar_client_new
+ * и #hyscan_sonar_client_new_full выполняют подключение синхронно, функция
+ * #hyscan_sonar_client_new_async - в отдельном потоке, не блокируя вызывающий поток.
+ * Объект, созданный функцией g_object_new, необходимо инициализировать функцией
+ * g_initable_init или g_async_initable_init_async.
+ *
+ * Сообщения, размер которых превышает размер одного UDP пакета, передаются фрагментами.
+ * Если недостающие фрагменты сообщения не поступают в течение заданного времени, сборка
+ * сообщения завершается: по умолчанию через #HYSCAN_SONAR_CLIENT_DEFAULT_FLUSH_TIMEOUT
+ * секунд неполное сообщение доставляется с обнулёнными недостающими фрагментами. Время
+ * ожидания и необходимость доставки неполных сообщений можно задать для каждого источника
+ * данных функцией #hyscan_sonar_client_set_flush_policy.
+ *
+ * Кроме сигнала "data", сообщения можно получать функциями приёма данных, добавляемыми
+ * функцией #hyscan_sonar_client_add_sink. Функции вызываются напрямую, без механизма
+ * сигналов, для сообщений заданного источника и типа данных и получают все накопившиеся
+ * в очереди доставки сообщения одним вызовом. Функции приёма данных вызываются раньше
+ * обработчиков сигнала "data", а сигнал отправляется, только если к нему подключены
+ * обработчики. При использовании общего приёмника сообщения передаются по одному.
+ *
+ * Сообщение, переданное в сигнале "data", размещается в буфере сборки сообщений и
+ * действительно до возврата из обработчика сигнала. Для обработки сообщения после
+ * возврата, например в другом потоке, на него можно получить ссылку функцией
+ * #hyscan_sonar_client_message_ref и освободить её функцией
+ * #hyscan_sonar_client_message_unref. Буфер используется повторно только после
+ * освобождения всех ссылок. Сообщения, на которые удерживаются ссылки, занимают
+ * буферы клиента, поэтому при нехватке буферов пакеты будут отбрасываться. Ссылка
+ * на сообщение не удерживает объект клиента, сообщение остаётся действительным и
+ * после его удаления.
+ *
+ * Клиент собирает статистику приёма данных по каждому источнику: число принятых пакетов
+ * и байт, потерянных фрагментов, ошибок, повторов, глубину переупорядочивания пакетов
+ * и задержку доставки сообщений. Статистику можно получить функцией
+ * #hyscan_sonar_client_get_stats или считать как параметры только для чтения вида
+ * "/stats/<идентификатор источника>/<счётчик>", где счётчик: packets, bytes, lost,
+ * crc-errors, malformed, duplicates, overruns, incomplete, reorder, latency-median и
+ * latency-p99. Эти параметры формируются клиентом и не входят в схему данных гидролокатора.
+ * Ошибки приёма не выводятся для каждого пакета, вместо этого раз в 10 секунд выводится
+ * их сводка.
+ *
  * Подключение к гидролокатору производится в пассивном режиме. В этом случае нет возможности
  * принимать данные от гидролокатора. Этот режим удобен для инспекции внутренего состояния
  * гидролокатора, без прерывания рабочей сессии.
@@ -35,12 +90,47 @@
  * #hyscan_sonar_client_set_master. Перевести подключение в активный режим можно только
  * если нет других активных подключений к гидролокатору.
  *
+ * Значения параметров гидролокатора, доступных только для чтения, кэшируются клиентом
+ * и считываются с сервера один раз. Значения изменяемых параметров всегда считываются
+ * с сервера, так как они могут быть изменены другим клиентом. Статистику использования
+ * кэша можно получить функцией #hyscan_sonar_client_get_cache_stats.
+ *
+ * Клиент поддерживает несколько RPC сессий с гидролокатором, их число задаётся свойством
+ * "n-sessions" при создании объекта. Запросы, выполняемые из разных потоков, используют
+ * свободные сессии и выполняются одновременно. Для выполнения запросов без блокировки
+ * вызывающего потока предназначены функции #hyscan_sonar_client_set_async и
+ * #hyscan_sonar_client_get_async. Для каждого асинхронного запроса можно задать собственное
+ * время ожидания, ограничивающее выполнение запроса с учётом повторных попыток. Запросы
+ * могут завершаться в порядке, отличном от порядка их отправки.
+ *
+ * Клиент оценивает время обращения к серверу (RTT) по полученным ответам. Если ответ
+ * на запрос не получен за время, определённое по этой оценке (RTO), запрос повторяется
+ * в другой свободной RPC сессии, при этом интервал до следующего повтора удваивается.
+ * Если во время ожидания ответа обнаружены потери пакетов данных, повтор выполняется
+ * раньше. Результатом запроса является первый полученный ответ. Время ожидания ответа,
+ * заданное свойством "timeout", ограничивает RTO сверху. Статистику выполнения запросов
+ * можно получить функцией #hyscan_sonar_client_get_rpc_stats.
+ *
+ * RTO и повторы в параллельных сессиях используются только для запросов чтения. Запросы
+ * установки значений параметров не дублируются: повтор такого запроса отправляется только
+ * после завершения предыдущей попытки по времени ожидания ответа "timeout", так как
+ * дубликат мог бы быть выполнен сервером после следующего запроса клиента.
+ *
+ * Одновременно выполняемые попытки используют свободные RPC сессии, поэтому число сессий
+ * ограничивает и число параллельных повторов. При числе сессий по умолчанию (2) у одного
+ * запроса может быть не более одного параллельного повтора, а при выполнении двух запросов
+ * одновременно повторы не отправляются до завершения одной из попыток. Для повторов при
+ * одновременных запросах из нескольких потоков число сессий следует увеличить.
+ *
  */
 
 #ifndef __HYSCAN_SONAR_CLIENT_H__
 #define __HYSCAN_SONAR_CLIENT_H__
 
 #include <hyscan-param.h>
+#include <hyscan-sonar-messages.h>
+#include <hyscan-sonar-receiver.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -65,6 +155,29 @@ G_BEGIN_DECLS
 #define HYSCAN_SONAR_CLIENT_DEFAULT_N_BUFFERS  256     /**< Число буферов для кэширования данных по
                                                         *   умолчанию - 256. */
 
+#define HYSCAN_SONAR_CLIENT_MIN_N_WORKERS      1       /**< Минимальное число потоков доставки
+                                                        *   сообщений - 1. */
+#define HYSCAN_SONAR_CLIENT_MAX_N_WORKERS      16      /**< Максимальное число потоков доставки
+                                                        *   сообщений - 16. */
+#define HYSCAN_SONAR_CLIENT_DEFAULT_N_WORKERS  1       /**< Число потоков доставки сообщений по
+                                                        *   умолчанию - 1. */
+
+#define HYSCAN_SONAR_CLIENT_MIN_N_SESSIONS     1       /**< Минимальное число RPC сессий - 1. */
+#define HYSCAN_SONAR_CLIENT_MAX_N_SESSIONS     8       /**< Максимальное число RPC сессий - 8. */
+#define HYSCAN_SONAR_CLIENT_DEFAULT_N_SESSIONS 2       /**< Число RPC сессий по умолчанию - 2. */
+
+#define HYSCAN_SONAR_CLIENT_MIN_FLUSH_TIMEOUT  0.01    /**< Минимальное время ожидания недостающих
+                                                        *   фрагментов сообщения - 10 миллисекунд. */
+#define HYSCAN_SONAR_CLIENT_MAX_FLUSH_TIMEOUT  10.0    /**< Максимальное время ожидания недостающих
+                                                        *   фрагментов сообщения - 10 секунд. */
+#define HYSCAN_SONAR_CLIENT_DEFAULT_FLUSH_TIMEOUT 1.0  /**< Время ожидания недостающих фрагментов
+                                                        *   сообщения по умолчанию - 1 секунда. */
+
+#define HYSCAN_SONAR_CLIENT_ANY_SOURCE         G_MAXUINT32 /**< Функция приёма данных получает сообщения
+                                                            *   всех источников данных. */
+#define HYSCAN_SONAR_CLIENT_ANY_TYPE           G_MAXUINT32 /**< Функция приёма данных получает сообщения
+                                                            *   всех типов данных. */
+
 #define HYSCAN_TYPE_SONAR_CLIENT             (hyscan_sonar_client_get_type ())
 #define HYSCAN_SONAR_CLIENT(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), HYSCAN_TYPE_SONAR_CLIENT, HyScanSonarClient))
 #define HYSCAN_IS_SONAR_CLIENT(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), HYSCAN_TYPE_SONAR_CLIENT))
@@ -75,6 +188,80 @@ G_BEGIN_DECLS
 typedef struct _HyScanSonarClient HyScanSonarClient;
 typedef struct _HyScanSonarClientPrivate HyScanSonarClientPrivate;
 typedef struct _HyScanSonarClientClass HyScanSonarClientClass;
+typedef struct _HyScanSonarClientRpcStats HyScanSonarClientRpcStats;
+typedef struct _HyScanSonarClientStats HyScanSonarClientStats;
+
+/** \brief Этапы подключения к гидролокатору. */
+typedef enum
+{
+  HYSCAN_SONAR_CLIENT_STAGE_CONNECTED,         /**< Установлено RPC соединение. */
+  HYSCAN_SONAR_CLIENT_STAGE_VERSION,           /**< Проверена версия сервера. */
+  HYSCAN_SONAR_CLIENT_STAGE_SCHEMA,            /**< Загружена схема данных гидролокатора. */
+  HYSCAN_SONAR_CLIENT_STAGE_SESSIONS,          /**< Подключены дополнительные RPC сессии. */
+  HYSCAN_SONAR_CLIENT_STAGE_READY              /**< Запущены потоки приёма данных, клиент готов к работе. */
+} HyScanSonarClientStage;
+
+/**
+ *
+ * Функция уведомления о ходе асинхронного подключения к гидролокатору.
+ *
+ * \param stage выполненный этап подключения;
+ * \param user_data пользовательские данные.
+ *
+ */
+typedef void (*HyScanSonarClientProgressFunc)  (HyScanSonarClientStage stage,
+                                                gpointer               user_data);
+
+/**
+ *
+ * Функция приёма данных. Функция вызывается в потоке доставки сообщений и получает
+ * все подходящие сообщения, накопившиеся в очереди потока, одним вызовом. Сообщения
+ * передаются в порядке их приёма и действительны до возврата из функции, если на них
+ * не были получены ссылки функцией #hyscan_sonar_client_message_ref.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param messages массив сообщений;
+ * \param n_messages число сообщений в массиве;
+ * \param user_data пользовательские данные.
+ *
+ */
+typedef void (*HyScanSonarClientSinkFunc)      (HyScanSonarClient             *client,
+                                                HyScanSonarMessage     *const *messages,
+                                                guint                          n_messages,
+                                                gpointer                       user_data);
+
+/** \brief Статистика выполнения RPC запросов. */
+struct _HyScanSonarClientRpcStats
+{
+  gdouble              srtt;                   /**< Сглаженное время обращения к серверу, с. */
+  gdouble              rttvar;                 /**< Отклонение времени обращения к серверу, с. */
+  gdouble              rto;                    /**< Текущий таймаут повтора запроса, с. */
+  gdouble              median;                 /**< Медиана времени обращения к серверу, с. */
+  gdouble              p99;                    /**< 99-й процентиль времени обращения к серверу, с. */
+
+  guint64              n_requests;             /**< Число выполненных запросов. */
+  guint64              n_samples;              /**< Число измерений времени обращения. */
+  guint64              n_retransmits;          /**< Число повторов запросов. */
+  guint64              n_timeouts;             /**< Число попыток, завершившихся без ответа. */
+};
+
+/** \brief Статистика приёма данных источника. */
+struct _HyScanSonarClientStats
+{
+  guint64              n_packets;              /**< Число принятых пакетов. */
+  guint64              n_bytes;                /**< Объём принятых данных, байт. */
+  guint64              n_lost;                 /**< Число потерянных фрагментов сообщений, для всех
+                                                *   источников - число пропусков в номерах пакетов. */
+  guint64              n_crc_errors;           /**< Число пакетов с ошибкой контрольной суммы. */
+  guint64              n_malformed;            /**< Число пакетов с ошибкой формата. */
+  guint64              n_duplicates;           /**< Число повторно принятых фрагментов. */
+  guint64              n_overruns;             /**< Число пакетов, отброшенных из-за нехватки буферов. */
+  guint64              n_incomplete;           /**< Число доставленных неполных сообщений. */
+  guint32              max_reorder;            /**< Максимальная глубина переупорядочивания пакетов. */
+
+  gdouble              latency_median;         /**< Медиана задержки доставки сообщений, с. */
+  gdouble              latency_p99;            /**< 99-й процентиль задержки доставки сообщений, с. */
+};
 
 struct _HyScanSonarClient
 {
@@ -124,6 +311,216 @@ HyScanSonarClient     *hyscan_sonar_client_new_full    (const gchar           *h
                                                         guint                  n_exec,
                                                         guint                  n_buffers);
 
+/**
+ *
+ * Функция асинхронно создаёт новый объект \link HyScanSonarClient \endlink и производит
+ * подключение к удалённому гидролокатору. Подключение выполняется в отдельном потоке,
+ * что позволяет параллельно подключаться к нескольким гидролокаторам. После завершения
+ * каждого этапа подключения вызывается функция progress_func, а по окончании подключения -
+ * функция callback. Обе функции вызываются в контексте, который был контекстом потока
+ * по умолчанию (g_main_context_get_thread_default) в момент вызова этой функции.
+ * Для получения объекта необходимо вызвать функцию #hyscan_sonar_client_new_finish.
+ *
+ * \param host IP адрес или DNS имя гидролокатора;
+ * \param timeout таймаут ожидания выполнения RPC запроса, секунды;
+ * \param n_exec число попыток выполнения RPC запроса;
+ * \param n_buffers число буферов для кэширования данных;
+ * \param progress_func функция уведомления о ходе подключения или NULL;
+ * \param progress_data пользовательские данные для функции progress_func;
+ * \param cancellable объект для отмены подключения или NULL;
+ * \param callback функция, вызываемая по завершении подключения;
+ * \param user_data пользовательские данные для функции callback.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_new_async   (const gchar           *host,
+                                                        gdouble                timeout,
+                                                        guint                  n_exec,
+                                                        guint                  n_buffers,
+                                                        HyScanSonarClientProgressFunc progress_func,
+                                                        gpointer               progress_data,
+                                                        GCancellable          *cancellable,
+                                                        GAsyncReadyCallback    callback,
+                                                        gpointer               user_data);
+
+/**
+ *
+ * Функция завершает асинхронное создание объекта \link HyScanSonarClient \endlink.
+ *
+ * \param result результат выполнения подключения;
+ * \param error указатель для информации об ошибке или NULL.
+ *
+ * \return Указатель на объект \link HyScanSonarClient \endlink или NULL в случае ошибки.
+ *
+ */
+HYSCAN_API
+HyScanSonarClient     *hyscan_sonar_client_new_finish  (GAsyncResult          *result,
+                                                        GError               **error);
+
+/**
+ *
+ * Функция создаёт объект \link HyScanSonarClient \endlink, который вместо подключения
+ * к гидролокатору воспроизводит пакеты, записанные функцией #hyscan_sonar_client_start_capture.
+ * Пакеты обрабатываются так же, как принятые от гидролокатора, и доставляются сигналом "data".
+ * Скорость воспроизведения задаётся относительно времени приёма пакетов при записи,
+ * нулевое значение означает воспроизведение с максимальной скоростью.
+ *
+ * \param path путь к файлу записанных пакетов;
+ * \param speed скорость воспроизведения;
+ * \param n_buffers число буферов для кэширования данных;
+ * \param n_workers число потоков доставки сообщений.
+ *
+ * \return Указатель на объект \link HyScanSonarClient \endlink или NULL в случае ошибки.
+ *
+ */
+HYSCAN_API
+HyScanSonarClient     *hyscan_sonar_client_new_replay  (const gchar           *path,
+                                                        gdouble                speed,
+                                                        guint                  n_buffers,
+                                                        guint                  n_workers);
+
+/**
+ *
+ * Функция подготавливает буферы клиента к приёму данных. Для сборки сообщений
+ * выделяется общая область памяти, разделяемая на блоки по одному на каждый буфер.
+ * Размер блока определяется максимальным размером сообщения источников данных,
+ * указанным в схеме гидролокатора (см. #hyscan_sonar_schema_source_set_max_size).
+ * Если размер в схеме не указан, используются блоки минимального размера.
+ * Все страницы памяти буферов отображаются заранее, что исключает страничные
+ * прерывания и выделение памяти во время приёма данных. Сообщения большего размера
+ * собираются в буферах, выделяемых динамически. Функцию рекомендуется вызывать
+ * до начала работы гидролокатора, повторный вызов не выполняет никаких действий.
+ *
+ * Если huge_pages равен TRUE, область памяти буферов сборки по возможности
+ * размещается в больших страницах памяти. Если большие страницы недоступны,
+ * память выделяется обычным образом.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param huge_pages использовать большие страницы памяти.
+ *
+ * \return TRUE - если буферы подготовлены, FALSE - если буферы уже были подготовлены.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_warm_up     (HyScanSonarClient     *client,
+                                                        gboolean               huge_pages);
+
+/**
+ *
+ * Функция увеличивает счётчик ссылок на сообщение, переданное в сигнале "data".
+ * Функция позволяет обрабатывать сообщение после возврата из обработчика сигнала
+ * без копирования его данных. Данные сообщения доступны только для чтения.
+ * Функцию можно вызывать только для сообщений, переданных клиентом. Сообщение
+ * остаётся действительным до освобождения ссылки, в том числе после удаления
+ * объекта клиента.
+ *
+ * \param message указатель на сообщение \link HyScanSonarMessage \endlink.
+ *
+ * \return Указатель на сообщение.
+ *
+ */
+HYSCAN_API
+HyScanSonarMessage    *hyscan_sonar_client_message_ref (HyScanSonarMessage    *message);
+
+/**
+ *
+ * Функция уменьшает счётчик ссылок на сообщение. После освобождения последней
+ * ссылки буфер сообщения используется для приёма новых данных.
+ *
+ * \param message указатель на сообщение \link HyScanSonarMessage \endlink.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_message_unref
+                                                       (HyScanSonarMessage    *message);
+
+/**
+ *
+ * Функция добавляет функцию приёма данных. Функция получает сообщения источника
+ * данных source с типом данных type. Для приёма сообщений всех источников или всех
+ * типов используются значения #HYSCAN_SONAR_CLIENT_ANY_SOURCE и
+ * #HYSCAN_SONAR_CLIENT_ANY_TYPE.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param source идентификатор источника данных;
+ * \param type тип данных - \link HyScanDataType \endlink;
+ * \param func функция приёма данных;
+ * \param user_data пользовательские данные для функции func;
+ * \param destroy функция освобождения пользовательских данных или NULL.
+ *
+ * \return Идентификатор функции приёма данных или 0 в случае ошибки.
+ *
+ */
+HYSCAN_API
+guint                  hyscan_sonar_client_add_sink    (HyScanSonarClient     *client,
+                                                        guint32                source,
+                                                        guint32                type,
+                                                        HyScanSonarClientSinkFunc func,
+                                                        gpointer               user_data,
+                                                        GDestroyNotify         destroy);
+
+/**
+ *
+ * Функция удаляет функцию приёма данных. Если в момент удаления выполняется доставка
+ * сообщений, функция может быть вызвана ещё раз. Функция destroy вызывается после
+ * завершения всех вызовов.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param id идентификатор функции приёма данных.
+ *
+ * \return TRUE - если функция удалена, FALSE - если функция не найдена.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_remove_sink (HyScanSonarClient     *client,
+                                                        guint                  id);
+
+/**
+ *
+ * Функция проверяет, все ли записанные пакеты переданы на обработку.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink.
+ *
+ * \return TRUE - если воспроизведение завершено, иначе FALSE.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_replay_done (HyScanSonarClient     *client);
+
+/**
+ *
+ * Функция начинает запись всех принятых от гидролокатора пакетов в файл. Для каждого
+ * пакета записывается время его приёма. Если запись уже ведётся, она завершается
+ * и начинается запись в новый файл.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param path путь к файлу записи.
+ *
+ * \return TRUE - если запись начата, FALSE - в случае ошибки.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_start_capture
+                                                       (HyScanSonarClient     *client,
+                                                        const gchar           *path);
+
+/**
+ *
+ * Функция завершает запись принятых пакетов.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_stop_capture
+                                                       (HyScanSonarClient     *client);
+
 /**
  *
  * Функция переводит подключение к гидролокатору в активный режим.
@@ -136,6 +533,169 @@ HyScanSonarClient     *hyscan_sonar_client_new_full    (const gchar           *h
 HYSCAN_API
 gboolean               hyscan_sonar_client_set_master  (HyScanSonarClient     *client);
 
+/**
+ *
+ * Функция асинхронно устанавливает значения параметров гидролокатора. Функция
+ * забирает ссылки на значения параметров в любом случае, элементы массива values
+ * обнуляются. По завершении запроса вызывается функция callback, в которой
+ * необходимо вызвать #hyscan_sonar_client_set_finish.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param names NULL терминированный список названий параметров;
+ * \param values значения параметров;
+ * \param timeout время ожидания выполнения запроса, секунды, или 0 для использования
+ *        только числа попыток выполнения запроса;
+ * \param cancellable объект для отмены запроса или NULL;
+ * \param callback функция, вызываемая по завершении запроса;
+ * \param user_data пользовательские данные для функции callback.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_set_async   (HyScanSonarClient     *client,
+                                                        const gchar *const    *names,
+                                                        GVariant             **values,
+                                                        gdouble                timeout,
+                                                        GCancellable          *cancellable,
+                                                        GAsyncReadyCallback    callback,
+                                                        gpointer               user_data);
+
+/**
+ *
+ * Функция завершает асинхронную установку значений параметров гидролокатора.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param result результат выполнения запроса;
+ * \param error указатель для информации об ошибке или NULL.
+ *
+ * \return TRUE - если значения установлены, FALSE - в случае ошибки.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_set_finish  (HyScanSonarClient     *client,
+                                                        GAsyncResult          *result,
+                                                        GError               **error);
+
+/**
+ *
+ * Функция асинхронно считывает значения параметров гидролокатора. По завершении
+ * запроса вызывается функция callback, в которой необходимо вызвать
+ * #hyscan_sonar_client_get_finish.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param names NULL терминированный список названий параметров;
+ * \param timeout время ожидания выполнения запроса, секунды, или 0 для использования
+ *        только числа попыток выполнения запроса;
+ * \param cancellable объект для отмены запроса или NULL;
+ * \param callback функция, вызываемая по завершении запроса;
+ * \param user_data пользовательские данные для функции callback.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_get_async   (HyScanSonarClient     *client,
+                                                        const gchar *const    *names,
+                                                        gdouble                timeout,
+                                                        GCancellable          *cancellable,
+                                                        GAsyncReadyCallback    callback,
+                                                        gpointer               user_data);
+
+/**
+ *
+ * Функция завершает асинхронное чтение значений параметров гидролокатора. Массив
+ * values должен иметь размер не меньше числа запрошенных параметров. Значения
+ * необходимо освободить функцией g_variant_unref.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param result результат выполнения запроса;
+ * \param values массив для значений параметров;
+ * \param error указатель для информации об ошибке или NULL.
+ *
+ * \return TRUE - если значения считаны, FALSE - в случае ошибки.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_get_finish  (HyScanSonarClient     *client,
+                                                        GAsyncResult          *result,
+                                                        GVariant             **values,
+                                                        GError               **error);
+
+/**
+ *
+ * Функция возвращает число запросов значений параметров, выполненных
+ * с использованием кэша и с обращением к серверу.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param hits число значений, взятых из кэша, или NULL;
+ * \param misses число значений, запрошенных у сервера, или NULL.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_get_cache_stats
+                                                       (HyScanSonarClient     *client,
+                                                        guint64               *hits,
+                                                        guint64               *misses);
+
+/**
+ *
+ * Функция возвращает статистику приёма данных источника. Статистику всех источников
+ * можно получить, указав #HYSCAN_SONAR_CLIENT_ANY_SOURCE. В этом случае число потерь
+ * определяется по пропускам в сквозной нумерации пакетов и учитывает пакеты, по
+ * которым нельзя определить источник, например пакеты с ошибкой контрольной суммы.
+ * Функцию можно вызывать из любого потока.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param source идентификатор источника данных или #HYSCAN_SONAR_CLIENT_ANY_SOURCE;
+ * \param stats указатель на структуру для статистики.
+ *
+ * \return TRUE - если статистика получена, FALSE - если данные от источника не принимались.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_client_get_stats   (HyScanSonarClient     *client,
+                                                        guint32                source,
+                                                        HyScanSonarClientStats *stats);
+
+/**
+ *
+ * Функция задаёт правило сборки фрагментированных сообщений источника данных.
+ * Правило применяется к сообщениям, сборка которых начнётся после вызова функции.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param source идентификатор источника данных;
+ * \param timeout время ожидания недостающих фрагментов сообщения, секунды;
+ * \param deliver TRUE - доставлять неполные сообщения, FALSE - отбрасывать их.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_set_flush_policy
+                                                       (HyScanSonarClient     *client,
+                                                        guint32                source,
+                                                        gdouble                timeout,
+                                                        gboolean               deliver);
+
+/**
+ *
+ * Функция возвращает статистику выполнения RPC запросов и текущую оценку
+ * времени обращения к серверу.
+ *
+ * \param client указатель на объект \link HyScanSonarClient \endlink;
+ * \param stats указатель на структуру для статистики.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_client_get_rpc_stats
+                                                       (HyScanSonarClient     *client,
+                                                        HyScanSonarClientRpcStats *stats);
+
 G_END_DECLS
 
 #endif /* __HYSCAN_SONAR_CLIENT_H__ */
@@ -720,6 +720,7 @@ hyscan_sonar_control_server_send_raw_data (HyScanSonarControlServer *server,
   message.rate = rate;
   message.size = data->size;
   message.data = data->data;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
@@ -753,6 +754,7 @@ hyscan_sonar_control_server_send_noise_data (HyScanSonarControlServer *server,
   message.rate = rate;
   message.size = data->size;
   message.data = data->data;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
@@ -783,6 +785,7 @@ hyscan_sonar_control_server_send_acoustic_data (HyScanSonarControlServer *server
   message.rate = rate;
   message.size = data->size;
   message.data = data->data;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
@@ -9,9 +9,16 @@
  */
 
 #include "hyscan-sonar-control.h"
+#include "hyscan-sonar-client.h"
 #include "hyscan-sonar-messages.h"
 #include "hyscan-control-common.h"
 #include "hyscan-control-marshallers.h"
+#include "hyscan-sonar-model.h"
+#include "hyscan-adc-convert.h"
+#include "hyscan-pulse-compressor.h"
+#include "hyscan-tvg-compensator.h"
+#include "hyscan-ping-preview.h"
+#include "hyscan-ping-history.h"
 
 enum
 {
@@ -22,35 +29,32 @@ enum
 enum
 {
   SIGNAL_RAW_DATA,
+  SIGNAL_RAW_DATA_FLOAT,
+  SIGNAL_COMPRESSED_DATA,
+  SIGNAL_CORRECTED_DATA,
+  SIGNAL_RAW_PREVIEW,
   SIGNAL_NOISE_DATA,
   SIGNAL_ACOUSTIC_DATA,
+  SIGNAL_ACOUSTIC_PREVIEW,
   SIGNAL_LAST
 };
 
-typedef struct
-{
-  HyScanSourceType             source;                         /* Тип источника данных. */
-  guint                        channel;                        /* Индекс приёмного канала. */
-  HyScanRawDataInfo            info;                           /* Параметры "сырых" гидролокационных данных. */
-} HyScanSonarControlChannel;
-
-typedef struct
-{
-  HyScanSourceType             source;                         /* Тип источника данных. */
-  HyScanAcousticDataInfo       info;                           /* Параметры акустических данных. */
-} HyScanSonarControlAcoustic;
-
 struct _HyScanSonarControlPrivate
 {
   HyScanParam                 *sonar;                          /* Интерфейс управления гидролокатором. */
+  HyScanSonarModel            *model;                          /* Описание гидролокатора. */
   HyScanDataSchema            *schema;                         /* Схема параметров гидролокатора. */
 
   GArray                      *sources;                        /* Список источников гидролокационных данных. */
-  GHashTable                  *channels;                       /* Список приёмных каналов гидролокатора. */
-  GHashTable                  *noises;                         /* Список источников шумов приёмных каналов гидролокатора. */
-  GHashTable                  *acoustics;                      /* Список источников акустических данных гидролокатора. */
   HyScanSonarSyncType          sync_types;                     /* Доступные методы синхронизации излучения. */
 
+  HyScanPulseCompressor       *compressor;                     /* Сжатие импульсов. */
+  HyScanTVGCompensator        *compensator;                    /* Коррекция данных по коэффициентам ВАРУ. */
+  HyScanPingPreview           *raw_preview;                    /* Предварительный просмотр "сырых" данных. */
+  HyScanPingPreview           *acoustic_preview;               /* Предварительный просмотр акустических данных. */
+  GHashTable                  *history;                        /* История строк приёмных каналов. */
+  gboolean                     ref_messages;                   /* Признак сообщений клиента гидролокатора. */
+
   gdouble                      alive_timeout;                  /* Интервал отправки сигнала alive. */
   GThread                     *guard;                          /* Поток для периодической отправки сигнала alive. */
   gint                         shutdown;                       /* Признак завершения работы. */
@@ -64,18 +68,68 @@ static void            hyscan_sonar_control_set_property       (GObject
                                                                 const GValue          *value,
                                                                 GParamSpec            *pspec);
 static void            hyscan_sonar_control_object_constructed (GObject               *object);
+static void            hyscan_sonar_control_object_dispose     (GObject               *object);
 static void            hyscan_sonar_control_object_finalize    (GObject               *object);
 
 static gpointer        hyscan_sonar_control_quard              (gpointer               data);
 
-static void            hyscan_sonar_control_raw_data_receiver  (HyScanSonarControl    *control,
+static void            hyscan_sonar_control_raw_data_receiver  (HyScanSensorControl   *control,
+                                                                gpointer               channel,
+                                                                HyScanSonarMessage    *message);
+
+static void            hyscan_sonar_control_raw_float_emit     (HyScanSensorControl   *control,
+                                                                HyScanSonarModelChannel *raw,
+                                                                HyScanRawDataInfo     *info,
+                                                                HyScanDataWriterData  *data);
+
+static void            hyscan_sonar_control_signal_image       (HyScanSonarControl    *control,
+                                                                HyScanSourceType       source,
+                                                                HyScanDataWriterSignal *signal);
+
+static void            hyscan_sonar_control_gains              (HyScanSonarControl    *control,
+                                                                HyScanSourceType       source,
+                                                                gint                   channel,
+                                                                HyScanDataWriterTVG   *tvg);
+
+static void            hyscan_sonar_control_compressed_emit    (HyScanSonarModelChannel *raw,
+                                                                HyScanRawDataInfo     *info,
+                                                                HyScanDataWriterData  *data,
+                                                                gpointer               user_data);
+
+static void            hyscan_sonar_control_raw_preview_emit   (gpointer               channel,
+                                                                HyScanSonarControlPreview *preview,
+                                                                gpointer               user_data);
+
+static void        hyscan_sonar_control_acoustic_preview_emit  (gpointer               channel,
+                                                                HyScanSonarControlPreview *preview,
+                                                                gpointer               user_data);
+
+static void            hyscan_sonar_control_noise_data_receiver
+                                                               (HyScanSensorControl   *control,
+                                                                gpointer               channel,
+                                                                HyScanSonarMessage    *message);
+
+static void        hyscan_sonar_control_acoustic_data_receiver (HyScanSensorControl   *control,
+                                                                gpointer               channel,
+                                                                HyScanSonarMessage    *message);
+
+static void            hyscan_sonar_control_raw_data_writer    (HyScanSensorControl   *control,
+                                                                gpointer               channel,
                                                                 HyScanSonarMessage    *message);
 
-static void        hyscan_sonar_control_acoustic_data_receiver (HyScanSonarControl    *control,
+static void            hyscan_sonar_control_noise_data_writer  (HyScanSensorControl   *control,
+                                                                gpointer               channel,
+                                                                HyScanSonarMessage    *message);
+
+static void          hyscan_sonar_control_acoustic_data_writer (HyScanSensorControl   *control,
+                                                                gpointer               channel,
                                                                 HyScanSonarMessage    *message);
 
 static guint           hyscan_sonar_control_signals[SIGNAL_LAST] = { 0 };
 
+/* Буфер для преобразования данных в поток приёма данных. */
+static GPrivate        hyscan_sonar_control_float_buffer = G_PRIVATE_INIT ((GDestroyNotify) g_array_unref);
+
 G_DEFINE_TYPE_WITH_CODE (HyScanSonarControl, hyscan_sonar_control, HYSCAN_TYPE_TVG_CONTROL,
                          G_ADD_PRIVATE (HyScanSonarControl)
                          G_IMPLEMENT_INTERFACE (HYSCAN_TYPE_PARAM, hyscan_sonar_control_interface_init))
@@ -88,6 +142,7 @@ hyscan_sonar_control_class_init (HyScanSonarControlClass *klass)
   object_class->set_property = hyscan_sonar_control_set_property;
 
   object_class->constructed = hyscan_sonar_control_object_constructed;
+  object_class->dispose = hyscan_sonar_control_object_dispose;
   object_class->finalize = hyscan_sonar_control_object_finalize;
 
   g_object_class_install_property (object_class, PROP_SONAR,
@@ -100,6 +155,30 @@ hyscan_sonar_control_class_init (HyScanSonarControlClass *klass)
                   G_TYPE_NONE,
                   4, G_TYPE_INT, G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER);
 
+  hyscan_sonar_control_signals[SIGNAL_RAW_DATA_FLOAT] =
+    g_signal_new ("raw-data-float", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                  hyscan_control_marshal_VOID__INT_UINT_POINTER_POINTER,
+                  G_TYPE_NONE,
+                  4, G_TYPE_INT, G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER);
+
+  hyscan_sonar_control_signals[SIGNAL_COMPRESSED_DATA] =
+    g_signal_new ("compressed-data", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                  hyscan_control_marshal_VOID__INT_UINT_POINTER_POINTER,
+                  G_TYPE_NONE,
+                  4, G_TYPE_INT, G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER);
+
+  hyscan_sonar_control_signals[SIGNAL_CORRECTED_DATA] =
+    g_signal_new ("corrected-data", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                  hyscan_control_marshal_VOID__INT_UINT_POINTER_POINTER,
+                  G_TYPE_NONE,
+                  4, G_TYPE_INT, G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER);
+
+  hyscan_sonar_control_signals[SIGNAL_RAW_PREVIEW] =
+    g_signal_new ("raw-preview", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                  hyscan_control_marshal_VOID__INT_UINT_POINTER,
+                  G_TYPE_NONE,
+                  3, G_TYPE_INT, G_TYPE_UINT, G_TYPE_POINTER);
+
   hyscan_sonar_control_signals[SIGNAL_NOISE_DATA] =
     g_signal_new ("noise-data", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
                   hyscan_control_marshal_VOID__INT_UINT_POINTER_POINTER,
@@ -111,6 +190,12 @@ hyscan_sonar_control_class_init (HyScanSonarControlClass *klass)
                   hyscan_control_marshal_VOID__INT_POINTER_POINTER,
                   G_TYPE_NONE,
                   3, G_TYPE_INT, G_TYPE_POINTER, G_TYPE_POINTER);
+
+  hyscan_sonar_control_signals[SIGNAL_ACOUSTIC_PREVIEW] =
+    g_signal_new ("acoustic-preview", HYSCAN_TYPE_SONAR_CONTROL, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+                  hyscan_control_marshal_VOID__INT_POINTER,
+                  G_TYPE_NONE,
+                  2, G_TYPE_INT, G_TYPE_POINTER);
 }
 
 static void
@@ -147,13 +232,9 @@ hyscan_sonar_control_object_constructed (GObject *object)
   HyScanSonarControl *control = HYSCAN_SONAR_CONTROL (object);
   HyScanSonarControlPrivate *priv = control->priv;
 
-  HyScanDataSchemaNode *params;
-  HyScanDataSchemaNode *sources;
+  HyScanSonarModel *model;
+  HyScanSourceType source;
   gchar *info;
-
-  gint64 sync_types;
-  gint64 version;
-  gint64 id;
   guint i, j;
 
   G_OBJECT_CLASS (hyscan_sonar_control_parent_class)->constructed (object);
@@ -163,212 +244,75 @@ hyscan_sonar_control_object_constructed (GObject *object)
   /* Список источников данных. */
   priv->sources = g_array_new (TRUE, TRUE, sizeof (HyScanSourceType));
 
-  /* Список приёмных каналов. */
-  priv->channels = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
-  priv->noises = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, NULL);
-  priv->acoustics = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
-
-  /* Обязательно должен быть передан указатель на интерфейс управления локатором. */
-  if (priv->sonar == NULL)
+  /* Описание гидролокатора. */
+  model = hyscan_sensor_control_get_model (HYSCAN_SENSOR_CONTROL (control));
+  if (model == NULL)
     return;
 
-  /* Проверяем идентификатор и версию схемы гидролокатора. */
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/id", &id))
-    return;
-  if (id != HYSCAN_SONAR_SCHEMA_ID)
-    return;
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/version", &version))
-    return;
-  if ((version / 100) != (HYSCAN_SONAR_SCHEMA_VERSION / 100))
-    return;
+  priv->model = hyscan_sonar_model_ref (model);
+  priv->schema = g_object_ref (model->schema);
+
+  /* На сообщения клиента гидролокатора можно получать ссылки без копирования данных. */
+  priv->ref_messages = HYSCAN_IS_SONAR_CLIENT (priv->sonar);
 
   /* Доступные методы синхронизации излучения. */
-  if (hyscan_param_get_integer (priv->sonar, "/sync/capabilities", &sync_types))
-    priv->sync_types = sync_types;
+  priv->sync_types = model->sync_capabilities;
 
-  /* Поток отправки сигнала alive. */
-  if (hyscan_param_get_double (priv->sonar, "/control/timeout", &priv->alive_timeout))
-    priv->guard = g_thread_new ("sonar-control-alive", hyscan_sonar_control_quard, priv);
+  /* Сжатие импульсов по образам излучаемых сигналов. */
+  priv->compressor = hyscan_pulse_compressor_new (hyscan_sonar_control_compressed_emit, control);
+  g_signal_connect (control, "signal-image", G_CALLBACK (hyscan_sonar_control_signal_image), NULL);
+
+  /* Коррекция данных по коэффициентам усиления ВАРУ. */
+  priv->compensator = hyscan_tvg_compensator_new ();
+  g_signal_connect (control, "gains", G_CALLBACK (hyscan_sonar_control_gains), NULL);
 
-  /* Параметры гидролокатора. */
-  priv->schema = hyscan_param_schema (priv->sonar);
-  params = hyscan_data_schema_list_nodes (priv->schema);
+  /* Предварительный просмотр данных. */
+  priv->raw_preview = hyscan_ping_preview_new (hyscan_sonar_control_raw_preview_emit, control);
+  priv->acoustic_preview = hyscan_ping_preview_new (hyscan_sonar_control_acoustic_preview_emit, control);
 
-  /* Ветка схемы с описанием источников данных - "/sources". */
-  for (i = 0, sources = NULL; i < params->n_nodes; i++)
+  /* Поток отправки сигнала alive. */
+  if (model->has_alive)
     {
-      if (g_strcmp0 (params->nodes[i]->path, "/sources") == 0)
-        {
-          sources = params->nodes[i];
-          break;
-        }
+      priv->alive_timeout = model->alive_timeout;
+      priv->guard = g_thread_new ("sonar-control-alive", hyscan_sonar_control_quard, priv);
     }
 
-  if (sources != NULL)
+  /* Источники "сырых" и акустических данных. */
+  for (i = 0; i < model->n_sources; i++)
     {
-      HyScanSourceType source;
-
-      /* Считываем описания источников "сырых" данных. */
-      for (i = 0; i < sources->n_nodes; i++)
-        {
-          gchar *param_names[7];
-          GVariant *param_values[7];
-
-          gchar **pathv;
-          gchar *param_id;
+      HyScanSonarModelSource *sonar_source = &model->sources[i];
 
-          gdouble antenna_vpattern;
-          gdouble antenna_hpattern;
-          gdouble antenna_frequency;
-          gdouble antenna_bandwidth;
-          gint64 acoustic_id;
+      if (!sonar_source->has_antenna)
+        continue;
 
-          gboolean status;
+      g_array_append_val (priv->sources, sonar_source->source);
 
-          /* Тип источника данных. */
-          pathv = g_strsplit (sources->nodes[i]->path, "/", -1);
-          source = hyscan_control_get_source_type (pathv[2]);
-          g_strfreev (pathv);
+      /* Обработчики данных и шумов приёмных каналов. */
+      for (j = 0; j < sonar_source->n_channels; j++)
+        {
+          HyScanSonarModelChannel *channel = &sonar_source->channels[j];
 
-          if (source == HYSCAN_SOURCE_INVALID)
+          if (channel->id == 0)
             continue;
 
-          param_names[0] = g_strdup_printf ("%s/antenna/pattern/vertical", sources->nodes[i]->path);
-          param_names[1] = g_strdup_printf ("%s/antenna/pattern/horizontal", sources->nodes[i]->path);
-          param_names[2] = g_strdup_printf ("%s/antenna/frequency", sources->nodes[i]->path);
-          param_names[3] = g_strdup_printf ("%s/antenna/bandwidth", sources->nodes[i]->path);
-          param_names[4] = NULL;
-
-          status = hyscan_param_get (priv->sonar, (const gchar **)param_names, param_values);
-
-          if (status)
-            {
-              antenna_vpattern = g_variant_get_double (param_values[0]);
-              antenna_hpattern = g_variant_get_double (param_values[1]);
-              antenna_frequency = g_variant_get_double (param_values[2]);
-              antenna_bandwidth = g_variant_get_double (param_values[3]);
-
-              g_variant_unref (param_values[0]);
-              g_variant_unref (param_values[1]);
-              g_variant_unref (param_values[2]);
-              g_variant_unref (param_values[3]);
-            }
-
-          g_free (param_names[0]);
-          g_free (param_names[1]);
-          g_free (param_names[2]);
-          g_free (param_names[3]);
-
-          if (!status)
-            continue;
+          hyscan_sensor_control_add_route (HYSCAN_SENSOR_CONTROL (control), channel->id,
+                                           hyscan_sonar_control_raw_data_receiver, channel);
+          hyscan_sensor_control_add_route (HYSCAN_SENSOR_CONTROL (control), channel->noise_id,
+                                           hyscan_sonar_control_noise_data_receiver, channel);
+        }
 
-          g_array_append_val (priv->sources, source);
-
-          /* Приёмные каналы. */
-          for (j = 1; TRUE; j++)
-            {
-              HyScanSonarControlChannel *channel;
-
-              gboolean has_channel;
-              gint64 data_id;
-              gint64 noise_id;
-              gdouble antenna_voffset;
-              gdouble antenna_hoffset;
-              gint adc_offset;
-              gdouble adc_vref;
-
-              param_id = g_strdup_printf ("%s/channels/%d/id", sources->nodes[i]->path, j);
-              has_channel = hyscan_data_schema_has_key (priv->schema, param_id);
-              g_free (param_id);
-
-              if (!has_channel)
-                break;
-
-              param_names[0] = g_strdup_printf ("%s/channels/%d/id", sources->nodes[i]->path, j);
-              param_names[1] = g_strdup_printf ("%s/channels/%d/noise/id", sources->nodes[i]->path, j);
-              param_names[2] = g_strdup_printf ("%s/channels/%d/antenna/offset/vertical", sources->nodes[i]->path, j);
-              param_names[3] = g_strdup_printf ("%s/channels/%d/antenna/offset/horizontal", sources->nodes[i]->path, j);
-              param_names[4] = g_strdup_printf ("%s/channels/%d/adc/offset", sources->nodes[i]->path, j);
-              param_names[5] = g_strdup_printf ("%s/channels/%d/adc/vref", sources->nodes[i]->path, j);
-              param_names[6] = NULL;
-
-              status = hyscan_param_get (priv->sonar, (const gchar **)param_names, param_values);
-
-              if (status)
-                {
-                  data_id = g_variant_get_int64 (param_values[0]);
-                  noise_id = g_variant_get_int64 (param_values[1]);
-                  antenna_voffset = g_variant_get_double (param_values[2]);
-                  antenna_hoffset = g_variant_get_double (param_values[3]);
-                  adc_offset = g_variant_get_int64 (param_values[4]);
-                  adc_vref = g_variant_get_double (param_values[5]);
-
-                  g_variant_unref (param_values[0]);
-                  g_variant_unref (param_values[1]);
-                  g_variant_unref (param_values[2]);
-                  g_variant_unref (param_values[3]);
-                  g_variant_unref (param_values[4]);
-                  g_variant_unref (param_values[5]);
-                }
-
-              g_free (param_names[0]);
-              g_free (param_names[1]);
-              g_free (param_names[2]);
-              g_free (param_names[3]);
-              g_free (param_names[4]);
-              g_free (param_names[5]);
-
-              if (!status)
-                continue;
-
-              if (data_id <= 0 || data_id > G_MAXINT32)
-                continue;
-
-              if (noise_id <= 0 || noise_id > G_MAXINT32)
-                continue;
-
-              channel = g_new0 (HyScanSonarControlChannel, 1);
-              channel->source = source;
-              channel->channel = j;
-              channel->info.adc.offset = adc_offset;
-              channel->info.adc.vref = adc_vref;
-              channel->info.antenna.offset.vertical = antenna_voffset;
-              channel->info.antenna.offset.horizontal = antenna_hoffset;
-              channel->info.antenna.pattern.vertical = antenna_vpattern;
-              channel->info.antenna.pattern.horizontal = antenna_hpattern;
-              channel->info.antenna.frequency = antenna_frequency;
-              channel->info.antenna.bandwidth = antenna_bandwidth;
-
-              g_hash_table_insert (priv->channels, GINT_TO_POINTER (data_id), channel);
-              g_hash_table_insert (priv->noises, GINT_TO_POINTER (noise_id), channel);
-            }
-
-          /* Акустические данные. */
-          param_id = g_strdup_printf ("%s/acoustic/id", sources->nodes[i]->path);
-          if (hyscan_param_get_integer (priv->sonar, param_id, &acoustic_id) &&
-              (acoustic_id > 0) && (acoustic_id <= G_MAXINT32))
-            {
-              HyScanSonarControlAcoustic *acoustic;
-
-              acoustic = g_new0 (HyScanSonarControlAcoustic, 1);
-              acoustic->source = source;
-              acoustic->info.antenna.pattern.vertical = antenna_vpattern;
-              acoustic->info.antenna.pattern.horizontal = antenna_hpattern;
-
-              g_hash_table_insert (priv->acoustics, GINT_TO_POINTER (acoustic_id), acoustic);
-            }
-          g_free (param_id);
+      /* Обработчик акустических данных. */
+      if (sonar_source->acoustic.id != 0)
+        {
+          hyscan_sensor_control_add_route (HYSCAN_SENSOR_CONTROL (control), sonar_source->acoustic.id,
+                                           hyscan_sonar_control_acoustic_data_receiver, &sonar_source->acoustic);
         }
+    }
 
-      source = HYSCAN_SOURCE_INVALID;
-      g_array_append_val (priv->sources, source);
+  source = HYSCAN_SOURCE_INVALID;
+  g_array_append_val (priv->sources, source);
 
-      /* Обработчик данных от гидролокатора. */
-      g_signal_connect_swapped (priv->sonar, "data",
-                                G_CALLBACK (hyscan_sonar_control_raw_data_receiver), control);
-      g_signal_connect_swapped (priv->sonar, "data",
-                                G_CALLBACK (hyscan_sonar_control_acoustic_data_receiver), control);
-    }
+  hyscan_sensor_control_apply_routes (HYSCAN_SENSOR_CONTROL (control));
 
   /* Информация о гидролокаторе. */
   info = hyscan_data_schema_get_data (priv->schema, "/info", "info");
@@ -378,8 +322,24 @@ hyscan_sonar_control_object_constructed (GObject *object)
 
       g_free (info);
     }
+}
 
-  hyscan_data_schema_free_nodes (params);
+/* Потоки сжатия импульсов и предварительного просмотра отправляют сигналы объекта,
+ * поэтому они завершаются до начала его финализации. Перед этим прекращается
+ * приём данных, чтобы в них не поступали новые строки. */
+static void
+hyscan_sonar_control_object_dispose (GObject *object)
+{
+  HyScanSonarControl *control = HYSCAN_SONAR_CONTROL (object);
+  HyScanSonarControlPrivate *priv = control->priv;
+
+  g_signal_handlers_disconnect_by_data (priv->sonar, control);
+
+  g_clear_pointer (&priv->compressor, hyscan_pulse_compressor_free);
+  g_clear_pointer (&priv->raw_preview, hyscan_ping_preview_free);
+  g_clear_pointer (&priv->acoustic_preview, hyscan_ping_preview_free);
+
+  G_OBJECT_CLASS (hyscan_sonar_control_parent_class)->dispose (object);
 }
 
 static void
@@ -388,7 +348,7 @@ hyscan_sonar_control_object_finalize (GObject *object)
   HyScanSonarControl *control = HYSCAN_SONAR_CONTROL (object);
   HyScanSonarControlPrivate *priv = control->priv;
 
-  g_signal_handlers_disconnect_by_data (priv->sonar, control);
+  hyscan_sensor_control_write_flush (HYSCAN_SENSOR_CONTROL (control));
 
   if (priv->guard != NULL)
     {
@@ -396,12 +356,13 @@ hyscan_sonar_control_object_finalize (GObject *object)
       g_thread_join (priv->guard);
     }
 
+  hyscan_tvg_compensator_free (priv->compensator);
+  g_clear_pointer (&priv->history, g_hash_table_unref);
+
   g_clear_object (&priv->schema);
+  g_clear_pointer (&priv->model, hyscan_sonar_model_unref);
   g_clear_object (&priv->sonar);
 
-  g_hash_table_unref (priv->channels);
-  g_hash_table_unref (priv->noises);
-  g_hash_table_unref (priv->acoustics);
   g_array_free (priv->sources, TRUE);
 
   g_mutex_clear (&priv->lock);
@@ -435,66 +396,217 @@ hyscan_sonar_control_quard (gpointer data)
 
 /* Функция обрабатывает сообщения с "сырыми" данными от приёмных каналов гидролокатора. */
 static void
-hyscan_sonar_control_raw_data_receiver (HyScanSonarControl *control,
-                                        HyScanSonarMessage *message)
+hyscan_sonar_control_raw_data_receiver (HyScanSensorControl *control,
+                                        gpointer             channel,
+                                        HyScanSonarMessage  *message)
 {
-  HyScanSonarControlChannel *channel;
+  HyScanSonarModelChannel *raw = channel;
   HyScanRawDataInfo info;
   HyScanDataWriterData data;
-  gboolean noise = FALSE;
-
-  /* Ищем приёмный канал. */
-  channel = g_hash_table_lookup (control->priv->channels, GINT_TO_POINTER (message->id));
-  if (channel == NULL)
-    {
-      channel = g_hash_table_lookup (control->priv->noises, GINT_TO_POINTER (message->id));
-      if (channel == NULL)
-        return;
-      noise = TRUE;
-    }
+  GHashTable *history;
 
   /* Данные. */
-  info = channel->info;
+  info = raw->info;
   info.data.type = message->type;
   info.data.rate = message->rate;
   data.time = message->time;
   data.size = message->size;
   data.data = message->data;
 
-  if (!noise)
+  hyscan_sensor_control_write (control, hyscan_sonar_control_raw_data_writer, raw, message);
+
+  /* История строк. */
+  history = g_atomic_pointer_get (&HYSCAN_SONAR_CONTROL (control)->priv->history);
+  if (history != NULL)
     {
-      hyscan_data_writer_raw_add_data (HYSCAN_DATA_WRITER (control),
-                                       channel->source, channel->channel,
-                                       &info, &data);
+      GBytes *bytes;
+
+      /* Строка истории удерживает ссылку на сообщение клиента вместо копии данных. */
+      if (HYSCAN_SONAR_CONTROL (control)->priv->ref_messages)
+        {
+          bytes = g_bytes_new_with_free_func (message->data, message->size,
+                                              (GDestroyNotify)hyscan_sonar_client_message_unref,
+                                              hyscan_sonar_client_message_ref (message));
+        }
+      else
+        {
+          bytes = g_bytes_new (message->data, message->size);
+        }
+
+      hyscan_ping_history_push (g_hash_table_lookup (history, raw), &info, message->time, bytes);
+      g_bytes_unref (bytes);
+    }
+
+  g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_RAW_DATA], 0,
+                 raw->source, raw->channel, &info, &data);
+
+  /* Данные преобразовываются только при наличии обработчиков сигнала. */
+  if (g_signal_has_handler_pending (control, hyscan_sonar_control_signals[SIGNAL_RAW_DATA_FLOAT], 0, FALSE))
+    hyscan_sonar_control_raw_float_emit (control, raw, &info, &data);
+
+  /* Коррекция по коэффициентам ВАРУ выполняется только при наличии обработчиков сигнала. */
+  if (g_signal_has_handler_pending (control, hyscan_sonar_control_signals[SIGNAL_CORRECTED_DATA], 0, FALSE))
+    {
+      HyScanRawDataInfo corrected_info;
+      HyScanDataWriterData corrected_data;
+
+      if (hyscan_tvg_compensator_apply (HYSCAN_SONAR_CONTROL (control)->priv->compensator, raw,
+                                        &info, &data, &corrected_info, &corrected_data))
+        {
+          g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_CORRECTED_DATA], 0,
+                         raw->source, raw->channel, &corrected_info, &corrected_data);
+        }
+    }
 
-      g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_RAW_DATA], 0,
-                     channel->source, channel->channel, &info, &data);
+  /* Предварительный просмотр выполняется только при наличии обработчиков сигнала. */
+  if (g_signal_has_handler_pending (control, hyscan_sonar_control_signals[SIGNAL_RAW_PREVIEW], 0, FALSE))
+    {
+      hyscan_ping_preview_add (HYSCAN_SONAR_CONTROL (control)->priv->raw_preview, raw,
+                               info.data.type, info.data.rate, info.adc.offset, info.adc.vref, &data);
     }
-  else
+
+  /* Сжатие импульсов выполняется только при наличии обработчиков сигнала. */
+  if (g_signal_has_handler_pending (control, hyscan_sonar_control_signals[SIGNAL_COMPRESSED_DATA], 0, FALSE))
+    hyscan_pulse_compressor_add (HYSCAN_SONAR_CONTROL (control)->priv->compressor, raw, &info, &data);
+}
+
+/* Функция преобразовывает "сырые" данные в числа с плавающей точкой и отправляет сигнал raw-data-float. */
+static void
+hyscan_sonar_control_raw_float_emit (HyScanSensorControl     *control,
+                                     HyScanSonarModelChannel *raw,
+                                     HyScanRawDataInfo       *info,
+                                     HyScanDataWriterData    *data)
+{
+  HyScanRawDataInfo float_info;
+  HyScanDataWriterData float_data;
+  GArray *buffer;
+  guint32 n_values;
+
+  float_info = *info;
+  float_data = *data;
+
+  float_info.data.type = hyscan_adc_convert_get_type (info->data.type);
+  if (float_info.data.type == HYSCAN_DATA_INVALID)
+    return;
+
+  /* Данные в формате АЦП. */
+  if (float_info.data.type != info->data.type)
     {
-      hyscan_data_writer_raw_add_noise (HYSCAN_DATA_WRITER (control),
-                                        channel->source, channel->channel,
-                                        &info, &data);
+      buffer = g_private_get (&hyscan_sonar_control_float_buffer);
+      if (buffer == NULL)
+        {
+          buffer = g_array_new (FALSE, FALSE, sizeof (gfloat));
+          g_private_set (&hyscan_sonar_control_float_buffer, buffer);
+        }
+
+      n_values = hyscan_adc_convert_get_n_values (info->data.type, data->size);
+      g_array_set_size (buffer, n_values);
 
-      g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_NOISE_DATA], 0,
-                     channel->source, channel->channel, &info, &data);
+      n_values = hyscan_adc_convert (info->data.type, info->adc.offset, info->adc.vref,
+                                     data->data, data->size, (gfloat*)buffer->data);
+
+      float_data.size = n_values * sizeof (gfloat);
+      float_data.data = buffer->data;
     }
+
+  g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_RAW_DATA_FLOAT], 0,
+                 raw->source, raw->channel, &float_info, &float_data);
+}
+
+/* Функция обрабатывает изменение образа излучаемого сигнала. */
+static void
+hyscan_sonar_control_signal_image (HyScanSonarControl     *control,
+                                   HyScanSourceType        source,
+                                   HyScanDataWriterSignal *signal)
+{
+  hyscan_pulse_compressor_set_image (control->priv->compressor, source, signal);
+}
+
+/* Функция обрабатывает изменение коэффициентов усиления ВАРУ. */
+static void
+hyscan_sonar_control_gains (HyScanSonarControl  *control,
+                            HyScanSourceType     source,
+                            gint                 channel,
+                            HyScanDataWriterTVG *tvg)
+{
+  const HyScanSonarModelSource *sonar_source;
+
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if ((sonar_source == NULL) || (channel < 1) || ((guint)channel > sonar_source->n_channels))
+    return;
+
+  hyscan_tvg_compensator_add_tvg (control->priv->compensator, &sonar_source->channels[channel - 1], tvg);
+}
+
+/* Функция отправляет сигнал compressed-data. Вызывается из потоков сжатия импульсов. */
+static void
+hyscan_sonar_control_compressed_emit (HyScanSonarModelChannel *raw,
+                                      HyScanRawDataInfo       *info,
+                                      HyScanDataWriterData    *data,
+                                      gpointer                 user_data)
+{
+  g_signal_emit (user_data, hyscan_sonar_control_signals[SIGNAL_COMPRESSED_DATA], 0,
+                 raw->source, raw->channel, info, data);
+}
+
+/* Функция отправляет сигнал raw-preview. Вызывается из потоков предварительного просмотра. */
+static void
+hyscan_sonar_control_raw_preview_emit (gpointer                   channel,
+                                       HyScanSonarControlPreview *preview,
+                                       gpointer                   user_data)
+{
+  HyScanSonarModelChannel *raw = channel;
+
+  g_signal_emit (user_data, hyscan_sonar_control_signals[SIGNAL_RAW_PREVIEW], 0,
+                 raw->source, raw->channel, preview);
+}
+
+/* Функция отправляет сигнал acoustic-preview. Вызывается из потоков предварительного просмотра. */
+static void
+hyscan_sonar_control_acoustic_preview_emit (gpointer                   channel,
+                                            HyScanSonarControlPreview *preview,
+                                            gpointer                   user_data)
+{
+  HyScanSonarModelAcoustic *acoustic = channel;
+
+  g_signal_emit (user_data, hyscan_sonar_control_signals[SIGNAL_ACOUSTIC_PREVIEW], 0,
+                 acoustic->source, preview);
+}
+
+/* Функция обрабатывает сообщения с шумами от приёмных каналов гидролокатора. */
+static void
+hyscan_sonar_control_noise_data_receiver (HyScanSensorControl *control,
+                                          gpointer             channel,
+                                          HyScanSonarMessage  *message)
+{
+  HyScanSonarModelChannel *raw = channel;
+  HyScanRawDataInfo info;
+  HyScanDataWriterData data;
+
+  /* Данные. */
+  info = raw->info;
+  info.data.type = message->type;
+  info.data.rate = message->rate;
+  data.time = message->time;
+  data.size = message->size;
+  data.data = message->data;
+
+  hyscan_sensor_control_write (control, hyscan_sonar_control_noise_data_writer, raw, message);
+
+  g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_NOISE_DATA], 0,
+                 raw->source, raw->channel, &info, &data);
 }
 
 /* Функция обрабатывает сообщения с обработанными акустическимим данными от гидролокатора. */
 static void
-hyscan_sonar_control_acoustic_data_receiver (HyScanSonarControl *control,
-                                             HyScanSonarMessage *message)
+hyscan_sonar_control_acoustic_data_receiver (HyScanSensorControl *control,
+                                             gpointer             channel,
+                                             HyScanSonarMessage  *message)
 {
-  HyScanSonarControlAcoustic *acoustic;
+  HyScanSonarModelAcoustic *acoustic = channel;
   HyScanAcousticDataInfo info;
   HyScanDataWriterData data;
 
-  /* Ищем источник акустических данных. */
-  acoustic = g_hash_table_lookup (control->priv->acoustics, GINT_TO_POINTER (message->id));
-  if (acoustic == NULL)
-    return;
-
   /* Данные. */
   info = acoustic->info;
   info.data.type = message->type;
@@ -502,10 +614,82 @@ hyscan_sonar_control_acoustic_data_receiver (HyScanSonarControl *control,
   data.time = message->time;
   data.size = message->size;
   data.data = message->data;
-  hyscan_data_writer_acoustic_add_data (HYSCAN_DATA_WRITER (control), acoustic->source, &info, &data);
+
+  hyscan_sensor_control_write (control, hyscan_sonar_control_acoustic_data_writer, acoustic, message);
 
   g_signal_emit (control, hyscan_sonar_control_signals[SIGNAL_ACOUSTIC_DATA], 0,
                  acoustic->source, &info, &data);
+
+  /* Предварительный просмотр выполняется только при наличии обработчиков сигнала. */
+  if (g_signal_has_handler_pending (control, hyscan_sonar_control_signals[SIGNAL_ACOUSTIC_PREVIEW], 0, FALSE))
+    {
+      hyscan_ping_preview_add (HYSCAN_SONAR_CONTROL (control)->priv->acoustic_preview, acoustic,
+                               info.data.type, info.data.rate, 0, 1.0, &data);
+    }
+}
+
+/* Функция записывает "сырые" данные приёмного канала. Вызывается из потока записи данных. */
+static void
+hyscan_sonar_control_raw_data_writer (HyScanSensorControl *control,
+                                      gpointer             channel,
+                                      HyScanSonarMessage  *message)
+{
+  HyScanSonarModelChannel *raw = channel;
+  HyScanRawDataInfo info;
+  HyScanDataWriterData data;
+
+  info = raw->info;
+  info.data.type = message->type;
+  info.data.rate = message->rate;
+  data.time = message->time;
+  data.size = message->size;
+  data.data = message->data;
+
+  hyscan_data_writer_raw_add_data (HYSCAN_DATA_WRITER (control),
+                                   raw->source, raw->channel,
+                                   &info, &data);
+}
+
+/* Функция записывает шумы приёмного канала. Вызывается из потока записи данных. */
+static void
+hyscan_sonar_control_noise_data_writer (HyScanSensorControl *control,
+                                        gpointer             channel,
+                                        HyScanSonarMessage  *message)
+{
+  HyScanSonarModelChannel *raw = channel;
+  HyScanRawDataInfo info;
+  HyScanDataWriterData data;
+
+  info = raw->info;
+  info.data.type = message->type;
+  info.data.rate = message->rate;
+  data.time = message->time;
+  data.size = message->size;
+  data.data = message->data;
+
+  hyscan_data_writer_raw_add_noise (HYSCAN_DATA_WRITER (control),
+                                    raw->source, raw->channel,
+                                    &info, &data);
+}
+
+/* Функция записывает акустические данные. Вызывается из потока записи данных. */
+static void
+hyscan_sonar_control_acoustic_data_writer (HyScanSensorControl *control,
+                                           gpointer             channel,
+                                           HyScanSonarMessage  *message)
+{
+  HyScanSonarModelAcoustic *acoustic = channel;
+  HyScanAcousticDataInfo info;
+  HyScanDataWriterData data;
+
+  info = acoustic->info;
+  info.data.type = message->type;
+  info.data.rate = message->rate;
+  data.time = message->time;
+  data.size = message->size;
+  data.data = message->data;
+
+  hyscan_data_writer_acoustic_add_data (HYSCAN_DATA_WRITER (control), acoustic->source, &info, &data);
 }
 
 /* Функция возвращает схему гидролокатора. */
@@ -596,16 +780,18 @@ gdouble
 hyscan_sonar_control_get_max_receive_time (HyScanSonarControl *control,
                                            HyScanSourceType    source)
 {
-  gchar *param_name;
+  const HyScanSonarModelSource *sonar_source;
   gdouble max_receive_time;
   GVariant *value;
 
   g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), -1.0);
 
-  param_name = g_strdup_printf ("/sources/%s/control/receive-time",
-                                hyscan_control_get_source_name (source));
-  value = hyscan_data_schema_key_get_maximum (control->priv->schema, param_name);
-  g_free (param_name);
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if (sonar_source == NULL)
+    return -1.0;
+
+  value = hyscan_data_schema_key_get_maximum (control->priv->schema,
+                                              sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_RECEIVE_TIME]);
 
   if (value == NULL)
     return -1.0;
@@ -621,16 +807,18 @@ gboolean
 hyscan_sonar_control_get_auto_receive_time (HyScanSonarControl *control,
                                             HyScanSourceType    source)
 {
-  gchar *param_name;
+  const HyScanSonarModelSource *sonar_source;
   gdouble min_receive_time;
   GVariant *value;
 
   g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
 
-  param_name = g_strdup_printf ("/sources/%s/control/receive-time",
-                                hyscan_control_get_source_name (source));
-  value = hyscan_data_schema_key_get_minimum (control->priv->schema, param_name);
-  g_free (param_name);
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if (sonar_source == NULL)
+    return FALSE;
+
+  value = hyscan_data_schema_key_get_minimum (control->priv->schema,
+                                              sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_RECEIVE_TIME]);
 
   if (value == NULL)
     return FALSE;
@@ -660,23 +848,26 @@ hyscan_sonar_control_set_position (HyScanSonarControl    *control,
                                    HyScanSourceType       source,
                                    HyScanAntennaPosition *position)
 {
-  const gchar *source_name;
+  const HyScanSonarModelSource *sonar_source;
 
-  gchar *param_names[7];
+  const gchar *param_names[7];
   GVariant *param_values[7];
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
 
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if (sonar_source == NULL)
+    return FALSE;
+
   g_mutex_lock (&control->priv->lock);
 
-  source_name = hyscan_control_get_source_name (source);
-  param_names[0] = g_strdup_printf ("/sources/%s/position/x", source_name);
-  param_names[1] = g_strdup_printf ("/sources/%s/position/y", source_name);
-  param_names[2] = g_strdup_printf ("/sources/%s/position/z", source_name);
-  param_names[3] = g_strdup_printf ("/sources/%s/position/psi", source_name);
-  param_names[4] = g_strdup_printf ("/sources/%s/position/gamma", source_name);
-  param_names[5] = g_strdup_printf ("/sources/%s/position/theta", source_name);
+  param_names[0] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_X];
+  param_names[1] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_Y];
+  param_names[2] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_Z];
+  param_names[3] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_PSI];
+  param_names[4] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_GAMMA];
+  param_names[5] = sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_POSITION_THETA];
   param_names[6] = NULL;
 
   param_values[0] = g_variant_new_double (position->x);
@@ -687,7 +878,7 @@ hyscan_sonar_control_set_position (HyScanSonarControl    *control,
   param_values[5] = g_variant_new_double (position->theta);
   param_values[6] = NULL;
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -699,13 +890,6 @@ hyscan_sonar_control_set_position (HyScanSonarControl    *control,
       g_variant_unref (param_values[5]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-  g_free (param_names[3]);
-  g_free (param_names[4]);
-  g_free (param_names[5]);
-
   if (status)
     hyscan_data_writer_sonar_set_position (HYSCAN_DATA_WRITER (control), source, position);
 
@@ -720,17 +904,167 @@ hyscan_sonar_control_set_receive_time (HyScanSonarControl *control,
                                        HyScanSourceType    source,
                                        gdouble             receive_time)
 {
-  gchar *param_name;
-  gboolean status;
+  const HyScanSonarModelSource *sonar_source;
 
   g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
 
-  param_name = g_strdup_printf ("/sources/%s/control/receive-time",
-                                hyscan_control_get_source_name (source));
-  status = hyscan_param_set_double (control->priv->sonar, param_name, receive_time);
-  g_free (param_name);
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if (sonar_source == NULL)
+    return FALSE;
 
-  return status;
+  return hyscan_param_set_double (control->priv->sonar,
+                                  sonar_source->keys[HYSCAN_SONAR_MODEL_SOURCE_RECEIVE_TIME],
+                                  receive_time);
+}
+
+/* Функция задаёт режим коррекции данных по коэффициентам усиления ВАРУ. */
+void
+hyscan_sonar_control_set_tvg_compensation (HyScanSonarControl *control,
+                                           gboolean            remove)
+{
+  g_return_if_fail (HYSCAN_IS_SONAR_CONTROL (control));
+
+  if (control->priv->compensator == NULL)
+    return;
+
+  hyscan_tvg_compensator_set_remove (control->priv->compensator, remove);
+}
+
+/* Функция задаёт параметры предварительного просмотра данных. */
+void
+hyscan_sonar_control_set_preview (HyScanSonarControl *control,
+                                  guint32             width,
+                                  gdouble             period)
+{
+  g_return_if_fail (HYSCAN_IS_SONAR_CONTROL (control));
+
+  if (control->priv->raw_preview == NULL)
+    return;
+
+  hyscan_ping_preview_set_params (control->priv->raw_preview, width, period);
+  hyscan_ping_preview_set_params (control->priv->acoustic_preview, width, period);
+}
+
+/* Функция возвращает историю строк приёмного канала. */
+static HyScanPingHistory *
+hyscan_sonar_control_get_history (HyScanSonarControl *control,
+                                  HyScanSourceType    source,
+                                  guint               channel)
+{
+  const HyScanSonarModelSource *sonar_source;
+  GHashTable *history;
+
+  history = g_atomic_pointer_get (&control->priv->history);
+  if (history == NULL)
+    return NULL;
+
+  sonar_source = hyscan_sonar_model_get_source (control->priv->model, source);
+  if ((sonar_source == NULL) || (channel < 1) || (channel > sonar_source->n_channels))
+    return NULL;
+
+  return g_hash_table_lookup (history, &sonar_source->channels[channel - 1]);
+}
+
+/* Функция включает историю строк приёмных каналов. */
+gboolean
+hyscan_sonar_control_set_history (HyScanSonarControl *control,
+                                  guint               n_pings)
+{
+  HyScanSonarModel *model;
+  GHashTable *history;
+  guint i, j;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
+
+  model = control->priv->model;
+  if ((model == NULL) || (n_pings == 0))
+    return FALSE;
+
+  history = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)hyscan_ping_history_free);
+
+  for (i = 0; i < model->n_sources; i++)
+    {
+      HyScanSonarModelSource *sonar_source = &model->sources[i];
+
+      if (!sonar_source->has_antenna)
+        continue;
+
+      for (j = 0; j < sonar_source->n_channels; j++)
+        {
+          HyScanSonarModelChannel *channel = &sonar_source->channels[j];
+
+          if (channel->id != 0)
+            g_hash_table_insert (history, channel, hyscan_ping_history_new (n_pings));
+        }
+    }
+
+  /* История включается один раз, т.к. читатели обращаются к ней без блокировок. */
+  if (!g_atomic_pointer_compare_and_exchange (&control->priv->history, NULL, history))
+    {
+      g_hash_table_unref (history);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Функция возвращает номера самой старой и самой новой строки в истории канала. */
+gboolean
+hyscan_sonar_control_history_get_range (HyScanSonarControl *control,
+                                        HyScanSourceType    source,
+                                        guint               channel,
+                                        guint64            *first,
+                                        guint64            *last)
+{
+  HyScanPingHistory *history;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
+
+  history = hyscan_sonar_control_get_history (control, source, channel);
+  if (history == NULL)
+    return FALSE;
+
+  return hyscan_ping_history_get_range (history, first, last);
+}
+
+/* Функция ищет в истории канала самую новую строку, принятую не позднее указанного времени. */
+gboolean
+hyscan_sonar_control_history_find (HyScanSonarControl *control,
+                                   HyScanSourceType    source,
+                                   guint               channel,
+                                   gint64              time,
+                                   guint64            *index)
+{
+  HyScanPingHistory *history;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), FALSE);
+  g_return_val_if_fail (index != NULL, FALSE);
+
+  history = hyscan_sonar_control_get_history (control, source, channel);
+  if (history == NULL)
+    return FALSE;
+
+  return hyscan_ping_history_find (history, time, index);
+}
+
+/* Функция возвращает строку из истории канала. */
+GBytes *
+hyscan_sonar_control_history_get (HyScanSonarControl *control,
+                                  HyScanSourceType    source,
+                                  guint               channel,
+                                  guint64             index,
+                                  gint64             *time,
+                                  HyScanRawDataInfo  *info)
+{
+  HyScanPingHistory *history;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_CONTROL (control), NULL);
+
+  history = hyscan_sonar_control_get_history (control, source, channel);
+  if (history == NULL)
+    return NULL;
+
+  return hyscan_ping_history_get (history, index, time, info);
 }
 
 /* Функция переводит гидролокатор в рабочий режим и включает запись данных. */
@@ -747,6 +1081,9 @@ hyscan_sonar_control_start (HyScanSonarControl *control,
 
   g_mutex_lock (&control->priv->lock);
 
+  /* Данные из очереди записи относятся к предыдущему галсу. */
+  hyscan_sensor_control_write_flush (HYSCAN_SENSOR_CONTROL (control));
+
   if (hyscan_data_writer_start (HYSCAN_DATA_WRITER (control), track_name, track_type))
     {
       param_names[0] = "/control/track-name";
@@ -785,6 +1122,7 @@ hyscan_sonar_control_stop (HyScanSonarControl *control)
   g_mutex_lock (&control->priv->lock);
 
   status = hyscan_param_set_boolean (control->priv->sonar, "/control/enable", FALSE);
+  hyscan_sensor_control_write_flush (HYSCAN_SENSOR_CONTROL (control));
   hyscan_data_writer_stop (HYSCAN_DATA_WRITER (control));
 
   g_mutex_unlock (&control->priv->lock);
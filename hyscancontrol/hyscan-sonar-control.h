@@ -56,6 +56,30 @@
  * - info - параметры "сырых" гидролокационных данных;
  * - data - "сырые" гидролокационные данные.
  *
+ * Если к сигналу "raw-data-float" подключен хотя бы один обработчик, класс преобразовывает
+ * "сырые" данные в напряжение на входе АЦП и посылает этот сигнал после сигнала "raw-data".
+ * Прототип обработчика совпадает с обработчиком сигнала "raw-data". Данные передаются в формате
+ * HYSCAN_DATA_FLOAT или HYSCAN_DATA_COMPLEX_FLOAT, тип данных указывается в поле info->data.type,
+ * размер данных в байтах - в поле data->size. Преобразование выполняется один раз для всех
+ * обработчиков сигнала. Данные и параметры действительны только во время вызова обработчика.
+ *
+ * Если к сигналу "compressed-data" подключен хотя бы один обработчик, класс выполняет сжатие
+ * импульсов: свёртку "сырых" данных каждого приёмного канала с образом сигнала, излучённого
+ * источником данных (см. сигнал "signal-image" класса \link HyScanGeneratorControl \endlink).
+ * Свёртка выполняется в пуле потоков, сигнал "compressed-data" посылается из потоков обработки.
+ * Прототип обработчика совпадает с обработчиком сигнала "raw-data", данные передаются в формате
+ * HYSCAN_DATA_COMPLEX_FLOAT. Данные источников без образа сигнала не обрабатываются. Если
+ * обработка не успевает за приёмом данных, часть строк пропускается.
+ *
+ * Если к сигналу "corrected-data" подключен хотя бы один обработчик, класс корректирует
+ * "сырые" данные по коэффициентам усиления системы ВАРУ (см. сигнал "gains" класса
+ * \link HyScanTVGControl \endlink). Для каждой строки используются последние коэффициенты,
+ * установленные до её приёма, интерполированные к частоте дискретизации данных. Режим коррекции
+ * (компенсация или применение усиления) задаётся функцией #hyscan_sonar_control_set_tvg_compensation.
+ * Прототип обработчика совпадает с обработчиком сигнала "raw-data", данные передаются в формате
+ * HYSCAN_DATA_FLOAT или HYSCAN_DATA_COMPLEX_FLOAT. Данные каналов без коэффициентов усиления
+ * не обрабатываются.
+ *
  * При получении обработанных акустических данных от гидролокатора, класс посылает сигнал
  * "acoustic-data", в котором передаёт их пользователю. Прототип обработчика сигнала:
  *
@@ -75,6 +99,41 @@
  * - info - параметры акустических данных;
  * - data - акустические данные.
  *
+ * Класс может хранить историю последних строк "сырых" данных каждого приёмного канала.
+ * История включается функцией #hyscan_sonar_control_set_history. Номера строк в истории
+ * можно получить функциями #hyscan_sonar_control_history_get_range и
+ * #hyscan_sonar_control_history_find, а данные строк - функцией #hyscan_sonar_control_history_get.
+ * Чтение истории выполняется без блокировок и без копирования данных.
+ *
+ * Для отображения данных без обработки строк полного размера класс формирует их
+ * предварительный просмотр: огибающую заданной ширины и статистику строки
+ * (см. \link HyScanSonarControlPreview \endlink). Параметры предварительного просмотра
+ * задаются функцией #hyscan_sonar_control_set_preview. Обработка выполняется в пуле
+ * потоков только при наличии обработчиков сигналов "raw-preview" и "acoustic-preview".
+ * Сигналы посылаются из потоков обработки не чаще заданного интервала для каждого канала.
+ * Для комплексных данных огибающая строится по амплитуде. Прототипы обработчиков сигналов:
+ *
+ * \code
+ *
+ * void    raw_preview_cb        (HyScanSonarControl        *control,
+ *                                HyScanSourceType           source,
+ *                                guint                      channel,
+ *                                HyScanSonarControlPreview *preview,
+ *                                gpointer                   user_data);
+ *
+ * void    acoustic_preview_cb   (HyScanSonarControl        *control,
+ *                                HyScanSourceType           source,
+ *                                HyScanSonarControlPreview *preview,
+ *                                gpointer                   user_data);
+ *
+ * \endcode
+ *
+ * Где:
+ *
+ * - source - идентификатор источника данных;
+ * - channel - индекс канала данных;
+ * - preview - предварительный просмотр строки данных.
+ *
  * Класс HyScanSonarControl поддерживает работу в многопоточном режиме.
  *
  * Класс HyScanSonarControl реализует интерфейс \link HyScanParam \endlink для доступа к
@@ -99,6 +158,21 @@ typedef enum
   HYSCAN_SONAR_SYNC_SOFTWARE                   = (1 << 2)      /**< Программная синхронизация. */
 } HyScanSonarSyncType;
 
+/** \brief Предварительный просмотр строки данных. */
+typedef struct
+{
+  gint64                       time;                           /**< Время приёма данных. */
+  gdouble                      rate;                           /**< Частота дискретизации данных, Гц. */
+  guint32                      n_points;                       /**< Число точек в строке данных. */
+  guint32                      width;                          /**< Число точек огибающей. */
+  const gfloat                *min;                            /**< Минимальные значения на участках строки. */
+  const gfloat                *max;                            /**< Максимальные значения на участках строки. */
+  const gfloat                *mean;                           /**< Средние значения на участках строки. */
+  gfloat                       peak;                           /**< Максимальная амплитуда в строке. */
+  gfloat                       rms;                            /**< Среднеквадратичное значение амплитуды в строке. */
+  guint32                      n_saturated;                    /**< Число отсчётов АЦП на границах шкалы. */
+} HyScanSonarControlPreview;
+
 #define HYSCAN_TYPE_SONAR_CONTROL             (hyscan_sonar_control_get_type ())
 #define HYSCAN_SONAR_CONTROL(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), HYSCAN_TYPE_SONAR_CONTROL, HyScanSonarControl))
 #define HYSCAN_IS_SONAR_CONTROL(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), HYSCAN_TYPE_SONAR_CONTROL))
@@ -249,6 +323,123 @@ gboolean               hyscan_sonar_control_set_receive_time           (HyScanSo
                                                                         HyScanSourceType       source,
                                                                         gdouble                receive_time);
 
+/**
+ *
+ * Функция задаёт режим коррекции данных по коэффициентам усиления системы ВАРУ для
+ * сигнала "corrected-data". По умолчанию усиление ВАРУ компенсируется.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param remove TRUE - компенсировать усиление ВАРУ, FALSE - применить усиление ВАРУ.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_control_set_tvg_compensation       (HyScanSonarControl    *control,
+                                                                        gboolean               remove);
+
+/**
+ *
+ * Функция задаёт параметры предварительного просмотра данных для сигналов
+ * "raw-preview" и "acoustic-preview". Нулевая ширина огибающей отключает
+ * предварительный просмотр. По умолчанию предварительный просмотр отключен.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param width число точек огибающей;
+ * \param period минимальный интервал между строками одного канала, секунды.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_control_set_preview                (HyScanSonarControl    *control,
+                                                                        guint32                width,
+                                                                        gdouble                period);
+
+/**
+ *
+ * Функция включает историю строк "сырых" данных приёмных каналов. Для каждого
+ * приёмного канала сохраняется n_pings последних строк. История может быть
+ * включена только один раз, её размер не изменяется.
+ *
+ * Если управление выполняется через \link HyScanSonarClient \endlink, строки истории
+ * удерживают буферы принятых клиентом сообщений без копирования данных. В этом случае
+ * n_pings, умноженное на число приёмных каналов, должно быть заметно меньше числа
+ * буферов клиента, иначе клиенту не хватит буферов для приёма новых данных.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param n_pings число строк в истории каждого канала.
+ *
+ * \return TRUE - если история включена, FALSE - в случае ошибки или если история уже включена.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_control_set_history                (HyScanSonarControl    *control,
+                                                                        guint                  n_pings);
+
+/**
+ *
+ * Функция возвращает номера самой старой и самой новой строки в истории канала.
+ * Номера строк возрастают на единицу с каждой принятой строкой.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param source идентификатор источника данных;
+ * \param channel индекс канала данных;
+ * \param first номер самой старой строки или NULL;
+ * \param last номер самой новой строки или NULL.
+ *
+ * \return TRUE - если история содержит строки, FALSE - если строк нет или история не включена.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_control_history_get_range          (HyScanSonarControl    *control,
+                                                                        HyScanSourceType       source,
+                                                                        guint                  channel,
+                                                                        guint64               *first,
+                                                                        guint64               *last);
+
+/**
+ *
+ * Функция ищет в истории канала самую новую строку, принятую не позднее указанного времени.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param source идентификатор источника данных;
+ * \param channel индекс канала данных;
+ * \param time время, мкс;
+ * \param index номер найденной строки.
+ *
+ * \return TRUE - если строка найдена, FALSE - в противном случае.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_control_history_find               (HyScanSonarControl    *control,
+                                                                        HyScanSourceType       source,
+                                                                        guint                  channel,
+                                                                        gint64                 time,
+                                                                        guint64               *index);
+
+/**
+ *
+ * Функция возвращает строку "сырых" данных из истории канала. Данные не копируются,
+ * функция возвращает ссылку на них. Данные остаются доступными до освобождения
+ * ссылки, даже если строка будет замещена в истории.
+ *
+ * После использования, необходимо освободить ссылку функцией g_bytes_unref.
+ *
+ * \param control указатель на класс \link HyScanSonarControl \endlink;
+ * \param source идентификатор источника данных;
+ * \param channel индекс канала данных;
+ * \param index номер строки;
+ * \param time время приёма строки или NULL;
+ * \param info параметры "сырых" гидролокационных данных или NULL.
+ *
+ * \return Данные строки или NULL, если строка отсутствует в истории.
+ *
+ */
+HYSCAN_API
+GBytes                *hyscan_sonar_control_history_get                (HyScanSonarControl    *control,
+                                                                        HyScanSourceType       source,
+                                                                        guint                  channel,
+                                                                        guint64                index,
+                                                                        gint64                *time,
+                                                                        HyScanRawDataInfo     *info);
+
 /**
  *
  * Функция переводит гидролокатор в рабочий режим и включает запись данных.
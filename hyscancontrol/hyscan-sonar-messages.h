@@ -15,15 +15,36 @@
 
 G_BEGIN_DECLS
 
-/** \brief Сообщение от гидролокатора с данными */
+/**
+ * \brief Сообщение от гидролокатора с данными
+ *
+ * Если часть данных сообщения была потеряна при передаче, поле n_parts содержит
+ * число фрагментов, на которые разбивались данные. Каждому фрагменту соответствует
+ * бит в маске parts (бит i % 32 слова i / 32), установленный если фрагмент был
+ * принят. Данные непринятых фрагментов заполняются нулями. Для полных сообщений
+ * поле n_parts равно нулю, а поля part_size и parts не используются.
+ *
+ * Поле arrival_time заполняется клиентом при приёме сообщения и содержит время
+ * приёма последнего фрагмента сообщения сетевой подсистемой (UTC). Если система
+ * не поддерживает метки времени приёма датаграмм, используется время чтения
+ * фрагмента из сокета. Разность arrival_time и time даёт задержку передачи данных
+ * от гидролокатора, а сравнение arrival_time с текущим временем позволяет обнаружить
+ * устаревшие данные. При отправке сообщения это поле не используется.
+ *
+ */
 typedef struct
 {
   gint64                   time;               /**< Время приёма сообщения, мкс. */
+  gint64                   arrival_time;       /**< Время приёма сообщения клиентом, мкс. */
   guint32                  id;                 /**< Идентификатор источника сообщения. */
   guint32                  type;               /**< Тип данных - \link HyScanDataType \endlink. */
   gfloat                   rate;               /**< Частота дискретизации данных, Гц. */
   guint32                  size;               /**< Размер данных, в байтах. */
   gconstpointer            data;               /**< Данные. */
+
+  guint32                  n_parts;            /**< Число фрагментов неполного сообщения или 0 для полного. */
+  guint32                  part_size;          /**< Размер одного фрагмента, в байтах. */
+  const guint32           *parts;              /**< Битовая маска принятых фрагментов. */
 } HyScanSonarMessage;
 
 G_END_DECLS
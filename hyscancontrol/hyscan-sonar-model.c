@@ -0,0 +1,634 @@
+/*
+ * \file hyscan-sonar-model.c
+ *
+ * \brief Исходный файл описания гидролокатора для классов управления
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-sonar-model.h"
+#include "hyscan-control-common.h"
+
+#define HYSCAN_SONAR_MODEL_DATA_KEY            "hyscan-sonar-model"
+
+/* Названия параметров относительно пути к описанию порта. */
+static const gchar *hyscan_sonar_model_port_keys[HYSCAN_SONAR_MODEL_PORT_N_KEYS] =
+{
+  "/status",
+  "/enable",
+  "/protocol",
+  "/channel",
+  "/time-offset",
+  "/uart-device",
+  "/uart-mode",
+  "/ip-address",
+  "/udp-port",
+  "/position/x",
+  "/position/y",
+  "/position/z",
+  "/position/psi",
+  "/position/gamma",
+  "/position/theta"
+};
+
+/* Названия параметров относительно пути к описанию генератора. */
+static const gchar *hyscan_sonar_model_generator_keys[HYSCAN_SONAR_MODEL_GENERATOR_N_KEYS] =
+{
+  "/enable",
+  "/preset/id",
+  "/auto/signal",
+  "/simple/signal",
+  "/simple/power",
+  "/tone/duration",
+  "/tone/power",
+  "/lfm/decreasing",
+  "/lfm/duration",
+  "/lfm/power"
+};
+
+/* Названия параметров относительно пути к описанию системы ВАРУ. */
+static const gchar *hyscan_sonar_model_tvg_keys[HYSCAN_SONAR_MODEL_TVG_N_KEYS] =
+{
+  "/enable",
+  "/auto/level",
+  "/auto/sensitivity",
+  "/constant/gain",
+  "/linear-db/gain0",
+  "/linear-db/step",
+  "/logarithmic/gain0",
+  "/logarithmic/beta",
+  "/logarithmic/alpha"
+};
+
+/* Названия параметров относительно пути к описанию источника данных. */
+static const gchar *hyscan_sonar_model_source_keys[HYSCAN_SONAR_MODEL_SOURCE_N_KEYS] =
+{
+  "/control/receive-time",
+  "/position/x",
+  "/position/y",
+  "/position/z",
+  "/position/psi",
+  "/position/gamma",
+  "/position/theta"
+};
+
+/* Функция формирует названия параметров. Названия помещаются в пул строк GLib,
+ * одинаковые названия разных описаний гидролокатора совпадают. */
+static void
+hyscan_sonar_model_make_keys (const gchar        **keys,
+                              const gchar         *path,
+                              const gchar *const  *suffixes,
+                              guint                n_keys)
+{
+  guint i;
+
+  for (i = 0; i < n_keys; i++)
+    {
+      gchar *name = g_strconcat (path, suffixes[i], NULL);
+
+      keys[i] = g_intern_string (name);
+      g_free (name);
+    }
+}
+
+/* Функция возвращает узел схемы с указанным путём. */
+static HyScanDataSchemaNode *
+hyscan_sonar_model_find_node (HyScanDataSchemaNode *params,
+                              const gchar          *path)
+{
+  guint i;
+
+  for (i = 0; i < params->n_nodes; i++)
+    {
+      if (g_strcmp0 (params->nodes[i]->path, path) == 0)
+        return params->nodes[i];
+    }
+
+  return NULL;
+}
+
+/* Функция возвращает число приёмных каналов источника данных. Приёмные каналы
+ * определяются по схеме гидролокатора. */
+static guint
+hyscan_sonar_model_count_channels (HyScanDataSchema *schema,
+                                   const gchar      *path)
+{
+  guint n_channels;
+
+  for (n_channels = 0; TRUE; n_channels++)
+    {
+      gchar *prefix;
+      gboolean has_channel;
+
+      prefix = g_strdup_printf ("%s/channels/%d", path, n_channels + 1);
+      has_channel = hyscan_control_has_param (schema, prefix, "/id");
+      g_free (prefix);
+
+      if (!has_channel)
+        break;
+    }
+
+  return n_channels;
+}
+
+/* Функция проверяет идентификатор и версию схемы гидролокатора. */
+static gboolean
+hyscan_sonar_model_check_schema (HyScanParam *sonar)
+{
+  const gchar *names[] = { "/schema/id", "/schema/version", NULL };
+  GVariant *values[2] = { NULL, NULL };
+  gboolean status = FALSE;
+
+  gint64 version;
+  gint64 id;
+
+  if (!hyscan_param_get (sonar, names, values))
+    {
+      g_warning ("HyScanControl: unknown sonar schema id");
+      return FALSE;
+    }
+
+  if (!hyscan_control_find_integer_param ("/schema/id", names, values, &id))
+    g_warning ("HyScanControl: unknown sonar schema id");
+  else if (id != HYSCAN_SONAR_SCHEMA_ID)
+    g_warning ("HyScanControl: sonar schema id mismatch");
+  else if (!hyscan_control_find_integer_param ("/schema/version", names, values, &version))
+    g_warning ("HyScanControl: unknown sonar schema version");
+  else if ((version / 100) != (HYSCAN_SONAR_SCHEMA_VERSION / 100))
+    g_warning ("HyScanControl: sonar schema version mismatch");
+  else
+    status = TRUE;
+
+  g_clear_pointer (&values[0], g_variant_unref);
+  g_clear_pointer (&values[1], g_variant_unref);
+
+  return status;
+}
+
+/* Функция считывает описание порта для подключения датчиков. */
+static gboolean
+hyscan_sonar_model_parse_port (HyScanSonarModelPort *port,
+                               GHashTable           *values,
+                               const gchar          *path)
+{
+  gchar **pathv;
+
+  gint64 id;
+  gint64 type;
+  gint64 protocol;
+
+  if (!hyscan_control_lookup_integer_param (values, path, "/id", &id) ||
+      !hyscan_control_lookup_integer_param (values, path, "/type", &type) ||
+      !hyscan_control_lookup_integer_param (values, path, "/protocol", &protocol))
+    {
+      return FALSE;
+    }
+
+  if (id <= 0 || id > G_MAXINT32)
+    return FALSE;
+
+  if (type != HYSCAN_SENSOR_PORT_VIRTUAL &&
+      type != HYSCAN_SENSOR_PORT_UART &&
+      type != HYSCAN_SENSOR_PORT_UDP_IP)
+    {
+      return FALSE;
+    }
+
+  if (protocol != HYSCAN_SENSOR_PROTOCOL_SAS &&
+      protocol != HYSCAN_SENSOR_PROTOCOL_NMEA_0183)
+    {
+      return FALSE;
+    }
+
+  pathv = g_strsplit (path, "/", -1);
+  port->name = g_strdup (pathv[2]);
+  g_strfreev (pathv);
+
+  port->id = id;
+  port->path = g_strdup (path);
+  port->type = type;
+  port->protocol = protocol;
+
+  hyscan_sonar_model_make_keys (port->keys, path, hyscan_sonar_model_port_keys,
+                                HYSCAN_SONAR_MODEL_PORT_N_KEYS);
+
+  return TRUE;
+}
+
+/* Функция считывает описание приёмного канала. */
+static void
+hyscan_sonar_model_parse_channel (HyScanSonarModelSource  *source,
+                                  HyScanSonarModelChannel *channel,
+                                  GHashTable              *values,
+                                  const gchar             *prefix)
+{
+  gint64 data_id;
+  gint64 noise_id;
+  gint64 tvg_id;
+  gdouble antenna_voffset;
+  gdouble antenna_hoffset;
+  gint64 adc_offset;
+  gdouble adc_vref;
+
+  /* Идентификатор ВАРУ канала. */
+  if (hyscan_control_lookup_integer_param (values, prefix, "/tvg/id", &tvg_id) &&
+      (tvg_id > 0) && (tvg_id <= G_MAXINT32))
+    {
+      channel->tvg_id = tvg_id;
+    }
+
+  /* Параметры "сырых" данных. */
+  if (!hyscan_control_lookup_integer_param (values, prefix, "/id", &data_id) ||
+      !hyscan_control_lookup_integer_param (values, prefix, "/noise/id", &noise_id) ||
+      !hyscan_control_lookup_double_param (values, prefix, "/antenna/offset/vertical", &antenna_voffset) ||
+      !hyscan_control_lookup_double_param (values, prefix, "/antenna/offset/horizontal", &antenna_hoffset) ||
+      !hyscan_control_lookup_integer_param (values, prefix, "/adc/offset", &adc_offset) ||
+      !hyscan_control_lookup_double_param (values, prefix, "/adc/vref", &adc_vref))
+    {
+      return;
+    }
+
+  if (data_id <= 0 || data_id > G_MAXINT32)
+    return;
+
+  if (noise_id <= 0 || noise_id > G_MAXINT32)
+    return;
+
+  channel->id = data_id;
+  channel->noise_id = noise_id;
+  channel->info.adc.offset = adc_offset;
+  channel->info.adc.vref = adc_vref;
+  channel->info.antenna.offset.vertical = antenna_voffset;
+  channel->info.antenna.offset.horizontal = antenna_hoffset;
+  channel->info.antenna.pattern.vertical = source->acoustic.info.antenna.pattern.vertical;
+  channel->info.antenna.pattern.horizontal = source->acoustic.info.antenna.pattern.horizontal;
+}
+
+/* Функция считывает описание источника данных. */
+static gboolean
+hyscan_sonar_model_parse_source (HyScanSonarModelSource *source,
+                                 HyScanDataSchema       *schema,
+                                 GHashTable             *values,
+                                 const gchar            *path)
+{
+  gchar **pathv;
+  guint i;
+
+  gint64 id;
+  gint64 capabilities;
+  gint64 signals;
+
+  gdouble antenna_vpattern;
+  gdouble antenna_hpattern;
+  gdouble antenna_frequency;
+  gdouble antenna_bandwidth;
+
+  /* Тип источника данных. */
+  pathv = g_strsplit (path, "/", -1);
+  source->source = hyscan_control_get_source_type (pathv[2]);
+  g_strfreev (pathv);
+
+  if (source->source == HYSCAN_SOURCE_INVALID)
+    return FALSE;
+
+  source->path = g_strdup (path);
+  hyscan_sonar_model_make_keys (source->keys, path, hyscan_sonar_model_source_keys,
+                                HYSCAN_SONAR_MODEL_SOURCE_N_KEYS);
+
+  source->generator.source = source->source;
+  source->tvg.source = source->source;
+  source->acoustic.source = source->source;
+
+  /* Генератор. */
+  if (hyscan_control_lookup_integer_param (values, path, "/generator/id", &id) &&
+      hyscan_control_lookup_integer_param (values, path, "/generator/capabilities", &capabilities) &&
+      hyscan_control_lookup_integer_param (values, path, "/generator/signals", &signals) &&
+      (id > 0) && (id <= G_MAXINT32))
+    {
+      source->generator.id = id;
+      source->generator.path = g_strdup_printf ("%s/generator", path);
+      source->generator.capabilities = capabilities;
+      source->generator.signals = signals;
+
+      hyscan_sonar_model_make_keys (source->generator.keys, source->generator.path,
+                                    hyscan_sonar_model_generator_keys,
+                                    HYSCAN_SONAR_MODEL_GENERATOR_N_KEYS);
+    }
+
+  /* Система ВАРУ. */
+  if (hyscan_control_lookup_integer_param (values, path, "/tvg/id", &id) &&
+      hyscan_control_lookup_integer_param (values, path, "/tvg/capabilities", &capabilities) &&
+      (id > 0) && (id <= G_MAXINT32))
+    {
+      source->tvg.id = id;
+      source->tvg.path = g_strdup_printf ("%s/tvg", path);
+      source->tvg.capabilities = capabilities;
+
+      hyscan_sonar_model_make_keys (source->tvg.keys, source->tvg.path,
+                                    hyscan_sonar_model_tvg_keys,
+                                    HYSCAN_SONAR_MODEL_TVG_N_KEYS);
+    }
+
+  /* Параметры антенны. */
+  if (hyscan_control_lookup_double_param (values, path, "/antenna/pattern/vertical", &antenna_vpattern) &&
+      hyscan_control_lookup_double_param (values, path, "/antenna/pattern/horizontal", &antenna_hpattern) &&
+      hyscan_control_lookup_double_param (values, path, "/antenna/frequency", &antenna_frequency) &&
+      hyscan_control_lookup_double_param (values, path, "/antenna/bandwidth", &antenna_bandwidth))
+    {
+      source->has_antenna = TRUE;
+      source->acoustic.info.antenna.pattern.vertical = antenna_vpattern;
+      source->acoustic.info.antenna.pattern.horizontal = antenna_hpattern;
+
+      /* Акустические данные. */
+      if (hyscan_control_lookup_integer_param (values, path, "/acoustic/id", &id) &&
+          (id > 0) && (id <= G_MAXINT32))
+        {
+          source->acoustic.id = id;
+        }
+    }
+
+  /* Приёмные каналы. */
+  source->n_channels = hyscan_sonar_model_count_channels (schema, path);
+  source->channels = g_new0 (HyScanSonarModelChannel, source->n_channels);
+  for (i = 0; i < source->n_channels; i++)
+    {
+      HyScanSonarModelChannel *channel = &source->channels[i];
+      gchar *prefix;
+
+      channel->source = source->source;
+      channel->channel = i + 1;
+
+      if (source->has_antenna)
+        {
+          channel->info.antenna.frequency = antenna_frequency;
+          channel->info.antenna.bandwidth = antenna_bandwidth;
+        }
+
+      prefix = g_strdup_printf ("%s/channels/%d", path, i + 1);
+      hyscan_sonar_model_parse_channel (source, channel, values, prefix);
+      g_free (prefix);
+
+      /* Без параметров антенны "сырые" данные не принимаются. */
+      if (!source->has_antenna)
+        {
+          channel->id = 0;
+          channel->noise_id = 0;
+        }
+    }
+
+  return TRUE;
+}
+
+/* Функция считывает описание гидролокатора. Все описательные параметры
+ * считываются одним запросом. */
+static HyScanSonarModel *
+hyscan_sonar_model_parse (HyScanParam *sonar,
+                          gboolean    *complete)
+{
+  HyScanSonarModel *model;
+  HyScanDataSchemaNode *params;
+  HyScanDataSchemaNode *sensors;
+  HyScanDataSchemaNode *sources;
+  GPtrArray *names;
+  GHashTable *values;
+
+  gint64 sync_capabilities;
+  guint i, j;
+
+  if (!hyscan_sonar_model_check_schema (sonar))
+    return NULL;
+
+  model = g_new0 (HyScanSonarModel, 1);
+  model->ref_count = 1;
+
+  /* Параметры гидролокатора. */
+  model->schema = hyscan_param_schema (sonar);
+  params = hyscan_data_schema_list_nodes (model->schema);
+
+  /* Ветки схемы с описанием портов - "/sensors" и источников данных - "/sources". */
+  sensors = hyscan_sonar_model_find_node (params, "/sensors");
+  sources = hyscan_sonar_model_find_node (params, "/sources");
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  hyscan_control_add_param (names, model->schema, "/sync", "/capabilities");
+  hyscan_control_add_param (names, model->schema, "/control", "/timeout");
+
+  for (i = 0; (sensors != NULL) && (i < sensors->n_nodes); i++)
+    {
+      const gchar *path = sensors->nodes[i]->path;
+
+      hyscan_control_add_param (names, model->schema, path, "/id");
+      hyscan_control_add_param (names, model->schema, path, "/type");
+      hyscan_control_add_param (names, model->schema, path, "/protocol");
+    }
+
+  for (i = 0; (sources != NULL) && (i < sources->n_nodes); i++)
+    {
+      const gchar *path = sources->nodes[i]->path;
+      guint n_channels;
+
+      hyscan_control_add_param (names, model->schema, path, "/generator/id");
+      hyscan_control_add_param (names, model->schema, path, "/generator/capabilities");
+      hyscan_control_add_param (names, model->schema, path, "/generator/signals");
+      hyscan_control_add_param (names, model->schema, path, "/tvg/id");
+      hyscan_control_add_param (names, model->schema, path, "/tvg/capabilities");
+      hyscan_control_add_param (names, model->schema, path, "/antenna/pattern/vertical");
+      hyscan_control_add_param (names, model->schema, path, "/antenna/pattern/horizontal");
+      hyscan_control_add_param (names, model->schema, path, "/antenna/frequency");
+      hyscan_control_add_param (names, model->schema, path, "/antenna/bandwidth");
+      hyscan_control_add_param (names, model->schema, path, "/acoustic/id");
+
+      n_channels = hyscan_sonar_model_count_channels (model->schema, path);
+      for (j = 1; j <= n_channels; j++)
+        {
+          gchar *prefix = g_strdup_printf ("%s/channels/%d", path, j);
+
+          hyscan_control_add_param (names, model->schema, prefix, "/id");
+          hyscan_control_add_param (names, model->schema, prefix, "/noise/id");
+          hyscan_control_add_param (names, model->schema, prefix, "/tvg/id");
+          hyscan_control_add_param (names, model->schema, prefix, "/antenna/offset/vertical");
+          hyscan_control_add_param (names, model->schema, prefix, "/antenna/offset/horizontal");
+          hyscan_control_add_param (names, model->schema, prefix, "/adc/offset");
+          hyscan_control_add_param (names, model->schema, prefix, "/adc/vref");
+
+          g_free (prefix);
+        }
+    }
+
+  values = hyscan_control_get_params (sonar, names);
+  g_ptr_array_unref (names);
+
+  /* Ошибка считывания - описание гидролокатора неполное. */
+  *complete = (values != NULL);
+  if (values == NULL)
+    values = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Доступные методы синхронизации излучения. */
+  if (hyscan_control_lookup_integer_param (values, "/sync", "/capabilities", &sync_capabilities))
+    model->sync_capabilities = sync_capabilities;
+
+  /* Интервал сигнала alive. */
+  model->has_alive = hyscan_control_lookup_double_param (values, "/control", "/timeout", &model->alive_timeout);
+
+  /* Порты для подключения датчиков. */
+  if (sensors != NULL)
+    {
+      model->ports = g_new0 (HyScanSonarModelPort, sensors->n_nodes);
+      for (i = 0; i < sensors->n_nodes; i++)
+        {
+          HyScanSonarModelPort *port = &model->ports[model->n_ports];
+
+          if (hyscan_sonar_model_parse_port (port, values, sensors->nodes[i]->path))
+            model->n_ports += 1;
+        }
+    }
+
+  /* Источники данных. */
+  if (sources != NULL)
+    {
+      model->sources = g_new0 (HyScanSonarModelSource, sources->n_nodes);
+      for (i = 0; i < sources->n_nodes; i++)
+        {
+          HyScanSonarModelSource *source = &model->sources[model->n_sources];
+
+          if (hyscan_sonar_model_parse_source (source, model->schema, values, sources->nodes[i]->path))
+            model->n_sources += 1;
+        }
+    }
+
+  g_hash_table_unref (values);
+  hyscan_data_schema_free_nodes (params);
+
+  return model;
+}
+
+/* Функция увеличивает счётчик ссылок на описание гидролокатора, сохранённое
+ * в объекте sonar. Вызывается под блокировкой данных объекта. */
+static gpointer
+hyscan_sonar_model_dup (gpointer model,
+                        gpointer user_data)
+{
+  if (model == NULL)
+    return NULL;
+
+  return hyscan_sonar_model_ref (model);
+}
+
+/* Функция возвращает описание гидролокатора. Описание сохраняется в объекте
+ * sonar, если оно было считано полностью. Считывание и разбор описания
+ * выполняются без блокировок. Если несколько потоков одновременно считали
+ * описание, в объекте сохраняется первое из них, остальные освобождаются. */
+HyScanSonarModel *
+hyscan_sonar_model_new (HyScanParam *sonar)
+{
+  HyScanSonarModel *model;
+  gboolean complete;
+
+  g_return_val_if_fail (HYSCAN_IS_PARAM (sonar), NULL);
+
+  model = g_object_dup_data (G_OBJECT (sonar), HYSCAN_SONAR_MODEL_DATA_KEY,
+                             hyscan_sonar_model_dup, NULL);
+  if (model != NULL)
+    return model;
+
+  model = hyscan_sonar_model_parse (sonar, &complete);
+  if ((model == NULL) || !complete)
+    return model;
+
+  /* Описание сохраняется, только если другой поток не сделал этого раньше. */
+  if (g_object_replace_data (G_OBJECT (sonar), HYSCAN_SONAR_MODEL_DATA_KEY,
+                             NULL, model, (GDestroyNotify)hyscan_sonar_model_unref, NULL))
+    {
+      return hyscan_sonar_model_ref (model);
+    }
+
+  hyscan_sonar_model_unref (model);
+
+  return g_object_dup_data (G_OBJECT (sonar), HYSCAN_SONAR_MODEL_DATA_KEY,
+                            hyscan_sonar_model_dup, NULL);
+}
+
+/* Функция увеличивает счётчик ссылок на описание гидролокатора. */
+HyScanSonarModel *
+hyscan_sonar_model_ref (HyScanSonarModel *model)
+{
+  g_atomic_int_inc (&model->ref_count);
+
+  return model;
+}
+
+/* Функция уменьшает счётчик ссылок на описание гидролокатора. */
+void
+hyscan_sonar_model_unref (HyScanSonarModel *model)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&model->ref_count))
+    return;
+
+  for (i = 0; i < model->n_ports; i++)
+    {
+      g_free (model->ports[i].name);
+      g_free (model->ports[i].path);
+    }
+
+  for (i = 0; i < model->n_sources; i++)
+    {
+      g_free (model->sources[i].path);
+      g_free (model->sources[i].generator.path);
+      g_free (model->sources[i].tvg.path);
+      g_free (model->sources[i].channels);
+    }
+
+  g_free (model->ports);
+  g_free (model->sources);
+  g_object_unref (model->schema);
+  g_free (model);
+}
+
+/* Функция возвращает описание источника данных. */
+const HyScanSonarModelSource *
+hyscan_sonar_model_get_source (HyScanSonarModel *model,
+                               HyScanSourceType  source)
+{
+  guint i;
+
+  if (model == NULL)
+    return NULL;
+
+  for (i = 0; i < model->n_sources; i++)
+    {
+      if (model->sources[i].source == source)
+        return &model->sources[i];
+    }
+
+  return NULL;
+}
+
+/* Функция возвращает описание генератора источника данных. */
+const HyScanSonarModelGenerator *
+hyscan_sonar_model_get_generator (HyScanSonarModel *model,
+                                  HyScanSourceType  source)
+{
+  const HyScanSonarModelSource *info = hyscan_sonar_model_get_source (model, source);
+
+  if ((info == NULL) || (info->generator.id == 0))
+    return NULL;
+
+  return &info->generator;
+}
+
+/* Функция возвращает описание системы ВАРУ источника данных. */
+const HyScanSonarModelTVG *
+hyscan_sonar_model_get_tvg (HyScanSonarModel *model,
+                            HyScanSourceType  source)
+{
+  const HyScanSonarModelSource *info = hyscan_sonar_model_get_source (model, source);
+
+  if ((info == NULL) || (info->tvg.id == 0))
+    return NULL;
+
+  return &info->tvg;
+}
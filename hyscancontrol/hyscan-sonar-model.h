@@ -0,0 +1,211 @@
+/*
+ * \file hyscan-sonar-model.h
+ *
+ * \brief Заголовочный файл описания гидролокатора для классов управления
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * Описание гидролокатора содержит источники данных, приёмные каналы, генераторы,
+ * системы ВАРУ и порты для подключения датчиков с их идентификаторами и путями к
+ * параметрам в схеме. Описание считывается из гидролокатора один раз и используется
+ * всеми классами управления: HyScanSensorControl, HyScanGeneratorControl,
+ * HyScanTVGControl и HyScanSonarControl. Описание не изменяется после создания и
+ * может использоваться из нескольких потоков без блокировок.
+ *
+ * Описание сохраняется в объекте интерфейса управления гидролокатором, поэтому
+ * объекты управления, созданные для одного гидролокатора, используют одно описание.
+ *
+ * Названия параметров портов, генераторов, систем ВАРУ и источников данных
+ * формируются при создании описания и хранятся в пуле строк GLib (g_intern_string).
+ * Функции управления используют готовые названия по индексам из перечислений
+ * HyScanSonarModel*Key и не формируют строк при каждом вызове.
+ *
+ */
+
+#ifndef __HYSCAN_SONAR_MODEL_H__
+#define __HYSCAN_SONAR_MODEL_H__
+
+#include <hyscan-param.h>
+#include <hyscan-core-types.h>
+#include <hyscan-sonar-control.h>
+
+/* Параметры порта для подключения датчиков. */
+typedef enum
+{
+  HYSCAN_SONAR_MODEL_PORT_STATUS,                              /* Состояние порта. */
+  HYSCAN_SONAR_MODEL_PORT_ENABLE,                              /* Включение порта. */
+  HYSCAN_SONAR_MODEL_PORT_PROTOCOL,                            /* Протокол передачи данных. */
+  HYSCAN_SONAR_MODEL_PORT_CHANNEL,                             /* Номер канала данных. */
+  HYSCAN_SONAR_MODEL_PORT_TIME_OFFSET,                         /* Коррекция времени. */
+  HYSCAN_SONAR_MODEL_PORT_UART_DEVICE,                         /* UART устройство. */
+  HYSCAN_SONAR_MODEL_PORT_UART_MODE,                           /* Режим работы UART устройства. */
+  HYSCAN_SONAR_MODEL_PORT_IP_ADDRESS,                          /* IP адрес. */
+  HYSCAN_SONAR_MODEL_PORT_UDP_PORT,                            /* UDP порт. */
+  HYSCAN_SONAR_MODEL_PORT_POSITION_X,                          /* Местоположение антенны. */
+  HYSCAN_SONAR_MODEL_PORT_POSITION_Y,
+  HYSCAN_SONAR_MODEL_PORT_POSITION_Z,
+  HYSCAN_SONAR_MODEL_PORT_POSITION_PSI,
+  HYSCAN_SONAR_MODEL_PORT_POSITION_GAMMA,
+  HYSCAN_SONAR_MODEL_PORT_POSITION_THETA,
+  HYSCAN_SONAR_MODEL_PORT_N_KEYS
+} HyScanSonarModelPortKey;
+
+/* Параметры генератора. */
+typedef enum
+{
+  HYSCAN_SONAR_MODEL_GENERATOR_ENABLE,                         /* Включение генератора. */
+  HYSCAN_SONAR_MODEL_GENERATOR_PRESET_ID,                      /* Преднастройка. */
+  HYSCAN_SONAR_MODEL_GENERATOR_AUTO_SIGNAL,                    /* Сигнал в автоматическом режиме. */
+  HYSCAN_SONAR_MODEL_GENERATOR_SIMPLE_SIGNAL,                  /* Сигнал в упрощённом режиме. */
+  HYSCAN_SONAR_MODEL_GENERATOR_SIMPLE_POWER,                   /* Энергия сигнала в упрощённом режиме. */
+  HYSCAN_SONAR_MODEL_GENERATOR_TONE_DURATION,                  /* Длительность тонального сигнала. */
+  HYSCAN_SONAR_MODEL_GENERATOR_TONE_POWER,                     /* Энергия тонального сигнала. */
+  HYSCAN_SONAR_MODEL_GENERATOR_LFM_DECREASING,                 /* Признак уменьшения частоты ЛЧМ сигнала. */
+  HYSCAN_SONAR_MODEL_GENERATOR_LFM_DURATION,                   /* Длительность ЛЧМ сигнала. */
+  HYSCAN_SONAR_MODEL_GENERATOR_LFM_POWER,                      /* Энергия ЛЧМ сигнала. */
+  HYSCAN_SONAR_MODEL_GENERATOR_N_KEYS
+} HyScanSonarModelGeneratorKey;
+
+/* Параметры системы ВАРУ. */
+typedef enum
+{
+  HYSCAN_SONAR_MODEL_TVG_ENABLE,                               /* Включение системы ВАРУ. */
+  HYSCAN_SONAR_MODEL_TVG_AUTO_LEVEL,                           /* Целевой уровень сигнала. */
+  HYSCAN_SONAR_MODEL_TVG_AUTO_SENSITIVITY,                     /* Чувствительность автомата ВАРУ. */
+  HYSCAN_SONAR_MODEL_TVG_CONSTANT_GAIN,                        /* Постоянный уровень усиления. */
+  HYSCAN_SONAR_MODEL_TVG_LINEAR_DB_GAIN0,                      /* Начальный уровень усиления линейного закона. */
+  HYSCAN_SONAR_MODEL_TVG_LINEAR_DB_STEP,                       /* Шаг усиления линейного закона. */
+  HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_GAIN0,                    /* Начальный уровень усиления логарифмического закона. */
+  HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_BETA,                     /* Коэффициент отражения цели. */
+  HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_ALPHA,                    /* Коэффициент затухания. */
+  HYSCAN_SONAR_MODEL_TVG_N_KEYS
+} HyScanSonarModelTVGKey;
+
+/* Параметры источника данных. */
+typedef enum
+{
+  HYSCAN_SONAR_MODEL_SOURCE_RECEIVE_TIME,                      /* Время приёма эхосигнала. */
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_X,                        /* Местоположение антенны. */
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_Y,
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_Z,
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_PSI,
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_GAMMA,
+  HYSCAN_SONAR_MODEL_SOURCE_POSITION_THETA,
+  HYSCAN_SONAR_MODEL_SOURCE_N_KEYS
+} HyScanSonarModelSourceKey;
+
+/* Описание порта для подключения датчиков. */
+typedef struct
+{
+  guint32                      id;                             /* Идентификатор источника данных. */
+  gchar                       *name;                           /* Название порта. */
+  gchar                       *path;                           /* Путь к описанию порта в схеме. */
+  HyScanSensorPortType         type;                           /* Тип порта. */
+  HyScanSensorProtocolType     protocol;                       /* Начальный протокол передачи данных. */
+  const gchar                 *keys[HYSCAN_SONAR_MODEL_PORT_N_KEYS]; /* Названия параметров. */
+} HyScanSonarModelPort;
+
+/* Описание генератора. Генератор отсутствует, если id равен нулю. */
+typedef struct
+{
+  HyScanSourceType             source;                         /* Тип источника данных. */
+  guint32                      id;                             /* Идентификатор образов сигналов. */
+  gchar                       *path;                           /* Путь к описанию генератора в схеме. */
+  HyScanGeneratorModeType      capabilities;                   /* Режимы работы. */
+  HyScanGeneratorSignalType    signals;                        /* Возможные сигналы. */
+  const gchar                 *keys[HYSCAN_SONAR_MODEL_GENERATOR_N_KEYS]; /* Названия параметров. */
+} HyScanSonarModelGenerator;
+
+/* Описание системы ВАРУ. Система ВАРУ отсутствует, если id равен нулю. */
+typedef struct
+{
+  HyScanSourceType             source;                         /* Тип источника данных. */
+  guint32                      id;                             /* Идентификатор системы ВАРУ. */
+  gchar                       *path;                           /* Путь к описанию системы ВАРУ в схеме. */
+  HyScanTVGModeType            capabilities;                   /* Режимы работы системы ВАРУ. */
+  const gchar                 *keys[HYSCAN_SONAR_MODEL_TVG_N_KEYS]; /* Названия параметров. */
+} HyScanSonarModelTVG;
+
+/* Описание приёмного канала. Нулевые идентификаторы означают отсутствие
+ * или ошибку описания соответствующих данных. */
+typedef struct
+{
+  HyScanSourceType             source;                         /* Тип источника данных. */
+  guint                        channel;                        /* Индекс приёмного канала. */
+  guint32                      id;                             /* Идентификатор "сырых" данных. */
+  guint32                      noise_id;                       /* Идентификатор шумов. */
+  guint32                      tvg_id;                         /* Идентификатор ВАРУ канала. */
+  HyScanRawDataInfo            info;                           /* Параметры "сырых" гидролокационных данных. */
+} HyScanSonarModelChannel;
+
+/* Описание акустических данных. Данные отсутствуют, если id равен нулю. */
+typedef struct
+{
+  HyScanSourceType             source;                         /* Тип источника данных. */
+  guint32                      id;                             /* Идентификатор акустических данных. */
+  HyScanAcousticDataInfo       info;                           /* Параметры акустических данных. */
+} HyScanSonarModelAcoustic;
+
+/* Описание источника данных. */
+typedef struct
+{
+  HyScanSourceType             source;                         /* Тип источника данных. */
+  gchar                       *path;                           /* Путь к описанию источника в схеме. */
+  gboolean                     has_antenna;                    /* Признак наличия параметров антенны. */
+  const gchar                 *keys[HYSCAN_SONAR_MODEL_SOURCE_N_KEYS]; /* Названия параметров. */
+
+  HyScanSonarModelGenerator    generator;                      /* Генератор. */
+  HyScanSonarModelTVG          tvg;                            /* Система ВАРУ. */
+  HyScanSonarModelAcoustic     acoustic;                       /* Акустические данные. */
+
+  guint                        n_channels;                     /* Число приёмных каналов. */
+  HyScanSonarModelChannel     *channels;                       /* Приёмные каналы. */
+} HyScanSonarModelSource;
+
+/* Описание гидролокатора. */
+typedef struct
+{
+  gint                         ref_count;                      /* Число ссылок на описание. */
+  HyScanDataSchema            *schema;                         /* Схема параметров гидролокатора. */
+
+  HyScanSonarSyncType          sync_capabilities;              /* Доступные методы синхронизации излучения. */
+  gboolean                     has_alive;                      /* Признак наличия сигнала alive. */
+  gdouble                      alive_timeout;                  /* Интервал сигнала alive. */
+
+  guint                        n_ports;                        /* Число портов. */
+  HyScanSonarModelPort        *ports;                          /* Порты для подключения датчиков. */
+
+  guint                        n_sources;                      /* Число источников данных. */
+  HyScanSonarModelSource      *sources;                        /* Источники данных. */
+} HyScanSonarModel;
+
+/* Функция возвращает описание гидролокатора. Описание считывается при первом
+ * обращении и сохраняется в объекте sonar. Функция возвращает NULL, если
+ * схема гидролокатора не поддерживается. */
+HyScanSonarModel              *hyscan_sonar_model_new          (HyScanParam                   *sonar);
+
+/* Функция увеличивает счётчик ссылок на описание гидролокатора. */
+HyScanSonarModel              *hyscan_sonar_model_ref          (HyScanSonarModel              *model);
+
+/* Функция уменьшает счётчик ссылок на описание гидролокатора. */
+void                           hyscan_sonar_model_unref        (HyScanSonarModel              *model);
+
+/* Функция возвращает описание источника данных или NULL. */
+const HyScanSonarModelSource  *hyscan_sonar_model_get_source   (HyScanSonarModel              *model,
+                                                                HyScanSourceType               source);
+
+/* Функция возвращает описание генератора источника данных или NULL. */
+const HyScanSonarModelGenerator *hyscan_sonar_model_get_generator
+                                                               (HyScanSonarModel              *model,
+                                                                HyScanSourceType               source);
+
+/* Функция возвращает описание системы ВАРУ источника данных или NULL. */
+const HyScanSonarModelTVG     *hyscan_sonar_model_get_tvg      (HyScanSonarModel              *model,
+                                                                HyScanSourceType               source);
+
+/* Функция возвращает описание гидролокатора, используемое объектом управления,
+ * или NULL. Ссылка на описание не увеличивается. */
+HyScanSonarModel              *hyscan_sensor_control_get_model (HyScanSensorControl           *control);
+
+#endif /* __HYSCAN_SONAR_MODEL_H__ */
@@ -0,0 +1,473 @@
+/*
+ * \file hyscan-sonar-receiver.c
+ *
+ * \brief Исходный файл общего приёмника данных клиентов гидролокаторов
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-sonar-receiver.h"
+
+enum
+{
+  PROP_O,
+  PROP_N_WORKERS
+};
+
+/* Подключение. Структура используется источниками событий цикла обработки,
+ * поэтому освобождается после удаления обоих источников. */
+typedef struct
+{
+  gint                 ref_count;              /* Счётчик ссылок. */
+  GMutex               lock;                   /* Блокировка вызова функции обработки. */
+  gboolean             active;                 /* Признак активного подключения. */
+
+  HyScanSonarReceiverFunc func;                /* Функция обработки событий подключения. */
+  gpointer             data;                   /* Пользовательские данные. */
+
+  GSource             *socket_source;          /* Источник событий сокета. */
+  GSource             *timer_source;           /* Источник событий таймера. */
+} HyScanSonarReceiverConnection;
+
+typedef struct
+{
+  gpointer             owner;                  /* Владелец задания. */
+  HyScanSonarReceiverJobFunc func;             /* Функция выполнения задания. */
+  gpointer             data;                   /* Данные задания. */
+} HyScanSonarReceiverJob;
+
+typedef struct
+{
+  HyScanSonarReceiverPrivate *priv;            /* Приёмник. */
+  GThread             *thread;                 /* Поток доставки. */
+
+  GMutex               lock;                   /* Блокировка очереди заданий. */
+  GCond                cond;                   /* Сигнализатор изменения очереди заданий. */
+  GQueue               jobs;                   /* Очередь заданий. */
+  gpointer             owner;                  /* Владелец выполняемого задания. */
+} HyScanSonarReceiverWorker;
+
+struct _HyScanSonarReceiverPrivate
+{
+  GMainContext        *context;                /* Контекст цикла обработки событий. */
+  GThread             *thread;                 /* Поток приёма. */
+
+  GMutex               lock;                   /* Блокировка списка подключений. */
+  GHashTable          *connections;            /* Подключения. */
+  guint                next_id;                /* Идентификатор следующего подключения. */
+
+  guint                n_workers;              /* Число потоков доставки. */
+  HyScanSonarReceiverWorker *workers;          /* Потоки доставки. */
+  gint                 shutdown;               /* Признак необходимости завершения работы. */
+};
+
+static void     hyscan_sonar_receiver_set_property     (GObject               *object,
+                                                        guint                  prop_id,
+                                                        const GValue          *value,
+                                                        GParamSpec            *pspec);
+static void     hyscan_sonar_receiver_object_constructed
+                                                       (GObject               *object);
+static void     hyscan_sonar_receiver_object_finalize  (GObject               *object);
+
+static gpointer hyscan_sonar_receiver_loop             (gpointer               data);
+static gpointer hyscan_sonar_receiver_worker           (gpointer               data);
+
+static void     hyscan_sonar_receiver_connection_unref (gpointer               data);
+static gboolean hyscan_sonar_receiver_dispatch         (HyScanSonarReceiverConnection *connection);
+static gboolean hyscan_sonar_receiver_socket_cb        (GSocket               *socket,
+                                                        GIOCondition           condition,
+                                                        gpointer               data);
+static gboolean hyscan_sonar_receiver_timer_dispatch   (GSource               *source,
+                                                        GSourceFunc            callback,
+                                                        gpointer               data);
+
+/* Источник событий таймера. Срабатывает только по заданному времени. */
+static GSourceFuncs hyscan_sonar_receiver_timer_funcs =
+{
+  NULL,
+  NULL,
+  hyscan_sonar_receiver_timer_dispatch,
+  NULL
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (HyScanSonarReceiver, hyscan_sonar_receiver, G_TYPE_OBJECT)
+
+static void
+hyscan_sonar_receiver_class_init (HyScanSonarReceiverClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->set_property = hyscan_sonar_receiver_set_property;
+
+  object_class->constructed = hyscan_sonar_receiver_object_constructed;
+  object_class->finalize = hyscan_sonar_receiver_object_finalize;
+
+  g_object_class_install_property (object_class, PROP_N_WORKERS,
+    g_param_spec_uint ("n-workers", "NWorkers", "Number of message delivery threads",
+                       HYSCAN_SONAR_RECEIVER_MIN_N_WORKERS,
+                       HYSCAN_SONAR_RECEIVER_MAX_N_WORKERS,
+                       HYSCAN_SONAR_RECEIVER_DEFAULT_N_WORKERS,
+                       G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY));
+}
+
+static void
+hyscan_sonar_receiver_init (HyScanSonarReceiver *receiver)
+{
+  receiver->priv = hyscan_sonar_receiver_get_instance_private (receiver);
+}
+
+static void
+hyscan_sonar_receiver_set_property (GObject      *object,
+                                    guint         prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  HyScanSonarReceiver *receiver = HYSCAN_SONAR_RECEIVER (object);
+  HyScanSonarReceiverPrivate *priv = receiver->priv;
+
+  switch (prop_id)
+    {
+    case PROP_N_WORKERS:
+      priv->n_workers = g_value_get_uint (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+hyscan_sonar_receiver_object_constructed (GObject *object)
+{
+  HyScanSonarReceiver *receiver = HYSCAN_SONAR_RECEIVER (object);
+  HyScanSonarReceiverPrivate *priv = receiver->priv;
+
+  guint i;
+
+  G_OBJECT_CLASS (hyscan_sonar_receiver_parent_class)->constructed (object);
+
+  g_mutex_init (&priv->lock);
+  priv->connections = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->next_id = 1;
+
+  /* Поток приёма. */
+  priv->context = g_main_context_new ();
+  priv->thread = g_thread_new ("sonar-receiver", hyscan_sonar_receiver_loop, priv);
+
+  /* Потоки доставки. */
+  priv->workers = g_new0 (HyScanSonarReceiverWorker, priv->n_workers);
+  for (i = 0; i < priv->n_workers; i++)
+    {
+      HyScanSonarReceiverWorker *worker = &priv->workers[i];
+
+      worker->priv = priv;
+      g_mutex_init (&worker->lock);
+      g_cond_init (&worker->cond);
+      g_queue_init (&worker->jobs);
+      worker->thread = g_thread_new ("sonar-receiver-worker", hyscan_sonar_receiver_worker, worker);
+    }
+}
+
+static void
+hyscan_sonar_receiver_object_finalize (GObject *object)
+{
+  HyScanSonarReceiver *receiver = HYSCAN_SONAR_RECEIVER (object);
+  HyScanSonarReceiverPrivate *priv = receiver->priv;
+
+  HyScanSonarReceiverJob *job;
+  guint i;
+
+  /* Клиенты удерживают ссылку на приёмник, поэтому к этому моменту
+   * все подключения уже удалены. */
+  g_atomic_int_set (&priv->shutdown, 1);
+  g_main_context_wakeup (priv->context);
+  g_thread_join (priv->thread);
+
+  for (i = 0; i < priv->n_workers; i++)
+    {
+      HyScanSonarReceiverWorker *worker = &priv->workers[i];
+
+      g_mutex_lock (&worker->lock);
+      g_cond_broadcast (&worker->cond);
+      g_mutex_unlock (&worker->lock);
+
+      g_thread_join (worker->thread);
+
+      while ((job = g_queue_pop_head (&worker->jobs)) != NULL)
+        g_free (job);
+      g_cond_clear (&worker->cond);
+      g_mutex_clear (&worker->lock);
+    }
+  g_free (priv->workers);
+
+  g_main_context_unref (priv->context);
+
+  g_hash_table_unref (priv->connections);
+  g_mutex_clear (&priv->lock);
+
+  G_OBJECT_CLASS (hyscan_sonar_receiver_parent_class)->finalize (object);
+}
+
+/* Поток приёма. */
+static gpointer
+hyscan_sonar_receiver_loop (gpointer data)
+{
+  HyScanSonarReceiverPrivate *priv = data;
+
+  g_main_context_push_thread_default (priv->context);
+  while (g_atomic_int_get (&priv->shutdown) != 1)
+    g_main_context_iteration (priv->context, TRUE);
+  g_main_context_pop_thread_default (priv->context);
+
+  return NULL;
+}
+
+/* Поток доставки. Поток ожидает заданий без ограничения времени и
+ * пробуждается только при их поступлении или завершении работы. */
+static gpointer
+hyscan_sonar_receiver_worker (gpointer data)
+{
+  HyScanSonarReceiverWorker *worker = data;
+  HyScanSonarReceiverPrivate *priv = worker->priv;
+
+  g_mutex_lock (&worker->lock);
+
+  while (g_atomic_int_get (&priv->shutdown) != 1)
+    {
+      HyScanSonarReceiverJob *job;
+
+      job = g_queue_pop_head (&worker->jobs);
+      if (job == NULL)
+        {
+          g_cond_wait (&worker->cond, &worker->lock);
+          continue;
+        }
+
+      worker->owner = job->owner;
+      g_mutex_unlock (&worker->lock);
+
+      job->func (job->owner, job->data);
+      g_free (job);
+
+      g_mutex_lock (&worker->lock);
+      worker->owner = NULL;
+      g_cond_broadcast (&worker->cond);
+    }
+
+  g_mutex_unlock (&worker->lock);
+
+  return NULL;
+}
+
+/* Функция освобождает ссылку на подключение. */
+static void
+hyscan_sonar_receiver_connection_unref (gpointer data)
+{
+  HyScanSonarReceiverConnection *connection = data;
+
+  if (!g_atomic_int_dec_and_test (&connection->ref_count))
+    return;
+
+  g_mutex_clear (&connection->lock);
+  g_free (connection);
+}
+
+/* Функция вызывает функцию обработки событий подключения и переустанавливает
+ * таймер подключения. */
+static gboolean
+hyscan_sonar_receiver_dispatch (HyScanSonarReceiverConnection *connection)
+{
+  gint64 ready_time;
+
+  g_mutex_lock (&connection->lock);
+
+  if (connection->active)
+    {
+      ready_time = connection->func (connection->data, g_get_monotonic_time ());
+      g_source_set_ready_time (connection->timer_source, ready_time);
+    }
+
+  g_mutex_unlock (&connection->lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Функция обработки событий сокета. */
+static gboolean
+hyscan_sonar_receiver_socket_cb (GSocket      *socket,
+                                 GIOCondition  condition,
+                                 gpointer      data)
+{
+  return hyscan_sonar_receiver_dispatch (data);
+}
+
+/* Функция обработки событий таймера. */
+static gboolean
+hyscan_sonar_receiver_timer_dispatch (GSource     *source,
+                                      GSourceFunc  callback,
+                                      gpointer     data)
+{
+  g_source_set_ready_time (source, -1);
+
+  return callback (data);
+}
+
+/* Функция создаёт новый объект HyScanSonarReceiver. */
+HyScanSonarReceiver *
+hyscan_sonar_receiver_new (guint n_workers)
+{
+  n_workers = CLAMP (n_workers, HYSCAN_SONAR_RECEIVER_MIN_N_WORKERS, HYSCAN_SONAR_RECEIVER_MAX_N_WORKERS);
+
+  return g_object_new (HYSCAN_TYPE_SONAR_RECEIVER, "n-workers", n_workers, NULL);
+}
+
+/* Функция добавляет сокет в список опрашиваемых. */
+guint
+hyscan_sonar_receiver_attach (HyScanSonarReceiver     *receiver,
+                              GSocket                 *socket,
+                              HyScanSonarReceiverFunc  func,
+                              gpointer                 data)
+{
+  HyScanSonarReceiverPrivate *priv;
+  HyScanSonarReceiverConnection *connection;
+  guint id;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_RECEIVER (receiver), 0);
+  g_return_val_if_fail (G_IS_SOCKET (socket), 0);
+
+  priv = receiver->priv;
+
+  connection = g_new0 (HyScanSonarReceiverConnection, 1);
+  connection->ref_count = 2;
+  connection->active = TRUE;
+  connection->func = func;
+  connection->data = data;
+  g_mutex_init (&connection->lock);
+
+  /* Источник событий сокета вызывает функцию с сигнатурой GSocketSourceFunc,
+   * приведение выполняется через указатель на функцию без аргументов. */
+  connection->socket_source = g_socket_create_source (socket, G_IO_IN, NULL);
+  g_source_set_callback (connection->socket_source, (GSourceFunc)(void (*)(void))hyscan_sonar_receiver_socket_cb,
+                         connection, hyscan_sonar_receiver_connection_unref);
+
+  connection->timer_source = g_source_new (&hyscan_sonar_receiver_timer_funcs, sizeof (GSource));
+  g_source_set_callback (connection->timer_source, (GSourceFunc)hyscan_sonar_receiver_dispatch,
+                         connection, hyscan_sonar_receiver_connection_unref);
+
+  g_mutex_lock (&priv->lock);
+  id = priv->next_id++;
+  g_hash_table_insert (priv->connections, GUINT_TO_POINTER (id), connection);
+  g_mutex_unlock (&priv->lock);
+
+  g_source_attach (connection->socket_source, priv->context);
+  g_source_attach (connection->timer_source, priv->context);
+
+  return id;
+}
+
+/* Функция исключает сокет из списка опрашиваемых. */
+void
+hyscan_sonar_receiver_detach (HyScanSonarReceiver *receiver,
+                              guint                id)
+{
+  HyScanSonarReceiverPrivate *priv;
+  HyScanSonarReceiverConnection *connection;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_RECEIVER (receiver));
+
+  priv = receiver->priv;
+
+  g_mutex_lock (&priv->lock);
+  connection = g_hash_table_lookup (priv->connections, GUINT_TO_POINTER (id));
+  g_hash_table_remove (priv->connections, GUINT_TO_POINTER (id));
+  g_mutex_unlock (&priv->lock);
+
+  if (connection == NULL)
+    return;
+
+  /* Дожидаемся завершения выполняемой функции обработки. */
+  g_mutex_lock (&connection->lock);
+  connection->active = FALSE;
+  g_mutex_unlock (&connection->lock);
+
+  g_source_destroy (connection->socket_source);
+  g_source_destroy (connection->timer_source);
+  g_source_unref (connection->socket_source);
+  g_source_unref (connection->timer_source);
+}
+
+/* Функция передаёт задание в поток доставки. */
+void
+hyscan_sonar_receiver_deliver (HyScanSonarReceiver        *receiver,
+                               gpointer                    owner,
+                               guint32                     key,
+                               HyScanSonarReceiverJobFunc  func,
+                               gpointer                    data)
+{
+  HyScanSonarReceiverPrivate *priv;
+  HyScanSonarReceiverWorker *worker;
+  HyScanSonarReceiverJob *job;
+  guint hash;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_RECEIVER (receiver));
+
+  priv = receiver->priv;
+
+  job = g_new (HyScanSonarReceiverJob, 1);
+  job->owner = owner;
+  job->func = func;
+  job->data = data;
+
+  hash = g_direct_hash (owner) ^ key;
+  worker = &priv->workers[hash % priv->n_workers];
+
+  g_mutex_lock (&worker->lock);
+  g_queue_push_tail (&worker->jobs, job);
+  g_cond_broadcast (&worker->cond);
+  g_mutex_unlock (&worker->lock);
+}
+
+/* Функция отменяет задания владельца. */
+void
+hyscan_sonar_receiver_cancel (HyScanSonarReceiver *receiver,
+                              gpointer             owner,
+                              GDestroyNotify       destroy)
+{
+  HyScanSonarReceiverPrivate *priv;
+  guint i;
+
+  g_return_if_fail (HYSCAN_IS_SONAR_RECEIVER (receiver));
+
+  priv = receiver->priv;
+
+  for (i = 0; i < priv->n_workers; i++)
+    {
+      HyScanSonarReceiverWorker *worker = &priv->workers[i];
+      GList *link;
+      GList *next;
+
+      g_mutex_lock (&worker->lock);
+
+      for (link = worker->jobs.head; link != NULL; link = next)
+        {
+          HyScanSonarReceiverJob *job = link->data;
+
+          next = link->next;
+          if (job->owner != owner)
+            continue;
+
+          g_queue_delete_link (&worker->jobs, link);
+          if (destroy != NULL)
+            destroy (job->data);
+          g_free (job);
+        }
+
+      while (worker->owner == owner)
+        g_cond_wait (&worker->cond, &worker->lock);
+
+      g_mutex_unlock (&worker->lock);
+    }
+}
@@ -0,0 +1,204 @@
+/**
+ * \file hyscan-sonar-receiver.h
+ *
+ * \brief Заголовочный файл общего приёмника данных клиентов гидролокаторов
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * \defgroup HyScanSonarReceiver HyScanSonarReceiver - общий приёмник данных клиентов гидролокаторов
+ *
+ * Каждый клиент \link HyScanSonarClient \endlink по умолчанию использует собственный
+ * поток приёма данных и собственные потоки доставки сообщений. При подключении к
+ * нескольким гидролокаторам число таких потоков растёт, при этом большую часть времени
+ * они простаивают. HyScanSonarReceiver позволяет нескольким клиентам использовать
+ * общие потоки приёма и доставки данных.
+ *
+ * Приём данных всех клиентов выполняется одним потоком, в котором работает цикл
+ * обработки событий GMainContext. Сокеты клиентов опрашиваются совместно, поток
+ * просыпается только при поступлении пакетов и на время ожидания недостающих
+ * фрагментов сообщений, поэтому в отсутствие данных процессорное время не расходуется.
+ * Состояние сборки сообщений хранится отдельно для каждого клиента.
+ *
+ * Доставка сообщений выполняется общим пулом потоков, их число задаётся при создании
+ * объекта функцией #hyscan_sonar_receiver_new. Задания одного источника данных
+ * клиента всегда выполняются одним потоком в порядке их поступления.
+ *
+ * Приёмник передаётся клиенту в свойстве "receiver" при его создании:
+ *
+ * \code
+ *
+ * receiver = hyscan_sonar_receiver_new (HYSCAN_SONAR_RECEIVER_DEFAULT_N_WORKERS);
+ * client = g_initable_new (HYSCAN_TYPE_SONAR_CLIENT, NULL, NULL,
+ *                          "host", host,
+ *                          "receiver", receiver,
+ *                          NULL);
+ *
+ * \endcode
+ *
+ * Клиент удерживает ссылку на приёмник, поэтому объект приёмника можно освободить
+ * сразу после создания клиентов. Функции #hyscan_sonar_receiver_attach,
+ * #hyscan_sonar_receiver_detach, #hyscan_sonar_receiver_deliver и
+ * #hyscan_sonar_receiver_cancel используются клиентами и не предназначены
+ * для прямого вызова.
+ *
+ */
+
+#ifndef __HYSCAN_SONAR_RECEIVER_H__
+#define __HYSCAN_SONAR_RECEIVER_H__
+
+#include <gio/gio.h>
+#include <hyscan-api.h>
+
+G_BEGIN_DECLS
+
+#define HYSCAN_SONAR_RECEIVER_MIN_N_WORKERS     1      /**< Минимальное число потоков доставки
+                                                        *   сообщений - 1. */
+#define HYSCAN_SONAR_RECEIVER_MAX_N_WORKERS     16     /**< Максимальное число потоков доставки
+                                                        *   сообщений - 16. */
+#define HYSCAN_SONAR_RECEIVER_DEFAULT_N_WORKERS 2      /**< Число потоков доставки сообщений по
+                                                        *   умолчанию - 2. */
+
+#define HYSCAN_TYPE_SONAR_RECEIVER             (hyscan_sonar_receiver_get_type ())
+#define HYSCAN_SONAR_RECEIVER(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), HYSCAN_TYPE_SONAR_RECEIVER, HyScanSonarReceiver))
+#define HYSCAN_IS_SONAR_RECEIVER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), HYSCAN_TYPE_SONAR_RECEIVER))
+#define HYSCAN_SONAR_RECEIVER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), HYSCAN_TYPE_SONAR_RECEIVER, HyScanSonarReceiverClass))
+#define HYSCAN_IS_SONAR_RECEIVER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), HYSCAN_TYPE_SONAR_RECEIVER))
+#define HYSCAN_SONAR_RECEIVER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), HYSCAN_TYPE_SONAR_RECEIVER, HyScanSonarReceiverClass))
+
+typedef struct _HyScanSonarReceiver HyScanSonarReceiver;
+typedef struct _HyScanSonarReceiverPrivate HyScanSonarReceiverPrivate;
+typedef struct _HyScanSonarReceiverClass HyScanSonarReceiverClass;
+
+/**
+ *
+ * Функция обработки событий подключения. Вызывается в потоке приёма при поступлении
+ * данных в сокет и по истечении заданного ранее времени.
+ *
+ * \param data пользовательские данные;
+ * \param cur_time текущее время, g_get_monotonic_time.
+ *
+ * \return Время следующего вызова функции (g_get_monotonic_time) или -1,
+ *         если вызов требуется только при поступлении данных.
+ *
+ */
+typedef gint64 (*HyScanSonarReceiverFunc)      (gpointer               data,
+                                                gint64                 cur_time);
+
+/**
+ *
+ * Функция выполнения задания в потоке доставки.
+ *
+ * \param owner владелец задания;
+ * \param data данные задания.
+ *
+ */
+typedef void   (*HyScanSonarReceiverJobFunc)   (gpointer               owner,
+                                                gpointer               data);
+
+struct _HyScanSonarReceiver
+{
+  GObject parent_instance;
+
+  HyScanSonarReceiverPrivate *priv;
+};
+
+struct _HyScanSonarReceiverClass
+{
+  GObjectClass parent_class;
+};
+
+HYSCAN_API
+GType                  hyscan_sonar_receiver_get_type  (void);
+
+/**
+ *
+ * Функция создаёт новый объект \link HyScanSonarReceiver \endlink и запускает
+ * поток приёма и потоки доставки сообщений.
+ *
+ * \param n_workers число потоков доставки сообщений.
+ *
+ * \return Указатель на объект \link HyScanSonarReceiver \endlink.
+ *
+ */
+HYSCAN_API
+HyScanSonarReceiver   *hyscan_sonar_receiver_new       (guint                  n_workers);
+
+/**
+ *
+ * Функция добавляет сокет в список опрашиваемых потоком приёма. Функция func
+ * вызывается при поступлении данных в сокет и в момент времени, который она
+ * вернула при предыдущем вызове. Функция должна считывать данные из сокета
+ * без блокировки.
+ *
+ * \param receiver указатель на объект \link HyScanSonarReceiver \endlink;
+ * \param socket сокет приёма данных;
+ * \param func функция обработки событий подключения;
+ * \param data пользовательские данные для функции func.
+ *
+ * \return Идентификатор подключения.
+ *
+ */
+HYSCAN_API
+guint                  hyscan_sonar_receiver_attach    (HyScanSonarReceiver   *receiver,
+                                                        GSocket               *socket,
+                                                        HyScanSonarReceiverFunc func,
+                                                        gpointer               data);
+
+/**
+ *
+ * Функция исключает сокет из списка опрашиваемых. После возврата из функции
+ * функция обработки событий подключения больше не вызывается.
+ *
+ * \param receiver указатель на объект \link HyScanSonarReceiver \endlink;
+ * \param id идентификатор подключения.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_receiver_detach    (HyScanSonarReceiver   *receiver,
+                                                        guint                  id);
+
+/**
+ *
+ * Функция передаёт задание в поток доставки. Поток выбирается по владельцу
+ * задания и ключу, поэтому задания с одинаковыми владельцем и ключом
+ * выполняются в порядке их поступления.
+ *
+ * \param receiver указатель на объект \link HyScanSonarReceiver \endlink;
+ * \param owner владелец задания;
+ * \param key ключ задания, например идентификатор источника данных;
+ * \param func функция выполнения задания;
+ * \param data данные задания.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_receiver_deliver   (HyScanSonarReceiver   *receiver,
+                                                        gpointer               owner,
+                                                        guint32                key,
+                                                        HyScanSonarReceiverJobFunc func,
+                                                        gpointer               data);
+
+/**
+ *
+ * Функция отменяет все невыполненные задания владельца и дожидается завершения
+ * выполняемых. Для данных отменённых заданий вызывается функция destroy.
+ *
+ * \param receiver указатель на объект \link HyScanSonarReceiver \endlink;
+ * \param owner владелец заданий;
+ * \param destroy функция освобождения данных задания или NULL.
+ *
+ * \return Нет.
+ *
+ */
+HYSCAN_API
+void                   hyscan_sonar_receiver_cancel    (HyScanSonarReceiver   *receiver,
+                                                        gpointer               owner,
+                                                        GDestroyNotify         destroy);
+
+G_END_DECLS
+
+#endif /* __HYSCAN_SONAR_RECEIVER_H__ */
@@ -1301,6 +1301,37 @@ exit:
   return id;
 }
 
+/* Функция добавляет в схему максимальный размер сообщения источника данных. */
+gboolean
+hyscan_sonar_schema_source_set_max_size (HyScanSonarSchema *schema,
+                                         HyScanSourceType   source,
+                                         guint32            max_size)
+{
+  HyScanDataSchemaBuilder *builder;
+  const gchar *source_name;
+  gboolean status;
+  gchar *key_id;
+
+  g_return_val_if_fail (HYSCAN_IS_SONAR_SCHEMA (schema), FALSE);
+
+  builder = HYSCAN_DATA_SCHEMA_BUILDER (schema);
+
+  source_name = hyscan_control_get_source_name (source);
+  if (source_name == NULL)
+    return FALSE;
+
+  if (!g_hash_table_contains (schema->priv->sources, GINT_TO_POINTER (source)))
+    return FALSE;
+
+  key_id = g_strdup_printf ("/sources/%s/data/max-size", source_name);
+  status = hyscan_data_schema_builder_key_integer_create (builder, key_id, "max-size", NULL, max_size);
+  if (status)
+    status = hyscan_data_schema_builder_key_set_access (builder, key_id, HYSCAN_DATA_SCHEMA_ACCESS_READONLY);
+  g_free (key_id);
+
+  return status;
+}
+
 /* Функция добавляет в схему описание источника "акустических" данных. */
 gint
 hyscan_sonar_schema_source_add_acoustic (HyScanSonarSchema *schema,
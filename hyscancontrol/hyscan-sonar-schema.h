@@ -29,6 +29,7 @@
  * - #hyscan_sonar_schema_generator_add_preset - функция добавляет вариант значения преднастройки генератора;
  * - #hyscan_sonar_schema_tvg_add - функция добавляет в схему описание системы ВАРУ;
  * - #hyscan_sonar_schema_channel_add - функция добавляет в схему описание приёмного канала гидролокатора;
+ * - #hyscan_sonar_schema_source_set_max_size - функция задаёт максимальный размер сообщения источника данных;
  * - #hyscan_sonar_schema_source_add_acuostic - функция добавляет в схему описание источника акустических данных;
  *
  */
@@ -277,6 +278,25 @@ gint                   hyscan_sonar_schema_channel_add                 (HyScanSo
                                                                         gint                           adc_offset,
                                                                         gfloat                         adc_vref);
 
+/**
+ *
+ * Функция добавляет в схему максимальный размер одного сообщения с данными
+ * источника. Размер используется клиентом для заблаговременного выделения
+ * буферов сборки сообщений, см. #hyscan_sonar_client_warm_up. Описание
+ * источника данных должно быть добавлено в схему до вызова этой функции.
+ *
+ * \param schema указатель на объект \link HyScanSonarSchema \endlink;
+ * \param source тип источника данных;
+ * \param max_size максимальный размер сообщения, байт.
+ *
+ * \return TRUE - если размер добавлен в схему, иначе FALSE.
+ *
+ */
+HYSCAN_API
+gboolean               hyscan_sonar_schema_source_set_max_size         (HyScanSonarSchema             *schema,
+                                                                        HyScanSourceType               source,
+                                                                        guint32                        max_size);
+
 /**
  *
  * Функция добавляет в схему описание источника "акустических" данных.
@@ -0,0 +1,316 @@
+/*
+ * \file hyscan-tvg-compensator.c
+ *
+ * \brief Исходный файл коррекции "сырых" данных по коэффициентам усиления ВАРУ
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ */
+
+#include "hyscan-tvg-compensator.h"
+#include "hyscan-adc-convert.h"
+
+#include <string.h>
+#include <math.h>
+
+/* Максимальное число сохраняемых коэффициентов усиления для канала. */
+#define HYSCAN_TVG_COMPENSATOR_MAX_CURVES      8
+
+/* Коэффициенты усиления ВАРУ. */
+typedef struct
+{
+  volatile gint                ref_count;                      /* Число ссылок на объект. */
+  gint64                       time;                           /* Время установки коэффициентов. */
+  gdouble                      rate;                           /* Частота следования коэффициентов. */
+  guint32                      n_gains;                        /* Число коэффициентов. */
+  gfloat                      *gains;                          /* Коэффициенты усиления, дБ. */
+} HyScanTVGCompensatorCurve;
+
+/* Состояние коррекции приёмного канала. */
+typedef struct
+{
+  GQueue                       curves;                         /* Последние коэффициенты усиления. */
+
+  HyScanTVGCompensatorCurve   *factors_curve;                  /* Коэффициенты, по которым рассчитаны множители. */
+  gdouble                      factors_rate;                   /* Частота дискретизации данных. */
+  gboolean                     factors_complex;                /* Признак комплексных данных. */
+  gboolean                     factors_remove;                 /* Режим коррекции. */
+  GArray                      *factors;                        /* Множители для каждого значения строки. */
+
+  GArray                      *values;                         /* Буфер скорректированных данных. */
+} HyScanTVGCompensatorChannel;
+
+struct _HyScanTVGCompensator
+{
+  GHashTable                  *channels;                       /* Состояния приёмных каналов. */
+  gint                         remove;                         /* Режим коррекции. */
+
+  GMutex                       lock;                           /* Блокировка. */
+};
+
+/* Функция освобождает ссылку на коэффициенты усиления. */
+static void
+hyscan_tvg_compensator_curve_unref (HyScanTVGCompensatorCurve *curve)
+{
+  if (!g_atomic_int_dec_and_test (&curve->ref_count))
+    return;
+
+  g_free (curve->gains);
+  g_slice_free (HyScanTVGCompensatorCurve, curve);
+}
+
+/* Функция удаляет состояние приёмного канала. */
+static void
+hyscan_tvg_compensator_channel_free (HyScanTVGCompensatorChannel *channel)
+{
+  HyScanTVGCompensatorCurve *curve;
+
+  while ((curve = g_queue_pop_head (&channel->curves)) != NULL)
+    hyscan_tvg_compensator_curve_unref (curve);
+
+  if (channel->factors_curve != NULL)
+    hyscan_tvg_compensator_curve_unref (channel->factors_curve);
+
+  g_array_unref (channel->factors);
+  g_array_unref (channel->values);
+
+  g_slice_free (HyScanTVGCompensatorChannel, channel);
+}
+
+/* Функция возвращает состояние приёмного канала. Вызывается с блокировкой. */
+static HyScanTVGCompensatorChannel *
+hyscan_tvg_compensator_get_channel (HyScanTVGCompensator    *compensator,
+                                    HyScanSonarModelChannel *channel)
+{
+  HyScanTVGCompensatorChannel *compensator_channel;
+
+  compensator_channel = g_hash_table_lookup (compensator->channels, channel);
+  if (compensator_channel != NULL)
+    return compensator_channel;
+
+  compensator_channel = g_slice_new0 (HyScanTVGCompensatorChannel);
+  g_queue_init (&compensator_channel->curves);
+  compensator_channel->factors = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  compensator_channel->values = g_array_new (FALSE, FALSE, sizeof (gfloat));
+
+  g_hash_table_insert (compensator->channels, channel, compensator_channel);
+
+  return compensator_channel;
+}
+
+/* Функция рассчитывает множители для каждого значения строки данных. */
+static void
+hyscan_tvg_compensator_update_factors (HyScanTVGCompensatorChannel *channel,
+                                       HyScanTVGCompensatorCurve   *curve,
+                                       gdouble                      rate,
+                                       gboolean                     complex,
+                                       gboolean                     remove,
+                                       guint32                      n_values)
+{
+  guint32 n_points = complex ? n_values / 2 : n_values;
+  gfloat *linear;
+  gfloat *factors;
+  gdouble step;
+  guint32 i;
+
+  if ((channel->factors_curve == curve) &&
+      (channel->factors_rate == rate) &&
+      (channel->factors_complex == complex) &&
+      (channel->factors_remove == remove) &&
+      (channel->factors->len == n_values))
+    {
+      return;
+    }
+
+  /* Множители в точках задания коэффициентов усиления. */
+  linear = g_new (gfloat, curve->n_gains);
+  for (i = 0; i < curve->n_gains; i++)
+    linear[i] = pow (10.0, (remove ? -curve->gains[i] : curve->gains[i]) / 20.0);
+
+  /* Число коэффициентов усиления на один отсчёт данных. */
+  step = ((rate > 0.0) && (curve->rate > 0.0)) ? curve->rate / rate : 0.0;
+
+  g_array_set_size (channel->factors, n_values);
+  factors = (gfloat*)channel->factors->data;
+
+  for (i = 0; i < n_points; i++)
+    {
+      gdouble position = i * step;
+      guint32 index = (guint32)position;
+      gfloat factor;
+
+      if (index + 1 >= curve->n_gains)
+        factor = linear[curve->n_gains - 1];
+      else
+        factor = linear[index] + (gfloat)(position - index) * (linear[index + 1] - linear[index]);
+
+      if (complex)
+        {
+          factors[2 * i] = factor;
+          factors[2 * i + 1] = factor;
+        }
+      else
+        {
+          factors[i] = factor;
+        }
+    }
+
+  g_free (linear);
+
+  g_atomic_int_inc (&curve->ref_count);
+  if (channel->factors_curve != NULL)
+    hyscan_tvg_compensator_curve_unref (channel->factors_curve);
+
+  channel->factors_curve = curve;
+  channel->factors_rate = rate;
+  channel->factors_complex = complex;
+  channel->factors_remove = remove;
+}
+
+/* Функция создаёт объект коррекции данных. */
+HyScanTVGCompensator *
+hyscan_tvg_compensator_new (void)
+{
+  HyScanTVGCompensator *compensator;
+
+  compensator = g_slice_new0 (HyScanTVGCompensator);
+  compensator->channels = g_hash_table_new_full (NULL, NULL, NULL,
+                                                 (GDestroyNotify)hyscan_tvg_compensator_channel_free);
+  compensator->remove = TRUE;
+
+  g_mutex_init (&compensator->lock);
+
+  return compensator;
+}
+
+/* Функция удаляет объект коррекции данных. */
+void
+hyscan_tvg_compensator_free (HyScanTVGCompensator *compensator)
+{
+  if (compensator == NULL)
+    return;
+
+  g_hash_table_unref (compensator->channels);
+  g_mutex_clear (&compensator->lock);
+
+  g_slice_free (HyScanTVGCompensator, compensator);
+}
+
+/* Функция задаёт режим коррекции. */
+void
+hyscan_tvg_compensator_set_remove (HyScanTVGCompensator *compensator,
+                                   gboolean              remove)
+{
+  g_atomic_int_set (&compensator->remove, remove ? TRUE : FALSE);
+}
+
+/* Функция добавляет коэффициенты усиления ВАРУ приёмного канала. */
+void
+hyscan_tvg_compensator_add_tvg (HyScanTVGCompensator    *compensator,
+                                HyScanSonarModelChannel *channel,
+                                HyScanDataWriterTVG     *tvg)
+{
+  HyScanTVGCompensatorChannel *compensator_channel;
+  HyScanTVGCompensatorCurve *curve;
+
+  if (tvg->n_gains == 0)
+    return;
+
+  curve = g_slice_new (HyScanTVGCompensatorCurve);
+  curve->ref_count = 1;
+  curve->time = tvg->time;
+  curve->rate = tvg->rate;
+  curve->n_gains = tvg->n_gains;
+  curve->gains = g_memdup (tvg->gains, tvg->n_gains * sizeof (gfloat));
+
+  g_mutex_lock (&compensator->lock);
+
+  compensator_channel = hyscan_tvg_compensator_get_channel (compensator, channel);
+
+  if (g_queue_get_length (&compensator_channel->curves) >= HYSCAN_TVG_COMPENSATOR_MAX_CURVES)
+    hyscan_tvg_compensator_curve_unref (g_queue_pop_head (&compensator_channel->curves));
+
+  g_queue_push_tail (&compensator_channel->curves, curve);
+
+  g_mutex_unlock (&compensator->lock);
+}
+
+/* Функция корректирует строку "сырых" данных. */
+gboolean
+hyscan_tvg_compensator_apply (HyScanTVGCompensator    *compensator,
+                              HyScanSonarModelChannel *channel,
+                              HyScanRawDataInfo       *info,
+                              HyScanDataWriterData    *data,
+                              HyScanRawDataInfo       *corrected_info,
+                              HyScanDataWriterData    *corrected_data)
+{
+  HyScanTVGCompensatorChannel *compensator_channel;
+  HyScanTVGCompensatorCurve *curve = NULL;
+  HyScanDataType type;
+  gboolean remove;
+  guint32 n_values;
+  gfloat *values;
+  GList *link;
+
+  type = hyscan_adc_convert_get_type (info->data.type);
+  if (type == HYSCAN_DATA_INVALID)
+    return FALSE;
+
+  /* Последние коэффициенты, установленные до приёма строки. Если строка
+   * принята раньше всех сохранённых коэффициентов, используются самые старые. */
+  g_mutex_lock (&compensator->lock);
+
+  compensator_channel = g_hash_table_lookup (compensator->channels, channel);
+  if (compensator_channel != NULL)
+    {
+      for (link = compensator_channel->curves.tail; link != NULL; link = link->prev)
+        {
+          curve = link->data;
+          if (curve->time <= data->time)
+            break;
+        }
+
+      if (curve != NULL)
+        g_atomic_int_inc (&curve->ref_count);
+    }
+
+  remove = g_atomic_int_get (&compensator->remove);
+
+  g_mutex_unlock (&compensator->lock);
+
+  if (curve == NULL)
+    return FALSE;
+
+  /* Данные в формате с плавающей точкой. */
+  if (type == info->data.type)
+    n_values = data->size / sizeof (gfloat);
+  else
+    n_values = hyscan_adc_convert_get_n_values (info->data.type, data->size);
+
+  if (type == HYSCAN_DATA_COMPLEX_FLOAT)
+    n_values &= ~1U;
+
+  g_array_set_size (compensator_channel->values, n_values);
+  values = (gfloat*)compensator_channel->values->data;
+
+  if (type == info->data.type)
+    memcpy (values, data->data, n_values * sizeof (gfloat));
+  else
+    hyscan_adc_convert (info->data.type, info->adc.offset, info->adc.vref, data->data, data->size, values);
+
+  /* Коррекция данных. */
+  hyscan_tvg_compensator_update_factors (compensator_channel, curve, info->data.rate,
+                                         type == HYSCAN_DATA_COMPLEX_FLOAT, remove, n_values);
+  hyscan_adc_convert_multiply (values, (gfloat*)compensator_channel->factors->data, n_values);
+
+  hyscan_tvg_compensator_curve_unref (curve);
+
+  *corrected_info = *info;
+  corrected_info->data.type = type;
+  corrected_data->time = data->time;
+  corrected_data->size = n_values * sizeof (gfloat);
+  corrected_data->data = values;
+
+  return TRUE;
+}
@@ -0,0 +1,56 @@
+/*
+ * \file hyscan-tvg-compensator.h
+ *
+ * \brief Заголовочный файл коррекции "сырых" данных по коэффициентам усиления ВАРУ
+ * \author Andrei Fadeev (andrei@webcontrol.ru)
+ * \date 2016
+ * \license Проприетарная лицензия ООО "Экран"
+ *
+ * Функции хранят последние коэффициенты усиления системы ВАРУ приёмных каналов и
+ * умножают "сырые" данные на соответствующие им коэффициенты. Коэффициенты усиления
+ * задаются в дБ и могут быть компенсированы (данные делятся на коэффициент усиления)
+ * или применены (данные умножаются на коэффициент усиления).
+ *
+ * Для строки данных выбираются последние коэффициенты, время установки которых не
+ * превышает время приёма строки. Коэффициенты линейно интерполируются к частоте
+ * дискретизации данных. Интерполированные коэффициенты сохраняются и пересчитываются
+ * только при изменении параметров ВАРУ или размера строки.
+ *
+ * Функция #hyscan_tvg_compensator_apply не должна вызываться одновременно для одного
+ * приёмного канала. Результат действителен до следующего вызова для этого канала.
+ *
+ */
+
+#ifndef __HYSCAN_TVG_COMPENSATOR_H__
+#define __HYSCAN_TVG_COMPENSATOR_H__
+
+#include "hyscan-sonar-model.h"
+
+typedef struct _HyScanTVGCompensator HyScanTVGCompensator;
+
+/* Функция создаёт объект коррекции данных. */
+HyScanTVGCompensator  *hyscan_tvg_compensator_new              (void);
+
+/* Функция удаляет объект коррекции данных. */
+void                   hyscan_tvg_compensator_free             (HyScanTVGCompensator    *compensator);
+
+/* Функция задаёт режим коррекции: TRUE - компенсация усиления, FALSE - применение усиления. */
+void                   hyscan_tvg_compensator_set_remove       (HyScanTVGCompensator    *compensator,
+                                                                gboolean                 remove);
+
+/* Функция добавляет коэффициенты усиления ВАРУ приёмного канала. */
+void                   hyscan_tvg_compensator_add_tvg          (HyScanTVGCompensator    *compensator,
+                                                                HyScanSonarModelChannel *channel,
+                                                                HyScanDataWriterTVG     *tvg);
+
+/* Функция корректирует строку "сырых" данных. Данные передаются в формате
+ * HYSCAN_DATA_FLOAT или HYSCAN_DATA_COMPLEX_FLOAT. Функция возвращает FALSE,
+ * если для канала нет коэффициентов усиления или формат данных не поддерживается. */
+gboolean               hyscan_tvg_compensator_apply            (HyScanTVGCompensator    *compensator,
+                                                                HyScanSonarModelChannel *channel,
+                                                                HyScanRawDataInfo       *info,
+                                                                HyScanDataWriterData    *data,
+                                                                HyScanRawDataInfo       *corrected_info,
+                                                                HyScanDataWriterData    *corrected_data);
+
+#endif /* __HYSCAN_TVG_COMPENSATOR_H__ */
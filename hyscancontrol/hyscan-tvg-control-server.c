@@ -640,6 +640,7 @@ hyscan_tvg_control_server_send_gains (HyScanTVGControlServer *server,
   message.rate = tvg->rate;
   message.size = tvg->n_gains * hyscan_data_get_point_size (HYSCAN_DATA_FLOAT);
   message.data = tvg->gains;
+  message.n_parts = 0;
 
   hyscan_sonar_box_send (HYSCAN_SONAR_BOX (server->priv->sonar), &message);
 }
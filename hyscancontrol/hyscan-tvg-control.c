@@ -11,6 +11,7 @@
 #include "hyscan-sonar-messages.h"
 #include "hyscan-control-common.h"
 #include "hyscan-control-marshallers.h"
+#include "hyscan-sonar-model.h"
 
 enum
 {
@@ -24,26 +25,11 @@ enum
   PROP_SONAR
 };
 
-typedef struct
-{
-  HyScanSourceType             source;                         /* Тип источника данных. */
-  gchar                       *path;                           /* Путь к описанию источника данных в схеме. */
-  HyScanTVGModeType            capabilities;                   /* Режимы работы системы ВАРУ. */
-} HyScanTVGControlTVG;
-
-typedef struct
-{
-  HyScanSourceType             source;                         /* Тип источника данных. */
-  guint                        channel;                        /* Индекс приёмного канала. */
-} HyScanTVGControlChannelTVG;
-
 struct _HyScanTVGControlPrivate
 {
   HyScanParam                 *sonar;                          /* Интерфейс управления гидролокатором. */
+  HyScanSonarModel            *model;                          /* Описание гидролокатора. */
   HyScanDataSchema            *schema;                         /* Схема параметров гидролокатора. */
-
-  GHashTable                  *tvgs_by_id;                     /* Список систем ВАРУ. */
-  GHashTable                  *tvgs_by_source;                 /* Список систем ВАРУ. */
 };
 
 static void    hyscan_tvg_control_set_property         (GObject               *object,
@@ -53,10 +39,13 @@ static void    hyscan_tvg_control_set_property         (GObject               *o
 static void    hyscan_tvg_control_object_constructed   (GObject               *object);
 static void    hyscan_tvg_control_object_finalize      (GObject               *object);
 
-static void    hyscan_tvg_control_tvg_receiver         (HyScanTVGControl      *control,
+static void    hyscan_tvg_control_tvg_receiver         (HyScanSensorControl   *control,
+                                                        gpointer               channel,
+                                                        HyScanSonarMessage    *message);
+static void    hyscan_tvg_control_tvg_writer           (HyScanSensorControl   *control,
+                                                        gpointer               channel,
                                                         HyScanSonarMessage    *message);
 
-static void    hyscan_tvg_control_free_tvg             (gpointer               data);
 
 static guint   hyscan_tvg_control_signals[SIGNAL_LAST] = { 0 };
 
@@ -117,142 +106,40 @@ hyscan_tvg_control_object_constructed (GObject *object)
   HyScanTVGControl *control = HYSCAN_TVG_CONTROL (object);
   HyScanTVGControlPrivate *priv = control->priv;
 
-  HyScanDataSchemaNode *params;
-  HyScanDataSchemaNode *sources;
-
-  gint64 version;
-  gint64 id;
+  HyScanSonarModel *model;
   guint i, j;
 
   G_OBJECT_CLASS (hyscan_tvg_control_parent_class)->constructed (object);
 
-  /* Список систем ВАРУ. */
-  priv->tvgs_by_id = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
-  priv->tvgs_by_source = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                                NULL, hyscan_tvg_control_free_tvg);
-
-  /* Обязательно должен быть передан указатель на интерфейс управления локатором. */
-  if (priv->sonar == NULL)
-    return;
-
-  /* Проверяем идентификатор и версию схемы гидролокатора. */
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/id", &id))
-    return;
-  if (id != HYSCAN_SONAR_SCHEMA_ID)
-    return;
-  if (!hyscan_param_get_integer (priv->sonar, "/schema/version", &version))
-    return;
-  if ((version / 100) != (HYSCAN_SONAR_SCHEMA_VERSION / 100))
+  /* Описание гидролокатора. */
+  model = hyscan_sensor_control_get_model (HYSCAN_SENSOR_CONTROL (control));
+  if (model == NULL)
     return;
 
-  /* Параметры гидролокатора. */
-  priv->schema = hyscan_param_schema (priv->sonar);
-  params = hyscan_data_schema_list_nodes (priv->schema);
+  priv->model = hyscan_sonar_model_ref (model);
+  priv->schema = g_object_ref (model->schema);
 
-  /* Ветка схемы с описанием источников данных - "/sources". */
-  for (i = 0, sources = NULL; i < params->n_nodes; i++)
+  /* Обработчики параметров систем ВАРУ приёмных каналов от гидролокатора. */
+  for (i = 0; i < model->n_sources; i++)
     {
-      if (g_strcmp0 (params->nodes[i]->path, "/sources") == 0)
-        {
-          sources = params->nodes[i];
-          break;
-        }
-    }
-
-  if (sources != NULL)
-    {
-      /* Считываем описания систем ВАРУ. */
-      for (i = 0; i < sources->n_nodes; i++)
-        {
-          HyScanTVGControlTVG *tvg;
+      HyScanSonarModelSource *source = &model->sources[i];
 
-          gchar *param_names[3];
-          GVariant *param_values[3];
-
-          gchar **pathv;
-          HyScanSourceType source;
-
-          gint64 id;
-          gint64 capabilities;
-
-          gboolean status;
-
-          /* Тип борта гидролокатора. */
-          pathv = g_strsplit (sources->nodes[i]->path, "/", -1);
-          source = hyscan_control_get_source_type (pathv[2]);
-          g_strfreev (pathv);
-
-          if (source == HYSCAN_SOURCE_INVALID)
-            continue;
+      if (source->tvg.id == 0)
+        continue;
 
-          param_names[0] = g_strdup_printf ("%s/tvg/id", sources->nodes[i]->path);
-          param_names[1] = g_strdup_printf ("%s/tvg/capabilities", sources->nodes[i]->path);
-          param_names[2] = NULL;
-
-          status = hyscan_param_get (priv->sonar, (const gchar **)param_names, param_values);
-
-          if (status)
-            {
-              id = g_variant_get_int64 (param_values[0]);
-              capabilities = g_variant_get_int64 (param_values[1]);
-
-              g_variant_unref (param_values[0]);
-              g_variant_unref (param_values[1]);
-            }
-
-          g_free (param_names[0]);
-          g_free (param_names[1]);
-
-          if (!status)
-            continue;
+      for (j = 0; j < source->n_channels; j++)
+        {
+          HyScanSonarModelChannel *channel = &source->channels[j];
 
-          if (id <= 0 || id > G_MAXINT32)
+          if (channel->tvg_id == 0)
             continue;
 
-          /* Описание системы ВАРУ. */
-          tvg = g_new0 (HyScanTVGControlTVG, 1);
-          tvg->source = source;
-          tvg->path = g_strdup_printf ("%s/tvg", sources->nodes[i]->path);
-          tvg->capabilities = capabilities;
-
-          g_hash_table_insert (priv->tvgs_by_source, GINT_TO_POINTER (source), tvg);
-
-          /* ВАРУ приёмных каналов. */
-          for (j = 1; TRUE; j++)
-            {
-              HyScanTVGControlChannelTVG *channel_tvg;
-
-              gchar *key_id;
-              gboolean has_channel;
-
-              gint64 tvg_id;
-
-              key_id = g_strdup_printf ("%s/channels/%d/id", sources->nodes[i]->path, j);
-              has_channel = hyscan_data_schema_has_key (priv->schema, key_id);
-              g_free (key_id);
-
-              if (!has_channel)
-                break;
-
-              /* Идентификатор ВАРУ канала. */
-              key_id = g_strdup_printf ("%s/channels/%d/tvg/id", sources->nodes[i]->path, j);
-              if (hyscan_param_get_integer (priv->sonar, key_id, &tvg_id))
-                {
-                  channel_tvg = g_new0 (HyScanTVGControlChannelTVG, 1);
-                  channel_tvg->source = source;
-                  channel_tvg->channel = j;
-                  g_hash_table_insert (priv->tvgs_by_id, GINT_TO_POINTER (tvg_id), channel_tvg);
-                }
-              g_free (key_id);
-            }
+          hyscan_sensor_control_add_route (HYSCAN_SENSOR_CONTROL (control), channel->tvg_id,
+                                           hyscan_tvg_control_tvg_receiver, channel);
         }
-
-      /* Обработчик параметров системы ВАРУ от гидролокатора. */
-      g_signal_connect_swapped (priv->sonar, "data",
-                                G_CALLBACK (hyscan_tvg_control_tvg_receiver), control);
     }
 
-  hyscan_data_schema_free_nodes (params);
+  hyscan_sensor_control_apply_routes (HYSCAN_SENSOR_CONTROL (control));
 }
 
 static void
@@ -262,22 +149,22 @@ hyscan_tvg_control_object_finalize (GObject *object)
   HyScanTVGControlPrivate *priv = control->priv;
 
   g_signal_handlers_disconnect_by_data (priv->sonar, control);
+  hyscan_sensor_control_write_flush (HYSCAN_SENSOR_CONTROL (control));
 
   g_clear_object (&priv->schema);
+  g_clear_pointer (&priv->model, hyscan_sonar_model_unref);
   g_clear_object (&priv->sonar);
 
-  g_hash_table_unref (priv->tvgs_by_source);
-  g_hash_table_unref (priv->tvgs_by_id);
-
   G_OBJECT_CLASS (hyscan_tvg_control_parent_class)->finalize (object);
 }
 
 /* Функция обрабатывает сообщения системы ВАРУ гидролокатора. */
 static void
-hyscan_tvg_control_tvg_receiver (HyScanTVGControl   *control,
-                                 HyScanSonarMessage *message)
+hyscan_tvg_control_tvg_receiver (HyScanSensorControl *control,
+                                 gpointer             channel,
+                                 HyScanSonarMessage  *message)
 {
-  HyScanTVGControlChannelTVG *tvg;
+  HyScanSonarModelChannel *tvg = channel;
 
   HyScanDataWriterTVG gain;
 
@@ -285,30 +172,33 @@ hyscan_tvg_control_tvg_receiver (HyScanTVGControl   *control,
   if (message->type != HYSCAN_DATA_FLOAT)
     return;
 
-  /* Ищем систему ВАРУ. */
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_id, GINT_TO_POINTER (message->id));
-  if (tvg == NULL)
-    return;
-
   /* Параметры ВАРУ. */
   gain.time = message->time;
   gain.rate = message->rate;
   gain.n_gains = message->size / sizeof (gfloat);
   gain.gains = message->data;
 
-  hyscan_data_writer_raw_add_tvg (HYSCAN_DATA_WRITER (control), tvg->source, tvg->channel, &gain);
+  hyscan_sensor_control_write (control, hyscan_tvg_control_tvg_writer, tvg, message);
 
   g_signal_emit (control, hyscan_tvg_control_signals[SIGNAL_GAINS], 0, tvg->source, tvg->channel, &gain);
 }
 
-/* Функция освобождает память, занятую структурой HyScanTVGControlTVG. */
+/* Функция записывает параметры системы ВАРУ. Вызывается из потока записи данных. */
 static void
-hyscan_tvg_control_free_tvg (gpointer data)
+hyscan_tvg_control_tvg_writer (HyScanSensorControl *control,
+                               gpointer             channel,
+                               HyScanSonarMessage  *message)
 {
-  HyScanTVGControlTVG *tvg = data;
+  HyScanSonarModelChannel *tvg = channel;
+
+  HyScanDataWriterTVG gain;
+
+  gain.time = message->time;
+  gain.rate = message->rate;
+  gain.n_gains = message->size / sizeof (gfloat);
+  gain.gains = message->data;
 
-  g_free (tvg->path);
-  g_free (tvg);
+  hyscan_data_writer_raw_add_tvg (HYSCAN_DATA_WRITER (control), tvg->source, tvg->channel, &gain);
 }
 
 /* Функция возвращает флаги допустимых режимов работы системы ВАРУ. */
@@ -316,11 +206,11 @@ HyScanTVGModeType
 hyscan_tvg_control_get_capabilities (HyScanTVGControl *control,
                                      HyScanSourceType  source)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
   g_return_val_if_fail (HYSCAN_IS_TVG_CONTROL (control), HYSCAN_TVG_MODE_INVALID);
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return HYSCAN_GENERATOR_MODE_INVALID;
 
@@ -334,9 +224,9 @@ hyscan_tvg_control_get_gain_range (HyScanTVGControl     *control,
                                    gdouble              *min_gain,
                                    gdouble              *max_gain)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_name;
+  const gchar *param_name;
   GVariant *min_gain_value;
   GVariant *max_gain_value;
 
@@ -344,14 +234,13 @@ hyscan_tvg_control_get_gain_range (HyScanTVGControl     *control,
 
   g_return_val_if_fail (HYSCAN_IS_TVG_CONTROL (control), FALSE);
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/constant/gain", tvg->path);
+  param_name = tvg->keys[HYSCAN_SONAR_MODEL_TVG_CONSTANT_GAIN];
   min_gain_value = hyscan_data_schema_key_get_minimum (control->priv->schema, param_name);
   max_gain_value = hyscan_data_schema_key_get_maximum (control->priv->schema, param_name);
-  g_free (param_name);
 
   if (min_gain_value != NULL && max_gain_value != NULL)
     {
@@ -377,9 +266,9 @@ hyscan_tvg_control_set_auto (HyScanTVGControl *control,
                              gdouble           level,
                              gdouble           sensitivity)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_names[3];
+  const gchar *param_names[3];
   GVariant *param_values[3];
   gboolean status;
 
@@ -388,12 +277,12 @@ hyscan_tvg_control_set_auto (HyScanTVGControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_names[0] = g_strdup_printf ("%s/auto/level", tvg->path);
-  param_names[1] = g_strdup_printf ("%s/auto/sensitivity", tvg->path);
+  param_names[0] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_AUTO_LEVEL];
+  param_names[1] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_AUTO_SENSITIVITY];
   param_names[2] = NULL;
 
   if (level < 0.0)
@@ -408,7 +297,7 @@ hyscan_tvg_control_set_auto (HyScanTVGControl *control,
 
   param_values[2] = NULL;
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -416,9 +305,6 @@ hyscan_tvg_control_set_auto (HyScanTVGControl *control,
       g_clear_pointer (&param_values[1], g_variant_unref);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-
   return status;
 }
 
@@ -428,9 +314,9 @@ hyscan_tvg_control_set_constant (HyScanTVGControl *control,
                                  HyScanSourceType  source,
                                  gdouble           gain)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_TVG_CONTROL (control), FALSE);
@@ -438,13 +324,12 @@ hyscan_tvg_control_set_constant (HyScanTVGControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/constant/gain", tvg->path);
+  param_name = tvg->keys[HYSCAN_SONAR_MODEL_TVG_CONSTANT_GAIN];
   status = hyscan_param_set_double (control->priv->sonar, param_name, gain);
-  g_free (param_name);
 
   return status;
 }
@@ -456,9 +341,9 @@ hyscan_tvg_control_set_linear_db (HyScanTVGControl *control,
                                   gdouble           gain0,
                                   gdouble           step)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_names[3];
+  const gchar *param_names[3];
   GVariant *param_values[3];
   gboolean status;
 
@@ -467,19 +352,19 @@ hyscan_tvg_control_set_linear_db (HyScanTVGControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_names[0] = g_strdup_printf ("%s/linear-db/gain0", tvg->path);
-  param_names[1] = g_strdup_printf ("%s/linear-db/step", tvg->path);
+  param_names[0] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_LINEAR_DB_GAIN0];
+  param_names[1] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_LINEAR_DB_STEP];
   param_names[2] = NULL;
 
   param_values[0] = g_variant_new_double (gain0);
   param_values[1] = g_variant_new_double (step);
   param_values[2] = NULL;
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -487,9 +372,6 @@ hyscan_tvg_control_set_linear_db (HyScanTVGControl *control,
       g_variant_unref (param_values[1]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-
   return status;
 }
 
@@ -501,9 +383,9 @@ hyscan_tvg_control_set_logarithmic (HyScanTVGControl *control,
                                     gdouble           beta,
                                     gdouble           alpha)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_names[4];
+  const gchar *param_names[4];
   GVariant *param_values[4];
   gboolean status;
 
@@ -512,13 +394,13 @@ hyscan_tvg_control_set_logarithmic (HyScanTVGControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_names[0] = g_strdup_printf ("%s/logarithmic/gain0", tvg->path);
-  param_names[1] = g_strdup_printf ("%s/logarithmic/beta", tvg->path);
-  param_names[2] = g_strdup_printf ("%s/logarithmic/alpha", tvg->path);
+  param_names[0] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_GAIN0];
+  param_names[1] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_BETA];
+  param_names[2] = tvg->keys[HYSCAN_SONAR_MODEL_TVG_LOGARITHMIC_ALPHA];
   param_names[3] = NULL;
 
   param_values[0] = g_variant_new_double (gain0);
@@ -526,7 +408,7 @@ hyscan_tvg_control_set_logarithmic (HyScanTVGControl *control,
   param_values[2] = g_variant_new_double (alpha);
   param_values[3] = NULL;
 
-  status = hyscan_param_set (control->priv->sonar, (const gchar **)param_names, param_values);
+  status = hyscan_param_set (control->priv->sonar, param_names, param_values);
 
   if (!status)
     {
@@ -535,10 +417,6 @@ hyscan_tvg_control_set_logarithmic (HyScanTVGControl *control,
       g_variant_unref (param_values[2]);
     }
 
-  g_free (param_names[0]);
-  g_free (param_names[1]);
-  g_free (param_names[2]);
-
   return status;
 }
 
@@ -548,9 +426,9 @@ hyscan_tvg_control_set_enable (HyScanTVGControl *control,
                                HyScanSourceType  source,
                                gboolean          enable)
 {
-  HyScanTVGControlTVG *tvg;
+  const HyScanSonarModelTVG *tvg;
 
-  gchar *param_name;
+  const gchar *param_name;
   gboolean status;
 
   g_return_val_if_fail (HYSCAN_IS_TVG_CONTROL (control), FALSE);
@@ -558,13 +436,12 @@ hyscan_tvg_control_set_enable (HyScanTVGControl *control,
   if (control->priv->sonar == NULL)
     return FALSE;
 
-  tvg = g_hash_table_lookup (control->priv->tvgs_by_source, GINT_TO_POINTER (source));
+  tvg = hyscan_sonar_model_get_tvg (control->priv->model, source);
   if (tvg == NULL)
     return FALSE;
 
-  param_name = g_strdup_printf ("%s/enable", tvg->path);
+  param_name = tvg->keys[HYSCAN_SONAR_MODEL_TVG_ENABLE];
   status = hyscan_param_set_boolean (control->priv->sonar, param_name, enable);
-  g_free (param_name);
 
   return status;
 }
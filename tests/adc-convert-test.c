@@ -0,0 +1,249 @@
+/* Тест сравнивает результаты векторных функций преобразования отсчётов АЦП
+ * с результатами функций без векторных инструкций. Функции преобразования
+ * не экспортируются библиотекой, поэтому исходный файл включается в тест. */
+
+#include "hyscan-adc-convert.c"
+
+#include <string.h>
+
+#define MAX_N_POINTS                   1031
+
+typedef struct
+{
+  const gchar                         *name;
+  HyScanDataType                       type;
+  guint32                              mask;
+  guint                                sample_size;
+  gboolean                             complex;
+} TestType;
+
+static const TestType test_types[] =
+{
+  { "adc-14le",         HYSCAN_DATA_ADC_14LE,         0x3FFF,   2, FALSE },
+  { "adc-16le",         HYSCAN_DATA_ADC_16LE,         0xFFFF,   2, FALSE },
+  { "adc-24le",         HYSCAN_DATA_ADC_24LE,         0xFFFFFF, 4, FALSE },
+  { "complex-adc-14le", HYSCAN_DATA_COMPLEX_ADC_14LE, 0x3FFF,   2, TRUE },
+  { "complex-adc-16le", HYSCAN_DATA_COMPLEX_ADC_16LE, 0xFFFF,   2, TRUE },
+  { "complex-adc-24le", HYSCAN_DATA_COMPLEX_ADC_24LE, 0xFFFFFF, 4, TRUE }
+};
+
+/* Длины строк, не кратные ширине векторных регистров. */
+static const guint32 test_n_points[] = { 1, 3, 7, 9, 15, 17, 23, 31, 33, 63, 65, 127, 1001, MAX_N_POINTS };
+
+/* Функция сравнивает значения. */
+static void
+check_values (const gchar  *kernel,
+              const gchar  *test,
+              guint32       n_values,
+              const gfloat *values,
+              const gfloat *ref_values)
+{
+  guint32 i;
+
+  for (i = 0; i < n_values; i++)
+    if (values[i] != ref_values[i])
+      g_error ("%s: %s error at %d of %d: %f != %f", kernel, test, i, n_values, values[i], ref_values[i]);
+}
+
+/* Функция проверяет набор функций преобразования. */
+static void
+check_kernels (const HyScanAdcConvertKernels *kernels,
+               const guint8                  *data,
+               const gfloat                  *factors)
+{
+  gfloat *values = g_new (gfloat, 2 * MAX_N_POINTS);
+  gfloat *ref_values = g_new (gfloat, 2 * MAX_N_POINTS);
+  guint i, j, k;
+
+  g_message ("Checking %s kernels", kernels->name);
+
+  for (i = 0; i < G_N_ELEMENTS (test_types); i++)
+    {
+      const TestType *test = &test_types[i];
+      gint32 offset = (test->mask + 1) / 2;
+      gfloat scale = 2.5f / test->mask;
+
+      for (j = 0; j < G_N_ELEMENTS (test_n_points); j++)
+        {
+          guint32 n_values = test_n_points[j] * (test->complex ? 2 : 1);
+
+          /* Невыровненные в памяти данные. */
+          for (k = 0; k < 2; k++)
+            {
+              const guint8 *src = data + k;
+
+              if (test->sample_size == 2)
+                {
+                  hyscan_adc_convert16_generic (src, ref_values, n_values, test->mask, offset, scale);
+                  kernels->convert16 (src, values, n_values, test->mask, offset, scale);
+                }
+              else
+                {
+                  hyscan_adc_convert32_generic (src, ref_values, n_values, test->mask, offset, scale);
+                  kernels->convert32 (src, values, n_values, test->mask, offset, scale);
+                }
+
+              check_values (kernels->name, test->name, n_values, values, ref_values);
+            }
+
+          /* Умножение на коэффициенты. */
+          hyscan_adc_multiply_generic (ref_values, factors, n_values);
+          kernels->multiply (values, factors, n_values);
+
+          check_values (kernels->name, "multiply", n_values, values, ref_values);
+        }
+    }
+
+  g_free (values);
+  g_free (ref_values);
+}
+
+/* Функция проверяет функции без векторных инструкций по заранее рассчитанным
+ * значениям напряжения для известных смещения и опорного напряжения АЦП. */
+static void
+check_known_values (void)
+{
+  static const struct
+  {
+    const gchar *name;
+    guint32      mask;
+    guint        sample_size;
+    gint32       offset;
+    gfloat       vref;
+    guint32      codes[5];
+    gfloat       volts[5];
+  } tests[] =
+  {
+    /* Биты за пределами маски не учитываются. */
+    { "adc-14le", 0x3FFF,   2, 8192,    2.5f, { 0, 8192, 16383, 12288, 0xC000 | 4096 },
+                                              { -1.2500763f, 0.0f, 1.2499237f, 0.625038149f, -0.625038149f } },
+    { "adc-16le", 0xFFFF,   2, 32768,   5.0f, { 0, 32768, 65535, 49152, 16384 },
+                                              { -2.50003815f, 0.0f, 2.49996185f, 1.25001907f, -1.25001907f } },
+    { "adc-24le", 0xFFFFFF, 4, 8388608, 1.0f, { 0, 8388608, 0xFFFFFF, 0xFF000000 | 4194304, 12582912 },
+                                              { -0.50000003f, 0.0f, 0.49999997f, -0.250000015f, 0.250000015f } }
+  };
+
+  guint i, j;
+
+  g_message ("Checking generic kernels with known values");
+
+  for (i = 0; i < G_N_ELEMENTS (tests); i++)
+    {
+      guint8 src[5 * sizeof (guint32)];
+      gfloat values[5];
+      gfloat scale = tests[i].vref / tests[i].mask;
+
+      for (j = 0; j < 5; j++)
+        {
+          guint32 code = tests[i].codes[j];
+          guint8 *sample = src + j * tests[i].sample_size;
+
+          sample[0] = code & 0xFF;
+          sample[1] = (code >> 8) & 0xFF;
+          if (tests[i].sample_size == 4)
+            {
+              sample[2] = (code >> 16) & 0xFF;
+              sample[3] = (code >> 24) & 0xFF;
+            }
+        }
+
+      if (tests[i].sample_size == 2)
+        hyscan_adc_convert16_generic (src, values, 5, tests[i].mask, tests[i].offset, scale);
+      else
+        hyscan_adc_convert32_generic (src, values, 5, tests[i].mask, tests[i].offset, scale);
+
+      for (j = 0; j < 5; j++)
+        {
+          if (ABS (values[j] - tests[i].volts[j]) > 1e-6f)
+            {
+              g_error ("%s: code 0x%08X: %.9f != %.9f", tests[i].name,
+                       tests[i].codes[j], values[j], tests[i].volts[j]);
+            }
+        }
+    }
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  guint8 *data;
+  gfloat *factors;
+  GRand *rand;
+  guint i;
+
+#ifdef HYSCAN_ADC_CONVERT_X86
+  gboolean sse2;
+  gboolean avx2;
+#endif
+
+  rand = g_rand_new_with_seed (0x5A5A);
+
+  /* Отсчёты со случайными значениями, в том числе с битами за пределами маски. */
+  data = g_new (guint8, 2 * MAX_N_POINTS * sizeof (guint32) + 1);
+  for (i = 0; i < 2 * MAX_N_POINTS * sizeof (guint32) + 1; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+
+  factors = g_new (gfloat, 2 * MAX_N_POINTS);
+  for (i = 0; i < 2 * MAX_N_POINTS; i++)
+    factors[i] = g_rand_double_range (rand, 0.1, 1000.0);
+
+  /* Функции без векторных инструкций проверяются по заранее рассчитанным значениям
+   * и сравниваются сами с собой. */
+  check_known_values ();
+  check_kernels (&hyscan_adc_convert_generic, data, factors);
+
+#ifdef HYSCAN_ADC_CONVERT_X86
+  hyscan_adc_convert_check_cpu (&sse2, &avx2);
+
+  if (sse2)
+    check_kernels (&hyscan_adc_convert_sse2, data, factors);
+  else
+    g_message ("SSE2 is not supported, skipping");
+
+  if (avx2)
+    check_kernels (&hyscan_adc_convert_avx2, data, factors);
+  else
+    g_message ("AVX2 is not supported, skipping");
+#endif
+
+  /* Преобразование выбранным набором функций. */
+  g_message ("Checking hyscan_adc_convert with %s kernels", hyscan_adc_convert_get_kernel ());
+
+  for (i = 0; i < G_N_ELEMENTS (test_types); i++)
+    {
+      const TestType *test = &test_types[i];
+      guint32 size = 1001 * test->sample_size * (test->complex ? 2 : 1);
+      gfloat *values = g_new (gfloat, 2 * MAX_N_POINTS);
+      gfloat *ref_values = g_new (gfloat, 2 * MAX_N_POINTS);
+      guint32 n_values;
+
+      if (hyscan_adc_convert_get_type (test->type) != (test->complex ? HYSCAN_DATA_COMPLEX_FLOAT : HYSCAN_DATA_FLOAT))
+        g_error ("%s: type error", test->name);
+
+      n_values = hyscan_adc_convert (test->type, 100, 2.5, data + 1, size, values);
+      if ((n_values != hyscan_adc_convert_get_n_values (test->type, size)) ||
+          (n_values != 1001 * (test->complex ? 2 : 1)))
+        {
+          g_error ("%s: n_values error", test->name);
+        }
+
+      if (test->sample_size == 2)
+        hyscan_adc_convert16_generic (data + 1, ref_values, n_values, test->mask, 100, 2.5 / test->mask);
+      else
+        hyscan_adc_convert32_generic (data + 1, ref_values, n_values, test->mask, 100, 2.5 / test->mask);
+
+      check_values (hyscan_adc_convert_get_kernel (), test->name, n_values, values, ref_values);
+
+      g_free (values);
+      g_free (ref_values);
+    }
+
+  g_message ("All done");
+
+  g_rand_free (rand);
+  g_free (factors);
+  g_free (data);
+
+  return 0;
+}
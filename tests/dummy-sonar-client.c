@@ -27,6 +27,7 @@ gdouble total_size = 0.0;
 guint sources = 4;
 gdouble data_msg_rate = 25.0;
 gint data_size = 4000;
+guint n_workers = HYSCAN_SONAR_CLIENT_DEFAULT_N_WORKERS;
 
 guint32 next_indexes[MSG_DATA_MAX_SOURCES];
 
@@ -71,6 +72,18 @@ message_check (HyScanParam        *sonar,
       return;
     }
 
+  if (message->n_parts > 0)
+    {
+      guint n_received = 0;
+
+      for (i = 0; i < message->n_parts; i++)
+        if (message->parts[i / 32] & (1u << (i % 32)))
+          n_received += 1;
+
+      g_warning ("source %d: incomplete message: %d of %d parts", message->id, n_received, message->n_parts);
+      return;
+    }
+
   points = message->data;
   n_points = message->size / sizeof (guint32);
 
@@ -120,6 +133,7 @@ main (int    argc,
         { "sources", 'n', 0, G_OPTION_ARG_INT, &sources, "Number of sources", NULL },
         { "data-rate", 'r', 0, G_OPTION_ARG_DOUBLE, &data_msg_rate, "Data message rate, msg/s (0 - 1000)", NULL },
         { "data-size", 'd', 0, G_OPTION_ARG_INT, &data_size, "Data size, points", NULL },
+        { "workers", 'w', 0, G_OPTION_ARG_INT, &n_workers, "Number of client delivery threads", NULL },
         { NULL } };
 
 #ifdef G_OS_WIN32
@@ -163,7 +177,16 @@ main (int    argc,
   /* Сетевой тест. */
   else
     {
-      client = hyscan_sonar_client_new (sonar_address);
+      client = g_initable_new (HYSCAN_TYPE_SONAR_CLIENT, NULL, NULL,
+                               "host", sonar_address,
+                               "timeout", HYSCAN_SONAR_CLIENT_DEFAULT_TIMEOUT,
+                               "n-exec", HYSCAN_SONAR_CLIENT_DEFAULT_EXEC,
+                               "n-buffers", HYSCAN_SONAR_CLIENT_DEFAULT_N_BUFFERS,
+                               "n-workers", n_workers,
+                               NULL);
+      if (client == NULL)
+        g_error ("can't connect to sonar '%s'", sonar_address);
+
       if (!hyscan_sonar_client_set_master (client))
         g_error ("can't setup master connection");
 
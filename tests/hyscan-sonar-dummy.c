@@ -268,6 +268,7 @@ hyscan_sonar_dummy_worker (gpointer user_data)
               message.id = i + 1;
               message.size = data_size * sizeof (guint32);
               message.data = data;
+              message.n_parts = 0;
 
               g_signal_emit (dummy_sonar, hyscan_sonar_dummy_signals[SIGNAL_DATA], 0, &message);
             }
@@ -0,0 +1,844 @@
+#include "hyscan-sonar-client.h"
+#include "hyscan-sonar-rpc.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <zlib.h>
+
+/* Формат файла записи пакетов HyScanSonarClient. */
+#define CAPTURE_MAGIC                  0x50414353
+#define CAPTURE_VERSION                1
+
+#define N_MESSAGES                     16
+#define N_PARTS                        4
+#define MESSAGE_SIZE                   ((N_PARTS - 1) * HYSCAN_SONAR_MSG_DATA_PART_SIZE + 1000)
+
+#define SOURCE_ID                      1
+#define MARKER_ID                      1000
+#define DATA_TYPE                      HYSCAN_DATA_ADC_16LE
+#define DATA_RATE                      100000.0
+
+#define FLUSH_TIMEOUT                  0.1
+#define FLUSH_CHECK_DELAY              (500 * G_TIME_SPAN_MILLISECOND)
+
+#define DELIVERY_TIMEOUT               (5 * G_TIME_SPAN_SECOND)
+
+/* Время от начала воспроизведения до первого проверяемого пакета, за которое
+ * тест успевает подключить обработчики к созданному клиенту. */
+#define REPLAY_DELAY                   (200 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct
+{
+  GOutputStream                       *stream;
+  guint32                              index;
+  gboolean                             corrupt;
+} Capture;
+
+typedef struct
+{
+  GMutex                               lock;
+  GPtrArray                           *messages;
+} Messages;
+
+typedef struct
+{
+  Messages                             messages;
+  Messages                            *signal;
+  gboolean                             late;
+  gboolean                             destroyed;
+} Sink;
+
+gchar                                 *capture_path;
+
+/* Функция преобразовывает значение float из машинного формата в LE. */
+gfloat
+float_to_le (gfloat value)
+{
+  union
+  {
+    gfloat             f;
+    guint32            u;
+  } le;
+
+  le.f = value;
+  le.u = GUINT32_TO_LE (le.u);
+
+  return le.f;
+}
+
+/* Функция заполняет данные сообщения. */
+void
+message_fill (guint8  *data,
+              guint32  size,
+              guint    n)
+{
+  guint32 i;
+
+  for (i = 0; i < size; i++)
+    data[i] = (i + n) & 0xff;
+}
+
+/* Функция проверяет данные сообщения. Если part_size не равен нулю, данные
+ * фрагментов, не отмеченных в маске parts, должны быть нулевыми. */
+gboolean
+message_check (const guint8  *data,
+               guint32        size,
+               guint          n,
+               guint32        part_size,
+               const guint32 *parts)
+{
+  guint32 i;
+
+  for (i = 0; i < size; i++)
+    {
+      guint8 value = (i + n) & 0xff;
+
+      if (part_size > 0)
+        {
+          guint32 part = i / part_size;
+
+          if (!(parts[part / 32] & (1u << (part % 32))))
+            value = 0;
+        }
+
+      if (data[i] != value)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Функция записывает в файл фрагмент part сообщения с номером пакета index. Если
+ * в capture установлен признак corrupt, контрольная сумма пакета искажается. */
+void
+capture_part (Capture *capture,
+              gint64   time,
+              guint32  id,
+              guint    n,
+              guint32  size,
+              guint32  part,
+              guint32  index)
+{
+  HyScanSonarRpcPacket *packet;
+  guint32 offset = part * HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+  guint32 part_size = MIN (size - offset, HYSCAN_SONAR_MSG_DATA_PART_SIZE);
+  guint32 packet_size = part_size + G_STRUCT_OFFSET (HyScanSonarRpcPacket, data);
+  guint8 record[sizeof (gint64) + sizeof (guint32)];
+  gint64 record_time;
+  guint32 record_size;
+  guint32 crc;
+  guint32 i;
+
+  packet = g_new0 (HyScanSonarRpcPacket, 1);
+
+  packet->magic = GUINT32_TO_LE (HYSCAN_SONAR_RPC_MAGIC);
+  packet->version = GUINT32_TO_LE (HYSCAN_SONAR_RPC_VERSION);
+  packet->index = GUINT32_TO_LE (index);
+  packet->crc32 = 0;
+  packet->time = GINT64_TO_LE (time);
+  packet->id = GUINT32_TO_LE (id);
+  packet->type = GUINT32_TO_LE (DATA_TYPE);
+  packet->rate = float_to_le (DATA_RATE);
+  packet->size = GUINT32_TO_LE (size);
+  packet->part_size = GUINT32_TO_LE (part_size);
+  packet->offset = GUINT32_TO_LE (offset);
+  for (i = 0; i < part_size; i++)
+    packet->data[i] = (offset + i + n) & 0xff;
+
+  crc = crc32 (0L, Z_NULL, 0);
+  crc = crc32 (crc, (gpointer)packet, packet_size);
+  packet->crc32 = GUINT32_TO_LE (capture->corrupt ? ~crc : crc);
+
+  record_time = GINT64_TO_LE (time);
+  record_size = GUINT32_TO_LE (packet_size);
+  memcpy (record, &record_time, sizeof (record_time));
+  memcpy (record + sizeof (record_time), &record_size, sizeof (record_size));
+
+  if (!g_output_stream_write_all (capture->stream, record, sizeof (record), NULL, NULL, NULL) ||
+      !g_output_stream_write_all (capture->stream, packet, packet_size, NULL, NULL, NULL))
+    {
+      g_error ("can't write capture file");
+    }
+
+  g_free (packet);
+}
+
+/* Функция записывает сообщение в файл так, как его передаёт HyScanSonarServer.
+ * Фрагменты, отмеченные в маске skip, не записываются, но номера пакетов для них
+ * расходуются, как при потере пакетов в сети. */
+void
+capture_message (Capture  *capture,
+                 gint64    time,
+                 guint32   id,
+                 guint     n,
+                 guint32   size,
+                 guint32   skip)
+{
+  guint32 n_parts = (size + HYSCAN_SONAR_MSG_DATA_PART_SIZE - 1) / HYSCAN_SONAR_MSG_DATA_PART_SIZE;
+  guint32 part;
+
+  for (part = 0; part < n_parts; part++)
+    {
+      guint32 index = capture->index++;
+
+      if (!(skip & (1u << part)))
+        capture_part (capture, time, id, n, size, part, index);
+    }
+}
+
+/* Функция создаёт файл записи пакетов. Файл начинается с сообщения-метки,
+ * проверяемые сообщения должны иметь время не меньше REPLAY_DELAY. Файл
+ * воспроизводится в реальном времени. */
+void
+capture_open (Capture *capture)
+{
+  GFile *file;
+  guint32 header[2];
+
+  file = g_file_new_for_path (capture_path);
+  capture->stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL));
+  capture->index = 0;
+  capture->corrupt = FALSE;
+  g_object_unref (file);
+
+  if (capture->stream == NULL)
+    g_error ("can't create capture file %s", capture_path);
+
+  header[0] = GUINT32_TO_LE (CAPTURE_MAGIC);
+  header[1] = GUINT32_TO_LE (CAPTURE_VERSION);
+  if (!g_output_stream_write_all (capture->stream, header, sizeof (header), NULL, NULL, NULL))
+    g_error ("can't write capture file");
+
+  capture_message (capture, 0, MARKER_ID, 0, 1, 0);
+}
+
+/* Функция закрывает файл записи пакетов. */
+void
+capture_close (Capture *capture)
+{
+  g_output_stream_close (capture->stream, NULL, NULL);
+  g_object_unref (capture->stream);
+}
+
+/* Обработчик сигнала "data". Сохраняет ссылки на принятые сообщения. */
+void
+data_cb (HyScanSonarClient  *client,
+         HyScanSonarMessage *message,
+         Messages           *messages)
+{
+  if (message->id == MARKER_ID)
+    return;
+
+  g_mutex_lock (&messages->lock);
+  g_ptr_array_add (messages->messages, hyscan_sonar_client_message_ref (message));
+  g_mutex_unlock (&messages->lock);
+}
+
+/* Функция ожидает доставки заданного числа сообщений. */
+guint
+messages_wait (Messages *messages,
+               guint     n_messages)
+{
+  gint64 end_time = g_get_monotonic_time () + DELIVERY_TIMEOUT;
+  guint n_received;
+
+  do
+    {
+      g_mutex_lock (&messages->lock);
+      n_received = messages->messages->len;
+      g_mutex_unlock (&messages->lock);
+
+      if (n_received >= n_messages)
+        break;
+
+      g_usleep (10000);
+    }
+  while (g_get_monotonic_time () < end_time);
+
+  return n_received;
+}
+
+/* Функция проверяет, что сообщения, на которые удерживаются ссылки, остаются
+ * действительными после удаления клиента. */
+void
+check_message_ref (void)
+{
+  HyScanSonarClient *client;
+  Messages messages;
+  Capture capture;
+  guint i;
+
+  capture_open (&capture);
+  for (i = 0; i < N_MESSAGES; i++)
+    capture_message (&capture, REPLAY_DELAY + 1000 * i, SOURCE_ID, i, (i % 2) ? MESSAGE_SIZE : 1000, 0);
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new ();
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("message-ref: can't create replay client");
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, N_MESSAGES) != N_MESSAGES)
+    g_error ("message-ref: messages not delivered");
+
+  /* Удаляем клиента до освобождения ссылок на сообщения. */
+  g_object_unref (client);
+
+  for (i = 0; i < messages.messages->len; i++)
+    {
+      HyScanSonarMessage *message = g_ptr_array_index (messages.messages, i);
+
+      if ((message->id != SOURCE_ID) ||
+          (message->time != REPLAY_DELAY + 1000 * i) ||
+          (message->size != ((i % 2) ? MESSAGE_SIZE : 1000)) ||
+          (message->n_parts != 0) ||
+          !message_check (message->data, message->size, i, 0, NULL))
+        {
+          g_error ("message-ref: message %d error", i);
+        }
+
+      hyscan_sonar_client_message_unref (message);
+    }
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+/* Функция проверяет сборку сообщений двух источников из фрагментов, принятых
+ * вперемешку, не по порядку и с повторами. */
+void
+check_reassembly (void)
+{
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  Messages messages;
+  Capture capture;
+  guint i;
+
+  /* Сервер передаёт фрагменты источника SOURCE_ID, затем SOURCE_ID + 1. Фрагменты
+   * первого источника приходят в порядке 3, 1, 0, 2 с повтором фрагмента 1, второго -
+   * по порядку. Последним приходит фрагмент первого источника. */
+  capture_open (&capture);
+  for (i = 0; i < N_MESSAGES / 2; i++)
+    {
+      gint64 time = REPLAY_DELAY + 1000 * i;
+      guint32 index = capture.index;
+
+      capture_part (&capture, time, SOURCE_ID, i, MESSAGE_SIZE, 3, index + 3);
+      capture_part (&capture, time, SOURCE_ID + 1, i + 1, MESSAGE_SIZE, 0, index + 4);
+      capture_part (&capture, time, SOURCE_ID, i, MESSAGE_SIZE, 1, index + 1);
+      capture_part (&capture, time, SOURCE_ID + 1, i + 1, MESSAGE_SIZE, 1, index + 5);
+      capture_part (&capture, time, SOURCE_ID, i, MESSAGE_SIZE, 1, index + 1);
+      capture_part (&capture, time, SOURCE_ID, i, MESSAGE_SIZE, 0, index + 0);
+      capture_part (&capture, time, SOURCE_ID + 1, i + 1, MESSAGE_SIZE, 2, index + 6);
+      capture_part (&capture, time, SOURCE_ID + 1, i + 1, MESSAGE_SIZE, 3, index + 7);
+      capture_part (&capture, time, SOURCE_ID, i, MESSAGE_SIZE, 2, index + 2);
+
+      capture.index += 2 * N_PARTS;
+    }
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("reassembly: can't create replay client");
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, N_MESSAGES) != N_MESSAGES)
+    g_error ("reassembly: messages not delivered");
+
+  /* Сообщение второго источника собирается раньше. */
+  for (i = 0; i < N_MESSAGES; i++)
+    {
+      HyScanSonarMessage *message = g_ptr_array_index (messages.messages, i);
+      guint32 id = (i % 2) ? SOURCE_ID : SOURCE_ID + 1;
+      guint n = (i / 2) + ((i % 2) ? 0 : 1);
+
+      if ((message->id != id) ||
+          (message->time != REPLAY_DELAY + 1000 * (i / 2)) ||
+          (message->size != MESSAGE_SIZE) ||
+          (message->n_parts != 0) ||
+          !message_check (message->data, message->size, n, 0, NULL))
+        {
+          g_error ("reassembly: message %d error", i);
+        }
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID, &stats))
+    g_error ("reassembly: no stats for source %d", SOURCE_ID);
+
+  if ((stats.n_packets != N_PARTS * N_MESSAGES / 2) ||
+      (stats.n_bytes != (guint64)MESSAGE_SIZE * N_MESSAGES / 2) ||
+      (stats.n_duplicates != N_MESSAGES / 2) ||
+      (stats.n_lost != 0) ||
+      (stats.n_incomplete != 0) ||
+      (stats.max_reorder != 3))
+    {
+      g_error ("reassembly: source %d stats error", SOURCE_ID);
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID + 1, &stats))
+    g_error ("reassembly: no stats for source %d", SOURCE_ID + 1);
+
+  if ((stats.n_packets != N_PARTS * N_MESSAGES / 2) ||
+      (stats.n_duplicates != 0) ||
+      (stats.max_reorder != 0))
+    {
+      g_error ("reassembly: source %d stats error", SOURCE_ID + 1);
+    }
+
+  g_object_unref (client);
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+/* Функция проверяет доставку неполных сообщений: маску принятых фрагментов,
+ * обнуление данных потерянных фрагментов и учёт потерь в статистике. Неполное
+ * сообщение завершается приходом следующего сообщения источника. */
+void
+check_incomplete (void)
+{
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  Messages messages;
+  Capture capture;
+  guint32 skip = (1u << 1) | (1u << 2);
+  guint i;
+
+  /* В чётных сообщениях теряются средние фрагменты. Буферы сборки используются
+   * повторно, поэтому полные сообщения оставляют в них ненулевые данные. */
+  capture_open (&capture);
+  for (i = 0; i < N_MESSAGES; i++)
+    capture_message (&capture, REPLAY_DELAY + 1000 * i, SOURCE_ID, i, MESSAGE_SIZE, (i % 2) ? 0 : skip);
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("incomplete: can't create replay client");
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, N_MESSAGES) != N_MESSAGES)
+    g_error ("incomplete: messages not delivered");
+
+  for (i = 0; i < N_MESSAGES; i++)
+    {
+      HyScanSonarMessage *message = g_ptr_array_index (messages.messages, i);
+      gboolean complete = (i % 2);
+
+      if ((message->id != SOURCE_ID) ||
+          (message->time != REPLAY_DELAY + 1000 * i) ||
+          (message->size != MESSAGE_SIZE))
+        {
+          g_error ("incomplete: message %d error", i);
+        }
+
+      if (complete)
+        {
+          if ((message->n_parts != 0) ||
+              !message_check (message->data, message->size, i, 0, NULL))
+            {
+              g_error ("incomplete: message %d data error", i);
+            }
+        }
+      else
+        {
+          if ((message->n_parts != N_PARTS) ||
+              (message->part_size != HYSCAN_SONAR_MSG_DATA_PART_SIZE) ||
+              (message->parts[0] != (((1u << N_PARTS) - 1) & ~skip)) ||
+              !message_check (message->data, message->size, i, message->part_size, message->parts))
+            {
+              g_error ("incomplete: message %d parts error", i);
+            }
+        }
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID, &stats))
+    g_error ("incomplete: no stats for source %d", SOURCE_ID);
+
+  if ((stats.n_packets != N_PARTS * N_MESSAGES - 2 * (N_MESSAGES / 2)) ||
+      (stats.n_incomplete != N_MESSAGES / 2) ||
+      (stats.n_lost != 2 * (N_MESSAGES / 2)))
+    {
+      g_error ("incomplete: stats error");
+    }
+
+  g_object_unref (client);
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+/* Функция проверяет завершение сборки неполных сообщений по таймеру с правилами
+ * сборки, заданными для каждого источника. Последующих сообщений от источников
+ * нет, поэтому сообщения завершаются только по истечении времени ожидания. */
+void
+check_flush_policy (void)
+{
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  HyScanSonarMessage *message;
+  Messages messages;
+  Capture capture;
+  guint n_messages;
+
+  /* Сообщение источника SOURCE_ID доставляется неполным, сообщение источника
+   * SOURCE_ID + 1 отбрасывается. Сообщение источника SOURCE_ID + 2 приходит позже
+   * времени ожидания этих источников, но раньше времени ожидания по умолчанию. */
+  capture_open (&capture);
+  capture_message (&capture, REPLAY_DELAY, SOURCE_ID, 0, MESSAGE_SIZE, 1u << 2);
+  capture_message (&capture, REPLAY_DELAY, SOURCE_ID + 1, 1, MESSAGE_SIZE, 1u << 1);
+  capture_message (&capture, REPLAY_DELAY + FLUSH_CHECK_DELAY, SOURCE_ID + 2, 2, 1000, 0);
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("flush-policy: can't create replay client");
+
+  hyscan_sonar_client_set_flush_policy (client, SOURCE_ID, FLUSH_TIMEOUT, TRUE);
+  hyscan_sonar_client_set_flush_policy (client, SOURCE_ID + 1, FLUSH_TIMEOUT, FALSE);
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, 2) != 2)
+    g_error ("flush-policy: messages not delivered");
+
+  /* Неполное сообщение доставлено по таймеру раньше следующего сообщения. */
+  message = g_ptr_array_index (messages.messages, 0);
+  if ((message->id != SOURCE_ID) ||
+      (message->n_parts != N_PARTS) ||
+      !message_check (message->data, message->size, 0, message->part_size, message->parts))
+    {
+      g_error ("flush-policy: incomplete message error");
+    }
+
+  message = g_ptr_array_index (messages.messages, 1);
+  if ((message->id != SOURCE_ID + 2) ||
+      (message->n_parts != 0) ||
+      !message_check (message->data, message->size, 2, 0, NULL))
+    {
+      g_error ("flush-policy: complete message error");
+    }
+
+  /* Сообщение с запретом доставки неполных сообщений отброшено. */
+  g_usleep (FLUSH_CHECK_DELAY);
+  g_mutex_lock (&messages.lock);
+  n_messages = messages.messages->len;
+  g_mutex_unlock (&messages.lock);
+  if (n_messages != 2)
+    g_error ("flush-policy: dropped message delivered");
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID, &stats) ||
+      (stats.n_incomplete != 1) || (stats.n_lost != 1))
+    {
+      g_error ("flush-policy: source %d stats error", SOURCE_ID);
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID + 1, &stats) ||
+      (stats.n_incomplete != 0) || (stats.n_lost != 1))
+    {
+      g_error ("flush-policy: source %d stats error", SOURCE_ID + 1);
+    }
+
+  g_object_unref (client);
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+/* Функция проверяет воспроизведение записи с максимальной скоростью. Время записи
+ * пакетов больше времени ожидания доставки, поэтому воспроизведение должно
+ * завершиться без учёта времени приёма пакетов. Обработчики подключаются после
+ * начала воспроизведения, поэтому проверяется статистика приёма. */
+void
+check_replay_speed (void)
+{
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  Capture capture;
+  gint64 end_time;
+  guint i;
+
+  capture_open (&capture);
+  for (i = 0; i < N_MESSAGES; i++)
+    capture_message (&capture, REPLAY_DELAY + G_TIME_SPAN_SECOND * i, SOURCE_ID, i, MESSAGE_SIZE, 0);
+  capture_close (&capture);
+
+  client = hyscan_sonar_client_new_replay (capture_path, 0.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("replay-speed: can't create replay client");
+
+  end_time = g_get_monotonic_time () + DELIVERY_TIMEOUT;
+  while (!hyscan_sonar_client_replay_done (client))
+    {
+      if (g_get_monotonic_time () > end_time)
+        g_error ("replay-speed: replay not finished");
+
+      g_usleep (10000);
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID, &stats))
+    g_error ("replay-speed: no stats for source %d", SOURCE_ID);
+
+  if ((stats.n_packets != N_PARTS * N_MESSAGES) ||
+      (stats.n_bytes != (guint64)MESSAGE_SIZE * N_MESSAGES) ||
+      (stats.n_lost != 0) ||
+      (stats.n_crc_errors != 0) ||
+      (stats.n_malformed != 0) ||
+      (stats.max_reorder != 0))
+    {
+      g_error ("replay-speed: stats error");
+    }
+
+  g_object_unref (client);
+}
+
+/* Функция приёма данных. Сохраняет ссылки на принятые сообщения и проверяет,
+ * что сообщения не были доставлены сигналом "data" раньше. */
+void
+sink_cb (HyScanSonarClient         *client,
+         HyScanSonarMessage *const *messages,
+         guint                      n_messages,
+         Sink                      *sink)
+{
+  guint i, j;
+
+  g_mutex_lock (&sink->signal->lock);
+  for (i = 0; i < n_messages; i++)
+    for (j = 0; j < sink->signal->messages->len; j++)
+      if (g_ptr_array_index (sink->signal->messages, j) == messages[i])
+        sink->late = TRUE;
+  g_mutex_unlock (&sink->signal->lock);
+
+  g_mutex_lock (&sink->messages.lock);
+  for (i = 0; i < n_messages; i++)
+    if (messages[i]->id != MARKER_ID)
+      g_ptr_array_add (sink->messages.messages, hyscan_sonar_client_message_ref (messages[i]));
+  g_mutex_unlock (&sink->messages.lock);
+}
+
+/* Функция освобождения пользовательских данных функции приёма данных. */
+void
+sink_destroy (Sink *sink)
+{
+  sink->destroyed = TRUE;
+}
+
+/* Функция проверяет функции приёма данных: выбор сообщений по источнику и типу
+ * данных, порядок доставки, вызов раньше сигнала "data" и удаление функций. */
+void
+check_sinks (void)
+{
+  HyScanSonarClient *client;
+  Messages messages;
+  Capture capture;
+  Sink sinks[4];
+  guint ids[4];
+  guint i, j;
+
+  /* Сообщения источников SOURCE_ID и SOURCE_ID + 1 чередуются. */
+  capture_open (&capture);
+  for (i = 0; i < N_MESSAGES; i++)
+    capture_message (&capture, REPLAY_DELAY + 1000 * i, SOURCE_ID + (i % 2), i, MESSAGE_SIZE, 0);
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+
+  for (i = 0; i < G_N_ELEMENTS (sinks); i++)
+    {
+      g_mutex_init (&sinks[i].messages.lock);
+      sinks[i].messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+      sinks[i].signal = &messages;
+      sinks[i].late = FALSE;
+      sinks[i].destroyed = FALSE;
+    }
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("sinks: can't create replay client");
+
+  /* Сообщения источника SOURCE_ID, все сообщения, сообщения другого типа данных
+   * и сообщения источника SOURCE_ID + 1, функция приёма которых будет удалена. */
+  ids[0] = hyscan_sonar_client_add_sink (client, SOURCE_ID, DATA_TYPE, (HyScanSonarClientSinkFunc)sink_cb,
+                                         &sinks[0], (GDestroyNotify)sink_destroy);
+  ids[1] = hyscan_sonar_client_add_sink (client, HYSCAN_SONAR_CLIENT_ANY_SOURCE, HYSCAN_SONAR_CLIENT_ANY_TYPE,
+                                         (HyScanSonarClientSinkFunc)sink_cb, &sinks[1], (GDestroyNotify)sink_destroy);
+  ids[2] = hyscan_sonar_client_add_sink (client, HYSCAN_SONAR_CLIENT_ANY_SOURCE, HYSCAN_DATA_FLOAT,
+                                         (HyScanSonarClientSinkFunc)sink_cb, &sinks[2], (GDestroyNotify)sink_destroy);
+  ids[3] = hyscan_sonar_client_add_sink (client, SOURCE_ID + 1, HYSCAN_SONAR_CLIENT_ANY_TYPE,
+                                         (HyScanSonarClientSinkFunc)sink_cb, &sinks[3], (GDestroyNotify)sink_destroy);
+
+  for (i = 0; i < G_N_ELEMENTS (ids); i++)
+    for (j = 0; j < i; j++)
+      if ((ids[i] == 0) || (ids[i] == ids[j]))
+        g_error ("sinks: sink %d id error", i);
+
+  if (!hyscan_sonar_client_remove_sink (client, ids[3]) ||
+      hyscan_sonar_client_remove_sink (client, ids[3]))
+    {
+      g_error ("sinks: can't remove sink");
+    }
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, N_MESSAGES) != N_MESSAGES)
+    g_error ("sinks: messages not delivered");
+
+  /* Функции приёма вызываются раньше сигнала и получают только свои сообщения. */
+  for (i = 0; i < G_N_ELEMENTS (sinks); i++)
+    if (sinks[i].late)
+      g_error ("sinks: sink %d called after signal", i);
+
+  if ((sinks[0].messages.messages->len != N_MESSAGES / 2) ||
+      (sinks[1].messages.messages->len != N_MESSAGES) ||
+      (sinks[2].messages.messages->len != 0) ||
+      (sinks[3].messages.messages->len != 0))
+    {
+      g_error ("sinks: messages filter error");
+    }
+
+  for (i = 0; i < N_MESSAGES; i++)
+    {
+      HyScanSonarMessage *message = g_ptr_array_index (sinks[1].messages.messages, i);
+
+      if ((message != g_ptr_array_index (messages.messages, i)) ||
+          (message->id != SOURCE_ID + (i % 2)) ||
+          !message_check (message->data, message->size, i, 0, NULL))
+        {
+          g_error ("sinks: message %d error", i);
+        }
+
+      if ((i % 2) == 0)
+        if (g_ptr_array_index (sinks[0].messages.messages, i / 2) != message)
+          g_error ("sinks: source message %d error", i);
+    }
+
+  g_object_unref (client);
+
+  for (i = 0; i < G_N_ELEMENTS (sinks); i++)
+    {
+      if (!sinks[i].destroyed)
+        g_error ("sinks: sink %d not destroyed", i);
+
+      g_ptr_array_unref (sinks[i].messages.messages);
+      g_mutex_clear (&sinks[i].messages.lock);
+    }
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+/* Функция проверяет учёт потерь по сквозной нумерации пакетов. Первый фрагмент
+ * сообщения принимается с ошибкой контрольной суммы, остальные теряются. */
+void
+check_sequence_loss (void)
+{
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  Messages messages;
+  Capture capture;
+
+  capture_open (&capture);
+  capture_message (&capture, REPLAY_DELAY, SOURCE_ID, 0, MESSAGE_SIZE, 0);
+  capture.corrupt = TRUE;
+  capture_message (&capture, REPLAY_DELAY + 1000, SOURCE_ID, 1, MESSAGE_SIZE, ~1u);
+  capture.corrupt = FALSE;
+  capture_message (&capture, REPLAY_DELAY + 2000, SOURCE_ID, 2, MESSAGE_SIZE, 0);
+  capture_close (&capture);
+
+  g_mutex_init (&messages.lock);
+  messages.messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+
+  client = hyscan_sonar_client_new_replay (capture_path, 1.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("sequence-loss: can't create replay client");
+
+  g_signal_connect (client, "data", G_CALLBACK (data_cb), &messages);
+
+  if (messages_wait (&messages, 2) != 2)
+    g_error ("sequence-loss: messages not delivered");
+
+  if (!hyscan_sonar_client_get_stats (client, HYSCAN_SONAR_CLIENT_ANY_SOURCE, &stats) ||
+      (stats.n_lost != N_PARTS) || (stats.n_crc_errors != 1) ||
+      (stats.n_packets != 2 * N_PARTS + 1))
+    {
+      g_error ("sequence-loss: total stats error");
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, SOURCE_ID, &stats) ||
+      (stats.n_lost != N_PARTS) || (stats.n_crc_errors != 1))
+    {
+      g_error ("sequence-loss: source %d stats error", SOURCE_ID);
+    }
+
+  g_object_unref (client);
+
+  g_ptr_array_unref (messages.messages);
+  g_mutex_clear (&messages.lock);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gchar *tmp_dir;
+
+  tmp_dir = g_dir_make_tmp ("sonar-client-test-XXXXXX", NULL);
+  if (tmp_dir == NULL)
+    g_error ("can't create temporary directory");
+
+  capture_path = g_build_filename (tmp_dir, "capture.bin", NULL);
+
+  /* Ссылки на сообщения после удаления клиента. */
+  g_message ("Checking message references");
+  check_message_ref ();
+
+  /* Сборка сообщений из фрагментов. */
+  g_message ("Checking message reassembly");
+  check_reassembly ();
+
+  /* Неполные сообщения. */
+  g_message ("Checking incomplete messages");
+  check_incomplete ();
+
+  /* Правила завершения сборки сообщений. */
+  g_message ("Checking flush policies");
+  check_flush_policy ();
+
+  /* Воспроизведение записи с максимальной скоростью. */
+  g_message ("Checking replay speed");
+  check_replay_speed ();
+
+  /* Функции приёма данных. */
+  g_message ("Checking data sinks");
+  check_sinks ();
+
+  /* Учёт потерь по нумерации пакетов. */
+  g_message ("Checking sequence loss accounting");
+  check_sequence_loss ();
+
+  g_message ("All done");
+
+  g_unlink (capture_path);
+  g_rmdir (tmp_dir);
+
+  g_free (capture_path);
+  g_free (tmp_dir);
+
+  return 0;
+}
@@ -26,6 +26,12 @@
 #define SIGNAL_N_POINTS                1024
 #define TVG_N_GAINS                    512
 
+#define HISTORY_N_PINGS                8
+
+#define COMPRESSED_EPSILON             1e-3
+
+#define PREVIEW_WIDTH                  64
+
 typedef struct
 {
   HyScanAntennaPosition                position;
@@ -48,9 +54,36 @@ typedef struct
   HyScanSonarControlServer            *sonar;
 } ServerInfo;
 
+/* Строка, переданная на сжатие импульсов. Данные строки равны data_offset + k,
+ * образ сигнала равен (image_offset + k) * (1 - i), где k - индекс точки. */
+typedef struct
+{
+  gint64                               time;
+  gdouble                              data_offset;
+  gdouble                              image_offset;
+} CompressedRow;
+
 PortInfo                               ports[SENSOR_N_PORTS];
 SourceInfo                             sources[SONAR_N_SOURCES];
 
+/* Последние "сырые" данные источников и число строк, полученных в сигналах
+ * обработанных данных. */
+gfloat                                 raw_values[SONAR_N_SOURCES][DATA_N_POINTS];
+guint                                  n_raw_float[SONAR_N_SOURCES];
+guint                                  n_corrected[SONAR_N_SOURCES];
+
+/* Строки, ожидающие сжатия импульсов, и текущие образы сигналов источников. */
+GMutex                                 compressed_lock;
+GQueue                                 compressed_rows[SONAR_N_SOURCES];
+gdouble                                image_offsets[SONAR_N_SOURCES];
+gboolean                               image_set[SONAR_N_SOURCES];
+gboolean                               compressed_checked[SONAR_N_SOURCES];
+volatile gint                          n_compressed[SONAR_N_SOURCES];
+
+/* Число строк, полученных в сигналах предварительного просмотра. */
+volatile gint                          n_raw_preview[SONAR_N_SOURCES];
+volatile gint                          n_acoustic_preview[SONAR_N_SOURCES];
+
 /* Функция возвращает тип источника данных по его индексу. */
 HyScanSourceType
 select_source_by_index (guint index)
@@ -73,6 +106,21 @@ select_source_by_index (guint index)
   return HYSCAN_SOURCE_INVALID;
 }
 
+/* Функция возвращает индекс источника данных. */
+guint
+select_index_by_source (HyScanSourceType source)
+{
+  guint i;
+
+  for (i = 0; i < SONAR_N_SOURCES; i++)
+    if (select_source_by_index (i) == source)
+      return i;
+
+  g_error ("unknown source %d", source);
+
+  return 0;
+}
+
 /* Функция возвращает информацию об источнике данных по его индексу. */
 SourceInfo *
 source_info_by_index (guint index)
@@ -234,6 +282,305 @@ sonar_ping_cb (ServerInfo *server)
   return TRUE;
 }
 
+/* Обработчик сигнала "raw-data". Сохраняет данные для проверки обработанных данных. */
+void
+raw_data_cb (HyScanSonarControl   *control,
+             HyScanSourceType      source,
+             guint                 channel,
+             HyScanRawDataInfo    *info,
+             HyScanDataWriterData *data)
+{
+  guint index = select_index_by_source (source);
+
+  if ((channel != 1) || (info->data.type != HYSCAN_DATA_FLOAT) ||
+      (data->size != DATA_N_POINTS * sizeof (gfloat)))
+    {
+      g_error ("raw-data: %s data error", hyscan_channel_get_name_by_types (source, TRUE, 1));
+    }
+
+  memcpy (raw_values[index], data->data, data->size);
+
+  /* Строка сжимается с образом сигнала, действующим на момент её приёма. */
+  g_mutex_lock (&compressed_lock);
+  if (image_set[index])
+    {
+      CompressedRow *row = g_new (CompressedRow, 1);
+
+      row->time = data->time;
+      row->data_offset = raw_values[index][0];
+      row->image_offset = image_offsets[index];
+      g_queue_push_tail (&compressed_rows[index], row);
+    }
+  g_mutex_unlock (&compressed_lock);
+}
+
+/* Обработчик сигнала "raw-data-float". Данные в формате с плавающей точкой
+ * передаются без изменений. */
+void
+raw_data_float_cb (HyScanSonarControl   *control,
+                   HyScanSourceType      source,
+                   guint                 channel,
+                   HyScanRawDataInfo    *info,
+                   HyScanDataWriterData *data)
+{
+  guint index = select_index_by_source (source);
+
+  if ((channel != 1) || (info->data.type != HYSCAN_DATA_FLOAT) ||
+      (data->size != DATA_N_POINTS * sizeof (gfloat)) ||
+      (memcmp (data->data, raw_values[index], data->size) != 0))
+    {
+      g_error ("raw-data-float: %s data error", hyscan_channel_get_name_by_types (source, TRUE, 1));
+    }
+
+  n_raw_float[index] += 1;
+}
+
+/* Обработчик сигнала "corrected-data". Коэффициенты усиления ВАРУ равны j + k + n_track дБ,
+ * где j - индекс источника, k - индекс коэффициента, n_track - номер галса, в котором они
+ * установлены. Частота следования коэффициентов совпадает с частотой дискретизации данных,
+ * за последним коэффициентом используется его значение. */
+void
+corrected_data_cb (HyScanSonarControl   *control,
+                   HyScanSourceType      source,
+                   guint                 channel,
+                   HyScanRawDataInfo    *info,
+                   HyScanDataWriterData *data)
+{
+  guint index = select_index_by_source (source);
+  const gfloat *values = data->data;
+  gdouble gain0;
+  guint k;
+
+  if ((channel != 1) || (info->data.type != HYSCAN_DATA_FLOAT) ||
+      (data->size != DATA_N_POINTS * sizeof (gfloat)))
+    {
+      g_error ("corrected-data: %s data error", hyscan_channel_get_name_by_types (source, TRUE, 1));
+    }
+
+  /* По умолчанию усиление ВАРУ компенсируется. */
+  gain0 = 20.0 * log10 (raw_values[index][1] / values[1]) - 1.0;
+  if ((gain0 < index - 1e-3) || (gain0 > index + N_TESTS) ||
+      (fabs (gain0 - index - floor (gain0 - index + 0.5)) > 1e-3))
+    g_error ("corrected-data: %s gain error", hyscan_channel_get_name_by_types (source, TRUE, 1));
+
+  for (k = 1; k < DATA_N_POINTS; k++)
+    {
+      gdouble gain = 20.0 * log10 (raw_values[index][k] / values[k]);
+
+      if (fabs (gain - gain0 - MIN (k, TVG_N_GAINS - 1)) > 1e-3)
+        g_error ("corrected-data: %s data error at %d", hyscan_channel_get_name_by_types (source, TRUE, 1), k);
+    }
+
+  n_corrected[index] += 1;
+}
+
+/* Обработчик сигнала "signal-image". Запоминает образ сигнала источника. */
+void
+signal_image_cb (HyScanSonarControl     *control,
+                 HyScanSourceType        source,
+                 HyScanDataWriterSignal *signal)
+{
+  guint index = select_index_by_source (source);
+
+  if ((signal->n_points != SIGNAL_N_POINTS) ||
+      (signal->points[0].im != -signal->points[0].re))
+    {
+      g_error ("signal-image: %s signal error", hyscan_channel_get_name_by_types (source, TRUE, 1));
+    }
+
+  g_mutex_lock (&compressed_lock);
+  image_offsets[index] = signal->points[0].re;
+  image_set[index] = TRUE;
+  g_mutex_unlock (&compressed_lock);
+}
+
+/* Функция сравнивает сжатую строку со свёрткой данных с сопряжённым образом сигнала:
+ * out[n] = sum (data[n + m] * conj (image[m])). Масштаб свёртки определяется методом
+ * наименьших квадратов, сравниваются точки, для которых образ целиком перекрывается
+ * с данными. */
+void
+compressed_check (const gchar              *name,
+                  const CompressedRow      *row,
+                  const HyScanComplexFloat *points)
+{
+  gdouble *ref;
+  gdouble norm = 0.0;
+  gdouble scale_re = 0.0;
+  gdouble scale_im = 0.0;
+  gdouble max_ref = 0.0;
+  gdouble scale;
+  guint n_ref = DATA_N_POINTS - SIGNAL_N_POINTS + 1;
+  guint n, m;
+
+  /* Образ сигнала равен (image_offset + m) * (1 - i), поэтому свёртка равна
+   * (1 + i) * sum ((data_offset + n + m) * (image_offset + m)). */
+  ref = g_new (gdouble, n_ref);
+  for (n = 0; n < n_ref; n++)
+    {
+      ref[n] = 0.0;
+      for (m = 0; m < SIGNAL_N_POINTS; m++)
+        ref[n] += (row->data_offset + n + m) * (row->image_offset + m);
+
+      /* scale = sum (out * conj (ref)) / sum (|ref| ^ 2). */
+      scale_re += (points[n].re + points[n].im) * ref[n];
+      scale_im += (points[n].im - points[n].re) * ref[n];
+      norm += 2.0 * ref[n] * ref[n];
+      max_ref = MAX (max_ref, fabs (ref[n]));
+    }
+
+  scale_re /= norm;
+  scale_im /= norm;
+  scale = sqrt (scale_re * scale_re + scale_im * scale_im);
+
+  if (scale < FLOAT_EPSILON)
+    g_error ("compressed-data: %s zero data", name);
+
+  for (n = 0; n < n_ref; n++)
+    {
+      gdouble re = (scale_re - scale_im) * ref[n];
+      gdouble im = (scale_re + scale_im) * ref[n];
+
+      if (hypot (points[n].re - re, points[n].im - im) > COMPRESSED_EPSILON * scale * max_ref)
+        g_error ("compressed-data: %s data error at %d", name, n);
+    }
+
+  g_free (ref);
+}
+
+/* Обработчик сигнала "compressed-data". Вызывается из потоков сжатия импульсов.
+ * Строки одного канала обрабатываются по порядку, часть строк может быть
+ * отброшена. Первая сжатая строка каждого источника сравнивается со свёрткой. */
+void
+compressed_data_cb (HyScanSonarControl   *control,
+                    HyScanSourceType      source,
+                    guint                 channel,
+                    HyScanRawDataInfo    *info,
+                    HyScanDataWriterData *data)
+{
+  guint index = select_index_by_source (source);
+  const gchar *name = hyscan_channel_get_name_by_types (source, TRUE, 1);
+  const HyScanComplexFloat *points = data->data;
+  CompressedRow *row;
+
+  if ((channel != 1) || (info->data.type != HYSCAN_DATA_COMPLEX_FLOAT) ||
+      (data->size != DATA_N_POINTS * sizeof (HyScanComplexFloat)) ||
+      (data->time < 1000) || (data->time > 1000 * N_TESTS))
+    {
+      g_error ("compressed-data: %s data error", name);
+    }
+
+  /* Пропускаем отброшенные строки. */
+  g_mutex_lock (&compressed_lock);
+  while ((row = g_queue_pop_head (&compressed_rows[index])) != NULL)
+    {
+      if (row->time == data->time)
+        break;
+
+      g_free (row);
+    }
+  g_mutex_unlock (&compressed_lock);
+
+  if (row == NULL)
+    g_error ("compressed-data: %s unknown row", name);
+
+  if (!compressed_checked[index])
+    {
+      compressed_check (name, row, points);
+      compressed_checked[index] = TRUE;
+    }
+
+  g_free (row);
+
+  g_atomic_int_inc (&n_compressed[index]);
+}
+
+/* Функция проверяет предварительный просмотр строки. Данные строки равны
+ * n_ping + j + k + n_track, где n_ping - номер строки в галсе, j - индекс
+ * источника, k - индекс точки. */
+void
+preview_check (const gchar               *name,
+               guint                      index,
+               gdouble                    rate,
+               HyScanSonarControlPreview *preview)
+{
+  guint points_per_bin = DATA_N_POINTS / PREVIEW_WIDTH;
+  guint n_ping = preview->time / 1000 - 1;
+  gdouble offset;
+  gdouble sum = 0.0;
+  guint k;
+
+  if ((preview->time < 1000) || (preview->time > 1000 * N_TESTS) ||
+      (preview->rate != rate) ||
+      (preview->n_points != DATA_N_POINTS) ||
+      (preview->width != PREVIEW_WIDTH) ||
+      (preview->n_saturated != 0))
+    {
+      g_error ("%s: preview error", name);
+    }
+
+  /* Номер галса определяется по первому значению строки. */
+  offset = preview->min[0];
+  if ((offset < n_ping + index) || (offset > n_ping + index + N_TESTS) ||
+      (offset != floor (offset)))
+    {
+      g_error ("%s: preview data error", name);
+    }
+
+  for (k = 0; k < PREVIEW_WIDTH; k++)
+    {
+      gdouble min = offset + k * points_per_bin;
+      gdouble max = min + points_per_bin - 1;
+      gdouble mean = (min + max) / 2.0;
+
+      if ((preview->min[k] != min) || (preview->max[k] != max) ||
+          (fabs (preview->mean[k] - mean) > FLOAT_EPSILON * mean))
+        {
+          g_error ("%s: preview envelope error at %d", name, k);
+        }
+    }
+
+  for (k = 0; k < DATA_N_POINTS; k++)
+    sum += (offset + k) * (offset + k);
+
+  if ((preview->peak != offset + DATA_N_POINTS - 1) ||
+      (fabs (preview->rms - sqrt (sum / DATA_N_POINTS)) > FLOAT_EPSILON * preview->rms))
+    {
+      g_error ("%s: preview statistics error", name);
+    }
+}
+
+/* Обработчик сигнала "raw-preview". Вызывается из потоков предварительного просмотра. */
+void
+raw_preview_cb (HyScanSonarControl        *control,
+                HyScanSourceType           source,
+                guint                      channel,
+                HyScanSonarControlPreview *preview)
+{
+  guint index = select_index_by_source (source);
+  const gchar *name = hyscan_channel_get_name_by_types (source, TRUE, 1);
+
+  if (channel != 1)
+    g_error ("raw-preview: %s channel error", name);
+
+  preview_check (name, index, source_info_by_index (index)->raw_info.data.rate, preview);
+
+  g_atomic_int_inc (&n_raw_preview[index]);
+}
+
+/* Обработчик сигнала "acoustic-preview". Вызывается из потоков предварительного просмотра. */
+void
+acoustic_preview_cb (HyScanSonarControl        *control,
+                     HyScanSourceType           source,
+                     HyScanSonarControlPreview *preview)
+{
+  guint index = select_index_by_source (source);
+  const gchar *name = hyscan_channel_get_name_by_types (source, FALSE, 1);
+
+  preview_check (name, index, source_info_by_index (index)->acoustic_info.data.rate, preview);
+
+  g_atomic_int_inc (&n_acoustic_preview[index]);
+}
+
 /* Функция проверяет управление гидролокатором. */
 void
 generate_data (HyScanSonarControl *control,
@@ -786,6 +1133,242 @@ check_data (HyScanDB *db,
   g_free (buffer);
 }
 
+/* Функция проверяет сигналы с обработанными данными. */
+void
+check_processed_data (void)
+{
+  gint64 end_time;
+  guint i;
+
+  /* Сжатие импульсов и предварительный просмотр выполняются в пуле потоков. */
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  for (i = 0; i < SONAR_N_SOURCES; i++)
+    {
+      while (((g_atomic_int_get (&n_compressed[i]) == 0) ||
+              (g_atomic_int_get (&n_raw_preview[i]) == 0) ||
+              (g_atomic_int_get (&n_acoustic_preview[i]) == 0)) &&
+             (g_get_monotonic_time () < end_time))
+        {
+          g_usleep (10000);
+        }
+    }
+
+  for (i = 0; i < SONAR_N_SOURCES; i++)
+    {
+      const gchar *name = hyscan_channel_get_name_by_types (select_source_by_index (i), TRUE, 1);
+
+      if (n_raw_float[i] != N_TESTS * N_TESTS)
+        g_error ("%s: raw-data-float signals error", name);
+
+      /* Коэффициенты ВАРУ устанавливаются начиная с галса номер 1. */
+      if (n_corrected[i] == 0)
+        g_error ("%s: no corrected-data signals", name);
+
+      if (g_atomic_int_get (&n_compressed[i]) == 0)
+        g_error ("%s: no compressed-data signals", name);
+
+      if (g_atomic_int_get (&n_raw_preview[i]) == 0)
+        g_error ("%s: no raw-preview signals", name);
+
+      if (g_atomic_int_get (&n_acoustic_preview[i]) == 0)
+        g_error ("%s: no acoustic-preview signals", name);
+    }
+}
+
+/* Функция проверяет историю строк. В истории каждого канала содержатся строки
+ * последнего галса с номерами n_track * N_TESTS + i. */
+void
+check_history (HyScanSonarControl *control)
+{
+  guint64 first, last;
+  guint64 index;
+  guint i, k;
+
+  if (hyscan_sonar_control_set_history (control, HISTORY_N_PINGS))
+    g_error ("history enabled twice");
+
+  for (i = 0; i < SONAR_N_SOURCES; i++)
+    {
+      HyScanSourceType source = select_source_by_index (i);
+      const gchar *name = hyscan_channel_get_name_by_types (source, TRUE, 1);
+      guint64 n;
+
+      /* Самая старая ячейка истории может замещаться и не учитывается. */
+      if (!hyscan_sonar_control_history_get_range (control, source, 1, &first, &last) ||
+          (last != N_TESTS * N_TESTS - 1) ||
+          (last - first != HISTORY_N_PINGS - 2))
+        {
+          g_error ("%s: history range error", name);
+        }
+
+      if (hyscan_sonar_control_history_get_range (control, source, 2, NULL, NULL))
+        g_error ("%s: history for unknown channel", name);
+
+      /* Данные строк. */
+      for (n = first; n <= last; n++)
+        {
+          HyScanRawDataInfo info;
+          GBytes *data;
+          const gfloat *values;
+          gsize size;
+          gint64 time;
+
+          guint n_track = n / N_TESTS;
+          guint n_ping = n % N_TESTS;
+
+          data = hyscan_sonar_control_history_get (control, source, 1, n, &time, &info);
+          if (data == NULL)
+            g_error ("%s: can't get history data %" G_GUINT64_FORMAT, name, n);
+
+          values = g_bytes_get_data (data, &size);
+          if ((time != 1000 * (n_ping + 1)) ||
+              (info.data.type != HYSCAN_DATA_FLOAT) ||
+              (size != DATA_N_POINTS * sizeof (gfloat)))
+            {
+              g_error ("%s: history data %" G_GUINT64_FORMAT " error", name, n);
+            }
+
+          for (k = 0; k < DATA_N_POINTS; k++)
+            {
+              gfloat ref_value = n_ping + i + k + n_track;
+              if (values[k] != ref_value)
+                g_error ("%s: history data %" G_GUINT64_FORMAT " error", name, n);
+            }
+
+          g_bytes_unref (data);
+        }
+
+      if ((hyscan_sonar_control_history_get (control, source, 1, first - 1, NULL, NULL) != NULL) ||
+          (hyscan_sonar_control_history_get (control, source, 1, last + 1, NULL, NULL) != NULL))
+        {
+          g_error ("%s: history get out of range", name);
+        }
+
+      /* Поиск строк по времени приёма. */
+      for (n = first; n <= last; n++)
+        {
+          gint64 time = 1000 * (n % N_TESTS + 1);
+
+          if (!hyscan_sonar_control_history_find (control, source, 1, time, &index) || (index != n))
+            g_error ("%s: history find %" G_GUINT64_FORMAT " error", name, n);
+
+          if (!hyscan_sonar_control_history_find (control, source, 1, time + 500, &index) || (index != n))
+            g_error ("%s: history find %" G_GUINT64_FORMAT " error", name, n);
+        }
+
+      if (hyscan_sonar_control_history_find (control, source, 1, 1000 * (first % N_TESTS + 1) - 1, &index))
+        g_error ("%s: history find before first error", name);
+
+      if (!hyscan_sonar_control_history_find (control, source, 1, G_MAXINT64, &index) || (index != last))
+        g_error ("%s: history find after last error", name);
+    }
+}
+
+/* Функция проверяет очередь записи данных. Данные первого зондирования отбрасываются
+ * при переполнении очереди, данные второго записываются через очередь, а третьего -
+ * без очереди. Данные второго и третьего зондирования должны быть записаны по порядку. */
+void
+check_write_queue (HyScanSonarControl *control,
+                   HyScanDB           *db,
+                   gint32              project_id)
+{
+  HyScanSensorControl *sensor = HYSCAN_SENSOR_CONTROL (control);
+  HyScanSensorControlWriteStats stats0, stats1, stats2, stats3;
+  gint32 track_id;
+  gfloat *values;
+  guint32 data_size;
+  guint i, j, k;
+
+  if (!hyscan_sonar_control_start (control, "queue-track", HYSCAN_TRACK_SURVEY))
+    g_error ("can't start queue-track");
+
+  hyscan_sensor_control_get_write_stats (sensor, &stats0);
+
+  /* Переполнение очереди: сообщения не помещаются в очередь. */
+  hyscan_sensor_control_set_write_queue_size (sensor, 1);
+  hyscan_sonar_control_ping (control);
+  hyscan_sensor_control_get_write_stats (sensor, &stats1);
+
+  if ((stats1.n_dropped - stats0.n_dropped < N_TESTS * SONAR_N_SOURCES) ||
+      (stats1.n_written != stats0.n_written) ||
+      (stats1.n_queued != 0))
+    {
+      g_error ("write queue overflow error");
+    }
+
+  /* Запись через очередь. При отключении очереди дожидаемся записи накопленных данных. */
+  hyscan_sensor_control_set_write_queue_size (sensor, 64 * 1024 * 1024);
+  hyscan_sonar_control_ping (control);
+  hyscan_sensor_control_set_write_queue_size (sensor, 0);
+  hyscan_sensor_control_get_write_stats (sensor, &stats2);
+
+  if ((stats2.n_written - stats1.n_written != stats1.n_dropped - stats0.n_dropped) ||
+      (stats2.n_dropped != stats1.n_dropped) ||
+      (stats2.n_queued != 0) || (stats2.queue_size != 0))
+    {
+      g_error ("write queue flush error");
+    }
+
+  /* Запись без очереди. */
+  hyscan_sonar_control_ping (control);
+  hyscan_sensor_control_get_write_stats (sensor, &stats3);
+
+  if ((stats3.n_written != stats2.n_written) || (stats3.n_dropped != stats2.n_dropped))
+    g_error ("direct write error");
+
+  hyscan_sensor_control_set_write_queue_size (sensor, 64 * 1024 * 1024);
+  hyscan_sonar_control_stop (control);
+
+  /* Проверяем порядок записанных данных. */
+  track_id = hyscan_db_track_open (db, project_id, "queue-track");
+  if (track_id < 0)
+    g_error ("can't open queue-track");
+
+  values = g_new (gfloat, DATA_N_POINTS);
+
+  for (j = 0; j < SONAR_N_SOURCES; j++)
+    {
+      const gchar *channel_name = hyscan_channel_get_name_by_types (select_source_by_index (j), TRUE, 1);
+      gint32 channel_id;
+      gint64 time;
+
+      channel_id = hyscan_db_channel_open (db, track_id, channel_name);
+      if (channel_id < 0)
+        g_error ("can't open channel queue-track.%s", channel_name);
+
+      for (i = 0; i < 2 * N_TESTS; i++)
+        {
+          guint n_track = N_TESTS + 1 + i / N_TESTS;
+          guint n_ping = i % N_TESTS;
+
+          data_size = DATA_N_POINTS * sizeof (gfloat);
+          if (!hyscan_db_channel_get_data (db, channel_id, i, values, &data_size, &time) ||
+              (data_size != DATA_N_POINTS * sizeof (gfloat)) ||
+              (time != 1000 * (n_ping + 1)))
+            {
+              g_error ("queue-track.%s: can't get data", channel_name);
+            }
+
+          for (k = 0; k < DATA_N_POINTS; k++)
+            {
+              gfloat ref_value = n_ping + j + k + n_track;
+              if (values[k] != ref_value)
+                g_error ("queue-track.%s: data order error", channel_name);
+            }
+        }
+
+      data_size = DATA_N_POINTS * sizeof (gfloat);
+      if (hyscan_db_channel_get_data (db, channel_id, 2 * N_TESTS, values, &data_size, &time))
+        g_error ("queue-track.%s: dropped data written", channel_name);
+
+      hyscan_db_close (db, channel_id);
+    }
+
+  g_free (values);
+
+  hyscan_db_close (db, track_id);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -923,6 +1506,20 @@ main (int    argc,
   /* Управление гидролокатором. */
   control = hyscan_sonar_control_new (HYSCAN_PARAM (sonar), 0, 0, db);
 
+  /* Обработанные данные и история строк. */
+  g_signal_connect (control, "raw-data", G_CALLBACK (raw_data_cb), NULL);
+  g_signal_connect (control, "raw-data-float", G_CALLBACK (raw_data_float_cb), NULL);
+  g_signal_connect (control, "corrected-data", G_CALLBACK (corrected_data_cb), NULL);
+  g_signal_connect (control, "signal-image", G_CALLBACK (signal_image_cb), NULL);
+  g_signal_connect (control, "compressed-data", G_CALLBACK (compressed_data_cb), NULL);
+  g_signal_connect (control, "raw-preview", G_CALLBACK (raw_preview_cb), NULL);
+  g_signal_connect (control, "acoustic-preview", G_CALLBACK (acoustic_preview_cb), NULL);
+
+  hyscan_sonar_control_set_preview (control, PREVIEW_WIDTH, 0.0);
+
+  if (!hyscan_sonar_control_set_history (control, HISTORY_N_PINGS))
+    g_error ("can't enable history");
+
   /* Тестовый проект. */
   project_id = hyscan_db_project_create (db, PROJECT_NAME, NULL);
   if (project_id < 0)
@@ -932,10 +1529,22 @@ main (int    argc,
   g_message ("Generating data");
   generate_data (control, PROJECT_NAME);
 
+  /* Проверка обработанных данных. */
+  g_message ("Checking processed data");
+  check_processed_data ();
+
+  /* Проверка истории строк. */
+  g_message ("Checking history");
+  check_history (control);
+
   /* Проверка записанных данных. */
   g_message ("Checking data");
   check_data (db, project_id);
 
+  /* Проверка очереди записи. */
+  g_message ("Checking write queue");
+  check_write_queue (control, db, project_id);
+
   /* Освобождаем память. */
   hyscan_db_close (db, project_id);
   hyscan_db_project_remove (db, PROJECT_NAME);
@@ -4,8 +4,13 @@
 #include "hyscan-generator-control-server.h"
 #include "hyscan-tvg-control-server.h"
 #include "hyscan-sonar-control-server.h"
+#include "hyscan-sonar-server.h"
+#include "hyscan-sonar-client.h"
+#include "hyscan-sonar-receiver.h"
+#include "hyscan-sonar-rpc.h"
 #include "hyscan-control-common.h"
 
+#include <glib/gstdio.h>
 #include <libxml/parser.h>
 #include <string.h>
 #include <math.h>
@@ -22,6 +27,11 @@
 
 #define GENERATOR_N_PRESETS            32
 
+#define CLIENT_DATA_ID                 1000
+#define CLIENT_N_MESSAGES              16
+#define CLIENT_MESSAGE_SIZE            (2 * HYSCAN_SONAR_MSG_DATA_PART_SIZE + 1000)
+#define CLIENT_DATA_TIMEOUT            (5 * G_TIME_SPAN_SECOND)
+
 typedef struct
 {
   HyScanSensorPortType                 type;
@@ -130,7 +140,35 @@ typedef struct
   gint64                              *counter;
 } ServerInfo;
 
+typedef struct
+{
+  HyScanSonarClient                   *client;
+  const gchar                         *name;
+  gboolean                             set;
+} CacheThreadInfo;
+
+typedef struct
+{
+  GMainLoop                           *loop;
+  GAsyncResult                        *result;
+} AsyncInfo;
+
+typedef struct
+{
+  GMutex                               lock;
+  GPtrArray                           *messages;
+} ClientData;
+
+typedef struct
+{
+  GThread                             *thread;
+  HyScanSonarClientStage               stages[HYSCAN_SONAR_CLIENT_STAGE_READY + 1];
+  guint                                n_stages;
+  gboolean                             foreign_thread;
+} ProgressInfo;
+
 gint64                                 counter = 0;
+gint                                   response_delay = 0;
 
 GHashTable                            *ports;
 
@@ -408,6 +446,10 @@ generator_set_enable_cb (ServerInfo       *server,
 
   *server->counter += 1;
 
+  /* Задержка ответа сервера, миллисекунды. */
+  if (g_atomic_int_get (&response_delay) > 0)
+    g_usleep (g_atomic_int_get (&response_delay) * G_TIME_SPAN_MILLISECOND);
+
   return TRUE;
 }
 
@@ -1218,6 +1260,709 @@ check_sonar_control (HyScanSonarControl *control)
     }
 }
 
+/* Функция считывает значение параметра через клиента и проверяет, взято ли оно из кэша. */
+GVariant *
+client_get_value (HyScanSonarClient *client,
+                  const gchar       *name,
+                  gboolean           cached)
+{
+  const gchar *names[2];
+  GVariant *values[1];
+  guint64 hits, misses;
+  guint64 new_hits, new_misses;
+
+  names[0] = name;
+  names[1] = NULL;
+
+  hyscan_sonar_client_get_cache_stats (client, &hits, &misses);
+
+  if (!hyscan_param_get (HYSCAN_PARAM (client), names, values))
+    g_error ("cache: can't get %s", name);
+
+  hyscan_sonar_client_get_cache_stats (client, &new_hits, &new_misses);
+
+  if (cached && ((new_hits != hits + 1) || (new_misses != misses)))
+    g_error ("cache: %s is not cached", name);
+
+  if (!cached && ((new_hits != hits) || (new_misses != misses + 1)))
+    g_error ("cache: %s is cached", name);
+
+  return values[0];
+}
+
+/* Функция считывает значение логического параметра через клиента. */
+gboolean
+client_get_boolean (HyScanSonarClient *client,
+                    const gchar       *name,
+                    gboolean           cached)
+{
+  GVariant *value;
+  gboolean status;
+
+  value = client_get_value (client, name, cached);
+  status = g_variant_get_boolean (value);
+  g_variant_unref (value);
+
+  return status;
+}
+
+/* Функция изменяет или считывает значение параметра в отдельном потоке. */
+gpointer
+client_cache_thread (gpointer data)
+{
+  CacheThreadInfo *info = data;
+  gboolean value;
+  guint i;
+
+  for (i = 0; i < 4 * N_TESTS; i++)
+    {
+      if (info->set)
+        {
+          if (!hyscan_param_set_boolean (HYSCAN_PARAM (info->client), info->name, (i % 2) ? TRUE : FALSE))
+            g_error ("cache: can't set %s", info->name);
+        }
+      else
+        {
+          if (!hyscan_param_get_boolean (HYSCAN_PARAM (info->client), info->name, &value))
+            g_error ("cache: can't get %s", info->name);
+        }
+    }
+
+  return NULL;
+}
+
+/* Функция проверяет кэш значений параметров клиента гидролокатора. */
+void
+check_client_cache (HyScanSonarBox *sonar)
+{
+  HyScanSonarServer *sonar_server;
+  HyScanSonarClient *client1;
+  HyScanSonarClient *client2;
+
+  CacheThreadInfo threads_info[4];
+  GThread *threads[4];
+
+  const gchar *source_name;
+  gchar *enable_name;
+  gchar *tvg_name;
+  gboolean value;
+  gboolean box_value;
+  guint i;
+
+  source_name = hyscan_channel_get_name_by_types (HYSCAN_SOURCE_SIDE_SCAN_STARBOARD, FALSE, 1);
+  enable_name = g_strdup_printf ("/sources/%s/generator/enable", source_name);
+  tvg_name = g_strdup_printf ("/sources/%s/tvg/enable", source_name);
+
+  sonar_server = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), "127.0.0.1");
+  if (!hyscan_sonar_server_start (sonar_server, HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+    g_error ("cache: can't start sonar server");
+
+  client1 = hyscan_sonar_client_new ("127.0.0.1");
+  client2 = hyscan_sonar_client_new ("127.0.0.1");
+  if ((client1 == NULL) || (client2 == NULL))
+    g_error ("cache: can't connect to sonar server");
+
+  /* Значение параметра только для чтения считывается с сервера один раз. */
+  g_variant_unref (client_get_value (client1, "/schema/id", FALSE));
+  g_variant_unref (client_get_value (client1, "/schema/id", TRUE));
+
+  /* Значения изменяемых параметров не кэшируются. */
+  client_get_boolean (client1, enable_name, FALSE);
+  client_get_boolean (client1, enable_name, FALSE);
+
+  if (!hyscan_param_set_boolean (HYSCAN_PARAM (client1), enable_name, TRUE))
+    g_error ("cache: can't set %s", enable_name);
+  if (!client_get_boolean (client1, enable_name, FALSE))
+    g_error ("cache: %s value mismatch", enable_name);
+
+  /* Изменение параметров другим клиентом сразу видно при чтении. */
+  if (!hyscan_param_set_boolean (HYSCAN_PARAM (client2), enable_name, FALSE))
+    g_error ("cache: can't set %s", enable_name);
+  if (!hyscan_param_set_boolean (HYSCAN_PARAM (client2), tvg_name, TRUE))
+    g_error ("cache: can't set %s", tvg_name);
+
+  if (client_get_boolean (client1, enable_name, FALSE))
+    g_error ("cache: %s stale value", enable_name);
+  if (!client_get_boolean (client1, tvg_name, FALSE))
+    g_error ("cache: %s stale value", tvg_name);
+  g_variant_unref (client_get_value (client1, "/schema/id", TRUE));
+
+  /* Клиент одновременно изменяет и считывает значения параметров из нескольких
+   * потоков. После завершения потоков считанные значения должны совпадать со
+   * значениями гидролокатора. */
+  threads_info[0].client = client1;
+  threads_info[0].name = enable_name;
+  threads_info[0].set = TRUE;
+  threads_info[1].client = client1;
+  threads_info[1].name = tvg_name;
+  threads_info[1].set = TRUE;
+  threads_info[2].client = client1;
+  threads_info[2].name = enable_name;
+  threads_info[2].set = FALSE;
+  threads_info[3].client = client1;
+  threads_info[3].name = tvg_name;
+  threads_info[3].set = FALSE;
+
+  for (i = 0; i < 4; i++)
+    threads[i] = g_thread_new ("cache", client_cache_thread, &threads_info[i]);
+  for (i = 0; i < 4; i++)
+    g_thread_join (threads[i]);
+
+  for (i = 0; i < 2; i++)
+    {
+      const gchar *name = threads_info[i].name;
+
+      if (!hyscan_param_get_boolean (HYSCAN_PARAM (client1), name, &value) ||
+          !hyscan_param_get_boolean (HYSCAN_PARAM (sonar), name, &box_value) ||
+          (value != box_value))
+        {
+          g_error ("cache: %s stale value", name);
+        }
+    }
+
+  g_object_unref (client1);
+  g_object_unref (client2);
+  g_object_unref (sonar_server);
+
+  g_free (enable_name);
+  g_free (tvg_name);
+}
+
+/* Функция запоминает результат асинхронного запроса клиента. */
+void
+client_async_cb (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      data)
+{
+  AsyncInfo *info = data;
+
+  info->result = g_object_ref (result);
+  g_main_loop_quit (info->loop);
+}
+
+/* Функция проверяет время ожидания асинхронных запросов клиента гидролокатора. */
+void
+check_client_timeout (HyScanSonarBox *sonar)
+{
+  HyScanSonarServer *sonar_server;
+  HyScanSonarClient *client;
+
+  const gchar *names[2];
+  GVariant *values[1];
+  GError *error = NULL;
+  AsyncInfo info;
+
+  const gchar *source_name;
+  gchar *enable_name;
+  gint64 start_time;
+  gdouble elapsed;
+  gboolean value;
+
+  source_name = hyscan_channel_get_name_by_types (HYSCAN_SOURCE_SIDE_SCAN_STARBOARD, FALSE, 1);
+  enable_name = g_strdup_printf ("/sources/%s/generator/enable", source_name);
+
+  sonar_server = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), "127.0.0.1");
+  if (!hyscan_sonar_server_start (sonar_server, HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+    g_error ("timeout: can't start sonar server");
+
+  client = hyscan_sonar_client_new ("127.0.0.1");
+  if (client == NULL)
+    g_error ("timeout: can't connect to sonar server");
+
+  /* Сервер отвечает через секунду, что меньше времени ожидания ответа RPC сессии,
+   * но больше времени ожидания запроса. Запрос должен завершиться по своему
+   * времени ожидания, не дожидаясь ответа сервера. */
+  info.loop = g_main_loop_new (NULL, FALSE);
+  info.result = NULL;
+
+  names[0] = enable_name;
+  names[1] = NULL;
+  values[0] = g_variant_new_boolean (TRUE);
+
+  g_atomic_int_set (&response_delay, 1000);
+  start_time = g_get_monotonic_time ();
+
+  hyscan_sonar_client_set_async (client, names, values, 0.2, NULL, client_async_cb, &info);
+  g_main_loop_run (info.loop);
+
+  elapsed = (gdouble)(g_get_monotonic_time () - start_time) / G_TIME_SPAN_SECOND;
+  g_atomic_int_set (&response_delay, 0);
+
+  if (hyscan_sonar_client_set_finish (client, info.result, &error))
+    g_error ("timeout: request completed after %.3fs", elapsed);
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+    g_error ("timeout: unexpected error %s", error->message);
+  if (elapsed > 0.6)
+    g_error ("timeout: request completed after %.3fs", elapsed);
+
+  g_clear_error (&error);
+  g_object_unref (info.result);
+  g_main_loop_unref (info.loop);
+
+  /* После ответа сервера на прерванную попытку клиент продолжает работать. */
+  if (!hyscan_param_get_boolean (HYSCAN_PARAM (client), enable_name, &value) || !value)
+    g_error ("timeout: %s value mismatch", enable_name);
+
+  g_object_unref (client);
+  g_object_unref (sonar_server);
+
+  g_free (enable_name);
+}
+
+/* Функция отправляет сообщения клиентам гидролокатора. */
+void
+client_data_send (HyScanSonarBox *sonar,
+                  guint           n_messages)
+{
+  HyScanSonarMessage message;
+  guint8 *data;
+  guint i, j;
+
+  data = g_malloc (CLIENT_MESSAGE_SIZE);
+
+  for (i = 0; i < n_messages; i++)
+    {
+      for (j = 0; j < CLIENT_MESSAGE_SIZE; j++)
+        data[j] = (i + j) & 0xff;
+
+      memset (&message, 0, sizeof (message));
+      message.time = i;
+      message.id = CLIENT_DATA_ID;
+      message.type = HYSCAN_DATA_ADC_16LE;
+      message.rate = 1.0;
+      message.size = CLIENT_MESSAGE_SIZE;
+      message.data = data;
+
+      hyscan_sonar_box_send (sonar, &message);
+
+      /* Сообщения отправляются с паузой, чтобы не переполнить буфер сокета клиента. */
+      g_usleep (10000);
+    }
+
+  g_free (data);
+}
+
+/* Функция проверяет сообщение, отправленное функцией client_data_send. */
+gboolean
+client_data_check (HyScanSonarMessage *message,
+                   guint               n)
+{
+  const guint8 *data = message->data;
+  guint j;
+
+  if ((message->id != CLIENT_DATA_ID) ||
+      (message->time != n) ||
+      (message->size != CLIENT_MESSAGE_SIZE) ||
+      (message->n_parts != 0))
+    {
+      return FALSE;
+    }
+
+  for (j = 0; j < CLIENT_MESSAGE_SIZE; j++)
+    if (data[j] != ((n + j) & 0xff))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Обработчик сигнала "data" клиента гидролокатора. Сохраняет ссылки на сообщения. */
+void
+client_data_cb (HyScanSonarClient  *client,
+                HyScanSonarMessage *message,
+                ClientData         *data)
+{
+  if (message->id != CLIENT_DATA_ID)
+    return;
+
+  g_mutex_lock (&data->lock);
+  g_ptr_array_add (data->messages, hyscan_sonar_client_message_ref (message));
+  g_mutex_unlock (&data->lock);
+}
+
+/* Функция ожидает доставки заданного числа сообщений. */
+guint
+client_data_wait (ClientData *data,
+                  guint       n_messages)
+{
+  gint64 end_time = g_get_monotonic_time () + CLIENT_DATA_TIMEOUT;
+  guint n_received;
+
+  do
+    {
+      g_mutex_lock (&data->lock);
+      n_received = data->messages->len;
+      g_mutex_unlock (&data->lock);
+
+      if (n_received >= n_messages)
+        break;
+
+      g_usleep (10000);
+    }
+  while (g_get_monotonic_time () < end_time);
+
+  return n_received;
+}
+
+/* Функция инициализирует список принятых сообщений. */
+void
+client_data_init (ClientData *data)
+{
+  g_mutex_init (&data->lock);
+  data->messages = g_ptr_array_new_with_free_func ((GDestroyNotify)hyscan_sonar_client_message_unref);
+}
+
+/* Функция освобождает список принятых сообщений. */
+void
+client_data_clear (ClientData *data)
+{
+  g_ptr_array_unref (data->messages);
+  g_mutex_clear (&data->lock);
+}
+
+/* Функция проверяет запись принятых клиентом пакетов и её воспроизведение. */
+void
+check_client_capture (HyScanSonarBox *sonar)
+{
+  HyScanSonarServer *sonar_server;
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  HyScanSonarClientStats replay_stats;
+  ClientData data;
+  gchar *path;
+  gint64 end_time;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("sonar-capture-XXXXXX", &path, NULL);
+  if (fd < 0)
+    g_error ("capture: can't create capture file");
+  g_close (fd, NULL);
+
+  sonar_server = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), "127.0.0.1");
+  if (!hyscan_sonar_server_start (sonar_server, HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+    g_error ("capture: can't start sonar server");
+
+  client = hyscan_sonar_client_new ("127.0.0.1");
+  if (client == NULL)
+    g_error ("capture: can't connect to sonar server");
+  if (!hyscan_sonar_client_set_master (client))
+    g_error ("capture: can't set master connection");
+
+  client_data_init (&data);
+  g_signal_connect (client, "data", G_CALLBACK (client_data_cb), &data);
+
+  /* Записываем принятые пакеты. */
+  if (!hyscan_sonar_client_start_capture (client, path))
+    g_error ("capture: can't start capture");
+
+  client_data_send (sonar, CLIENT_N_MESSAGES);
+  if (client_data_wait (&data, CLIENT_N_MESSAGES) != CLIENT_N_MESSAGES)
+    g_error ("capture: messages not delivered");
+
+  hyscan_sonar_client_stop_capture (client);
+
+  for (i = 0; i < CLIENT_N_MESSAGES; i++)
+    if (!client_data_check (g_ptr_array_index (data.messages, i), i))
+      g_error ("capture: message %d error", i);
+
+  if (!hyscan_sonar_client_get_stats (client, CLIENT_DATA_ID, &stats))
+    g_error ("capture: no stats");
+
+  g_object_unref (client);
+  g_object_unref (sonar_server);
+  client_data_clear (&data);
+
+  /* При воспроизведении записи клиент принимает те же пакеты. */
+  client = hyscan_sonar_client_new_replay (path, 0.0, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS, 1);
+  if (client == NULL)
+    g_error ("capture: can't create replay client");
+
+  end_time = g_get_monotonic_time () + CLIENT_DATA_TIMEOUT;
+  while (!hyscan_sonar_client_replay_done (client))
+    {
+      if (g_get_monotonic_time () > end_time)
+        g_error ("capture: replay not finished");
+
+      g_usleep (10000);
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, CLIENT_DATA_ID, &replay_stats))
+    g_error ("capture: no replay stats");
+
+  if ((replay_stats.n_packets != stats.n_packets) ||
+      (replay_stats.n_bytes != stats.n_bytes) ||
+      (replay_stats.n_bytes != (guint64)CLIENT_MESSAGE_SIZE * CLIENT_N_MESSAGES) ||
+      (replay_stats.n_lost != 0) ||
+      (replay_stats.n_incomplete != 0))
+    {
+      g_error ("capture: replay stats mismatch");
+    }
+
+  g_object_unref (client);
+
+  g_unlink (path);
+  g_free (path);
+}
+
+/* Функция уведомления о ходе асинхронного подключения клиента гидролокатора. */
+void
+client_progress_cb (HyScanSonarClientStage  stage,
+                    ProgressInfo           *info)
+{
+  if (g_thread_self () != info->thread)
+    info->foreign_thread = TRUE;
+
+  if (info->n_stages < G_N_ELEMENTS (info->stages))
+    info->stages[info->n_stages] = stage;
+
+  info->n_stages += 1;
+}
+
+/* Функция подсчитывает итерации цикла обработки событий. */
+gboolean
+client_tick_cb (guint *ticks)
+{
+  *ticks += 1;
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Функция асинхронно подключается к гидролокатору и возвращает клиента или NULL. */
+HyScanSonarClient *
+client_new_async (ProgressInfo  *progress,
+                  GCancellable  *cancellable,
+                  guint         *ticks,
+                  GError       **error)
+{
+  HyScanSonarClient *client;
+  AsyncInfo info;
+  guint tick_id;
+
+  info.loop = g_main_loop_new (NULL, FALSE);
+  info.result = NULL;
+
+  progress->thread = g_thread_self ();
+  progress->n_stages = 0;
+  progress->foreign_thread = FALSE;
+
+  *ticks = 0;
+  tick_id = g_timeout_add (10, (GSourceFunc)client_tick_cb, ticks);
+
+  hyscan_sonar_client_new_async ("127.0.0.1", 0.5, 1, HYSCAN_SONAR_CLIENT_MIN_N_BUFFERS,
+                                 (HyScanSonarClientProgressFunc)client_progress_cb, progress,
+                                 cancellable, client_async_cb, &info);
+  g_main_loop_run (info.loop);
+
+  g_source_remove (tick_id);
+
+  client = hyscan_sonar_client_new_finish (info.result, error);
+
+  g_object_unref (info.result);
+  g_main_loop_unref (info.loop);
+
+  return client;
+}
+
+/* Функция проверяет асинхронное подключение клиента гидролокатора. */
+void
+check_client_async (HyScanSonarBox *sonar)
+{
+  HyScanSonarServer *sonar_server;
+  HyScanSonarClient *client;
+  GCancellable *cancellable;
+  GError *error = NULL;
+  ProgressInfo progress;
+  GVariant *value;
+  guint ticks;
+  guint i;
+
+  sonar_server = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), "127.0.0.1");
+  if (!hyscan_sonar_server_start (sonar_server, HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+    g_error ("async: can't start sonar server");
+
+  /* Этапы подключения сообщаются по порядку в потоке, вызвавшем подключение. */
+  client = client_new_async (&progress, NULL, &ticks, &error);
+  if (client == NULL)
+    g_error ("async: can't connect to sonar server: %s", error->message);
+
+  if (progress.n_stages != G_N_ELEMENTS (progress.stages))
+    g_error ("async: %d connection stages reported", progress.n_stages);
+  for (i = 0; i < progress.n_stages; i++)
+    if (progress.stages[i] != (HyScanSonarClientStage)i)
+      g_error ("async: connection stage %d out of order", i);
+  if (progress.foreign_thread)
+    g_error ("async: progress reported in foreign thread");
+
+  value = client_get_value (client, "/schema/id", FALSE);
+  g_variant_unref (value);
+
+  g_object_unref (client);
+
+  /* Отменённое подключение. */
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  client = client_new_async (&progress, cancellable, &ticks, &error);
+  if (client != NULL)
+    g_error ("async: cancelled connection completed");
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_error ("async: unexpected error %s", error->message);
+  if (progress.n_stages != 0)
+    g_error ("async: cancelled connection reported progress");
+
+  g_clear_error (&error);
+  g_object_unref (cancellable);
+
+  g_object_unref (sonar_server);
+
+  /* Подключение к отсутствующему серверу завершается ошибкой, цикл обработки
+   * событий при этом не блокируется. */
+  client = client_new_async (&progress, NULL, &ticks, &error);
+  if (client != NULL)
+    g_error ("async: connected without server");
+  if (error == NULL)
+    g_error ("async: no connection error");
+  if (progress.n_stages != 0)
+    g_error ("async: failed connection reported progress");
+  if (ticks < 2)
+    g_error ("async: main loop blocked during connection");
+
+  g_clear_error (&error);
+}
+
+/* Функция проверяет время приёма сообщений клиентом гидролокатора и статистику
+ * задержки их доставки. */
+void
+check_client_timestamps (HyScanSonarBox *sonar)
+{
+  HyScanSonarServer *sonar_server;
+  HyScanSonarClient *client;
+  HyScanSonarClientStats stats;
+  ClientData data;
+  gint64 start_time;
+  gint64 end_time;
+  gint64 prev_time;
+  guint i;
+
+  sonar_server = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), "127.0.0.1");
+  if (!hyscan_sonar_server_start (sonar_server, HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+    g_error ("timestamps: can't start sonar server");
+
+  client = hyscan_sonar_client_new ("127.0.0.1");
+  if (client == NULL)
+    g_error ("timestamps: can't connect to sonar server");
+  if (!hyscan_sonar_client_set_master (client))
+    g_error ("timestamps: can't set master connection");
+
+  client_data_init (&data);
+  g_signal_connect (client, "data", G_CALLBACK (client_data_cb), &data);
+
+  start_time = g_get_real_time ();
+  client_data_send (sonar, CLIENT_N_MESSAGES);
+  if (client_data_wait (&data, CLIENT_N_MESSAGES) != CLIENT_N_MESSAGES)
+    g_error ("timestamps: messages not delivered");
+  end_time = g_get_real_time ();
+
+  /* Время приёма лежит между отправкой и доставкой сообщений и не убывает. */
+  prev_time = start_time;
+  for (i = 0; i < CLIENT_N_MESSAGES; i++)
+    {
+      HyScanSonarMessage *message = g_ptr_array_index (data.messages, i);
+
+      if (!client_data_check (message, i))
+        g_error ("timestamps: message %d error", i);
+
+      if ((message->arrival_time < prev_time) || (message->arrival_time > end_time))
+        g_error ("timestamps: message %d arrival time error", i);
+
+      prev_time = message->arrival_time;
+    }
+
+  if (!hyscan_sonar_client_get_stats (client, CLIENT_DATA_ID, &stats))
+    g_error ("timestamps: no stats");
+
+  if ((stats.latency_median > stats.latency_p99) || (stats.latency_p99 > 1.0))
+    g_error ("timestamps: latency stats error");
+
+  g_object_unref (client);
+  g_object_unref (sonar_server);
+  client_data_clear (&data);
+}
+
+/* Функция проверяет приём данных несколькими клиентами через общий приёмник.
+ * Каждый клиент подключается к своему серверу, сервера передают одни и те же
+ * сообщения гидролокатора. */
+void
+check_client_receiver (HyScanSonarBox *sonar)
+{
+  const gchar *hosts[2] = { "127.0.0.1", "127.0.0.2" };
+
+  HyScanSonarReceiver *receiver;
+  HyScanSonarServer *sonar_servers[2];
+  HyScanSonarClient *clients[2];
+  ClientData data[2];
+  guint i, j;
+
+  receiver = hyscan_sonar_receiver_new (HYSCAN_SONAR_RECEIVER_DEFAULT_N_WORKERS);
+
+  for (i = 0; i < 2; i++)
+    {
+      sonar_servers[i] = hyscan_sonar_server_new (HYSCAN_PARAM (sonar), hosts[i]);
+      if (!hyscan_sonar_server_start (sonar_servers[i], HYSCAN_SONAR_SERVER_DEFAULT_TIMEOUT))
+        g_error ("receiver: can't start sonar server on %s", hosts[i]);
+
+      clients[i] = g_initable_new (HYSCAN_TYPE_SONAR_CLIENT, NULL, NULL,
+                                   "host", hosts[i],
+                                   "receiver", receiver,
+                                   NULL);
+      if (clients[i] == NULL)
+        g_error ("receiver: can't connect to sonar server on %s", hosts[i]);
+      if (!hyscan_sonar_client_set_master (clients[i]))
+        g_error ("receiver: can't set master connection to %s", hosts[i]);
+
+      client_data_init (&data[i]);
+      g_signal_connect (clients[i], "data", G_CALLBACK (client_data_cb), &data[i]);
+    }
+
+  /* Клиент удерживает ссылку на приёмник. */
+  g_object_unref (receiver);
+
+  /* Оба клиента принимают все сообщения. */
+  client_data_send (sonar, CLIENT_N_MESSAGES);
+
+  for (i = 0; i < 2; i++)
+    {
+      if (client_data_wait (&data[i], CLIENT_N_MESSAGES) != CLIENT_N_MESSAGES)
+        g_error ("receiver: messages not delivered to client %d", i);
+
+      for (j = 0; j < CLIENT_N_MESSAGES; j++)
+        if (!client_data_check (g_ptr_array_index (data[i].messages, j), j))
+          g_error ("receiver: client %d message %d error", i, j);
+    }
+
+  /* После удаления одного клиента другой продолжает принимать данные. */
+  g_object_unref (clients[0]);
+  g_object_unref (sonar_servers[0]);
+  g_mutex_lock (&data[1].lock);
+  g_ptr_array_set_size (data[1].messages, 0);
+  g_mutex_unlock (&data[1].lock);
+
+  client_data_send (sonar, CLIENT_N_MESSAGES);
+
+  if (client_data_wait (&data[1], CLIENT_N_MESSAGES) != CLIENT_N_MESSAGES)
+    g_error ("receiver: messages not delivered after client removal");
+
+  for (j = 0; j < CLIENT_N_MESSAGES; j++)
+    if (!client_data_check (g_ptr_array_index (data[1].messages, j), j))
+      g_error ("receiver: message %d error after client removal", j);
+
+  g_object_unref (clients[1]);
+  g_object_unref (sonar_servers[1]);
+
+  for (i = 0; i < 2; i++)
+    client_data_clear (&data[i]);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -1554,6 +2299,30 @@ main (int    argc,
   g_message ("Checking sonar control");
   check_sonar_control (HYSCAN_SONAR_CONTROL (control));
 
+  /* Проверка кэша параметров клиента гидролокатора. */
+  g_message ("Checking sonar client cache");
+  check_client_cache (sonar);
+
+  /* Проверка времени ожидания асинхронных запросов клиента гидролокатора. */
+  g_message ("Checking sonar client request timeout");
+  check_client_timeout (sonar);
+
+  /* Проверка записи и воспроизведения принятых клиентом пакетов. */
+  g_message ("Checking sonar client capture");
+  check_client_capture (sonar);
+
+  /* Проверка асинхронного подключения клиента гидролокатора. */
+  g_message ("Checking sonar client async connection");
+  check_client_async (sonar);
+
+  /* Проверка времени приёма сообщений клиентом гидролокатора. */
+  g_message ("Checking sonar client timestamps");
+  check_client_timestamps (sonar);
+
+  /* Проверка общего приёмника данных клиентов гидролокатора. */
+  g_message ("Checking sonar receiver");
+  check_client_receiver (sonar);
+
   g_message ("All done");
 
 exit: